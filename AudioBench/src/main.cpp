@@ -0,0 +1,92 @@
+/**
+ * @file main.cpp
+ * @author Imre Korf
+ * @brief Runs the audio analysis of the MAX4466 on synthetic or recorded samples on the host.
+ * @version 0.1
+ * @date 2022-03-21
+ *
+ * usage: AudioBench --tone <Hz> <dBFS> [seconds]
+ *        AudioBench --raw < samples.u16
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+
+#include "../../src/Wrappers/Sensors/MAX4466/AudioAnalyzer.h"
+
+// prints a summary as one CSV line.
+static void printSummary(uint32_t second, const AudioSummary& S){
+	printf("%u,%u,%u,%.2f,%.2f,%.2f", second, S.blocks, S.clipped, S.rms_dbfs, S.peak_dbfs, S.dba);
+	for(int b = 0; b < AUDIO_OCTAVE_BANDS; b++){
+		printf(",%.2f", S.bands[b]);
+	}
+	printf("\n");
+}
+
+int main(int argc, char** argv){
+	bool tone = argc >= 4 && !strcmp(argv[1], "--tone");
+	bool raw = argc >= 2 && !strcmp(argv[1], "--raw");
+	if(!tone && !raw){
+		fprintf(stderr, "usage: %s --tone <Hz> <dBFS> [seconds]\n       %s --raw < samples.u16\n", argv[0], argv[0]);
+		return 1;
+	}
+	// the analyzer holds its buffers inline, like the firmware it is too big for the stack of a task.
+	std::unique_ptr<AudioAnalyzer> analyzer(new AudioAnalyzer(MAX4466_SAMPLE_RATE));
+
+	printf("second,blocks,clipped,rms_dbfs,peak_dbfs,dba");
+	for(int b = 0; b < AUDIO_OCTAVE_BANDS; b++){
+		printf(",band_%g", 62.5 * (1 << b));
+	}
+	printf("\n");
+
+	uint16_t samples[AudioAnalyzer::N];
+	uint32_t second = 0;
+	uint32_t in_second = 0;
+	double process_s = 0;
+	uint64_t total = 0;
+	const double pi = 3.14159265358979323846;
+	const double freq = tone ? atof(argv[2]) : 0;
+	const double amplitude = tone ? 2047 * pow(10, atof(argv[3]) / 20) : 0;
+	const uint64_t length = tone ? (uint64_t)((argc > 4 ? atof(argv[4]) : 5) * MAX4466_SAMPLE_RATE) : 0;
+
+	for(;;){
+		size_t count = 0;
+		if(tone){
+			// a sine around the middle of the 12 bit ADC range, like the biased microphone output.
+			for(; count < AudioAnalyzer::N && total + count < length; count++){
+				double x = 2048 + amplitude * sin(2 * pi * freq * (total + count) / MAX4466_SAMPLE_RATE);
+				long v = lround(x);
+				samples[count] = (uint16_t)(v < 0 ? 0 : v > 4095 ? 4095 : v);
+			}
+		}
+		else{
+			// the samples as written by the I2S ADC, 16 bit little endian with the data in the lower 12 bits.
+			count = fread(samples, sizeof(samples[0]), AudioAnalyzer::N, stdin);
+		}
+		if(!count){break;}
+		total += count;
+
+		clock_t start = clock();
+		analyzer->pushAdc(samples, count);
+		process_s += (double)(clock() - start) / CLOCKS_PER_SEC;
+
+		in_second += count;
+		if(in_second >= MAX4466_SAMPLE_RATE){
+			in_second -= MAX4466_SAMPLE_RATE;
+			printSummary(second++, analyzer->takeSummary());
+		}
+	}
+	if(in_second >= AudioAnalyzer::N){
+		printSummary(second, analyzer->takeSummary());
+	}
+
+	double audio_s = (double)total / MAX4466_SAMPLE_RATE;
+	fprintf(stderr, "%.1f s of audio analyzed in %.3f s, %.0fx real time\n", audio_s, process_s, process_s > 0 ? audio_s / process_s : 0);
+	return 0;
+}
\ No newline at end of file
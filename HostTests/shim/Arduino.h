@@ -0,0 +1,86 @@
+/**
+ * @file Arduino.h
+ * @author Imre Korf
+ * @brief The part of the Arduino core that the firmware headers use, so the host tests can include them.
+ * @version 0.1
+ * @date 2022-04-05
+ *
+ * String keeps every non empty text on the heap, like the Arduino String of cores without a small string buffer,
+ * so a host test sees every conversion to a String as an allocation.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define HIGH 1
+#define LOW 0
+
+class String {
+private:
+	char* buffer = nullptr;
+	unsigned len = 0;
+
+	void copy(const char* s, unsigned n){
+		delete[] buffer;
+		buffer = nullptr;
+		len = n;
+		if(n){
+			buffer = new char[n + 1];
+			memcpy(buffer, s, n);
+			buffer[n] = '\0';
+		}
+	}
+	template<typename T>
+	void format(const char* f, T value){
+		char text[32];
+		int n = snprintf(text, sizeof(text), f, value);
+		copy(text, n < 0 ? 0 : (unsigned)n);
+	}
+
+public:
+	String(const char* s = ""){ copy(s, s ? strlen(s) : 0); }
+	String(const String& s){ copy(s.c_str(), s.len); }
+	String(char c){ copy(&c, 1); }
+	String(int v){ format("%d", v); }
+	String(unsigned v){ format("%u", v); }
+	String(long v){ format("%ld", v); }
+	String(unsigned long v){ format("%lu", v); }
+	String(float v, unsigned char decimals = 2){ format(decimals == 2 ? "%.2f" : "%f", (double)v); }
+	String(double v, unsigned char decimals = 2){ format(decimals == 2 ? "%.2f" : "%f", v); }
+	~String(){ delete[] buffer; }
+
+	String& operator=(const String& s){
+		if(this != &s){copy(s.c_str(), s.len);}
+		return *this;
+	}
+	String& operator+=(const String& s){
+		String joined;
+		joined.len = len + s.len;
+		if(joined.len){
+			joined.buffer = new char[joined.len + 1];
+			memcpy(joined.buffer, c_str(), len);
+			memcpy(joined.buffer + len, s.c_str(), s.len + 1);
+		}
+		return *this = joined;
+	}
+	friend String operator+(const String& a, const String& b){
+		String joined(a);
+		return joined += b;
+	}
+
+	const char* c_str() const { return buffer ? buffer : ""; }
+	unsigned length() const { return len; }
+};
+
+unsigned long millis();
+int digitalRead(uint8_t pin);
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
\ No newline at end of file
@@ -0,0 +1,35 @@
+/**
+ * @file FS.h
+ * @author Imre Korf
+ * @brief Declarations of the Arduino file system that the storage headers use, the host tests don't open files.
+ * @version 0.1
+ * @date 2022-04-05
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <Arduino.h>
+
+namespace fs {
+class File {
+public:
+	size_t read(uint8_t*, size_t){ return 0; }
+	size_t write(const uint8_t*, size_t){ return 0; }
+	bool seek(uint32_t){ return false; }
+	size_t size() const { return 0; }
+	void flush(){}
+	void close(){}
+};
+class FS {
+public:
+	bool exists(const char*){ return false; }
+	bool remove(const char*){ return false; }
+	bool rename(const char*, const char*){ return false; }
+	bool mkdir(const char*){ return false; }
+	bool rmdir(const char*){ return false; }
+};
+}
+using fs::File;
+using fs::FS;
\ No newline at end of file
@@ -0,0 +1,24 @@
+/**
+ * @file LittleFS.h
+ * @author Imre Korf
+ * @brief Declarations of the Arduino LittleFS library that the storage headers use.
+ * @version 0.1
+ * @date 2022-04-05
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include "FS.h"
+
+namespace fs {
+class LittleFSFS : public FS {
+public:
+	bool begin(bool){ return false; }
+	void end(){}
+	size_t totalBytes(){ return 0; }
+	size_t usedBytes(){ return 0; }
+};
+}
+extern fs::LittleFSFS LittleFS;
\ No newline at end of file
@@ -0,0 +1,13 @@
+/**
+ * @file RTC.h
+ * @author Imre Korf
+ * @brief Declaration of the PCF8563 RTC library class that the RTC wrapper keeps as a member.
+ * @version 0.1
+ * @date 2022-04-05
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+class PCF8563 {};
\ No newline at end of file
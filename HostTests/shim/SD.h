@@ -0,0 +1,28 @@
+/**
+ * @file SD.h
+ * @author Imre Korf
+ * @brief Declarations of the Arduino SD library that the storage headers use.
+ * @version 0.1
+ * @date 2022-04-05
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include "FS.h"
+
+typedef enum { CARD_NONE, CARD_MMC, CARD_SD, CARD_SDHC, CARD_UNKNOWN } sdcard_type_t;
+
+namespace fs {
+class SDFS : public FS {
+public:
+	void end(){}
+	sdcard_type_t cardType(){ return CARD_NONE; }
+	uint64_t cardSize(){ return 0; }
+	uint64_t totalBytes(){ return 0; }
+	uint64_t usedBytes(){ return 0; }
+};
+}
+using fs::SDFS;
+extern fs::SDFS SD;
\ No newline at end of file
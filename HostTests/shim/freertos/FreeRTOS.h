@@ -0,0 +1,22 @@
+/**
+ * @file freertos/FreeRTOS.h
+ * @author Imre Korf
+ * @brief The FreeRTOS types that the firmware headers use.
+ * @version 0.1
+ * @date 2022-04-05
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+#define pdMS_TO_TICKS(ms) (ms)
+#define pdTRUE 1
+
+typedef struct { int owner; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
\ No newline at end of file
@@ -0,0 +1,18 @@
+/**
+ * @file freertos/semphr.h
+ * @author Imre Korf
+ * @brief The FreeRTOS semaphore functions that the firmware headers use, the host tests don't take them.
+ * @version 0.1
+ * @date 2022-04-05
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include "FreeRTOS.h"
+
+typedef void* SemaphoreHandle_t;
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex();
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t, TickType_t);
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t);
\ No newline at end of file
@@ -0,0 +1,15 @@
+/**
+ * @file freertos/task.h
+ * @author Imre Korf
+ * @brief The FreeRTOS task types that the firmware headers use.
+ * @version 0.1
+ * @date 2022-04-05
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include "FreeRTOS.h"
+
+typedef void* TaskHandle_t;
\ No newline at end of file
@@ -0,0 +1,180 @@
+/**
+ * @file AudioAnalyzerTest.cpp
+ * @author Imre Korf
+ * @brief Checks the levels of the AudioAnalyzer against synthetic tones and noise of known levels.
+ * @version 0.1
+ * @date 2022-04-04
+ *
+ * usage: AudioAnalyzerTest
+ * Prints a line per check and exits with 1 when a level is outside its tolerance.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+
+#include "../../src/Wrappers/Sensors/MAX4466/AudioAnalyzer.h"
+
+static const double PI = 3.14159265358979323846;
+// one second of audio per check, a whole amount of blocks.
+static const size_t SAMPLES = MAX4466_SAMPLE_RATE / AudioAnalyzer::N * AudioAnalyzer::N;
+
+static int failures = 0;
+
+// compares a value with its expectation.
+static void check(const char* name, double value, double expected, double tolerance){
+	bool ok = fabs(value - expected) <= tolerance;
+	printf("%s %-44s %8.2f, expected %8.2f +- %.2f\n", ok ? "PASS" : "FAIL", name, value, expected, tolerance);
+	if(!ok){failures++;}
+}
+
+// checks that a value is at most the limit.
+static void checkBelow(const char* name, double value, double limit){
+	bool ok = value <= limit;
+	printf("%s %-44s %8.2f, expected <= %.2f\n", ok ? "PASS" : "FAIL", name, value, limit);
+	if(!ok){failures++;}
+}
+
+// A-weighting of IEC 61672 in dB, written out here so the check doesn't share the table of the analyzer.
+static double aWeightDb(double f){
+	double f2 = f * f;
+	double ra = 12194.0 * 12194.0 * f2 * f2 /
+		((f2 + 20.6 * 20.6) * sqrt((f2 + 107.7 * 107.7) * (f2 + 737.9 * 737.9)) * (f2 + 12194.0 * 12194.0));
+	return 20 * log10(ra) + 2.0;
+}
+
+// octave band of a frequency, as in the header of the analyzer.
+static int bandOf(double f){
+	return (int)floor(log2(f / 62.5) + 0.5);
+}
+
+// runs Q15 samples through a new analyzer.
+static AudioSummary analyze(const std::vector<int16_t>& samples){
+	std::unique_ptr<AudioAnalyzer> A(new AudioAnalyzer(MAX4466_SAMPLE_RATE));
+	A->process(samples.data(), samples.size());
+	return A->takeSummary();
+}
+
+// a sine of the given level in dBFS straight in Q15.
+static void checkTone(double freq, double dbfs){
+	std::vector<int16_t> samples(SAMPLES);
+	double amplitude = 32767 * pow(10, dbfs / 20);
+	for(size_t i = 0; i < SAMPLES; i++){
+		samples[i] = (int16_t)lround(amplitude * sin(2 * PI * freq * i / MAX4466_SAMPLE_RATE));
+	}
+	AudioSummary S = analyze(samples);
+	char name[64];
+	int band = bandOf(freq);
+	double level = dbfs + MAX4466_DB_OFFSET;
+
+	snprintf(name, sizeof(name), "%g Hz %g dBFS rms dBFS", freq, dbfs);
+	check(name, S.rms_dbfs, dbfs, 0.2);
+	snprintf(name, sizeof(name), "%g Hz %g dBFS dB(A)", freq, dbfs);
+	check(name, S.dba, level + aWeightDb(freq), 0.5);
+	snprintf(name, sizeof(name), "%g Hz %g dBFS band %d", freq, dbfs, band);
+	check(name, S.bands[band], level, 0.5);
+	// the Hann window leaks into the neighbouring bands, but a tone should be far above the other bands.
+	double others = AUDIO_DB_FLOOR;
+	for(int b = 0; b < AUDIO_OCTAVE_BANDS; b++){
+		if(b != band && S.bands[b] > others){others = S.bands[b];}
+	}
+	snprintf(name, sizeof(name), "%g Hz %g dBFS loudest other band", freq, dbfs);
+	checkBelow(name, others, level - 25);
+}
+
+// the same sine through the 12 bit ADC path, with the DC offset of the biased microphone.
+static void checkAdcTone(double freq, double dbfs){
+	std::unique_ptr<AudioAnalyzer> A(new AudioAnalyzer(MAX4466_SAMPLE_RATE));
+	std::vector<uint16_t> raw(SAMPLES);
+	double amplitude = 2047 * pow(10, dbfs / 20);
+	// the DC average needs a few blocks to settle, they are left out of the summary.
+	for(int pass = 0; pass < 2; pass++){
+		for(size_t i = 0; i < SAMPLES; i++){
+			raw[i] = (uint16_t)lround(2048 + amplitude * sin(2 * PI * freq * i / MAX4466_SAMPLE_RATE));
+		}
+		A->pushAdc(raw.data(), raw.size());
+		if(!pass){A->takeSummary();}
+	}
+	AudioSummary S = A->takeSummary();
+	char name[64];
+	snprintf(name, sizeof(name), "ADC %g Hz %g dBFS dB(A)", freq, dbfs);
+	check(name, S.dba, dbfs + MAX4466_DB_OFFSET + aWeightDb(freq), 1.0);
+}
+
+// white noise with an rms of one 12 bit ADC step, 16 in Q15.
+static void checkNoise(){
+	std::mt19937 rng(1);
+	std::normal_distribution<double> noise(0, 16);
+	std::vector<int16_t> samples(SAMPLES);
+	double ms = 0;
+	for(size_t i = 0; i < SAMPLES; i++){
+		samples[i] = (int16_t)lround(noise(rng));
+		ms += (double)samples[i] * samples[i];
+	}
+	double rms_dbfs = 10 * log10(ms / SAMPLES / (32767.0 * 32767.0 / 2));
+	// white noise spreads its power evenly up to half the sample rate, so its A-weighting is the mean of the squared gain.
+	double weight = 0;
+	const int steps = 8000;
+	for(int i = 1; i <= steps; i++){
+		weight += pow(10, aWeightDb((i - 0.5) * MAX4466_SAMPLE_RATE / 2.0 / steps) / 10);
+	}
+	double weight_db = 10 * log10(weight / steps);
+
+	AudioSummary S = analyze(samples);
+	check("noise 1 LSB rms dBFS", S.rms_dbfs, rms_dbfs, 0.2);
+	check("noise 1 LSB dB(A)", S.dba, rms_dbfs + MAX4466_DB_OFFSET + weight_db, 1.0);
+}
+
+// compares the FFT kernel with a double precision DFT of the same block.
+static void checkFft(double amplitude){
+	std::unique_ptr<AudioAnalyzer> A(new AudioAnalyzer(MAX4466_SAMPLE_RATE));
+	const size_t N = AudioAnalyzer::N;
+	std::mt19937 rng(2);
+	std::uniform_real_distribution<double> uniform(-amplitude, amplitude);
+	int16_t re[N], im[N];
+	for(size_t i = 0; i < N; i++){
+		re[i] = (int16_t)lround(uniform(rng));
+		im[i] = 0;
+	}
+	std::vector<double> ref_re(N), ref_im(N);
+	for(size_t k = 0; k < N; k++){
+		for(size_t i = 0; i < N; i++){
+			ref_re[k] += re[i] * cos(2 * PI * k * i / N) / N;
+			ref_im[k] -= re[i] * sin(2 * PI * k * i / N) / N;
+		}
+	}
+	int exponent = A->fft(re, im);
+	double signal = 0, error = 0;
+	for(size_t k = 0; k < N; k++){
+		double dr = ldexp(re[k], exponent) - ref_re[k];
+		double di = ldexp(im[k], exponent) - ref_im[k];
+		signal += ref_re[k] * ref_re[k] + ref_im[k] * ref_im[k];
+		error += dr * dr + di * di;
+	}
+	char name[64];
+	snprintf(name, sizeof(name), "FFT of +-%g, error below the signal in dB", amplitude);
+	double snr = 10 * log10(signal / error);
+	checkBelow(name, -snr, -60);
+}
+
+int main(){
+	checkFft(30000);
+	checkFft(16);
+	checkTone(1000, 0);
+	checkTone(1000, -20);
+	checkTone(1000, -40);
+	checkTone(1000, -60);
+	checkTone(1000, -70);
+	checkTone(125, -20);
+	checkTone(250, -50);
+	checkTone(4000, -40);
+	checkAdcTone(1000, -20);
+	checkAdcTone(1000, -60);
+	checkNoise();
+	printf("%d checks failed\n", failures);
+	return failures ? 1 : 0;
+}
\ No newline at end of file
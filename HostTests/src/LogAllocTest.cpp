@@ -0,0 +1,156 @@
+/**
+ * @file LogAllocTest.cpp
+ * @author Imre Korf
+ * @brief Checks that the log statements of disabled levels and outputs don't allocate, and that text is passed without a copy.
+ * @version 0.1
+ * @date 2022-04-05
+ *
+ * usage: LogAllocTest
+ * operator new and malloc are replaced by counting versions, on other C libraries than glibc only operator new is counted.
+ * The test runs the print templates of Logger.h for every log level and output with the serial limited to errors and the
+ * SD card to info, so both a disabled level and a disabled output are covered. The Logger members behind the templates are
+ * replaced below by counters, only the code that a statement compiles to at its call site is measured.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "../../src/Defines/Defines.h"
+// only errors to the serial, so for the other levels LogType::Serial is a disabled output of an enabled level.
+#undef DEBUGLEVEL
+#define DEBUGLEVEL 0
+#undef LOGLEVEL
+#define LOGLEVEL 2
+#include "../../src/Logger/Logger.h"
+
+static size_t allocations = 0;
+
+void* operator new(size_t size){
+	allocations++;
+	void* p = malloc(size ? size : 1);
+	if(!p){throw std::bad_alloc();}
+	return p;
+}
+void* operator new[](size_t size){ return operator new(size); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+
+#ifdef __GLIBC__
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* p, size_t size);
+void __libc_free(void* p);
+
+void* malloc(size_t size){ allocations++; return __libc_malloc(size); }
+void* calloc(size_t count, size_t size){ allocations++; return __libc_calloc(count, size); }
+void* realloc(void* p, size_t size){ allocations++; return __libc_realloc(p, size); }
+void free(void* p){ __libc_free(p); }
+}
+#endif
+
+// the members behind the templates, they count the statements and keep the last text.
+static size_t statements = 0;
+static char last_text[LOG_LINE_SIZE];
+
+bool Logger::checkInitialized(){ return Initialized; }
+ERR_Type Logger::init(){ return SUCCESS; }
+void Logger::printText(const LogText* parts, size_t count, LogLevel, bool, bool, bool){
+	statements++;
+	size_t n = 0;
+	for(size_t i = 0; i < count; i++){
+		size_t len = parts[i].len < sizeof(last_text) - 1 - n ? parts[i].len : sizeof(last_text) - 1 - n;
+		memcpy(last_text + n, parts[i].text(), len);
+		n += len;
+	}
+	last_text[n] = '\0';
+}
+void Logger::writeChar(char, LogLevel, bool, bool){ statements++; }
+void Logger::logRecord(LogMessage, LogLevel, bool, bool, LogEntry&, size_t){ statements++; }
+
+static int failures = 0;
+
+// compares a count with its expectation.
+static void check(const char* name, size_t value, size_t expected){
+	bool ok = value == expected;
+	printf("%s %-44s %6zu, expected %6zu\n", ok ? "PASS" : "FAIL", name, value, expected);
+	if(!ok){failures++;}
+}
+
+// checks that a value is at least the limit.
+static void checkAbove(const char* name, size_t value, size_t limit){
+	bool ok = value >= limit;
+	printf("%s %-44s %6zu, expected >= %zu\n", ok ? "PASS" : "FAIL", name, value, limit);
+	if(!ok){failures++;}
+}
+
+// runs the statements of a level and output, once with texts only and once with values that are converted to a String.
+template<LogLevel LL, LogType LT>
+static void checkStatements(const char* name){
+	static const String unit(" ppm");
+	Logger& L = Logger::getInstance();
+	const bool enabled = LogEnabled(LL, LT);
+	char label[64];
+
+	size_t before = allocations;
+	size_t counted = statements;
+	L.print<LL, LT>("CO2: ");
+	L.println<LL, LT>("value ", "of the ", unit);
+	L.write<LL, LT>('x');
+	L.log<LL, LT>(LOG_MSG_TEXT, "text");
+	size_t used = allocations - before;
+	snprintf(label, sizeof(label), "%s texts allocations", name);
+	check(label, used, 0);
+	snprintf(label, sizeof(label), "%s texts statements", name);
+	check(label, statements - counted, enabled ? 4 : 0);
+
+	before = allocations;
+	counted = statements;
+	L.println<LL, LT>("CO2: ", 412, unit, ", T: ", 21.5f, ' ', 7UL);
+	L.log<LL, LT>(LOG_MSG_SCD30, 412.0f, 21.5f, 40.0f);
+	used = allocations - before;
+	snprintf(label, sizeof(label), "%s values allocations", name);
+	if(enabled){
+		checkAbove(label, used, 1); // the numbers are converted to a String, which shows that the counter works.
+	}
+	else{
+		check(label, used, 0);
+	}
+	snprintf(label, sizeof(label), "%s values statements", name);
+	check(label, statements - counted, enabled ? 2 : 0);
+}
+
+// runs the statements of every level for an output.
+template<LogType LT>
+static void checkLevels(const char* output){
+	char name[32];
+	snprintf(name, sizeof(name), "%s Error", output);
+	checkStatements<LogLevel::Error, LT>(name);
+	snprintf(name, sizeof(name), "%s Warning", output);
+	checkStatements<LogLevel::Warning, LT>(name);
+	snprintf(name, sizeof(name), "%s Info", output);
+	checkStatements<LogLevel::Info, LT>(name);
+	snprintf(name, sizeof(name), "%s DataDump", output);
+	checkStatements<LogLevel::DataDump, LT>(name);
+	snprintf(name, sizeof(name), "%s SD_printInfo", output);
+	checkStatements<LogLevel::SD_printInfo, LT>(name);
+}
+
+int main(){
+	Logger::getInstance(); // the instance itself is not part of the measured statements.
+	checkLevels<LogType::Serial>("Serial");
+	checkLevels<LogType::SD>("SD");
+	checkLevels<LogType::Serial_SD>("Serial_SD");
+
+	statements = 0;
+	String unit(" ppm");
+	Logger::getInstance().println<LogLevel::Error>("CO2: ", 412, unit);
+	check("joined text is one statement", statements, 1);
+	check("joined text", strcmp(last_text, "CO2: 412 ppm"), 0);
+
+	printf("%d checks failed\n", failures);
+	return failures ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,154 @@
+/**
+ * @file LogBufferTest.cpp
+ * @author Imre Korf
+ * @brief Checks what the LogBuffer of the Logger writes to the log file and when.
+ * @version 0.1
+ * @date 2022-04-05
+ *
+ * usage: LogBufferTest
+ * The log file is a sink that keeps the written bytes and counts its calls. Prints a line per check and exits with 1
+ * when one fails.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <cstdio>
+#include <string>
+
+#include "../../src/Logger/LogBuffer.h"
+
+static int failures = 0;
+
+// compares a value with its expectation.
+static void check(const char* name, long value, long expected){
+	bool ok = value == expected;
+	printf("%s %-52s %8ld, expected %8ld\n", ok ? "PASS" : "FAIL", name, value, expected);
+	if(!ok){failures++;}
+}
+
+/**
+ * @brief The log file, keeps what was written.
+ */
+struct Sink {
+	std::string data;
+	/** Amount of calls. */
+	long calls = 0;
+	/** Amount of calls after which every call fails, never when negative. */
+	long fail_after = -1;
+};
+
+static ERR_Type append(const uint8_t* data, size_t len, void* context){
+	Sink* sink = (Sink*)context;
+	sink->calls++;
+	if(sink->fail_after >= 0 && sink->calls > sink->fail_after){return SD_APP_FAIL;}
+	sink->data.append((const char*)data, len);
+	return SUCCESS;
+}
+
+// a text of len characters that differs per position, so a part in the wrong order shows.
+static std::string text(size_t len, size_t offset = 0){
+	std::string s;
+	for(size_t i = 0; i < len; i++){
+		s += (char)('a' + (offset + i) % 26);
+	}
+	return s;
+}
+
+// a short line stays in the buffer until LOG_FLUSH_INTERVAL has passed, an error line is written at once.
+static void checkPolicy(){
+	LogBuffer B;
+	B.setFlushTime(0);
+	std::string line = text(40);
+	B.write(line.c_str(), line.size());
+	check("policy: short line", (long)B.due(false, 10), (long)LogFlush::None);
+	check("policy: short line after the interval", (long)B.due(false, LOG_FLUSH_INTERVAL), (long)LogFlush::All);
+	check("policy: error line", (long)B.due(true, 10), (long)LogFlush::All);
+	LogBuffer E;
+	check("policy: empty buffer after the interval", (long)E.due(false, LOG_FLUSH_INTERVAL * 2), (long)LogFlush::None);
+}
+
+// once LOG_FLUSH_SIZE is buffered only the complete chunks are written, in one call.
+static void checkChunks(){
+	LogBuffer B;
+	Sink S;
+	std::string in = text(LOG_FLUSH_SIZE * 2 + 100);
+	check("chunks: copied", B.write(in.c_str(), in.size()), in.size());
+	check("chunks: due", (long)B.due(false, 0), (long)LogFlush::Chunks);
+	check("chunks: flush result", B.flush(false, 0, append, &S), SUCCESS);
+	check("chunks: written bytes", S.data.size(), LOG_FLUSH_SIZE * 2);
+	check("chunks: sink calls", S.calls, 1);
+	check("chunks: left in the buffer", B.size(), 100);
+	B.flush(true, 0, append, &S);
+	check("chunks: written in order", S.data == in, 1);
+}
+
+// writing the chunks leaves the LOG_FLUSH_INTERVAL of the rest running, only a flush that empties the buffer restarts it.
+static void checkInterval(){
+	LogBuffer B;
+	Sink S;
+	B.setFlushTime(0);
+	std::string in = text(LOG_FLUSH_SIZE + 100);
+	B.write(in.c_str(), in.size());
+	B.flush(false, LOG_FLUSH_INTERVAL / 2, append, &S);
+	check("interval: left after the chunks", B.size(), 100);
+	check("interval: rest due after the interval", (long)B.due(false, LOG_FLUSH_INTERVAL), (long)LogFlush::All);
+	B.flush(true, LOG_FLUSH_INTERVAL, append, &S);
+	B.write(in.c_str(), 100);
+	check("interval: restarted by the empty buffer", (long)B.due(false, LOG_FLUSH_INTERVAL * 2 - 1), (long)LogFlush::None);
+	check("interval: due a whole interval later", (long)B.due(false, LOG_FLUSH_INTERVAL * 2), (long)LogFlush::All);
+}
+
+// data that wraps around the end of the buffer is written in two parts, in order.
+static void checkWrap(){
+	LogBuffer B;
+	Sink S;
+	std::string first = text(LOG_BUFFER_SIZE - 100);
+	B.write(first.c_str(), first.size());
+	B.flush(true, 0, append, &S);
+	S = Sink();
+	std::string in = text(300, 7);
+	B.write(in.c_str(), in.size());
+	B.flush(true, 0, append, &S);
+	check("wrap: sink calls", S.calls, 2);
+	check("wrap: written in order", S.data == in, 1);
+	check("wrap: empty after the flush", B.size(), 0);
+}
+
+// a full buffer copies what fits and reports it, the Logger then writes the chunks to make room.
+static void checkFull(){
+	LogBuffer B;
+	std::string in = text(LOG_BUFFER_SIZE + 50);
+	check("full: copied", B.write(in.c_str(), in.size()), LOG_BUFFER_SIZE);
+	check("full: full()", B.full(), 1);
+	Sink S;
+	B.flush(false, 0, append, &S);
+	check("full: room after writing the chunks", B.full(), 0);
+	check("full: copied after the flush", B.write(in.c_str() + LOG_BUFFER_SIZE, 50), 50);
+}
+
+// a failing log file drops the data and returns the error, so a missing SD card doesn't stall the buffer.
+static void checkFailure(){
+	LogBuffer B;
+	Sink S;
+	S.fail_after = 0;
+	std::string first = text(LOG_BUFFER_SIZE - 10);
+	B.write(first.c_str(), first.size());
+	B.flush(true, 0, nullptr, nullptr);
+	check("failure: no sink drops the data", B.size(), 0);
+	std::string in = text(100);
+	B.write(in.c_str(), in.size()); // wraps, so the flush has two parts.
+	check("failure: flush result", B.flush(true, 0, append, &S), SD_APP_FAIL);
+	check("failure: sink calls after the first failure", S.calls, 1);
+	check("failure: dropped", B.size(), 0);
+}
+
+int main(){
+	checkPolicy();
+	checkChunks();
+	checkInterval();
+	checkWrap();
+	checkFull();
+	checkFailure();
+	printf("%d checks failed\n", failures);
+	return failures ? 1 : 0;
+}
\ No newline at end of file
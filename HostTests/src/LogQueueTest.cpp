@@ -0,0 +1,142 @@
+/**
+ * @file LogQueueTest.cpp
+ * @author Imre Korf
+ * @brief Runs several producer threads and a consumer thread on a LogQueue and checks that nothing is lost or read twice.
+ * @version 0.1
+ * @date 2022-04-05
+ *
+ * usage: LogQueueTest
+ * Every producer pushes numbered statements of one to three items, the statements of more than one item as a block.
+ * The consumer checks that every item arrives at most once and in the order of its producer, that the items of a block
+ * arrive one after another and that all the items that were not read were counted as dropped by their producer.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "../../src/Logger/LogQueue.h"
+#include "../../src/Defines/Defines.h"
+
+static const uint32_t PRODUCERS = 4;
+static const uint32_t STATEMENTS = 50000;
+
+/**
+ * @brief A queued item, one part of a statement.
+ */
+struct Item {
+	uint32_t producer;
+	uint32_t statement;
+	uint32_t part;
+	uint32_t parts;
+};
+
+typedef LogQueue<Item, LOG_QUEUE_LENGTH> Queue;
+
+static int failures = 0;
+
+// compares a count with its expectation.
+static void check(const char* name, uint64_t value, uint64_t expected){
+	bool ok = value == expected;
+	printf("%s %-44s %10llu, expected %10llu\n", ok ? "PASS" : "FAIL", name, (unsigned long long)value, (unsigned long long)expected);
+	if(!ok){failures++;}
+}
+
+// a full queue refuses a block that doesn't fit as a whole, and doesn't add a part of it.
+static void checkBlockFull(){
+	Queue Q;
+	Item I = {0, 0, 0, 1};
+	for(size_t i = 0; i < LOG_QUEUE_LENGTH - 2; i++){Q.push(I);}
+	bool pushed = Q.push(3, [](Item& item, size_t i){ item = {1, 0, (uint32_t)i, 3}; });
+	check("block of 3 with 2 free slots", pushed, 0);
+	check("size after the refused block", Q.size(), LOG_QUEUE_LENGTH - 2);
+	pushed = Q.push(2, [](Item& item, size_t i){ item = {1, 1, (uint32_t)i, 2}; });
+	check("block of 2 with 2 free slots", pushed, 1);
+	check("size after the block", Q.size(), LOG_QUEUE_LENGTH);
+	check("high water", Q.highWater(), LOG_QUEUE_LENGTH);
+	Item R;
+	for(size_t i = 0; i < LOG_QUEUE_LENGTH - 2; i++){Q.pop(R);}
+	bool ok = Q.pop(R) && R.producer == 1 && R.part == 0 && Q.pop(R) && R.producer == 1 && R.part == 1 && !Q.pop(R);
+	check("block read back in order", ok, 1);
+}
+
+// producers and a consumer at full speed, the queue runs full so the drops are part of the check.
+static void checkThreads(){
+	Queue Q;
+	std::atomic<uint32_t> running(PRODUCERS);
+	std::vector<uint64_t> dropped(PRODUCERS, 0);
+	std::vector<uint64_t> pushed(PRODUCERS, 0);
+
+	std::vector<std::thread> producers;
+	for(uint32_t p = 0; p < PRODUCERS; p++){
+		producers.emplace_back([&, p](){
+			for(uint32_t s = 0; s < STATEMENTS; s++){
+				uint32_t parts = 1 + s % 3;
+				bool ok = false;
+				// like an error statement, a producer gives the consumer a few chances to make room before it drops.
+				for(int attempt = 0; attempt < 8 && !ok; attempt++){
+					if(attempt){std::this_thread::yield();}
+					if(parts == 1){
+						Item I = {p, s, 0, 1};
+						ok = Q.push(I);
+					}
+					else{
+						ok = Q.push(parts, [&](Item& item, size_t i){ item = {p, s, (uint32_t)i, parts}; });
+					}
+				}
+				if(ok){pushed[p] += parts;}
+				else{dropped[p] += parts;}
+			}
+			running--;
+		});
+	}
+
+	uint64_t received = 0, duplicates = 0, interleaved = 0;
+	std::vector<int64_t> last(PRODUCERS, -1);
+	Item open = {0, 0, 0, 1}; // the block that is being read.
+	for(;;){
+		bool done = !running.load();
+		Item I;
+		if(!Q.pop(I)){
+			if(done){break;}
+			std::this_thread::yield();
+			continue;
+		}
+		received++;
+		if(open.part + 1 < open.parts){
+			// the next item should be the next part of the open block.
+			if(I.producer != open.producer || I.statement != open.statement || I.part != open.part + 1){interleaved++;}
+			open = I;
+			continue;
+		}
+		if(I.part != 0 || (int64_t)I.statement <= last[I.producer]){duplicates++;}
+		last[I.producer] = I.statement;
+		open = I;
+	}
+	for(std::thread& T : producers){T.join();}
+
+	uint64_t total_pushed = 0, total_dropped = 0;
+	for(uint32_t p = 0; p < PRODUCERS; p++){
+		total_pushed += pushed[p];
+		total_dropped += dropped[p];
+	}
+	printf("     %u producers, %llu items, %llu dropped, high water %zu\n", PRODUCERS,
+		(unsigned long long)(total_pushed + total_dropped), (unsigned long long)total_dropped, Q.highWater());
+	check("items read", received, total_pushed);
+	uint64_t total = 0;
+	for(uint32_t s = 0; s < STATEMENTS; s++){total += 1 + s % 3;}
+	check("items read + dropped", received + total_dropped, total * PRODUCERS);
+	check("items read twice or out of order", duplicates, 0);
+	check("blocks with a foreign item", interleaved, 0);
+	check("queue empty", Q.size(), 0);
+}
+
+int main(){
+	checkBlockFull();
+	checkThreads();
+	printf("%d checks failed\n", failures);
+	return failures ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+/**
+ * @file SampleQueueTest.cpp
+ * @author Imre Korf
+ * @brief Runs a producer thread and a consumer thread on a SampleQueue and checks the order, the drops and the high water mark.
+ * @version 0.1
+ * @date 2022-04-05
+ *
+ * usage: SampleQueueTest
+ * The producer pushes numbered items without waiting, the consumer pauses now and then so the ring runs full.
+ * The consumer checks that the items arrive in order, none of them twice and none of them torn, and that every item
+ * that was not read was counted as dropped.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#include "../../src/Pipeline/SampleQueue.h"
+#include "../../src/Defines/Defines.h"
+
+static const uint32_t ITEMS = 500000;
+
+/**
+ * @brief A queued item, larger than a word so a torn copy shows.
+ */
+struct Item {
+	uint32_t number;
+	uint32_t words[7];
+};
+
+typedef SampleQueue<Item, PIPELINE_QUEUE_LENGTH> Queue;
+
+static int failures = 0;
+
+// compares a count with its expectation.
+static void check(const char* name, uint64_t value, uint64_t expected){
+	bool ok = value == expected;
+	printf("%s %-44s %10llu, expected %10llu\n", ok ? "PASS" : "FAIL", name, (unsigned long long)value, (unsigned long long)expected);
+	if(!ok){failures++;}
+}
+
+static Item make(uint32_t number){
+	Item I;
+	I.number = number;
+	for(uint32_t i = 0; i < 7; i++){I.words[i] = number * 2654435761u + i;}
+	return I;
+}
+
+static bool intact(const Item& I){
+	for(uint32_t i = 0; i < 7; i++){
+		if(I.words[i] != I.number * 2654435761u + i){return false;}
+	}
+	return true;
+}
+
+// a full ring drops the new item and keeps the old ones.
+static void checkFull(){
+	Queue Q;
+	uint32_t pushed = 0;
+	for(uint32_t i = 0; i < PIPELINE_QUEUE_LENGTH + 3; i++){pushed += Q.push(make(i));}
+	check("full: pushed", pushed, PIPELINE_QUEUE_LENGTH);
+	check("full: dropped", Q.getDropped(), 3);
+	check("full: high water", Q.highWater(), PIPELINE_QUEUE_LENGTH);
+	check("full: size", Q.size(), PIPELINE_QUEUE_LENGTH);
+	Item R;
+	uint32_t in_order = 0;
+	for(uint32_t i = 0; Q.pop(R); i++){in_order += R.number == i && intact(R);}
+	check("full: read back in order", in_order, PIPELINE_QUEUE_LENGTH);
+	check("full: high water after reading", Q.highWater(), PIPELINE_QUEUE_LENGTH);
+	check("full: pushed after reading", Q.push(make(0)), 1);
+}
+
+// a producer at full speed and a consumer that pauses, like the network task during a publish.
+static void checkThreads(){
+	Queue Q;
+	std::atomic<bool> running(true);
+	uint64_t refused = 0;
+	std::thread producer([&](){
+		for(uint32_t i = 0; i < ITEMS; i++){
+			if(!Q.push(make(i))){refused++;}
+			if(i % 64 == 0){std::this_thread::yield();}
+		}
+		running = false;
+	});
+
+	uint64_t received = 0, out_of_order = 0, torn = 0;
+	int64_t last = -1;
+	for(;;){
+		bool done = !running.load();
+		Item I;
+		if(!Q.pop(I)){
+			if(done){break;}
+			std::this_thread::yield();
+			continue;
+		}
+		received++;
+		if((int64_t)I.number <= last){out_of_order++;}
+		if(!intact(I)){torn++;}
+		last = I.number;
+		if(received % 4096 == 0){std::this_thread::sleep_for(std::chrono::microseconds(200));}
+	}
+	producer.join();
+
+	printf("     %u items, %llu dropped, high water %zu\n", ITEMS, (unsigned long long)refused, Q.highWater());
+	check("threads: items read + dropped", received + Q.getDropped(), ITEMS);
+	check("threads: dropped as counted by the producer", Q.getDropped(), refused);
+	check("threads: items read twice or out of order", out_of_order, 0);
+	check("threads: torn items", torn, 0);
+	check("threads: ring ran full", refused > 0, 1);
+	check("threads: high water", Q.highWater(), PIPELINE_QUEUE_LENGTH);
+	check("threads: queue empty", Q.size(), 0);
+}
+
+int main(){
+	checkFull();
+	checkThreads();
+	printf("%d checks failed\n", failures);
+	return failures ? 1 : 0;
+}
\ No newline at end of file
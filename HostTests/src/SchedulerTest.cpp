@@ -0,0 +1,237 @@
+/**
+ * @file SchedulerTest.cpp
+ * @author Imre Korf
+ * @brief Runs the Scheduler on a VirtualClock with fake tasks and checks when their steps are called.
+ * @version 0.1
+ * @date 2022-04-05
+ *
+ * usage: SchedulerTest
+ * The clock is moved forward by the time that poll() returns, like the sampling task sleeps, so the polls that return 0
+ * show whether the scheduler busy waits. Prints a line per check and exits with 1 when one fails.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "../../src/Scheduler/Scheduler.h"
+
+static int failures = 0;
+
+// compares a value with its expectation.
+static void check(const char* name, long value, long expected){
+	bool ok = value == expected;
+	printf("%s %-52s %8ld, expected %8ld\n", ok ? "PASS" : "FAIL", name, value, expected);
+	if(!ok){failures++;}
+}
+
+// checks that a value is at most the limit.
+static void checkBelow(const char* name, long value, long limit){
+	bool ok = value <= limit;
+	printf("%s %-52s %8ld, expected <= %ld\n", ok ? "PASS" : "FAIL", name, value, limit);
+	if(!ok){failures++;}
+}
+
+/**
+ * @brief A sensor with a conversion time, records the times of its steps.
+ */
+class FakeTask : public iTask {
+public:
+	/** Time in ms from the start until the result is ready, never ready when negative. */
+	int32_t conversion;
+	/** Result of start(). */
+	ERR_Type start_result = SUCCESS;
+	/** Times of the starts, the collects and the calls of ready(). */
+	std::vector<uint32_t> starts, collects;
+	uint32_t ready_calls = 0;
+	/** Log shared by the tasks, to check the order of the steps of different tasks. */
+	std::vector<char>* order = nullptr;
+	/** Name of the task in the order log. */
+	char name = '?';
+
+	explicit FakeTask(int32_t conversion) : conversion(conversion) {}
+
+	virtual ERR_Type start(uint32_t now){
+		starts.push_back(now);
+		if(order){order->push_back(name);}
+		return start_result;
+	}
+	virtual bool ready(uint32_t now){
+		ready_calls++;
+		return conversion >= 0 && now - starts.back() >= (uint32_t)conversion;
+	}
+	virtual ERR_Type collect(uint32_t now){
+		collects.push_back(now);
+		if(order){order->push_back(name - 'a' + 'A');}
+		return SUCCESS;
+	}
+};
+
+/**
+ * @brief The results that the scheduler passed to the callback.
+ */
+struct CallbackLog {
+	std::vector<uint8_t> ids;
+	std::vector<ERR_Type> results;
+};
+
+static void onMeasurement(uint8_t id, ERR_Type ET, void* context){
+	CallbackLog* log = (CallbackLog*)context;
+	log->ids.push_back(id);
+	log->results.push_back(ET);
+}
+
+/**
+ * @brief Polls until the clock reaches the end time, the clock moves by the time poll() returns.
+ * @param busy set to the amount of polls that returned 0, when not nullptr.
+ * @return long the amount of polls.
+ */
+static long run(Scheduler& S, VirtualClock& clock, uint32_t end, long* busy = nullptr){
+	long polls = 0, zero = 0;
+	while((int32_t)(clock.now() - end) < 0){
+		uint32_t wait = S.poll();
+		polls++;
+		if(!wait){zero++;}
+		clock.advance(wait);
+		if(zero > 1000){break;} // a poll that keeps returning 0 would never end.
+	}
+	if(busy){*busy = zero;}
+	return polls;
+}
+
+// a task without conversion time is started and collected once per period, at the planned time.
+static void checkPeriod(){
+	VirtualClock clock;
+	Scheduler S(clock);
+	FakeTask T(0);
+	S.add(T, 1, 1000, 500);
+	long busy = 0;
+	long polls = run(S, clock, 10000, &busy);
+	check("period: measurements in 10 s", T.collects.size(), 10);
+	bool on_time = true;
+	for(size_t i = 0; i < T.starts.size(); i++){
+		if(T.starts[i] != i * 1000){on_time = false;}
+	}
+	check("period: every start on a multiple of 1000 ms", on_time, 1);
+	check("period: max_late", S.getStats(1)->max_late, 0);
+	// the sampling task sleeps between the polls, at most SCHEDULER_POLL_INTERVAL at a time.
+	checkBelow("period: polls in 10 s", polls, 10000 / SCHEDULER_POLL_INTERVAL + 10);
+	check("period: polls that returned 0", busy, 0);
+}
+
+// a running measurement is checked every SCHEDULER_POLL_INTERVAL ms and collected once it is ready.
+static void checkReadiness(){
+	VirtualClock clock;
+	Scheduler S(clock);
+	FakeTask T(250);
+	S.add(T, 1, 1000, 800);
+	run(S, clock, 5000);
+	check("ready: measurements in 5 s", T.collects.size(), 5);
+	long latest = 0;
+	for(size_t i = 0; i < T.collects.size(); i++){
+		long delay = (long)(T.collects[i] - T.starts[i]) - 250;
+		if(delay > latest){latest = delay;}
+	}
+	checkBelow("ready: collect after ready, ms", latest, SCHEDULER_POLL_INTERVAL);
+	checkBelow("ready: ready() calls per measurement", T.ready_calls / T.collects.size(), 250 / SCHEDULER_POLL_INTERVAL + 2);
+	check("ready: no timeouts", S.getStats(1)->timeouts, 0);
+}
+
+// a slow sensor doesn't delay a fast one, the fast task is started and collected while the slow one converts.
+static void checkOrder(){
+	VirtualClock clock;
+	Scheduler S(clock);
+	std::vector<char> order;
+	FakeTask slow(500), fast(0);
+	slow.order = &order;
+	slow.name = 's';
+	fast.order = &order;
+	fast.name = 'f';
+	S.add(slow, 1, 1000, 900);
+	S.add(fast, 2, 100, 50);
+	long busy = 0;
+	run(S, clock, 1000, &busy);
+	check("order: polls that returned 0", busy, 0);
+	check("order: fast measurements in 1 s", fast.collects.size(), 10);
+	check("order: slow measurements in 1 s", slow.collects.size(), 1);
+	check("order: fast max_late", S.getStats(2)->max_late, 0);
+	// the slow start, then the fast measurements at 0 to 500 ms, the slow collect at 500 ms and the rest of the fast ones.
+	std::string steps(order.begin(), order.end());
+	printf("     order of the steps: %s\n", steps.c_str());
+	check("order: steps", steps == "sfFfFfFfFfFSfFfFfFfFfF", 1);
+}
+
+// a measurement that never becomes ready is given up after the timeout, the next start keeps the phase.
+static void checkTimeout(){
+	VirtualClock clock;
+	Scheduler S(clock);
+	CallbackLog log;
+	S.setCallback(onMeasurement, &log);
+	FakeTask T(-1);
+	S.add(T, 7, 1000, 300);
+	run(S, clock, 3000);
+	check("timeout: timeouts in 3 s", S.getStats(7)->timeouts, 3);
+	check("timeout: collects", T.collects.size(), 0);
+	check("timeout: starts on 0, 1000 and 2000 ms", T.starts.size() == 3 && T.starts[1] == 1000 && T.starts[2] == 2000, 1);
+	check("timeout: callbacks with READ_FAIL", log.results.size() == 3 && log.results[0] == READ_FAIL && log.ids[0] == 7, 1);
+}
+
+// a start that fails is counted, reported and the task is started again a period later.
+static void checkStartError(){
+	VirtualClock clock;
+	Scheduler S(clock);
+	CallbackLog log;
+	S.setCallback(onMeasurement, &log);
+	FakeTask T(0);
+	T.start_result = ERROR;
+	S.add(T, 3, 1000, 500);
+	run(S, clock, 2000);
+	check("start error: errors in 2 s", S.getStats(3)->errors, 2);
+	check("start error: ready() calls", T.ready_calls, 0);
+	check("start error: callbacks with ERROR", log.results.size() == 2 && log.results[1] == ERROR, 1);
+}
+
+// when the scheduler is not polled for several periods the missed starts are skipped instead of run back to back.
+static void checkSkip(){
+	VirtualClock clock;
+	Scheduler S(clock);
+	FakeTask T(0);
+	S.add(T, 1, 1000, 500);
+	S.poll(); // the first measurement at 0 ms.
+	clock.set(3500);
+	S.poll();
+	check("skip: starts after a stall of 3.5 periods", T.starts.size(), 2);
+	check("skip: skipped starts", S.getStats(1)->skipped, 2);
+	check("skip: late start at 3500 ms", T.starts.back(), 3500);
+	check("skip: poll() after the late measurement", S.poll(), SCHEDULER_POLL_INTERVAL);
+	check("skip: no second start at 3500 ms", T.starts.size(), 2);
+	run(S, clock, 4001);
+	check("skip: next start at 4000 ms", T.starts.back(), 4000);
+}
+
+// the clock wraps around after 49.7 days, the periods continue over the wrap.
+static void checkWrap(){
+	VirtualClock clock;
+	clock.set(0xFFFFFFFF - 1500);
+	Scheduler S(clock);
+	FakeTask T(100);
+	S.add(T, 1, 1000, 500);
+	run(S, clock, 0xFFFFFFFF - 1500 + 5000);
+	check("wrap: measurements over the wrap", T.collects.size(), 5);
+	check("wrap: max_late", S.getStats(1)->max_late, 0);
+	check("wrap: timeouts", S.getStats(1)->timeouts, 0);
+}
+
+int main(){
+	checkPeriod();
+	checkReadiness();
+	checkOrder();
+	checkTimeout();
+	checkStartError();
+	checkSkip();
+	checkWrap();
+	printf("%d checks failed\n", failures);
+	return failures ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,130 @@
+/**
+ * @file TSL2591Test.cpp
+ * @author Imre Korf
+ * @brief Checks the lux and the range changes of TSL2591Ranging with a simulated sensor.
+ * @version 0.1
+ * @date 2022-04-05
+ *
+ * usage: TSL2591Test
+ * The simulated sensor gives counts in proportion to the gain and integration time of the range, up to the maximum
+ * count of the ADC. Prints a line per check and exits with 1 when one fails.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <cmath>
+#include <cstdio>
+
+#include "../../src/Wrappers/Sensors/TSL2591/TSL2591Ranging.h"
+
+static int failures = 0;
+
+// compares a value with its expectation.
+static void check(const char* name, double value, double expected, double tolerance){
+	bool ok = fabs(value - expected) <= tolerance;
+	printf("%s %-52s %10.3f, expected %10.3f +- %.3f\n", ok ? "PASS" : "FAIL", name, value, expected, tolerance);
+	if(!ok){failures++;}
+}
+
+// highest count of a channel, as in the data sheet.
+static uint32_t maxCount(const TSL2591Range& R){
+	return R.time == 100 ? 36863 : 65535;
+}
+
+/**
+ * @brief A light level, the counts of both channels at 1x and 100 ms.
+ */
+struct Light {
+	double full;
+	double ir;
+};
+
+// the counts the sensor reads with a range.
+static void convert(const Light& L, const TSL2591Range& R, uint16_t& full, uint16_t& ir){
+	double scale = R.factor * (R.time / 100.0);
+	double f = L.full * scale;
+	double i = L.ir * scale;
+	full = (uint16_t)(f > maxCount(R) ? maxCount(R) : f + 0.5);
+	ir = (uint16_t)(i > maxCount(R) ? maxCount(R) : i + 0.5);
+}
+
+// lux of a light level, with the Adafruit formula on the counts at 1x and 100 ms without rounding.
+static double expectedLux(const Light& L){
+	return (L.full - L.ir) * (1.0 - L.ir / L.full) / (100.0 / 408.0);
+}
+
+// the same light gives the same lux in every range that doesn't saturate.
+static void checkRanges(){
+	Light L = {40, 8};
+	char name[64];
+	for(uint8_t r = 0; r < TSL2591_RANGE_COUNT; r++){
+		const TSL2591Range& R = TSL2591Ranging::Ranges[r];
+		uint16_t full, ir;
+		convert(L, R, full, ir);
+		if(full >= maxCount(R)){continue;}
+		snprintf(name, sizeof(name), "ranges: lux at %ux %u ms", R.factor, R.time);
+		check(name, TSL2591Ranging::lux(full, ir, R), expectedLux(L), expectedLux(L) * 0.02);
+	}
+}
+
+// a conversion that moves the range up keeps the lux of its own range, the next conversion reads the same lux.
+static void checkRangeUp(){
+	TSL2591Ranging G;
+	G.set(1);
+	Light L = {4, 1};
+	uint16_t full, ir;
+	convert(L, G.current(), full, ir);
+	float expected = TSL2591Ranging::lux(full, ir, TSL2591Ranging::Ranges[1]);
+	float lux = G.evaluate(full, ir);
+	check("up: range changed", G.index() > 1, 1, 0);
+	check("up: lux of the conversion", lux, expected, 0);
+	check("up: lux with the range of the conversion", lux, expectedLux(L), expectedLux(L) * 0.05);
+	convert(L, G.current(), full, ir);
+	check("up: lux of the next conversion", G.evaluate(full, ir), expectedLux(L), expectedLux(L) * 0.02);
+}
+
+// a saturated conversion has no lux and moves the range down, a clipped one back to the least sensitive range.
+static void checkRangeDown(){
+	TSL2591Ranging G;
+	G.set(4);
+	check("down: saturated lux", G.evaluate(34000, 5000), -1, 0);
+	check("down: one range down", G.index(), 3, 0);
+	G.set(4);
+	check("down: clipped lux", G.evaluate(36863, 5000), -1, 0);
+	check("down: least sensitive range", G.index(), 0, 0);
+}
+
+// from the start range every light level settles in a few conversions, every lux that is read is the lux of the light.
+static void checkSettle(){
+	const Light Levels[] = {{0.02, 0.004}, {1, 0.3}, {50, 10}, {2000, 300}, {30000, 12000}};
+	char name[64];
+	for(const Light& L : Levels){
+		TSL2591Ranging G;
+		G.set(TSL2591_RANGE_START);
+		long wrong = 0;
+		long read = 0;
+		for(int i = 0; i < 6; i++){
+			uint16_t full, ir;
+			convert(L, G.current(), full, ir);
+			// low counts are rounded, so the tolerance includes a count of each channel.
+			double tolerance = expectedLux(L) * 0.02 + 2 * 408.0 / (G.current().factor * G.current().time);
+			float lux = G.evaluate(full, ir);
+			if(lux < 0){continue;}
+			read++;
+			if(fabs(lux - expectedLux(L)) > tolerance){wrong++;}
+		}
+		snprintf(name, sizeof(name), "settle: %.2f counts, conversions with a lux", L.full);
+		check(name, read >= 4, 1, 0);
+		snprintf(name, sizeof(name), "settle: %.2f counts, wrong lux", L.full);
+		check(name, wrong, 0, 0);
+	}
+}
+
+int main(){
+	checkRanges();
+	checkRangeUp();
+	checkRangeDown();
+	checkSettle();
+	printf("%d checks failed\n", failures);
+	return failures ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+/**
+ * @file main.cpp
+ * @author Imre Korf
+ * @brief Replays a recorded byte stream of the SM-UART-04L through the frame parser of the SenseBox.
+ * @version 0.1
+ * @date 2022-03-23
+ *
+ * usage: LDSReplay [--corrupt <rate>] [--seed <n>] [capture.bin]
+ *        LDSReplay --generate <frames> > capture.bin
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "../../src/Wrappers/Sensors/DustSensor/PMFrameParser.h"
+
+// writes frames with changing values, as the sensor would send them.
+static void generate(unsigned long count){
+	for(unsigned long n = 0; n < count; n++){
+		uint8_t frame[PM_FRAME_SIZE] = {0x42, 0x4D, 0, 2 * PM_FRAME_WORDS + 2};
+		for(int i = 0; i < PM_FRAME_WORDS; i++){
+			uint16_t value = (uint16_t)((i + 1) * 10 + n % 50);
+			frame[4 + 2 * i] = value >> 8;
+			frame[5 + 2 * i] = value & 0xFF;
+		}
+		uint16_t sum = 0;
+		for(int i = 0; i < PM_FRAME_SIZE - 2; i++){
+			sum += frame[i];
+		}
+		frame[PM_FRAME_SIZE - 2] = sum >> 8;
+		frame[PM_FRAME_SIZE - 1] = sum & 0xFF;
+		fwrite(frame, 1, sizeof(frame), stdout);
+	}
+}
+
+int main(int argc, char** argv){
+	double corrupt = 0;
+	const char* path = nullptr;
+	for(int i = 1; i < argc; i++){
+		if(!strcmp(argv[i], "--generate") && i + 1 < argc){
+			generate(strtoul(argv[i + 1], nullptr, 10));
+			return 0;
+		}
+		else if(!strcmp(argv[i], "--corrupt") && i + 1 < argc){corrupt = atof(argv[++i]);}
+		else if(!strcmp(argv[i], "--seed") && i + 1 < argc){srand((unsigned)strtoul(argv[++i], nullptr, 10));}
+		else if(argv[i][0] != '-'){path = argv[i];}
+		else{
+			fprintf(stderr, "usage: %s [--corrupt <rate>] [--seed <n>] [capture.bin]\n       %s --generate <frames> > capture.bin\n", argv[0], argv[0]);
+			return 1;
+		}
+	}
+	FILE* in = path ? fopen(path, "rb") : stdin;
+	if(!in){
+		fprintf(stderr, "can't open %s\n", path);
+		return 1;
+	}
+
+	PMFrameParser parser;
+	unsigned long corrupted = 0;
+	printf("offset,pm10_std,pm25_std,pm100_std,pm10_env,pm25_env,pm100_env,p03,p05,p10,p25,p50,p100\n");
+	unsigned long offset = 0;
+	int c;
+	while((c = fgetc(in)) != EOF){
+		uint8_t byte = (uint8_t)c;
+		// a corrupted byte gets a random value, like a bit error on the line.
+		if(corrupt > 0 && rand() < corrupt * RAND_MAX){
+			byte = (uint8_t)rand();
+			corrupted++;
+		}
+		offset++;
+		if(parser.push(byte)){
+			const PMFrame& F = parser.getFrame();
+			printf("%lu", offset - PM_FRAME_SIZE);
+			for(int i = 0; i < PM_FRAME_WORDS - 1; i++){
+				printf(",%u", F.data[i]);
+			}
+			printf("\n");
+		}
+	}
+	if(path){fclose(in);}
+
+	const PMParserStats& S = parser.getStats();
+	fprintf(stderr, "%u bytes, %lu corrupted, %u frames, %u checksum errors, %u length errors, %u bytes skipped\n",
+		S.bytes, corrupted, S.frames, S.checksum_errors, S.length_errors, S.skipped);
+	return 0;
+}
\ No newline at end of file
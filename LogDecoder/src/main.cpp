@@ -0,0 +1,152 @@
+/**
+ * @file main.cpp
+ * @author Imre Korf
+ * @brief Converts binary SenseBox log files back into the text log format.
+ * @version 0.1
+ * @date 2022-02-14
+ *
+ * usage: LogDecoder <logfile.bin> [output.txt]
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstdio>
+
+#include "../../src/Logger/LogMessages.h"
+#include "../../src/Logger/LogRecord.h"
+
+// level tags as printed by the Logger, DataDump and SD_printInfo lines have no tag.
+static const char* const level_tags[] = {"[Err ]: ", "[Warn]: ", "[Info]: ", "", ""};
+
+struct Record {
+	uint8_t level;
+	uint16_t id;
+	uint32_t timestamp;
+	const uint8_t* args;
+	uint8_t arglen;
+};
+
+struct TimeAnchor {
+	bool valid;
+	uint32_t seconds;	// seconds since midnight at the time of the anchor.
+	uint32_t timestamp;	// millis() of the ESP32 at the time of the anchor.
+	uint32_t previous;	// millis() of the ESP32 at the time of the previous record.
+};
+
+// read the record at the start of data, returns false if there is no valid record.
+static bool parseRecord(const uint8_t* data, size_t size, Record& rec){
+	if(size < LOG_RECORD_HEADER_SIZE || data[0] != LOG_RECORD_SYNC){return false;}
+	rec.level = data[1];
+	rec.id = data[2] | (data[3] << 8);
+	rec.timestamp = data[4] | (data[5] << 8) | (data[6] << 16) | ((uint32_t)data[7] << 24);
+	rec.arglen = data[8];
+	rec.args = data + LOG_RECORD_HEADER_SIZE;
+	if(rec.level > 4 || rec.id >= LOG_MSG_COUNT){return false;}
+	return size >= (size_t)LOG_RECORD_HEADER_SIZE + rec.arglen;
+}
+
+// read the numeric arguments of a record, returns the amount of arguments read.
+static size_t numericArgs(const Record& rec, uint32_t* out, size_t count){
+	size_t n = 0;
+	size_t pos = 0;
+	while(n < count && pos + 5 <= rec.arglen){
+		uint8_t type = rec.args[pos];
+		if(type != LOG_ARG_INT && type != LOG_ARG_UINT){break;}
+		const uint8_t* v = rec.args + pos + 1;
+		out[n++] = v[0] | (v[1] << 8) | (v[2] << 16) | ((uint32_t)v[3] << 24);
+		pos += 5;
+	}
+	return n;
+}
+
+static void printRecord(std::ostream& out, const Record& rec, TimeAnchor& anchor){
+	char text[1024];
+	// millis() starts again at 0 after a reset, the times after it can't be related to the anchor before it.
+	if(rec.timestamp < anchor.previous){
+		out << "[Reset]   time went back from " << anchor.previous << "ms to " << rec.timestamp << "ms\n";
+		anchor.valid = false;
+	}
+	anchor.previous = rec.timestamp;
+	if(rec.id == LOG_MSG_START){
+		LogRecord::format(text, sizeof(text), "{}", rec.args, rec.arglen);
+		out << "---------------------------------------------------------------------------------------------------\n";
+		out << "[Start]   Start of Logfile\n";
+		out << "[Version] " << text << "\n";
+		return;
+	}
+	if(rec.id == LOG_MSG_TIME){
+		uint32_t dt[6];
+		if(numericArgs(rec, dt, 6) != 6){return;}
+		anchor.valid = true;
+		anchor.seconds = dt[3] * 3600 + dt[4] * 60 + dt[5];
+		anchor.timestamp = rec.timestamp;
+		snprintf(text, sizeof(text), "%lu-%lu-%lu %lu:%lu:%lu", (unsigned long)dt[0], (unsigned long)dt[1], (unsigned long)dt[2], (unsigned long)dt[3], (unsigned long)dt[4], (unsigned long)dt[5]);
+		out << "[Date]    " << text << "\n";
+		out << "---------------------------------------------------------------------------------------------------\n";
+		return;
+	}
+	if(rec.level < 3){
+		// same layout as __W_RTC::stringTime.
+		if(anchor.valid){
+			uint32_t secs = (anchor.seconds + (rec.timestamp - anchor.timestamp) / 1000) % 86400;
+			out << "[" << secs / 3600 << ":" << (secs / 60) % 60 << ":" << secs % 60 << "] ";
+		}
+		else{
+			out << "[" << rec.timestamp << "ms] ";
+		}
+		out << level_tags[rec.level];
+	}
+	LogRecord::format(text, sizeof(text), log_message_formats[rec.id], rec.args, rec.arglen);
+	out << text << "\n";
+}
+
+int main(int argc, char** argv){
+	if(argc < 2){
+		std::cout << "usage: " << argv[0] << " <logfile.bin> [output.txt]" << std::endl;
+		return 1;
+	}
+
+	std::ifstream input(argv[1], std::ios::binary);
+	if(!input){
+		std::cerr << "Could not open " << argv[1] << std::endl;
+		return 1;
+	}
+	std::vector<uint8_t> data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+	std::ofstream file;
+	if(argc > 2){
+		file.open(argv[2]);
+		if(!file){
+			std::cerr << "Could not open " << argv[2] << std::endl;
+			return 1;
+		}
+	}
+	std::ostream& out = argc > 2 ? file : std::cout;
+
+	TimeAnchor anchor = {false, 0, 0, 0};
+	size_t pos = 0;
+	size_t skipped = 0;
+	size_t records = 0;
+	while(pos < data.size()){
+		Record rec;
+		if(!parseRecord(data.data() + pos, data.size() - pos, rec)){
+			// corrupt or cut off record, search for the next sync byte.
+			pos++;
+			skipped++;
+			continue;
+		}
+		printRecord(out, rec, anchor);
+		pos += LOG_RECORD_HEADER_SIZE + rec.arglen;
+		records++;
+	}
+
+	std::cerr << records << " records decoded";
+	if(skipped){
+		std::cerr << ", " << skipped << " corrupt bytes skipped";
+	}
+	std::cerr << std::endl;
+	return 0;
+}
\ No newline at end of file
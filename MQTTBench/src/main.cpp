@@ -0,0 +1,572 @@
+/**
+ * @file main.cpp
+ * @author Imre Korf
+ * @brief Compares publishing a measurement cycle per attribute and as one batch against an MQTT broker on the host.
+ * @version 0.1
+ * @date 2022-03-28
+ *
+ * usage: MQTTBench [host] [port] [cycles]
+ *        MQTTBench fake [cycles] [ack loss %]
+ *
+ * The tool subscribes to its own topics, so the latency of a QoS 0 cycle is the time from the first publish
+ * until the broker has delivered the last message of the cycle back to it. The QoS 1 cycles are published
+ * by the MQTTSession of the firmware on a second connection, their latency lasts until the last PUBACK.
+ *
+ * With fake as host the MQTTSession runs against a broker in the process that loses PUBACKs and drops
+ * the connection now and then, and the tool checks that every message arrives at least once.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <initializer_list>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../../src/MQTT/MQTTBatch.h"
+#include "../../src/MQTT/MQTTSession.h"
+
+// client id and asset id of the topics, the topics have the same layout as those of the MQTTClient.
+static const char* CLIENT_ID = "MQTTBench";
+static const char* ASSET_ID = "/bench";
+
+// overhead of a TLS 1.2 record with AES-GCM: 5 bytes header, 8 bytes explicit nonce and a 16 byte tag.
+static const size_t TLS_RECORD_OVERHEAD = 29;
+// IPv4 and TCP headers without options.
+static const size_t TCP_IP_OVERHEAD = 40;
+// maximum TCP payload of a segment on an Ethernet or WiFi link.
+static const size_t SEGMENT_SIZE = 1460;
+
+// amount of octave bands of the MAX4466.
+static const int AUDIO_BANDS = sizeof(MAX4466_Bands_fields) / sizeof(MAX4466_Bands_fields[0]);
+
+typedef std::chrono::steady_clock Clock;
+
+// a value as the Pipeline would send it.
+struct Value {
+	attributes attribute;
+	std::string text;
+};
+
+// counters of one mode.
+struct Result {
+	size_t messages = 0;
+	size_t payload_bytes = 0;
+	size_t mqtt_bytes = 0;
+	size_t wire_bytes = 0;
+	std::vector<double> send_us;
+	std::vector<double> latency_us;
+};
+
+static std::string number(float value, uint8_t decimals){
+	char buff[32];
+	PayloadWriter W(buff);
+	W.number(value, decimals);
+	return W.c_str();
+}
+
+template<size_t N>
+static std::string object(const JsonField (&fields)[N], const float (&values)[N]){
+	char buff[MQTT_PAYLOAD_SIZE];
+	PayloadWriter W(buff);
+	W.object(fields, values);
+	return W.c_str();
+}
+
+// builds the values of one measurement of every sensor, formatted like the Pipeline does.
+static std::vector<Value> makeCycle(unsigned cycle){
+	const float d = (cycle % 10) / 10.0f; // make the values move a bit.
+	std::vector<Value> values;
+	values.push_back({ambimate_Voc, number(12 + d * 10, 0)});
+	values.push_back({ambimate_hum, number(45.3f + d, 2)});
+	values.push_back({ambimate_temp, number(21.52f + d, 2)});
+	values.push_back({ambimate_Eco2, number(410 + d * 100, 0)});
+	const float color[] = {123.45f + d, 234.5f, 345.67f, 456.78f, 567.89f, 678.9f + d};
+	values.push_back({AS7262_Color, object(AS7262_Color_fields, color)});
+	values.push_back({PM10, number(1234 + d * 10, 0)});
+	values.push_back({PM25, number(321 + d * 10, 0)});
+	values.push_back({PM100, number(12 + d * 10, 0)});
+	values.push_back({MAX4466_Audio, number(48.3f + d, 1)});
+	float bands[AUDIO_BANDS];
+	for(int b = 0; b < AUDIO_BANDS; b++){
+		bands[b] = 40.1f - b * 2.5f + d;
+	}
+	values.push_back({MAX4466_Bands, object(MAX4466_Bands_fields, bands)});
+	values.push_back({MIX8410_O2, number(20.9f, 2)});
+	values.push_back({SCD30_CO2, number(612 + d * 10, 0)});
+	values.push_back({SCD30_hum, number(44.18f + d, 2)});
+	values.push_back({SCD30_temp, number(22.04f + d, 2)});
+	const float spectrum[] = {1234 + d * 10, 321, 1555 + d * 10, 87.65f + d};
+	values.push_back({TSL2591_Spectrum, object(TSL2591_Spectrum_fields, spectrum)});
+	return values;
+}
+
+static std::string topic(attributes attribute){
+	return std::string("alkmaar/") + CLIENT_ID + "/writeattributevalue/" + attribute_names[attribute] + ASSET_ID;
+}
+
+// appends the MQTT remaining length encoding.
+static void putLength(std::string& packet, size_t length){
+	do {
+		uint8_t b = length % 128;
+		length /= 128;
+		if(length){b |= 0x80;}
+		packet += (char)b;
+	} while(length);
+}
+
+static void putString(std::string& body, const std::string& s){
+	body += (char)(s.size() >> 8);
+	body += (char)(s.size() & 0xFF);
+	body += s;
+}
+
+static std::string packet(uint8_t type, const std::string& body){
+	std::string p(1, (char)type);
+	putLength(p, body.size());
+	return p + body;
+}
+
+static bool sendAll(int fd, const std::string& data){
+	size_t done = 0;
+	while(done < data.size()){
+		ssize_t n = send(fd, data.data() + done, data.size() - done, 0);
+		if(n <= 0){return false;}
+		done += n;
+	}
+	return true;
+}
+
+// reads one packet, returns its type or -1 when the connection is closed.
+static int readPacket(int fd, std::string& body){
+	uint8_t header;
+	if(recv(fd, &header, 1, MSG_WAITALL) != 1){return -1;}
+	size_t length = 0;
+	for(int shift = 0; ; shift += 7){
+		uint8_t b;
+		if(recv(fd, &b, 1, MSG_WAITALL) != 1 || shift > 21){return -1;}
+		length |= (size_t)(b & 0x7F) << shift;
+		if(!(b & 0x80)){break;}
+	}
+	body.resize(length);
+	if(length && recv(fd, &body[0], length, MSG_WAITALL) != (ssize_t)length){return -1;}
+	return header >> 4;
+}
+
+// counts the bytes of a publish as the ESP32 would send it, as one TLS record over TCP.
+static void countWrite(Result& R, size_t payload, size_t bytes){
+	R.messages++;
+	R.payload_bytes += payload;
+	R.mqtt_bytes += bytes;
+	size_t record = bytes + TLS_RECORD_OVERHEAD;
+	R.wire_bytes += record + ((record + SEGMENT_SIZE - 1) / SEGMENT_SIZE) * TCP_IP_OVERHEAD;
+}
+
+static std::string publishPacket(attributes attribute, const char* payload, size_t length){
+	std::string body;
+	putString(body, topic(attribute));
+	body.append(payload, length);
+	return packet(0x30, body);
+}
+
+static bool runCycle(int fd, unsigned cycle, bool batched, Result& R){
+	std::vector<Value> values = makeCycle(cycle);
+	// the packets are built before the clock starts, the tool measures the network and not its own string handling.
+	std::vector<std::string> packets;
+	std::vector<size_t> payloads;
+	if(batched){
+		MQTTBatch batch;
+		for(const Value& V : values){
+			if(!batch.add(V.attribute, V.text.c_str())){
+				fprintf(stderr, "%s doesn't fit in a batch of MQTT_BATCH_SIZE bytes\n", attribute_names[V.attribute]);
+				return false;
+			}
+		}
+		packets.push_back(publishPacket(BATCH, batch.data(), batch.bytes()));
+		payloads.push_back(batch.bytes());
+	}
+	else{
+		for(const Value& V : values){
+			packets.push_back(publishPacket(V.attribute, V.text.c_str(), V.text.size()));
+			payloads.push_back(V.text.size());
+		}
+	}
+
+	Clock::time_point start = Clock::now();
+	for(size_t i = 0; i < packets.size(); i++){
+		// one write per publish, like the MQTTSession hands a whole packet to the WiFiClientSecure.
+		if(!sendAll(fd, packets[i])){return false;}
+		countWrite(R, payloads[i], packets[i].size());
+	}
+	Clock::time_point sent = Clock::now();
+	size_t received = 0;
+	std::string body;
+	while(received < packets.size()){
+		int type = readPacket(fd, body);
+		if(type < 0){return false;}
+		if(type == 3){received++;}
+	}
+	Clock::time_point done = Clock::now();
+	R.send_us.push_back(std::chrono::duration<double, std::micro>(sent - start).count());
+	R.latency_us.push_back(std::chrono::duration<double, std::micro>(done - start).count());
+	return true;
+}
+
+// the connection of an MQTTSession to the broker, like the SecureTransport of the firmware without TLS.
+class SocketTransport : public iMQTTTransport {
+public:
+	int fd;
+	explicit SocketTransport(int fd) : fd(fd) {}
+	bool write(const uint8_t* data, size_t length) override {
+		return sendAll(fd, std::string((const char*)data, length));
+	}
+	int read(uint8_t* data, size_t length) override {
+		ssize_t n = recv(fd, data, length, MSG_DONTWAIT);
+		if(n > 0){return (int)n;}
+		return n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK) ? -1 : 0;
+	}
+};
+
+static uint32_t millis(){
+	return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now().time_since_epoch()).count();
+}
+
+// polls the session until the socket has data or 1 ms has passed, so the tool doesn't spin.
+static void pollSession(MQTTSession& session, int fd){
+	pollfd P = {fd, POLLIN, 0};
+	poll(&P, 1, 1);
+	session.poll(millis());
+}
+
+static bool connectSession(MQTTSession& session, int fd, const char* client_id){
+	session.connect(client_id, nullptr, nullptr, 60, millis());
+	while(session.getState() == MQTTSession::State::Connecting){
+		pollSession(session, fd);
+	}
+	return session.connected();
+}
+
+// publishes a cycle with QoS 1 and waits until the broker has acknowledged every message.
+static bool runQoS1(MQTTSession& session, int fd, unsigned cycle, bool batched, Result& R){
+	std::vector<Value> values = makeCycle(cycle);
+	std::vector<Value> messages;
+	if(batched){
+		MQTTBatch batch;
+		for(const Value& V : values){
+			if(!batch.add(V.attribute, V.text.c_str())){return false;}
+		}
+		messages.push_back({BATCH, std::string(batch.data(), batch.bytes())});
+	}
+	else{
+		messages = values;
+	}
+	std::vector<std::string> topics;
+	for(const Value& V : messages){
+		topics.push_back(topic(V.attribute));
+	}
+
+	Clock::time_point start = Clock::now();
+	for(size_t i = 0; i < messages.size(); i++){
+		const Value& V = messages[i];
+		// a full window is the flow control, the next message waits for a PUBACK.
+		while(!session.publish(V.attribute, topics[i].c_str(), (const uint8_t*)V.text.data(), V.text.size(), 1, millis())){
+			if(!session.connected()){return false;}
+			pollSession(session, fd);
+		}
+		countWrite(R, V.text.size(), publishPacket(V.attribute, V.text.data(), V.text.size()).size() + 2);
+	}
+	Clock::time_point sent = Clock::now();
+	while(session.inFlight()){
+		if(!session.connected()){return false;}
+		pollSession(session, fd);
+	}
+	Clock::time_point done = Clock::now();
+	R.send_us.push_back(std::chrono::duration<double, std::micro>(sent - start).count());
+	R.latency_us.push_back(std::chrono::duration<double, std::micro>(done - start).count());
+	return true;
+}
+
+// a broker in the process, the MQTTSession writes to it and reads its answers as if it were a connection.
+class FakeBroker : public iMQTTTransport {
+public:
+	// percentage of the PUBACKs that are lost.
+	unsigned ack_loss = 20;
+	// the connection is dropped after this many PUBLISH packets, 0 for never.
+	unsigned drop_every = 97;
+	bool closed = false;
+	std::set<unsigned> delivered;
+	size_t publishes = 0;
+	size_t duplicates = 0;
+	size_t dup_flags = 0;
+	size_t id_errors = 0;
+	size_t connects = 0;
+
+	void reconnect(){
+		closed = false;
+		out.clear();
+		unacked.clear(); // clean session, the broker forgets the packet ids.
+	}
+
+	bool write(const uint8_t* data, size_t length) override {
+		if(closed){return false;}
+		size_t pos = 1;
+		size_t remaining = 0;
+		for(int shift = 0; pos < length; shift += 7){
+			remaining |= (size_t)(data[pos] & 0x7F) << shift;
+			if(!(data[pos++] & 0x80)){break;}
+		}
+		if(pos + remaining != length){
+			fprintf(stderr, "fake broker: a write holds %zu bytes but the packet %zu\n", length, pos + remaining);
+			id_errors++;
+			return false;
+		}
+		const uint8_t* body = data + pos;
+		switch(data[0] & 0xF0){
+			case 0x10:
+				connects++;
+				answer({0x20, 2, 0, 0});
+				break;
+			case 0x30: {
+				size_t topic_length = (body[0] << 8) | body[1];
+				uint16_t id = (body[2 + topic_length] << 8) | body[3 + topic_length];
+				std::string payload((const char*)body + 4 + topic_length, remaining - 4 - topic_length);
+				publishes++;
+				if(data[0] & 0x08){dup_flags++;}
+				// a new message may not reuse the id of one that has not been acknowledged.
+				else if(unacked.count(id)){id_errors++;}
+				unsigned seq = atoi(payload.c_str() + payload.find(':') + 1);
+				if(!delivered.insert(seq).second){duplicates++;}
+				if(drop_every && publishes % drop_every == 0){
+					closed = true;
+					return true; // the message arrived, but the connection dies before the PUBACK.
+				}
+				if(random() % 100 < ack_loss){
+					unacked.insert(id);
+					break;
+				}
+				unacked.erase(id);
+				answer({0x40, 2, (uint8_t)(id >> 8), (uint8_t)(id & 0xFF)});
+				break;
+			}
+			case 0xC0:
+				answer({0xD0, 0});
+				break;
+			default:
+				break;
+		}
+		return true;
+	}
+
+	int read(uint8_t* data, size_t length) override {
+		if(closed){return -1;}
+		size_t n = std::min(length, out.size());
+		for(size_t i = 0; i < n; i++){
+			data[i] = out.front();
+			out.pop_front();
+		}
+		return (int)n;
+	}
+
+private:
+	std::deque<uint8_t> out;
+	std::set<uint16_t> unacked;
+	void answer(std::initializer_list<uint8_t> packet){
+		out.insert(out.end(), packet.begin(), packet.end());
+	}
+};
+
+// runs the MQTTSession against the fake broker on a simulated clock, returns false when a message was lost.
+static int runFake(unsigned messages, unsigned ack_loss){
+	FakeBroker broker;
+	broker.ack_loss = ack_loss;
+	srandom(1);
+	MQTTSession session(broker);
+	// the messages that were handed off at a disconnect are published first after the reconnect, like MQTT_UNACKED_FILE.
+	std::deque<std::string> handed_off;
+	session.setUnackedCallback([](attributes, const uint8_t* payload, size_t length, void* context){
+		((std::deque<std::string>*)context)->push_back(std::string((const char*)payload, length));
+	}, &handed_off);
+	std::string name = topic(BATCH);
+
+	uint32_t now = 0;
+	unsigned next = 0;
+	unsigned reconnects = 0;
+	while(next < messages || session.inFlight() || !handed_off.empty()){
+		now += 10;
+		if(!session.connected()){
+			if(session.getState() == MQTTSession::State::Closed){
+				if(broker.connects){reconnects++;}
+				broker.reconnect();
+				session.connect(CLIENT_ID, nullptr, nullptr, 15, now);
+			}
+			session.poll(now);
+			continue;
+		}
+		while(session.connected() && session.windowFree()){
+			std::string payload;
+			if(!handed_off.empty()){
+				payload = handed_off.front();
+				handed_off.pop_front();
+			}
+			else if(next < messages){
+				payload = "{\"seq\":" + std::to_string(next++) + "}";
+			}
+			else{
+				break;
+			}
+			session.publish(BATCH, name.c_str(), (const uint8_t*)payload.data(), payload.size(), 1, now);
+		}
+		session.poll(now);
+		if(now > 3600000u){
+			fprintf(stderr, "the fake run doesn't finish\n");
+			return 1;
+		}
+	}
+
+	MQTTSessionStats S = session.getStats();
+	size_t lost = messages - broker.delivered.size();
+	printf("%u messages against the fake broker with %u%% lost PUBACKs, %u reconnects, %.1f s simulated\n", messages, ack_loss, reconnects, now / 1000.0);
+	printf("published %u acked %u retransmits %u (dup flags %zu) handed off %u window full %u max ack %u ms\n",
+		S.published, S.acked, S.retransmits, broker.dup_flags, S.handed_off, S.window_full, S.max_ack_ms);
+	printf("delivered %zu duplicates %zu lost %zu packet id errors %zu\n", broker.delivered.size(), broker.duplicates, lost, broker.id_errors);
+	return lost || broker.id_errors ? 1 : 0;
+}
+
+// opens a TCP connection, returns -1 when it fails.
+static int openSocket(const char* host, const char* port){
+	addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo* addr;
+	if(getaddrinfo(host, port, &hints, &addr)){return -1;}
+	int fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+	if(fd >= 0 && connect(fd, addr->ai_addr, addr->ai_addrlen)){
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(addr);
+	if(fd < 0){return -1;}
+	// every publish goes out in its own segment, as the lwIP stack of the ESP32 does for every TLS record.
+	int one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	return fd;
+}
+
+static double percentile(std::vector<double> v, double p){
+	if(v.empty()){return 0;}
+	std::sort(v.begin(), v.end());
+	size_t i = (size_t)(p * (v.size() - 1) + 0.5);
+	return v[i];
+}
+
+static double mean(const std::vector<double>& v){
+	double sum = 0;
+	for(double x : v){sum += x;}
+	return v.empty() ? 0 : sum / v.size();
+}
+
+static void printResult(const char* mode, const Result& R, unsigned cycles){
+	printf("%-9s %8.1f %8.1f %8.1f %8.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n", mode,
+		(double)R.messages / cycles, (double)R.payload_bytes / cycles, (double)R.mqtt_bytes / cycles, (double)R.wire_bytes / cycles,
+		mean(R.send_us), mean(R.latency_us), percentile(R.latency_us, 0.5), percentile(R.latency_us, 0.99),
+		percentile(R.latency_us, 1.0));
+}
+
+int main(int argc, char** argv){
+	if(argc > 1 && !strcmp(argv[1], "fake")){
+		const unsigned messages = argc > 2 ? (unsigned)atoi(argv[2]) : 1000;
+		const unsigned loss = argc > 3 ? (unsigned)atoi(argv[3]) : 20;
+		if(argc > 4 || !messages || loss >= 100){
+			fprintf(stderr, "usage: %s fake [messages] [ack loss %%]\n", argv[0]);
+			return 1;
+		}
+		return runFake(messages, loss);
+	}
+	const char* host = argc > 1 ? argv[1] : "127.0.0.1";
+	const char* port = argc > 2 ? argv[2] : "1883";
+	const unsigned cycles = argc > 3 ? (unsigned)atoi(argv[3]) : 200;
+	if(argc > 4 || !cycles){
+		fprintf(stderr, "usage: %s [host] [port] [cycles]\n", argv[0]);
+		return 1;
+	}
+
+	int fd = openSocket(host, port);
+	int qos_fd = openSocket(host, port);
+	if(fd < 0 || qos_fd < 0){
+		fprintf(stderr, "can't connect to %s:%s\n", host, port);
+		return 1;
+	}
+
+	// CONNECT with a clean session and a 60 second keep alive.
+	std::string body;
+	putString(body, "MQTT");
+	body += (char)4;    // protocol level 3.1.1
+	body += (char)0x02; // clean session
+	body += (char)0;
+	body += (char)60;
+	putString(body, CLIENT_ID);
+	if(!sendAll(fd, packet(0x10, body)) || readPacket(fd, body) != 2 || body.size() < 2 || body[1] != 0){
+		fprintf(stderr, "the broker refused the connection\n");
+		return 1;
+	}
+	// SUBSCRIBE to the own topics with QoS 0, so every publish comes back once.
+	body = std::string("\x00\x01", 2);
+	putString(body, std::string("alkmaar/") + CLIENT_ID + "/writeattributevalue/#");
+	body += (char)0;
+	if(!sendAll(fd, packet(0x82, body)) || readPacket(fd, body) != 9){
+		fprintf(stderr, "the broker refused the subscription\n");
+		return 1;
+	}
+
+	SocketTransport transport(qos_fd);
+	MQTTSession session(transport);
+	if(!connectSession(session, qos_fd, "MQTTBench-qos")){
+		fprintf(stderr, "the broker refused the QoS 1 connection\n");
+		return 1;
+	}
+
+	Result per_attribute, batched, stop_and_wait, windowed, batched_qos;
+	for(unsigned c = 0; c < cycles; c++){
+		// alternate the modes, so all see the same state of the broker and the host.
+		bool ok = runCycle(fd, c, false, per_attribute) && runCycle(fd, c, true, batched);
+		session.setWindow(1);
+		ok = ok && runQoS1(session, qos_fd, c, false, stop_and_wait);
+		session.setWindow(MQTT_INFLIGHT_WINDOW);
+		ok = ok && runQoS1(session, qos_fd, c, false, windowed) && runQoS1(session, qos_fd, c, true, batched_qos);
+		if(!ok){
+			fprintf(stderr, "the connection was lost in cycle %u\n", c);
+			return 1;
+		}
+	}
+	close(fd);
+	close(qos_fd);
+
+	printf("%u cycles against %s:%s, the wire bytes are estimated for TLS 1.2 AES-GCM over TCP/IPv4.\n", cycles, host, port);
+	printf("%-9s %8s %8s %8s %8s %9s %9s %9s %9s %9s\n", "mode", "msgs", "payload", "mqtt", "wire",
+		"send_us", "avg_us", "p50_us", "p99_us", "max_us");
+	printResult("attribute", per_attribute, cycles);
+	printResult("batch", batched, cycles);
+	printResult("q1 attr 1", stop_and_wait, cycles);
+	char mode[16];
+	snprintf(mode, sizeof(mode), "q1 attr %d", MQTT_INFLIGHT_WINDOW);
+	printResult(mode, windowed, cycles);
+	printResult("q1 batch", batched_qos, cycles);
+	MQTTSessionStats S = session.getStats();
+	printf("QoS 1: published %u acked %u retransmits %u window full %u max ack %u ms\n", S.published, S.acked, S.retransmits, S.window_full, S.max_ack_ms);
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,211 @@
+#include "LogBench.h"
+#include "../../src/Logger/LogBuffer.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+// path of the log file on the storage under test.
+#define LOG_BENCH_FILE "/logbench.txt"
+
+// texts of the simulated log statements, about the lengths the sensors log.
+static const char* const LOG_BENCH_TEXTS[] = {
+	"[SCD30] CO2: 412.00 ppm, Temperature: 21.50 C, Humidity: 40.00 %",
+	"[Ambimate] Temperature: 21.62 C, Humidity: 39.80 %, Light: 312 lux, VOC: 3 ppb",
+	"[AS7262] V: 10.12, B: 11.40, G: 12.05, Y: 13.77, O: 14.02, R: 15.31",
+	"[SMUART] PM1.0: 3, PM2.5: 5, PM10: 7 ug/m3",
+	"[MAX4466] 48.20 dB(A)",
+	"[MQTT] Published 12 records",
+};
+static const size_t LOG_BENCH_TEXT_COUNT = sizeof(LOG_BENCH_TEXTS) / sizeof(LOG_BENCH_TEXTS[0]);
+
+/**
+ * @brief Counts the calls on a file of the CountingStorage.
+ */
+class CountingFile : public iStorageFile {
+private:
+	StorageFile file;
+	LogBenchResult& result;
+	bool dirty = false;
+
+public:
+	CountingFile(StorageFile opened, LogBenchResult& result) : file(std::move(opened)), result(result) {}
+	virtual ~CountingFile(){
+		if(dirty){result.syncs++;} // closing a written file updates its directory entry.
+	}
+
+	virtual size_t read(uint8_t* buffer, size_t len){ return file.read(buffer, len); }
+	virtual size_t write(const uint8_t* data, size_t len){
+		result.writes++;
+		dirty = true;
+		size_t written = file.write(data, len);
+		result.bytes += written;
+		return written;
+	}
+	virtual bool seek(size_t pos){
+		result.seeks++;
+		return file.seek(pos);
+	}
+	virtual size_t size(){ return file.size(); }
+	virtual void flush(){
+		result.syncs++;
+		dirty = false;
+		file.flush();
+	}
+};
+
+/**
+ * @brief Passes the calls to another storage and counts the opens and the calls on the opened files.
+ */
+class CountingStorage : public iStorage {
+private:
+	iStorage& storage;
+	LogBenchResult& result;
+
+public:
+	CountingStorage(iStorage& storage, LogBenchResult& result) : storage(storage), result(result) {}
+
+	virtual const char* name() const { return storage.name(); }
+	virtual bool begin(){ return storage.begin(); }
+	virtual void end(){ storage.end(); }
+	virtual bool present(){ return storage.present(); }
+
+	virtual StorageFile open(const char* path, StorageMode mode){
+		result.opens++;
+		if(mode == StorageMode::Append){result.seeks++;} // the file system seeks to the end of the file.
+		StorageFile file = storage.open(path, mode);
+		if(!file){return file;}
+		return StorageFile(new CountingFile(std::move(file), result));
+	}
+	virtual bool exists(const char* path){ return storage.exists(path); }
+	virtual bool remove(const char* path){ return storage.remove(path); }
+	virtual bool rename(const char* from, const char* to){ return storage.rename(from, to); }
+	virtual bool mkdir(const char* path){ return storage.mkdir(path); }
+	virtual bool rmdir(const char* path){ return storage.rmdir(path); }
+	virtual bool listDir(const char* path, Storage_DirCallback callback, void* context){ return storage.listDir(path, callback, context); }
+
+	virtual uint64_t totalBytes(){ return storage.totalBytes(); }
+	virtual uint64_t usedBytes(){ return storage.usedBytes(); }
+};
+
+/**
+ * @brief The log file of a run, written directly or through a LogBuffer like the Logger does.
+ */
+class BenchLog {
+private:
+	iStorage& storage;
+	bool buffered;
+	LogBuffer buffer;
+	// the stream of the buffered mode, opened by the first flush like __W_SD::openStream().
+	StorageFile stream;
+	uint32_t last_sync = 0;
+	bool dirty = false;
+	uint32_t now = 0;
+	ERR_Type error = SUCCESS;
+
+	// appends a part of the buffer to the stream, like __W_SD::appendStream().
+	static ERR_Type append(const uint8_t* data, size_t len, void* context){
+		BenchLog* log = (BenchLog*)context;
+		if(log->stream.write(data, len) != len){return SD_APP_FAIL;}
+		log->dirty = true;
+		if(log->now - log->last_sync >= SD_SYNC_INTERVAL){log->sync();}
+		return SUCCESS;
+	}
+
+	void flush(bool all){
+		if(!stream){
+			stream = storage.open(LOG_BENCH_FILE, StorageMode::Append);
+			last_sync = now;
+		}
+		ERR_Type ET = buffer.flush(all, now, stream ? append : nullptr, this);
+		if(!stream){ET = SD_FILE_OPEN_FAIL;}
+		if(ET && !error){error = ET;}
+	}
+
+public:
+	BenchLog(iStorage& storage, bool buffered) : storage(storage), buffered(buffered) { buffer.setFlushTime(0); }
+
+	// writes a part of a log line, like Logger::SD_write().
+	void write(const char* s, size_t len){
+		if(!buffered){
+			// __W_SD::appendFile(): open, write and close for every part.
+			StorageFile file = storage.open(LOG_BENCH_FILE, StorageMode::Append);
+			if(!file || file.write((const uint8_t*)s, len) != len){
+				if(!error){error = SD_APP_FAIL;}
+			}
+			return;
+		}
+		while(len){
+			if(buffer.full()){flush(false);}
+			size_t n = buffer.write(s, len);
+			s += n;
+			len -= n;
+		}
+	}
+
+	// ends a log line, like Logger::SD_checkFlush().
+	void endLine(bool is_error){
+		if(!buffered){return;}
+		LogFlush F = buffer.due(is_error, now);
+		if(F != LogFlush::None){flush(F == LogFlush::All);}
+	}
+
+	void sync(){
+		if(stream && dirty){
+			stream.flush();
+			dirty = false;
+		}
+		last_sync = now;
+	}
+
+	// writes what is left in the buffer and syncs, like Logger::flush().
+	ERR_Type close(){
+		if(buffered){
+			flush(true);
+			sync();
+			stream.close();
+		}
+		return error;
+	}
+
+	void setTime(uint32_t ms){ now = ms; }
+};
+
+ERR_Type runLogBench(iStorage& storage, bool buffered, const LogBenchOptions& opt, LogBenchResult& result){
+	result = {buffered ? "buffered" : "direct", 0, 0, 0, 0, 0, 0, 0};
+	storage.remove(LOG_BENCH_FILE);
+	CountingStorage counting(storage, result);
+	BenchLog log(counting, buffered);
+
+	auto start = std::chrono::steady_clock::now();
+	for(uint32_t loop = 0; loop < opt.loops; loop++){
+		uint32_t now = loop * opt.period;
+		log.setTime(now);
+		char time[16];
+		snprintf(time, sizeof(time), "%02u:%02u:%02u", (unsigned)(now / 3600000 % 24), (unsigned)(now / 60000 % 60), (unsigned)(now / 1000 % 60));
+		for(uint32_t line = 0; line < opt.lines; line++){
+			bool is_error = line < opt.errors;
+			const char* text = LOG_BENCH_TEXTS[(loop * opt.lines + line) % LOG_BENCH_TEXT_COUNT];
+			// the parts of Logger::SD_print_LL_type() and Logger::SD_text().
+			log.write("[", 1);
+			log.write(time, strlen(time));
+			log.write("] ", 2);
+			log.write(is_error ? "[Err ]: " : "[Info]: ", 8);
+			log.write(text, strlen(text));
+			log.write("\n", 1);
+			log.endLine(is_error);
+			result.lines++;
+		}
+	}
+	ERR_Type ET = log.close();
+	result.total_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	storage.remove(LOG_BENCH_FILE);
+	return ET;
+}
+
+void formatLogBenchResult(const LogBenchResult& result, uint32_t loops, char* line, size_t size){
+	double n = loops ? loops : 1;
+	snprintf(line, size, "%s,%u,%u,%llu,%u,%u,%u,%u,%llu,%.2f,%.2f,%.2f,%.2f", result.mode, (unsigned)loops, (unsigned)result.lines,
+		(unsigned long long)result.bytes, (unsigned)result.opens, (unsigned)result.seeks, (unsigned)result.writes, (unsigned)result.syncs,
+		(unsigned long long)result.total_us, result.opens / n, result.seeks / n, result.writes / n, result.syncs / n);
+}
\ No newline at end of file
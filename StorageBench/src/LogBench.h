@@ -0,0 +1,74 @@
+/**
+ * @file LogBench.h
+ * @author Imre Korf
+ * @brief Counts the storage calls of the SD log with and without the LogBuffer of the Logger.
+ * @version 0.1
+ * @date 2022-04-05
+ *
+ * Every simulated loop logs a number of lines the way Logger::SD_text() does: the time and level header, the text of the
+ * statement and the line end, each as a separate write to the log.
+ * Mode | Description
+ * :-----:|:-----------------------------:
+ *  direct | every write to the log is an append to the log file: open, write and close, as before the LogBuffer
+ *  buffered | the writes go through a LogBuffer with the flush policy of the Logger into a stream that stays open and is synced every SD_SYNC_INTERVAL ms
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include "../../src/Wrappers/Storage/iStorage.h"
+#include "../../src/Defines/Defines.h"
+
+#include <stdint.h>
+
+/**
+ * @brief Settings of a log bench run.
+ */
+struct LogBenchOptions {
+	/** Amount of simulated loops. */
+	uint32_t loops;
+	/** Amount of log lines per loop. */
+	uint32_t lines;
+	/** Amount of the lines per loop that are errors, these are flushed immediately by the buffered mode. */
+	uint32_t errors;
+	/** Time in ms between two loops. */
+	uint32_t period;
+};
+
+/**
+ * @brief Counted storage calls of a log bench run.
+ */
+struct LogBenchResult {
+	/** Name of the mode. */
+	const char* mode;
+	/** Amount of log lines. */
+	uint32_t lines;
+	/** Amount of bytes written to the log file. */
+	uint64_t bytes;
+	/** Amount of opened files. */
+	uint32_t opens;
+	/** Amount of seeks, an open in append mode counts as a seek to the end of the file. */
+	uint32_t seeks;
+	/** Amount of write calls. */
+	uint32_t writes;
+	/** Amount of syncs, a flush or the close of a written file. */
+	uint32_t syncs;
+	/** Wall time of the run in us. */
+	uint64_t total_us;
+};
+
+/**
+ * @brief Logs opt.loops loops of log lines to a file on the storage and counts the storage calls.
+ * @param storage the storage, the log file is removed afterwards.
+ * @param buffered run the buffered mode instead of the direct mode.
+ * @param opt the settings.
+ * @param result the counters.
+ * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+ */
+ERR_Type runLogBench(iStorage& storage, bool buffered, const LogBenchOptions& opt, LogBenchResult& result);
+
+/**
+ * @brief Formats a result as a CSV line: mode,loops,lines,bytes,opens,seeks,writes,syncs,total_us and the calls per loop.
+ */
+void formatLogBenchResult(const LogBenchResult& result, uint32_t loops, char* line, size_t size);
\ No newline at end of file
@@ -0,0 +1,87 @@
+/**
+ * @file main.cpp
+ * @author Imre Korf
+ * @brief Runs the SD benchmark of the SenseBox on a directory of the host.
+ * @version 0.1
+ * @date 2022-03-09
+ *
+ * usage: StorageBench <directory> [results.csv]
+ *        StorageBench --log <directory> [loops] [lines] [errors] [period_ms]
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+#include "../../src/Wrappers/Storage/POSIX_Storage.h"
+#include "../../src/Wrappers/SD/SD_Benchmark.h"
+#include "LogBench.h"
+
+// counts the storage calls of the SD log with and without the LogBuffer.
+static int runLog(int argc, char** argv){
+	if(argc < 3){
+		fprintf(stderr, "usage: %s --log <directory> [loops] [lines] [errors] [period_ms]\n", argv[0]);
+		return 1;
+	}
+	POSIX_Storage storage(argv[2]);
+	if(!storage.begin()){
+		fprintf(stderr, "can't use directory %s\n", argv[2]);
+		return 1;
+	}
+	LogBenchOptions opt = {100, 20, 0, 1000};
+	if(argc > 3){opt.loops = strtoul(argv[3], nullptr, 10);}
+	if(argc > 4){opt.lines = strtoul(argv[4], nullptr, 10);}
+	if(argc > 5){opt.errors = strtoul(argv[5], nullptr, 10);}
+	if(argc > 6){opt.period = strtoul(argv[6], nullptr, 10);}
+
+	char line[160];
+	printf("mode,loops,lines,bytes,opens,seeks,writes,syncs,total_us,opens_per_loop,seeks_per_loop,writes_per_loop,syncs_per_loop\n");
+	for(int buffered = 0; buffered < 2; buffered++){
+		LogBenchResult result;
+		ERR_Type ET = runLogBench(storage, buffered, opt, result);
+		if(ET){
+			fprintf(stderr, "log bench failed with error %d\n", (int)ET);
+			return 1;
+		}
+		formatLogBenchResult(result, opt.loops, line, sizeof(line));
+		printf("%s\n", line);
+	}
+	return 0;
+}
+
+int main(int argc, char** argv){
+	if(argc > 1 && !strcmp(argv[1], "--log")){
+		return runLog(argc, argv);
+	}
+	if(argc < 2){
+		fprintf(stderr, "usage: %s <directory> [results.csv]\n       %s --log <directory> [loops] [lines] [errors] [period_ms]\n", argv[0], argv[0]);
+		return 1;
+	}
+	POSIX_Storage storage(argv[1]);
+	if(!storage.begin()){
+		fprintf(stderr, "can't use directory %s\n", argv[1]);
+		return 1;
+	}
+
+	// the CSV file is written in the directory under test, like on the SD card.
+	const char* csv_path = argc > 2 ? argv[2] : SD_BENCH_CSV;
+	std::unique_ptr<SD_Benchmark> bench(new SD_Benchmark(storage));
+	ERR_Type ET = bench->run(csv_path);
+
+	size_t count;
+	const SD_BenchResult* results = bench->getResults(count);
+	char line[128];
+	printf("test,block,ops,bytes,total_us,kBps,min_us,p50_us,p99_us,max_us\n");
+	for(size_t i = 0; i < count; i++){
+		SD_Benchmark::formatResult(results[i], line, sizeof(line));
+		printf("%s\n", line);
+	}
+	if(ET){
+		fprintf(stderr, "benchmark failed with error %d\n", (int)ET);
+		return 1;
+	}
+	return 0;
+}
\ No newline at end of file
@@ -54,14 +54,592 @@
  */
 #define LOGLEVEL 3
 
+/** @brief LOG_FORMAT value for human readable log files. */
+#define LOG_FORMAT_TEXT 0
+/** @brief LOG_FORMAT value for binary log files, these can be turned into text with the LogDecoder tool. */
+#define LOG_FORMAT_BINARY 1
 /**
- * @brief The amount of retries the ESP32 will try to connect to the provided WiFi network before timing out.
+ * @brief Format of the log files on the SD card, either LOG_FORMAT_TEXT or LOG_FORMAT_BINARY.
+ * Binary log files store every log line as a small record with a message id and the raw arguments instead of formatted text.
+ * The Serial output is always text.
+ */
+#define LOG_FORMAT LOG_FORMAT_TEXT
+/**
+ * @brief Maximum length in bytes of a single formatted log message.
+ * Must be below 254 so a line fits in a single binary text record.
+ */
+#define LOG_LINE_SIZE 160
+
+#if LOG_FORMAT == LOG_FORMAT_BINARY
+/** @brief Extension of the log files. */
+#define LOG_FILE_EXTENSION ".bin"
+#else
+#define LOG_FILE_EXTENSION ".txt"
+#endif
+
+/**
+ * @brief Time in seconds an attempt to join the provided WiFi network may take before the client backs off and tries again.
  */
 #define WIFI_TIMEOUT 50
 /**
- * @brief The amount of retries the ESP32 will try to connect to the MQTT Broker before timing out.
+ * @brief Time in seconds the TLS handshake and the answer of the MQTT broker to a CONNECT may take.
+ */
+#define MQTT_CONN_TIMEOUT 10
+/**
+ * @brief Time in ms to wait after the first failed connection attempt, doubled after every next failure.
+ * The actual wait is a random time between half and all of it, so devices don't retry in lockstep.
+ */
+#define MQTT_BACKOFF_MIN 1000
+/**
+ * @brief Highest time in ms to wait between two connection attempts.
+ */
+#define MQTT_BACKOFF_MAX 120000
+/**
+ * @brief Core of the task that runs the blocking TLS handshake and MQTT CONNECT.
+ */
+#define MQTT_CONNECT_CORE 0
+/**
+ * @brief Priority of the MQTT connect task, below the sampling task.
+ */
+#define MQTT_CONNECT_PRIORITY 1
+/**
+ * @brief Stack size in bytes of the MQTT connect task, the TLS handshake needs most of it.
+ */
+#define MQTT_CONNECT_STACK 8192
+/**
+ * @brief Maximum size in bytes of the MQTT settings file.
+ */
+#define MQTT_SETTINGS_SIZE 2048
+/**
+ * @brief Set to 1 to publish all the measurements that are queued in a network cycle as one json message on the Batch attribute.
+ * Set to 0 to publish every measurement on its own attribute topic.
+ */
+#define MQTT_BATCH 1
+/**
+ * @brief Size in bytes of the payload of a batch message, should hold the measurements of every sensor at once.
+ */
+#define MQTT_BATCH_SIZE 1024
+/**
+ * @brief Size in bytes of the buffer in which a single value is formatted, the json objects of the attributes are checked against it at compile time.
+ */
+#define MQTT_PAYLOAD_SIZE 192
+/**
+ * @brief Size in bytes of the arena that holds the topics of all the attributes, built once by MQTTClient::init().
+ * Every topic takes the length of the client id, the asset id and the attribute name plus 30 bytes.
+ */
+#define MQTT_TOPIC_ARENA 2048
+/**
+ * @brief QoS of the published messages. With 1 every message is kept until the broker acknowledges it, with 0 it is sent once.
+ */
+#define MQTT_QOS 1
+/**
+ * @brief Maximum amount of QoS 1 messages that wait for their PUBACK at once, every one takes MQTT_PACKET_SIZE bytes.
+ */
+#define MQTT_INFLIGHT_WINDOW 8
+/**
+ * @brief Time in ms after which a QoS 1 message without PUBACK is sent again.
+ */
+#define MQTT_ACK_TIMEOUT 5000
+/**
+ * @brief Size in bytes of an encoded message, should hold a batch or a value with its topic and a 9 byte header.
+ */
+#define MQTT_PACKET_SIZE 1280
+/**
+ * @brief Size in bytes of the received packets, larger messages on the subscriptions are skipped.
+ */
+#define MQTT_RX_SIZE 512
+/**
+ * @brief Keep alive interval in seconds of the MQTT session.
+ */
+#define MQTT_KEEP_ALIVE 15
+/**
+ * @brief File in which the QoS 1 messages that were not acknowledged are kept when the connection is lost.
+ * They are published again after the reconnect.
+ */
+#define MQTT_UNACKED_FILE "/unacked.bin"
+/**
+ * @brief Time in ms before MQTT_UNACKED_FILE is read again after a failed read, for example while the storage is busy.
+ */
+#define MQTT_UNACKED_RETRY 1000
+
+/**
+ * @brief GPIO of the SDA line of the I2C bus.
+ */
+#define I2C_SDA_PIN 21
+/**
+ * @brief GPIO of the SCL line of the I2C bus.
+ */
+#define I2C_SCL_PIN 22
+/**
+ * @brief Clock in Hz of the I2C transactions with the Ambimate.
+ */
+#define I2C_CLOCK_AMBIMATE 100000
+/**
+ * @brief Clock in Hz of the I2C transactions with the AS7262, which supports fast mode.
+ */
+#define I2C_CLOCK_AS7262 400000
+/**
+ * @brief Clock in Hz of the I2C transactions with the SCD30. It stretches the clock and Sensirion recommends at most 50 kHz.
+ */
+#define I2C_CLOCK_SCD30 50000
+/**
+ * @brief Clock in Hz of the I2C transactions with the TSL2591, which supports fast mode.
+ */
+#define I2C_CLOCK_TSL2591 400000
+/**
+ * @brief Clock in Hz of the I2C transactions with the PCF8563 RTC, which supports fast mode.
+ */
+#define I2C_CLOCK_RTC 400000
+/**
+ * @brief Timeout in ms of a single I2C transaction.
+ */
+#define I2C_TIMEOUT 50
+/**
+ * @brief Timeout in ms of a single I2C transaction with the SCD30, long enough for its clock stretching.
+ */
+#define I2C_TIMEOUT_SCD30 200
+/**
+ * @brief Time in ms a task waits for the I2C bus when another task is using it.
+ */
+#define I2C_LOCK_TIMEOUT 1000
+/**
+ * @brief Amount of failed I2C transactions in a row after which the bus is cleared by toggling SCL.
+ */
+#define I2C_RECOVER_ERRORS 3
+
+/**
+ * @brief I2C address of the PCF8563 RTC.
+ */
+#define RTC_I2C_ADDRESS 0x51
+/**
+ * @brief Time in ms after which the clock of the ESP32 is resynced with the RTC.
+ * In between the time is interpolated with the ESP32 timer, so reading the time does not cause any I2C traffic.
  */
-#define MQTT_CONN_TIMEOUT 20
+#define RTC_RESYNC_INTERVAL 3600000
+
+/**
+ * @brief GPIO of the SD card detect switch. The pin reads LOW when a card is inserted.
+ */
+#define SD_DETECT_PIN 25
+/**
+ * @brief Maximum time in ms between two syncs of an open SD stream.
+ * Data written to a stream is only guaranteed to be on the card after a sync.
+ */
+#define SD_SYNC_INTERVAL 10000
+/**
+ * @brief Default size in bytes of the blocks in which __W_SD::readFileChunks() reads a file.
+ */
+#define SD_READ_BLOCK_SIZE 512
+/**
+ * @brief Set to 1 to dump the content of every file read by __W_SD to the log with the DataDump loglevel.
+ * This is slow, so it should only be used for debugging.
+ */
+#define SD_DUMP_READS 0
+
+/**
+ * @brief Set to 1 to store the files on LittleFS on the internal flash when the SD card is absent or fails.
+ * The flash only has room for a few log files, the oldest are removed by the log retention.
+ */
+#define STORAGE_FLASH_FALLBACK 1
+/**
+ * @brief Set to 1 to format the LittleFS partition when it can not be mounted, for example on the first boot.
+ */
+#define STORAGE_FLASH_FORMAT 1
+/**
+ * @brief Time in ms between two attempts to mount the SD card again while the flash fallback is used.
+ * Mounting a card that is inserted but broken takes a long time, so it is not tried on every write.
+ */
+#define STORAGE_RETRY_INTERVAL 60000
+/**
+ * @brief Time in ms a task waits for the storage when another task is using it.
+ * The Logger writer task, the network task and the spool share the storage, so this should be longer than a log flush.
+ */
+#define SD_LOCK_TIMEOUT 2000
+/**
+ * @brief Maximum length of a path in the POSIX storage, including the root directory.
+ */
+#define STORAGE_PATH_SIZE 256
+
+/**
+ * @brief Set to 1 to run the SD benchmark at startup, the results are written to SD_BENCH_CSV.
+ * @see SD_Benchmark
+ */
+#define SD_BENCHMARK 0
+/**
+ * @brief Directory in which the SD benchmark creates its test files, is removed afterwards.
+ */
+#define SD_BENCH_DIR "/bench"
+/**
+ * @brief Path of the CSV file with the results of the SD benchmark.
+ */
+#define SD_BENCH_CSV "/bench.csv"
+/**
+ * @brief Smallest block size in bytes used by the SD benchmark, the block size is doubled up to SD_BENCH_MAX_BLOCK.
+ */
+#define SD_BENCH_MIN_BLOCK 64
+/**
+ * @brief Largest block size in bytes used by the SD benchmark.
+ */
+#define SD_BENCH_MAX_BLOCK 32768
+/**
+ * @brief Size in bytes of the test file of the sequential and random SD benchmarks.
+ */
+#define SD_BENCH_FILE_SIZE 262144
+/**
+ * @brief Maximum amount of timed operations per SD benchmark, every operation takes 4 bytes of RAM.
+ */
+#define SD_BENCH_MAX_SAMPLES 1024
+/**
+ * @brief Amount of appends done by the SD append benchmarks.
+ */
+#define SD_BENCH_APPEND_OPS 256
+/**
+ * @brief Amount of directories and files used by the SD mkdir, rename and remove benchmarks.
+ */
+#define SD_BENCH_META_OPS 32
+
+/**
+ * @brief Size in bytes of the RAM buffer in which the Logger collects SD log lines before writing them to the SD card.
+ * Should be a multiple of LOG_FLUSH_SIZE.
+ */
+#define LOG_BUFFER_SIZE 4096
+/**
+ * @brief Amount of buffered bytes after which the Logger writes to the SD card.
+ * Writes are done in chunks of this size, which should match the SD sector size (512 bytes).
+ */
+#define LOG_FLUSH_SIZE 512
+/**
+ * @brief Maximum time in ms that a log line may stay in the Logger's RAM buffer before it is written to the SD card.
+ */
+#define LOG_FLUSH_INTERVAL 5000
+
+/**
+ * @brief Maximum size in bytes of a log file, once it is reached the Logger continues in a new file.
+ * The Logger also starts a new file at midnight.
+ */
+#define LOG_MAX_FILE_SIZE 1048576
+/**
+ * @brief Maximum amount of log files on the SD card, the oldest log file is deleted when a new one is started.
+ */
+#define LOG_MAX_FILES 10
+/**
+ * @brief Free space in bytes that the Logger keeps on the SD card by deleting the oldest log files.
+ */
+#define LOG_MIN_FREE_SPACE 16777216
+/**
+ * @brief Path of the file in which the Logger keeps track of its log files.
+ */
+#define LOG_INDEX_FILE "/logindex.dat"
+/**
+ * @brief Maximum length of a log file path in the log index, including the null terminator.
+ */
+#define LOG_INDEX_PATH_SIZE 32
+/**
+ * @brief Set to 1 to let a separate writer task print the log statements to the serial and SD card.
+ * Log statements are then only copied into the LogQueue, so they do not wait on the serial or SD card.
+ * Set to 0 to print the log statements directly in the task that calls the Logger.
+ */
+#define LOG_ASYNC 1
+/**
+ * @brief Amount of log entries that fit in the LogQueue, should be a power of 2.
+ */
+#define LOG_QUEUE_LENGTH 64
+/**
+ * @brief Size in bytes of a single entry in the LogQueue. Longer print statements are split over consecutive entries, which are queued as one block.
+ */
+#define LOG_ENTRY_SIZE 128
+/**
+ * @brief Amount of LogQueue entries that are kept free for warnings and errors.
+ * Info and lower messages are dropped once less entries are free.
+ */
+#define LOG_QUEUE_RESERVE 8
+/**
+ * @brief Maximum time in ms that an error waits for a free LogQueue entry before it is dropped.
+ * Warnings and lower messages are dropped immediately when the LogQueue is full.
+ */
+#define LOG_QUEUE_ERROR_WAIT 10
+/**
+ * @brief Core on which the Logger writer task runs. The Arduino loop runs on core 1.
+ */
+#define LOG_TASK_CORE 0
+/**
+ * @brief Priority of the Logger writer task.
+ */
+#define LOG_TASK_PRIORITY 1
+/**
+ * @brief Stack size in bytes of the Logger writer task.
+ */
+#define LOG_TASK_STACK 4096
+/**
+ * @brief Time in ms the Logger writer task sleeps when the LogQueue is empty.
+ */
+#define LOG_TASK_PERIOD 10
+
+/**
+ * @brief Maximum amount of tasks in the Scheduler.
+ */
+#define SCHEDULER_MAX_TASKS 8
+/**
+ * @brief Maximum time in ms between two checks of a running measurement.
+ */
+#define SCHEDULER_POLL_INTERVAL 10
+/**
+ * @brief Time in ms between two measurements of the Ambimate.
+ */
+#define SBOX_PERIOD_AMBIMATE 5000
+/**
+ * @brief Time in ms between two measurements of the AS7262.
+ */
+#define SBOX_PERIOD_AS7262 5000
+/**
+ * @brief Time in ms between two measurements of the SM-UART-04L, the sensor sends a frame every second.
+ */
+#define SBOX_PERIOD_LDS 5000
+/**
+ * @brief Time in ms between two measurements of the MAX4466.
+ */
+#define SBOX_PERIOD_MAX4466 1000
+/**
+ * @brief Time in ms between two measurements of the MIX8410.
+ */
+#define SBOX_PERIOD_MIX8410 1000
+/**
+ * @brief Time in ms between two measurements of the SCD30, should not be below its measurement interval of 2 s.
+ */
+#define SBOX_PERIOD_SCD30 2000
+/**
+ * @brief Time in ms between two measurements of the TSL2591.
+ */
+#define SBOX_PERIOD_TSL2591 5000
+/**
+ * @brief Time in ms after which a measurement that is not ready is given up.
+ */
+#define SBOX_TIMEOUT 3000
+/**
+ * @brief Time in ms the Ambimate needs to scan its sensors after the scan command.
+ */
+#define AMBIMATE_SCAN_TIME 100
+/**
+ * @brief Time in ms after init before the Ambimate accepts its first scan command.
+ */
+#define AMBIMATE_STARTUP_TIME 1000
+/**
+ * @brief UART of the SM-UART-04L dust sensor.
+ */
+#define LDS_UART UART_NUM_2
+/**
+ * @brief GPIO of the RX pin of the dust sensor UART.
+ */
+#define LDS_RX_PIN 16
+/**
+ * @brief GPIO of the TX pin of the dust sensor UART.
+ */
+#define LDS_TX_PIN 17
+/**
+ * @brief Baud rate of the SM-UART-04L.
+ */
+#define LDS_BAUD 9600
+/**
+ * @brief Size in bytes of the receive ring buffer of the dust sensor UART, filled by the UART interrupt.
+ */
+#define LDS_RX_BUFFER 512
+/**
+ * @brief Length of the event queue of the dust sensor UART.
+ */
+#define LDS_EVENT_QUEUE 16
+/**
+ * @brief Core on which the dust sensor UART task runs.
+ */
+#define LDS_TASK_CORE 0
+/**
+ * @brief Priority of the dust sensor UART task.
+ */
+#define LDS_TASK_PRIORITY 2
+/**
+ * @brief Stack size in bytes of the dust sensor UART task.
+ */
+#define LDS_TASK_STACK 2048
+/**
+ * @brief Sample rate in Hz of the MAX4466 microphone, sampled by the I2S ADC.
+ */
+#define MAX4466_SAMPLE_RATE 16000
+/**
+ * @brief Amount of samples in an analyzed audio block, a power of 2. 512 samples are 32 ms at 16 kHz.
+ */
+#define MAX4466_FFT_SIZE 512
+/**
+ * @brief Amount of DMA buffers of the I2S ADC, each holds MAX4466_FFT_SIZE samples.
+ */
+#define MAX4466_DMA_BUFFERS 4
+/**
+ * @brief Level in dB of a full scale sine at the ADC, calibrates the dB(A) and band levels.
+ * Should be measured with a reference sound level meter, it depends on the gain potentiometer of the MAX4466.
+ */
+#define MAX4466_DB_OFFSET 110.0f
+/**
+ * @brief Core on which the audio task runs.
+ */
+#define MAX4466_TASK_CORE 1
+/**
+ * @brief Priority of the audio task, below the sampling task. The DMA buffers give it MAX4466_DMA_BUFFERS blocks of slack.
+ */
+#define MAX4466_TASK_PRIORITY 2
+/**
+ * @brief Stack size in bytes of the audio task.
+ */
+#define MAX4466_TASK_STACK 4096
+/**
+ * @brief Highest amount of samples another module can read from ADC1 at once while the I2S ADC is running.
+ * @see __W_MAX4466::readAdc1()
+ */
+#define MAX4466_SHARE_SAMPLES 16
+/**
+ * @brief Time in ms a module waits for the audio task to read ADC1 for it, a few audio blocks.
+ */
+#define MAX4466_SHARE_TIMEOUT 200
+/**
+ * @brief Time in ms between two sample bursts of the MIX8410 background sampling.
+ * While the I2S ADC is running every burst pauses the audio sampling for less than a ms.
+ */
+#define MIX8410_SAMPLE_INTERVAL 500
+/**
+ * @brief Amount of ADC samples in a burst of the MIX8410, the median of the burst goes into the filter. At most MAX4466_SHARE_SAMPLES.
+ */
+#define MIX8410_BURST 9
+/**
+ * @brief Strength of the IIR filter of the MIX8410, every burst moves the output 1/2^shift towards the burst median.
+ * 3 gives a time constant of 8 bursts, 4 seconds with a MIX8410_SAMPLE_INTERVAL of 500.
+ */
+#define MIX8410_FILTER_SHIFT 3
+/**
+ * @brief Set to 1 to convert the MIX8410 ADC values with the eFuse calibration of the ESP32, 0 to assume a linear 0 - 3.3 V range.
+ */
+#define MIX8410_ADC_CALIBRATION 1
+/**
+ * @brief Calibration points of the MIX8410 as {mV, O2 %}, sorted on the voltage. Between two points the concentration is interpolated,
+ * outside the table the first or last segment is extended. The default is the linear 2.0 V at 21 % of the sensor board.
+ */
+#define MIX8410_CALIBRATION {0.0f, 0.0f}, {2000.0f, 21.0f}
+/**
+ * @brief Core on which the MIX8410 sampling task runs.
+ */
+#define MIX8410_TASK_CORE 0
+/**
+ * @brief Priority of the MIX8410 sampling task.
+ */
+#define MIX8410_TASK_PRIORITY 1
+/**
+ * @brief Stack size in bytes of the MIX8410 sampling task.
+ */
+#define MIX8410_TASK_STACK 2048
+/**
+ * @brief GPIO of the INT pin of the AS7262, set to -1 to poll the data ready flag over I2C instead.
+ */
+#define AS7262_INT_PIN -1
+/**
+ * @brief GPIO of the RDY pin of the SCD30, set to -1 to poll the data ready status over I2C instead.
+ */
+#define SCD30_RDY_PIN -1
+/**
+ * @brief Time in ms between two data ready status polls of the SCD30, when SCD30_RDY_PIN is not set.
+ */
+#define SCD30_POLL_INTERVAL 100
+/**
+ * @brief Time in ms the SCD30 needs between a command and reading its response.
+ */
+#define SCD30_RESPONSE_TIME 3
+/**
+ * @brief Time in ms the SCD30 needs after a new measurement interval before it takes the next command.
+ */
+#define SCD30_INTERVAL_SETTLE_TIME 200
+/**
+ * @brief Set to 1 to let the TSL2591 change its gain and integration time after every conversion.
+ * Set to 0 to always measure with TSL2591_RANGE_START.
+ */
+#define TSL2591_AUTORANGE 1
+/**
+ * @brief Index of the TSL2591 range used after init, 0 (1x, 100 ms) to 6 (9876x, 600 ms).
+ */
+#define TSL2591_RANGE_START 1
+/**
+ * @brief Percentage of the maximum count at which a TSL2591 channel is treated as saturated.
+ * A range is only made more sensitive when the counts are expected to stay below half of this.
+ */
+#define TSL2591_RANGE_HIGH 90
+
+/**
+ * @brief Set to 1 to run the sampling and the MQTT publishing in two tasks on different cores.
+ * Set to 0 to run both from the Arduino loop.
+ */
+#define PIPELINE_DUAL_CORE 1
+/**
+ * @brief Amount of sample records that fit in the SampleQueue between the sampling and the network task, should be a power of 2.
+ * New samples are dropped when the queue is full, for example while the broker is unreachable.
+ */
+#define PIPELINE_QUEUE_LENGTH 32
+/**
+ * @brief Core on which the sampling task runs. The WiFi stack runs on core 0.
+ */
+#define PIPELINE_SAMPLE_CORE 1
+/**
+ * @brief Priority of the sampling task, higher than the network task so the measurements keep their period.
+ */
+#define PIPELINE_SAMPLE_PRIORITY 3
+/**
+ * @brief Stack size in bytes of the sampling task.
+ */
+#define PIPELINE_SAMPLE_STACK 4096
+/**
+ * @brief Core on which the network task runs.
+ */
+#define PIPELINE_NETWORK_CORE 0
+/**
+ * @brief Priority of the network task.
+ */
+#define PIPELINE_NETWORK_PRIORITY 1
+/**
+ * @brief Stack size in bytes of the network task, the TLS connection needs a large stack.
+ */
+#define PIPELINE_NETWORK_STACK 8192
+/**
+ * @brief Maximum time in ms the network task sleeps before it keeps the MQTT connection alive again.
+ */
+#define PIPELINE_NETWORK_PERIOD 100
+/**
+ * @brief Time in ms between two logs of the pipeline counters, 0 to disable.
+ */
+#define PIPELINE_STATS_INTERVAL 60000
+
+/**
+ * @brief Set to 1 to keep the records that can't be published in a spool on the SD card, and publish them once the broker is reachable again.
+ */
+#define SPOOL_ENABLED 1
+/**
+ * @brief Directory of the spool files.
+ */
+#define SPOOL_DIR "/spool"
+/**
+ * @brief Amount of records in a spool segment file, a segment is deleted once all its records are published.
+ */
+#define SPOOL_SEGMENT_RECORDS 256
+/**
+ * @brief Maximum amount of spool segments, the oldest segment is dropped when a new one is needed.
+ * A record takes about 100 bytes, so the default keeps about 6 MB or a day of measurements.
+ */
+#define SPOOL_MAX_SEGMENTS 256
+/**
+ * @brief Free space in bytes that the spool leaves on the storage, records are dropped below it.
+ * This also keeps the spool off the small flash fallback.
+ */
+#define SPOOL_MIN_FREE 1048576
+/**
+ * @brief Amount of spooled records published per second after a reconnect, the live records always go first.
+ */
+#define SPOOL_DRAIN_RATE 10
+/**
+ * @brief Maximum amount of spooled records published in a single network step.
+ */
+#define SPOOL_DRAIN_BURST 8
 
 /** @} */
 
@@ -103,9 +681,17 @@ enum ERR_Type {
 	/** MOD_INIT_ERR, indicates that a module was not succesfully initialized. */
 	MOD_INIT_ERR,
 
+	// I2C Errors
+	/** I2C_BUS_BUSY, indicates that the I2C bus was not released by another task within I2C_LOCK_TIMEOUT. */
+	I2C_BUS_BUSY,
+	/** I2C_BUS_STUCK, indicates that SDA is still held low after clearing the bus. */
+	I2C_BUS_STUCK,
+
 	// RTC Errors
 	/** RTC_BEGIN_ERR, indicates that the .begin() method has failed. */
 	RTC_BEGIN_ERR,
+	/** RTC_READ_FAIL, indicates that the date time registers of the RTC could not be read. */
+	RTC_READ_FAIL,
 
 	// SD Errors
 	/** SD_BEGIN_ERR, indicates that the .begin() method has failed. */
@@ -132,6 +718,10 @@ enum ERR_Type {
 	SD_RENAME_FAIL,
 	/** SD_RM_FAIL, failed to remove file */
 	SD_RM_FAIL,
+	/** SD_BUFFER_TOO_SMALL, the file did not fit in the provided buffer */
+	SD_BUFFER_TOO_SMALL,
+	/** SD_BUSY, indicates that the storage was not released by another task within SD_LOCK_TIMEOUT. */
+	SD_BUSY,
 
 	// Wifi & MQTT Errors
 	/** WIFI_CONN_FAIL, failed to connect to wifi network */
@@ -144,6 +734,10 @@ enum ERR_Type {
 	WIFI_SETTINGS_NOT_COMPLETE,
 	/** WIFI_SETTINGS_NOT_COMPLETE, provided setting was over 50 characters */
 	WIFI_SETTINGS_STRING_OVERLOAD,
+	/** MQTT_TOPIC_OVERFLOW, the topics of the attributes did not fit in MQTT_TOPIC_ARENA */
+	MQTT_TOPIC_OVERFLOW,
+	/** SPOOL_FULL, the record was not spooled because the storage has less than SPOOL_MIN_FREE free space */
+	SPOOL_FULL,
 
 	// Ambimate Errors
 	/** AMBI_I2C_INIT_ERR, Aindicates that an I2C error occured in the init function. */
@@ -159,13 +753,25 @@ enum ERR_Type {
 	/** NO_LDS_SENSOR, indicates that no LDS sensor was found. */
 	NO_LDS_SENSOR,
 
+	// MAX4466 Errors
+	/** MAX4466_I2S_ERR, indicates that the I2S ADC could not be started. */
+	MAX4466_I2S_ERR,
+
+	// MIX8410 Errors
+	/** MIX8410_NO_SAMPLES, indicates that the background sampling has not produced a value yet. */
+	MIX8410_NO_SAMPLES,
+
 	// SCD30 Errors
 	/** SCD30_BEGIN_ERR, indicates that the .begin() method has failed. */
 	SCD30_BEGIN_ERR,
+	/** SCD30_CRC_ERR, a word read from the SCD30 did not match its CRC. */
+	SCD30_CRC_ERR,
 
 	// TSL2591 Errors
 	/** TSL_BEGIN_ERR, indicates that the .begin() method has failed. */
 	TSL_BEGIN_ERR,
+	/** TSL_SATURATED, a channel of the TSL2591 was saturated, the next conversion uses a less sensitive range. */
+	TSL_SATURATED,
 
 };
 /**@}*/
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include "LogBuffer.h"
+
+#include <string.h>
+
+// copy characters into the free space, up to the end of the free space or the end of the buffer, whichever comes first.
+size_t LogBuffer::write(const char* s, size_t len){
+	size_t copied = 0;
+	while(len && count < LOG_BUFFER_SIZE){
+		size_t n = LOG_BUFFER_SIZE - count;
+		if(n > LOG_BUFFER_SIZE - head){ n = LOG_BUFFER_SIZE - head; }
+		if(n > len){ n = len; }
+		memcpy(buffer + head, s, n);
+		head = (head + n) % LOG_BUFFER_SIZE;
+		count += n;
+		s += n;
+		len -= n;
+		copied += n;
+	}
+	return copied;
+}
+
+LogFlush LogBuffer::due(bool error, uint32_t now) const {
+	if(error){
+		return LogFlush::All; // errors could precede a crash, so write them out immediately.
+	}
+	if(count >= LOG_FLUSH_SIZE){
+		return LogFlush::Chunks;
+	}
+	if(count && (now - last_flush) >= LOG_FLUSH_INTERVAL){
+		return LogFlush::All;
+	}
+	return LogFlush::None;
+}
+
+ERR_Type LogBuffer::flush(bool all, uint32_t now, LogBufferSink sink, void* context){
+	ERR_Type ret = SUCCESS;
+	size_t len = count;
+	if(!all){
+		len -= len % LOG_FLUSH_SIZE; // only write complete chunks.
+	}
+	while(len){
+		size_t n = LOG_BUFFER_SIZE - tail;
+		if(n > len){ n = len; }
+		if(sink && !ret){
+			ret = sink((const uint8_t*)(buffer + tail), n, context);
+		}
+		tail = (tail + n) % LOG_BUFFER_SIZE;
+		count -= n;
+		len -= n;
+	}
+	// the rest of a chunked flush has been waiting since the buffer was last empty, its interval keeps running.
+	if(!count){
+		last_flush = now;
+	}
+	return ret;
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+/**
+ * @file LogBuffer.h
+ * @author Imre Korf
+ * @brief Ring buffer in which the Logger collects the SD log lines, and the policy that decides when they are written.
+ * @version 0.1
+ * @date 2022-04-05
+ *
+ * The buffer is written in complete LOG_FLUSH_SIZE chunks, so the SD card mostly receives whole sectors:
+ * Reason | Written
+ * :-----:|:-----------------------------:
+ *  error | everything, immediately at the end of the line, as an error could precede a crash
+ *  LOG_FLUSH_SIZE buffered | the complete chunks, the rest stays in the buffer
+ *  LOG_FLUSH_INTERVAL passed | everything
+ *  buffer full | the complete chunks, before more is copied in
+ *
+ * This file only uses the standard library and gets the time passed in, so the HostTests and the StorageBench tool can run it on a host.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include "../Defines/Defines.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @addtogroup ENUM
+ * @{
+ */
+/**
+ *  What a LogBuffer should write at the end of a log line.
+ */
+enum class LogFlush : uint8_t {
+	/** (0) Nothing, the line stays in the buffer. */
+	None,
+	/** (1) The complete LOG_FLUSH_SIZE chunks. */
+	Chunks,
+	/** (2) Everything in the buffer. */
+	All
+};
+/**@}*/
+
+/**
+ * @brief Writes a part of the buffered data to the log file.
+ * @return ERR_Type SUCCESS when the part has been written.
+ */
+typedef ERR_Type (*LogBufferSink)(const uint8_t* data, size_t len, void* context);
+
+/**
+ * @brief Ring buffer of LOG_BUFFER_SIZE bytes between the Logger and the log file.
+ */
+class LogBuffer {
+private:
+	/** The buffered bytes. */
+	char buffer[LOG_BUFFER_SIZE];
+	/** Write position in the buffer. */
+	size_t head = 0;
+	/** Read position in the buffer, this is where the next flush starts. */
+	size_t tail = 0;
+	/** Amount of buffered bytes that have not been written yet. */
+	size_t count = 0;
+	/** Time in ms of the last flush that emptied the buffer. */
+	uint32_t last_flush = 0;
+
+public:
+	/**
+	 * @brief Copies as many characters as fit into the buffer.
+	 * @param s the characters.
+	 * @param len the amount of characters.
+	 * @return size_t the amount of characters copied, less than len when the buffer is full.
+	 */
+	size_t write(const char* s, size_t len);
+
+	/**
+	 * @brief Decides what should be written at the end of a log line.
+	 * @param error the line is an error.
+	 * @param now the time in ms.
+	 */
+	LogFlush due(bool error, uint32_t now) const;
+
+	/**
+	 * @brief Writes the buffered data to the sink, in at most two parts when the data wraps around the end of the buffer.
+	 * The data is removed from the buffer also when the sink fails, otherwise a missing SD card would stall the buffer forever.
+	 * @param all when false only complete LOG_FLUSH_SIZE chunks are written, the rest stays in the buffer.
+	 * @param now the time in ms.
+	 * @param sink writes the data, nullptr drops it.
+	 * @param context passed to the sink.
+	 * @return ERR_Type the first error of the sink, SUCCESS when all parts were written.
+	 */
+	ERR_Type flush(bool all, uint32_t now, LogBufferSink sink, void* context);
+
+	/** @brief Returns true when no more characters fit in the buffer. */
+	bool full() const { return count == LOG_BUFFER_SIZE; }
+	/** @brief Returns the amount of buffered bytes. */
+	size_t size() const { return count; }
+	/** @brief Sets the time of the last flush, the LOG_FLUSH_INTERVAL starts from here. */
+	void setFlushTime(uint32_t now){ last_flush = now; }
+};
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "LogIndex.h"
+#include "Logger.h"
+#include "../Wrappers/SD/__W_SD.h"
+
+ERR_Type LogIndex::load(){
+	size_t read = 0;
+	ERR_Type ET = __W_SD::getInstance().readBytes(LOG_INDEX_FILE, 0, (uint8_t*)&header, sizeof(header), read);
+	if(!ET && read == sizeof(header) && header.magic == LOG_INDEX_MAGIC && header.slots == LOG_MAX_FILES && header.count <= LOG_MAX_FILES){
+		ET = __W_SD::getInstance().readBytes(LOG_INDEX_FILE, sizeof(header), (uint8_t*)paths, sizeof(paths), read);
+		if(!ET && read == sizeof(paths)){
+			for(int i = 0; i < LOG_MAX_FILES; i++){
+				paths[i][LOG_INDEX_PATH_SIZE - 1] = '\0';
+			}
+			return SUCCESS;
+		}
+	}
+
+	// start a new index, log files from an older index are no longer deleted.
+	Logger::getInstance().println<LogLevel::Warning>("[LogIndex] Creating new log index");
+	header = {LOG_INDEX_MAGIC, LOG_MAX_FILES, 0, 0, 0};
+	memset(paths, 0, sizeof(paths));
+	ET = __W_SD::getInstance().writeBytes(LOG_INDEX_FILE, 0, (const uint8_t*)&header, sizeof(header));
+	if(ET){return ET;}
+	return __W_SD::getInstance().writeBytes(LOG_INDEX_FILE, sizeof(header), (const uint8_t*)paths, sizeof(paths));
+}
+
+ERR_Type LogIndex::add(const char* path){
+	if(strlen(path) >= LOG_INDEX_PATH_SIZE){
+		Logger::getInstance().println<LogLevel::Warning>("[LogIndex] Path too long for the log index: ", path);
+		return ERROR;
+	}
+	if(header.count == LOG_MAX_FILES){
+		removeOldest();
+	}
+	uint16_t slot = (header.head + header.count) % LOG_MAX_FILES;
+	strncpy(paths[slot], path, LOG_INDEX_PATH_SIZE);
+	header.count++;
+	// the slot is written before the header, so a reset in between never leaves the header pointing at an old path.
+	ERR_Type ET = writeSlot(slot);
+	if(ET){return ET;}
+	return writeHeader();
+}
+
+ERR_Type LogIndex::removeOldest(){
+	if(!header.count){return ERROR;}
+	uint16_t slot = header.head;
+	// the file could already be gone, it is removed from the index either way so the index can't get stuck.
+	ERR_Type ET = __W_SD::getInstance().deleteFile(paths[slot]);
+	header.head = (header.head + 1) % LOG_MAX_FILES;
+	header.count--;
+	removeEmptyDirs(paths[slot], header.count ? paths[header.head] : "");
+	paths[slot][0] = '\0';
+	ERR_Type ET2 = writeHeader();
+	return ET ? ET : ET2;
+}
+
+ERR_Type LogIndex::writeHeader(){
+	return __W_SD::getInstance().writeBytes(LOG_INDEX_FILE, 0, (const uint8_t*)&header, sizeof(header));
+}
+
+ERR_Type LogIndex::writeSlot(uint16_t slot){
+	return __W_SD::getInstance().writeBytes(LOG_INDEX_FILE, sizeof(header) + slot * LOG_INDEX_PATH_SIZE, (const uint8_t*)paths[slot], LOG_INDEX_PATH_SIZE);
+}
+
+void LogIndex::removeEmptyDirs(const char* removed, const char* next){
+	char dir[LOG_INDEX_PATH_SIZE];
+	strncpy(dir, removed, sizeof(dir));
+	dir[sizeof(dir) - 1] = '\0';
+	// walk up from the day directory to the year directory, stop at the first directory that is still in use.
+	for(;;){
+		char* slash = strrchr(dir, '/');
+		if(!slash || slash == dir){return;} // never remove the root directory.
+		*slash = '\0';
+		size_t len = slash - dir;
+		if(!strncmp(next, dir, len) && next[len] == '/'){return;}
+		if(__W_SD::getInstance().removeDir(dir)){return;}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+/**
+ * @file LogIndex.h
+ * @author Imre Korf
+ * @brief Index of the log files on the SD card, used to delete the oldest log files.
+ * @version 0.1
+ * @date 2022-02-28
+ *
+ * The index file is a ring of LOG_MAX_FILES fixed size slots, stored little endian as:
+ * Bytes | Description
+ * :-----:|:-----------------------------:
+ *  4 | LOG_INDEX_MAGIC
+ *  2 | amount of slots, LOG_MAX_FILES at the time the index was created
+ *  2 | slot of the oldest log file
+ *  2 | amount of log files in the index
+ *  2 | reserved
+ *  LOG_MAX_FILES * LOG_INDEX_PATH_SIZE | null terminated paths of the log files
+ *
+ * Adding or removing a log file only rewrites the header and a single slot, so no directories have to be scanned.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "../Defines/Defines.h"
+
+/**
+ * @addtogroup DEFINES
+ * @{
+ */
+/** @brief Value of the first 4 bytes of the index file ("LIDX"). */
+#define LOG_INDEX_MAGIC 0x5844494C
+/** @} */
+
+/**
+ * @brief Keeps track of the log files on the SD card from oldest to newest.
+ */
+class LogIndex {
+private:
+	/**
+	 * @brief Header at the start of the index file.
+	 */
+	struct Header {
+		/** Should be LOG_INDEX_MAGIC. */
+		uint32_t magic;
+		/** Amount of slots in the file. */
+		uint16_t slots;
+		/** Slot of the oldest log file. */
+		uint16_t head;
+		/** Amount of log files in the index. */
+		uint16_t count;
+		/** Unused, keeps the slots aligned. */
+		uint16_t reserved;
+	};
+
+	/** Copy of the header of the index file. */
+	Header header = {LOG_INDEX_MAGIC, LOG_MAX_FILES, 0, 0, 0};
+	/** Copy of the slots of the index file. */
+	char paths[LOG_MAX_FILES][LOG_INDEX_PATH_SIZE];
+
+	/**
+	 * @brief Writes the header to the index file.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 */
+	ERR_Type writeHeader();
+	/**
+	 * @brief Writes a single slot to the index file.
+	 * @param slot the slot to be written.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 */
+	ERR_Type writeSlot(uint16_t slot);
+	/**
+	 * @brief Removes the directories of a removed log file which do not contain the next log file.
+	 * The log files are added in order, so these directories are empty once their last log file is removed.
+	 * @param removed the path of the removed log file.
+	 * @param next the path of the now oldest log file, or an empty string.
+	 */
+	void removeEmptyDirs(const char* removed, const char* next);
+
+public:
+	/**
+	 * @brief Reads the index file, a new index file is created when it is missing or does not match LOG_MAX_FILES.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 * @see ERR_Type
+	 */
+	ERR_Type load();
+
+	/**
+	 * @brief Adds a new log file as the newest file.
+	 * When the index already contains LOG_MAX_FILES log files the oldest one is deleted first.
+	 * @param path the path of the log file.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 * @see ERR_Type
+	 */
+	ERR_Type add(const char* path);
+
+	/**
+	 * @brief Deletes the oldest log file and removes it from the index.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 * @see ERR_Type
+	 */
+	ERR_Type removeOldest();
+
+	/**
+	 * @brief Returns the amount of log files in the index.
+	 */
+	uint16_t count() const { return header.count; }
+};
\ No newline at end of file
@@ -0,0 +1,60 @@
+/**
+ * @file LogMessages.h
+ * @author Imre Korf
+ * @brief Table of the binary log messages.
+ * @version 0.1
+ * @date 2022-02-14
+ *
+ * This file is shared with the LogDecoder tool, so it should not include any Arduino headers.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @brief X-macro table containing every binary log message and its format string.
+ * Every {} in the format string is replaced with the next argument of the record when it is printed.
+ * The position in this table is the message id that is stored in the log files.
+ * ! Only add new messages at the end, otherwise older log files can not be decoded anymore.
+ */
+#define LOG_MESSAGE_TABLE(X) \
+	X(LOG_MSG_TIME,		"Time anchor {}-{}-{} {}:{}:{}") \
+	X(LOG_MSG_TEXT,		"{}") \
+	X(LOG_MSG_START,	"Start of Logfile, version {}") \
+	X(LOG_MSG_AMBIMATE,	"Ambimate: {} C, {} RH, {} V, audio {}, eco2 {} ppm, voc {} ppm, events mot {} aud {} pir {}") \
+	X(LOG_MSG_AS7262,	"AS7262: violet {}, blue {}, green {}, yellow {}, orange {}, red {}") \
+	X(LOG_MSG_TSL2591,	"TSL2591: visible {} lux, IR {} lux, full {} lux") \
+	X(LOG_MSG_SCD30,	"SCD30: CO2 {} ppm, {} C, {} RH") \
+	X(LOG_MSG_MIX8410,	"MIX8410: O2 {} %") \
+	X(LOG_MSG_MAX4466,	"MAX4466: audio {}") \
+	X(LOG_MSG_TSL2591_LUX,	"TSL2591: {} lux, gain {}x, integration {} ms") \
+	X(LOG_MSG_MAX4466_LEVEL,	"MAX4466: {} dB(A), rms {} dBFS, peak {} dBFS, clipped {}, bands {} {} {} {} {} {} {} {} dB")
+
+/** @cond */
+#define LOG_MESSAGE_ENUM(id, format) id,
+#define LOG_MESSAGE_FORMAT(id, format) format,
+/** @endcond */
+
+/**
+ * @addtogroup ENUM
+ * @{
+ */
+/**
+ * @brief Ids of the binary log messages, generated from LOG_MESSAGE_TABLE.
+ */
+enum LogMessage : uint16_t {
+	LOG_MESSAGE_TABLE(LOG_MESSAGE_ENUM)
+	/** Amount of messages in the table. */
+	LOG_MSG_COUNT
+};
+/**@}*/
+
+/**
+ * @brief Format strings of the binary log messages, indexed by LogMessage.
+ */
+static const char * const log_message_formats[] = {
+	LOG_MESSAGE_TABLE(LOG_MESSAGE_FORMAT)
+};
\ No newline at end of file
@@ -0,0 +1,167 @@
+/**
+ * @file LogQueue.h
+ * @author Imre Korf
+ * @brief Bounded lock-free multi producer single consumer queue used between the log statements and the Logger writer task.
+ * @version 0.1
+ * @date 2022-02-21
+ *
+ * Every slot has a sequence number which tells producers and the consumer whose turn it is to use the slot,
+ * so a push or pop never takes a lock and never waits on another task that is halfway through its own push.
+ * A log statement that needs several items claims them as one block, so its parts are always read one after another.
+ * This file only uses the standard library, so it can also be compiled for a host to test it with threads.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Bounded lock-free queue with any amount of producers and a single consumer.
+ * @tparam T the type of the queued items, is copied in and out of the queue.
+ * @tparam N the amount of slots, should be a power of 2.
+ */
+template<typename T, size_t N>
+class LogQueue {
+	static_assert(N >= 2 && (N & (N - 1)) == 0, "the LogQueue length should be a power of 2");
+private:
+	/**
+	 * @brief A slot of the queue.
+	 */
+	struct Slot {
+		/** Position at which the slot can be written (seq == pos) or read (seq == pos + 1). */
+		std::atomic<size_t> seq;
+		/** The queued item. */
+		T item;
+	};
+
+	/** The slots of the queue. */
+	Slot slots[N];
+	/** Next position to be claimed by a producer. */
+	std::atomic<size_t> head;
+	/** Next position to be read by the consumer. */
+	std::atomic<size_t> tail;
+	/** Highest amount of items that has been in the queue at once. */
+	std::atomic<size_t> high_water;
+
+public:
+	LogQueue() : head(0), tail(0), high_water(0) {
+		for(size_t i = 0; i < N; i++){
+			slots[i].seq.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	/**
+	 * @brief Adds an item to the queue, can be called by multiple tasks at the same time.
+	 * @param item the item to be copied into the queue.
+	 * @return true the item has been added.
+	 * @return false the queue is full.
+	 */
+	bool push(const T& item){
+		size_t pos = head.load(std::memory_order_relaxed);
+		for(;;){
+			Slot& slot = slots[pos & (N - 1)];
+			size_t seq = slot.seq.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+			if(diff == 0){
+				// the slot is free, try to claim it before another producer does.
+				if(head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){
+					slot.item = item;
+					slot.seq.store(pos + 1, std::memory_order_release);
+					updateHighWater(pos + 1 - tail.load(std::memory_order_relaxed));
+					return true;
+				}
+			}
+			else if(diff < 0){
+				return false; // the slot still holds an item that has not been read yet.
+			}
+			else{
+				pos = head.load(std::memory_order_relaxed); // another producer claimed the slot first.
+			}
+		}
+	}
+
+	/**
+	 * @brief Adds count items as one block of consecutive slots, so the items of other producers can't end up in between.
+	 * Either all items are added or none, the block is only claimed when all its slots are free.
+	 * @tparam F function object called as fill(T& item, size_t i) for i = 0 .. count-1, in that order.
+	 * @param count the amount of items, at most N.
+	 * @param fill writes the i-th item straight into its slot, is only called once the block has been claimed.
+	 * @return true the items have been added.
+	 * @return false the queue doesn't have count free slots.
+	 */
+	template<typename F>
+	bool push(size_t count, F fill){
+		if(count > N){return false;}
+		size_t pos = head.load(std::memory_order_relaxed);
+		for(;;){
+			intptr_t diff = 0;
+			for(size_t i = 0; i < count && !diff; i++){
+				diff = (intptr_t)slots[(pos + i) & (N - 1)].seq.load(std::memory_order_acquire) - (intptr_t)(pos + i);
+			}
+			if(diff == 0){
+				if(head.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)){
+					// the slots are published one by one, the consumer reads the first items while the rest is written.
+					for(size_t i = 0; i < count; i++){
+						Slot& slot = slots[(pos + i) & (N - 1)];
+						fill(slot.item, i);
+						slot.seq.store(pos + i + 1, std::memory_order_release);
+					}
+					updateHighWater(pos + count - tail.load(std::memory_order_relaxed));
+					return true;
+				}
+			}
+			else if(diff < 0){
+				return false; // a slot of the block still holds an item that has not been read yet.
+			}
+			else{
+				pos = head.load(std::memory_order_relaxed); // another producer claimed a slot of the block first.
+			}
+		}
+	}
+
+	/**
+	 * @brief Takes the oldest item from the queue, should only be called by a single task.
+	 * @param item buffer for the item.
+	 * @return true an item has been read.
+	 * @return false the queue is empty, or the oldest item is still being written.
+	 */
+	bool pop(T& item){
+		size_t pos = tail.load(std::memory_order_relaxed);
+		Slot& slot = slots[pos & (N - 1)];
+		if(slot.seq.load(std::memory_order_acquire) != pos + 1){
+			return false;
+		}
+		item = slot.item;
+		tail.store(pos + 1, std::memory_order_relaxed);
+		slot.seq.store(pos + N, std::memory_order_release); // hand the slot back to the producers for the next round.
+		return true;
+	}
+
+	/**
+	 * @brief Returns the amount of items in the queue.
+	 * The value is only an indication when other tasks are pushing or popping at the same time.
+	 */
+	size_t size() const {
+		size_t h = head.load(std::memory_order_relaxed);
+		size_t t = tail.load(std::memory_order_relaxed);
+		return h - t > N ? N : h - t;
+	}
+
+	/** @brief Returns the amount of slots of the queue. */
+	static constexpr size_t capacity(){ return N; }
+
+	/** @brief Returns the highest amount of items that has been in the queue at once. */
+	size_t highWater() const { return high_water.load(std::memory_order_relaxed); }
+
+private:
+	// remember the highest fill level of the queue.
+	void updateHighWater(size_t count){
+		if(count > N){count = N;}
+		size_t prev = high_water.load(std::memory_order_relaxed);
+		while(count > prev && !high_water.compare_exchange_weak(prev, count, std::memory_order_relaxed)){}
+	}
+};
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include "LogRecord.h"
+#include <stdio.h>
+
+void LogRecord::encodeHeader(uint8_t* buf, uint8_t level, uint16_t id, uint32_t timestamp, uint8_t arglen){
+	buf[0] = LOG_RECORD_SYNC;
+	buf[1] = level;
+	memcpy(buf + 2, &id, sizeof(id));
+	memcpy(buf + 4, &timestamp, sizeof(timestamp));
+	buf[8] = arglen;
+}
+
+// print the next argument into the text buffer, returns the amount of argument bytes used or 0 if the arguments are malformed.
+static size_t formatArg(char* out, size_t size, size_t& len, const uint8_t* args, size_t arglen){
+	if(arglen < 2){return 0;}
+	int n = 0;
+	size_t used = 0;
+	switch(args[0]){
+		case LOG_ARG_INT: {
+			if(arglen < 5){return 0;}
+			int32_t v;
+			memcpy(&v, args + 1, sizeof(v));
+			n = snprintf(out + len, size - len, "%ld", (long)v);
+			used = 5;
+			break;
+		}
+		case LOG_ARG_UINT: {
+			if(arglen < 5){return 0;}
+			uint32_t v;
+			memcpy(&v, args + 1, sizeof(v));
+			n = snprintf(out + len, size - len, "%lu", (unsigned long)v);
+			used = 5;
+			break;
+		}
+		case LOG_ARG_FLOAT: {
+			if(arglen < 5){return 0;}
+			float v;
+			memcpy(&v, args + 1, sizeof(v));
+			n = snprintf(out + len, size - len, "%.2f", v); // same precision as String(float).
+			used = 5;
+			break;
+		}
+		case LOG_ARG_STR: {
+			size_t slen = args[1];
+			if(arglen < slen + 2){return 0;}
+			n = snprintf(out + len, size - len, "%.*s", (int)slen, (const char*)(args + 2));
+			used = slen + 2;
+			break;
+		}
+		default:
+			return 0;
+	}
+	if(n > 0){
+		len += n;
+		if(len >= size){len = size - 1;} // output was cut off.
+	}
+	return used;
+}
+
+size_t LogRecord::format(char* out, size_t size, const char* format, const uint8_t* args, size_t arglen){
+	if(!size){return 0;}
+	size_t len = 0;
+	while(*format && len + 1 < size){
+		if(format[0] == '{' && format[1] == '}'){
+			size_t used = formatArg(out, size, len, args, arglen);
+			if(used){
+				args += used;
+				arglen -= used;
+			}
+			else{
+				out[len++] = '?'; // missing or malformed argument.
+				arglen = 0;
+			}
+			format += 2;
+		}
+		else{
+			out[len++] = *format++;
+		}
+	}
+	out[len] = '\0';
+	return len;
+}
\ No newline at end of file
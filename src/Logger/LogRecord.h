@@ -0,0 +1,153 @@
+/**
+ * @file LogRecord.h
+ * @author Imre Korf
+ * @brief Encoding and formatting of binary log records.
+ * @version 0.1
+ * @date 2022-02-14
+ *
+ * A binary log record is stored little endian as:
+ * Bytes | Description
+ * :-----:|:-----------------------------:
+ *  1 | LOG_RECORD_SYNC
+ *  1 | LogLevel
+ *  2 | LogMessage id
+ *  4 | timestamp, millis() of the ESP32
+ *  1 | length of the arguments
+ *  n | arguments, each one is a LogArgType byte followed by the value
+ *
+ * This file is shared with the LogDecoder tool, so it should not include any Arduino headers outside of the ARDUINO guard.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <type_traits>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+/**
+ * @addtogroup DEFINES
+ * @{
+ */
+/** @brief Value of the first byte of a binary log record, used to find the start of a record. */
+#define LOG_RECORD_SYNC 0xA5
+/** @brief Size of the fixed part of a binary log record. */
+#define LOG_RECORD_HEADER_SIZE 9
+/** @brief Maximum amount of argument bytes in a binary log record. */
+#define LOG_RECORD_MAX_ARGS 255
+/** @} */
+
+/**
+ * @addtogroup ENUM
+ * @{
+ */
+/**
+ * @brief Type of an argument in a binary log record.
+ */
+enum LogArgType : uint8_t {
+	/** Signed integer, 4 bytes. */
+	LOG_ARG_INT = 1,
+	/** Unsigned integer, 4 bytes. */
+	LOG_ARG_UINT,
+	/** Float, 4 bytes. */
+	LOG_ARG_FLOAT,
+	/** String, 1 length byte followed by the characters. */
+	LOG_ARG_STR
+};
+/**@}*/
+
+/**
+ * @brief Functions to encode and format binary log records.
+ */
+namespace LogRecord {
+	/**
+	 * @brief Copies a typed value into the argument buffer.
+	 * @return size_t the amount of bytes used, 0 if it did not fit.
+	 */
+	inline size_t encodeRaw(uint8_t* buf, size_t size, LogArgType type, const void* value, size_t len){
+		if(len + 1 > size){return 0;}
+		buf[0] = type;
+		memcpy(buf + 1, value, len);
+		return len + 1;
+	}
+
+	/** @brief Encodes a signed integer argument. */
+	template<typename T>
+	typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, size_t>::type
+	encodeArg(uint8_t* buf, size_t size, T value){
+		int32_t v = value;
+		return encodeRaw(buf, size, LOG_ARG_INT, &v, sizeof(v));
+	}
+	/** @brief Encodes an unsigned integer argument. */
+	template<typename T>
+	typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value, size_t>::type
+	encodeArg(uint8_t* buf, size_t size, T value){
+		uint32_t v = value;
+		return encodeRaw(buf, size, LOG_ARG_UINT, &v, sizeof(v));
+	}
+	/** @brief Encodes a floating point argument. */
+	template<typename T>
+	typename std::enable_if<std::is_floating_point<T>::value, size_t>::type
+	encodeArg(uint8_t* buf, size_t size, T value){
+		float v = value;
+		return encodeRaw(buf, size, LOG_ARG_FLOAT, &v, sizeof(v));
+	}
+	/** @brief Encodes a string argument, strings longer than 255 characters are cut off. */
+	inline size_t encodeArg(uint8_t* buf, size_t size, const char* value){
+		size_t len = strlen(value);
+		if(len > 255){len = 255;}
+		if(len + 2 > size){return 0;}
+		buf[0] = LOG_ARG_STR;
+		buf[1] = (uint8_t)len;
+		memcpy(buf + 2, value, len);
+		return len + 2;
+	}
+#ifdef ARDUINO
+	/** @brief Encodes an Arduino String argument. */
+	inline size_t encodeArg(uint8_t* buf, size_t size, const String& value){
+		return encodeArg(buf, size, value.c_str());
+	}
+#endif
+
+	/** @brief End of the argument list. */
+	inline size_t encodeArgs(uint8_t*, size_t){return 0;}
+	/**
+	 * @brief Encodes all arguments after each other into the buffer.
+	 * Arguments that do not fit anymore are left out.
+	 * @return size_t the amount of bytes used.
+	 */
+	template<typename T, typename... Rest>
+	size_t encodeArgs(uint8_t* buf, size_t size, const T& value, const Rest&... rest){
+		size_t n = encodeArg(buf, size, value);
+		if(!n){return 0;}
+		return n + encodeArgs(buf + n, size - n, rest...);
+	}
+
+	/**
+	 * @brief Writes the fixed part of a record into the buffer.
+	 * @param buf buffer of at least LOG_RECORD_HEADER_SIZE bytes.
+	 * @param level the loglevel as number.
+	 * @param id the message id.
+	 * @param timestamp the time of the record in ms.
+	 * @param arglen the length of the arguments that follow the header.
+	 */
+	void encodeHeader(uint8_t* buf, uint8_t level, uint16_t id, uint32_t timestamp, uint8_t arglen);
+
+	/**
+	 * @brief Formats the message of a record into text.
+	 * Every {} in the format string is replaced with the next argument, {} without an argument is printed as ?.
+	 * @param out the text buffer, is always null terminated.
+	 * @param size the size of the text buffer.
+	 * @param format the format string of the message.
+	 * @param args the encoded arguments.
+	 * @param arglen the length of the encoded arguments.
+	 * @return size_t the length of the text.
+	 */
+	size_t format(char* out, size_t size, const char* format, const uint8_t* args, size_t arglen);
+}
\ No newline at end of file
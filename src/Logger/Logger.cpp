@@ -8,7 +8,7 @@ bool Logger::checkInitialized(){
         return 0;
     }
     else{
-        Logger::println("Logger is not initialized!", LogLevel::Warning);
+        Logger::println<LogLevel::Warning>("Logger is not initialized!");
         return 1;
     }
 }
@@ -20,36 +20,205 @@ ERR_Type Logger::init(){
 	if(__W_RTC::getInstance().init()){
 		Serial.println("RTC begin error!");
 	}
-	RTC_DATE_TIME RTC_DT = __W_RTC::getInstance().read();
-	curr_day = RTC_DT.Day;
 	
 	ERR_Type ET = __W_SD::getInstance().init();
 	if(ET){
-		Logger::println("SD card failed to initialize!", LogLevel::Error);
-		Logger::println("SD Error: " + String(ET), LogLevel::Error);
+		Logger::println<LogLevel::Error>("SD card failed to initialize!");
+		Logger::println<LogLevel::Error>("SD Error: ", (int)ET);
 		return SD_NOT_INIT;
 	}
 
-	__W_SD::getInstance().createDir(("/" + String(RTC_DT.Year) ).c_str());
-	__W_SD::getInstance().createDir(("/" + String(RTC_DT.Year)+"/"+String(RTC_DT.Month)).c_str());
-	__W_SD::getInstance().createDir(("/" + String(RTC_DT.Year)+"/"+String(RTC_DT.Month)+"/"+String(RTC_DT.Day)).c_str());
-	filepath = ("/"+String(RTC_DT.Year)+"/"+String(RTC_DT.Month)+"/"+String(RTC_DT.Day)+"/"+
-					String(RTC_DT.Hour)+"."+String(RTC_DT.Minute)+"."+String(RTC_DT.Second) + ".txt");
-	__W_SD::getInstance().writeFile(filepath.c_str(), String(
+	SD_openLogFile(__W_RTC::getInstance().read());
+	
+	SD_buffer.setFlushTime(millis());
+	Initialized = true;
+#if LOG_ASYNC
+	// from here on the log statements are written by the writer task.
+	xTaskCreatePinnedToCore(writerTask, "Logger", LOG_TASK_STACK, this, LOG_TASK_PRIORITY, &writer_task, LOG_TASK_CORE);
+#endif
+	return SUCCESS;
+}
+
+// writer task, drains the LogQueue
+void Logger::writerTask(void* param){
+	Logger* logger = (Logger*)param;
+	LogEntry entry;
+	for(;;){
+		while(logger->log_queue.pop(entry)){
+			logger->outEntry(entry);
+		}
+		logger->reportDrops();
+		if(logger->flush_request){
+			logger->flush_result = logger->flushNow();
+			logger->flush_request = false;
+		}
+		else{
+			logger->SD_checkFlush(LogLevel::Info); // writes the buffer once LOG_FLUSH_INTERVAL has passed, also when nothing is logged.
+		}
+		vTaskDelay(pdMS_TO_TICKS(LOG_TASK_PERIOD));
+	}
+}
+
+// pass an entry to the writer task
+void Logger::submit(const LogEntry& entry){
+	submit((LogLevel)entry.level, 1, [](LogEntry& E, size_t, void* context){ E = *(const LogEntry*)context; }, (void*)&entry);
+}
+
+// pass the entries of a statement to the writer task in one block
+void Logger::submit(LogLevel LL, size_t count, LogFill fill, void* context){
+#if LOG_ASYNC
+	if(writer_task){
+		uint8_t level = (uint8_t)LL;
+		auto push = [&](){
+			return log_queue.push(count, [&](LogEntry& E, size_t i){ fill(E, i, context); });
+		};
+		// info and lower leave the last entries free, so warnings and errors still fit when the queue fills up.
+		if(level > (uint8_t)LogLevel::Warning && log_queue.size() + LOG_QUEUE_RESERVE + count > log_queue.capacity()){
+			dropped[level] += count;
+			return;
+		}
+		if(push()){return;}
+		// errors could precede a crash, so give the writer task a moment to make room. The writer task can't wait on itself.
+		if(LL == LogLevel::Error && xTaskGetCurrentTaskHandle() != writer_task){
+			uint32_t start = millis();
+			while((millis() - start) < LOG_QUEUE_ERROR_WAIT){
+				vTaskDelay(1);
+				if(push()){return;}
+			}
+		}
+		dropped[level] += count;
+		return;
+	}
+#endif
+	LogEntry entry;
+	for(size_t i = 0; i < count; i++){
+		fill(entry, i, context);
+		outEntry(entry);
+	}
+}
+
+void Logger::initEntry(LogEntry& entry, LogEntryKind kind, LogLevel LL, bool toSerial, bool toSD){
+	entry.timestamp = millis();
+	entry.kind		= kind;
+	entry.level		= (uint8_t)LL;
+	entry.type		= (toSerial ? (uint8_t)LogType::Serial : 0) | (toSD ? (uint8_t)LogType::SD : 0);
+	entry.newline	= false;
+	entry.len		= 0;
+}
+
+// write an entry, called by the writer task or directly by submit()
+void Logger::outEntry(const LogEntry& entry){
+	LogLevel LL	  = (LogLevel)entry.level;
+	bool toSerial = entry.type & (uint8_t)LogType::Serial;
+	bool toSD	  = entry.type & (uint8_t)LogType::SD;
+	line_time = entry.timestamp;
+	switch(entry.kind){
+		case LogEntryKind::Text:
+			outText((const char*)entry.data, entry.len, LL, toSerial, toSD, entry.newline);
+			break;
+		case LogEntryKind::Char:
+			outChar((char)entry.data[0], LL, toSerial);
+			break;
+		case LogEntryKind::Record:
+			outRecord((LogMessage)entry.id, LL, toSerial, toSD, entry.data, entry.len);
+			break;
+		case LogEntryKind::Break:
+			outBreak((LogType)entry.type);
+			break;
+	}
+}
+
+// log the amount of dropped entries
+void Logger::reportDrops(){
+	uint32_t total = 0;
+	for(int i = 0; i < 5; i++){
+		total += dropped[i].load();
+	}
+	if(total == reported_drops){return;}
+	char text[64];
+	size_t len = snprintf(text, sizeof(text), "LogQueue full, %lu log entries dropped", (unsigned long)(total - reported_drops));
+	reported_drops = total;
+	line_time = millis();
+	outText(text, len, LogLevel::Warning, LogToSerial(LogLevel::Warning, LogType::Serial_SD), LogToSD(LogLevel::Warning, LogType::Serial_SD), true);
+}
+
+// time of a log statement, the RTC time is corrected for the time the entry spent in the queue.
+const char* Logger::timeString(uint32_t timestamp){
+	__W_RTC& RTC = __W_RTC::getInstance();
+	uint64_t epoch = RTC.epochMillis() - (uint32_t)(millis() - timestamp);
+	return RTC.stringTime(epoch / 1000);
+}
+
+// create a new log file and apply the retention
+void Logger::SD_openLogFile(const RTC_DATE_TIME& RTC_DT){
+	__W_SD& sd = __W_SD::getInstance();
+	// the index is stored next to the log files, so it is loaded again when the storage has changed.
+	if(SD_mount != sd.getMountCount()){
+		log_index.load();
+		SD_mount = sd.getMountCount();
+	}
+	String dir = "/" + String(RTC_DT.Year);
+	sd.createDir(dir.c_str());
+	dir += "/" + String(RTC_DT.Month);
+	sd.createDir(dir.c_str());
+	dir += "/" + String(RTC_DT.Day);
+	sd.createDir(dir.c_str());
+	filepath = dir + "/" + String(RTC_DT.Hour) + "." + String(RTC_DT.Minute) + "." + String(RTC_DT.Second) + LOG_FILE_EXTENSION;
+	curr_day = RTC_DT.Day;
+	SD_file_size = 0;
+
+	// the index deletes the oldest log file once LOG_MAX_FILES are stored, the new log file itself is never deleted.
+	log_index.add(filepath.c_str());
+	while(sd.getFreeSpace() < LOG_MIN_FREE_SPACE && log_index.count() > 1){
+		log_index.removeOldest();
+	}
+	SD_startFile();
+}
+
+// continue in a new log file at midnight, when the current one is full or when another storage has been mounted
+void Logger::SD_checkRotate(){
+	if(SD_rotating){return;}
+	RTC_DATE_TIME RTC_DT = __W_RTC::getInstance().read();
+	if(RTC_DT.Day == curr_day && SD_file_size < LOG_MAX_FILE_SIZE && SD_mount == __W_SD::getInstance().getMountCount()){return;}
+	SD_rotating = true;
+	SD_flush(true); // the buffered lines still belong in the old file.
+	__W_SD::getInstance().closeStream(log_stream);
+	SD_openLogFile(RTC_DT);
+	SD_rotating = false;
+}
+
+// write the header of a new log file
+void Logger::SD_startFile(){
+#if LOG_FORMAT == LOG_FORMAT_BINARY
+	// the file is created by opening the stream, the header consists of records like the rest of the file.
+	uint8_t args[LOG_RECORD_MAX_ARGS];
+	size_t len = LogRecord::encodeArgs(args, sizeof(args), SenseBox_VERSION);
+	SD_writeRecord(LOG_MSG_START, LogLevel::Info, args, len, millis());
+	// the anchor is placed on the millis() value at which the RTC second started, so the decoder can restore the milliseconds.
+	uint32_t now = millis();
+	uint64_t epoch = __W_RTC::getInstance().epochMillis();
+	RTC_DATE_TIME anchor = __W_RTC::toDateTime(epoch / 1000);
+	len = LogRecord::encodeArgs(args, sizeof(args), anchor.Year, anchor.Month, anchor.Day, anchor.Hour, anchor.Minute, anchor.Second);
+	SD_writeRecord(LOG_MSG_TIME, LogLevel::Info, args, len, now - (uint32_t)(epoch % 1000));
+	__W_SD::getInstance().openStream(log_stream, filepath.c_str());
+	SD_flush(true);
+#else
+	__W_SD::getInstance().writeFile(filepath.c_str(), (String(
 	"---------------------------------------------------------------------------------------------------\n"
 	"[Start]   Start of Logfile\n"
-	"[Date]    " + __W_RTC::getInstance().stringDateTime() + "\n"
+	"[Date]    ") + __W_RTC::getInstance().stringDateTime() + "\n"
 	"[Version] " + SenseBox_VERSION + "\n"
 	"---------------------------------------------------------------------------------------------------").c_str());
-	
-	Initialized = true;
-	return SUCCESS;
+	__W_SD::getInstance().openStream(log_stream, filepath.c_str());
+#endif
 }
 
 // print the loglevel type to serial
 void Logger::SER_print_LL_type(LogLevel LL){
 	if(SER_line_ended){ // make sure to only add this at the beginning of a line
-		Serial.print("[" + __W_RTC::getInstance().stringTime() + "]");
+		Serial.print('[');
+		Serial.print(timeString(line_time));
+		Serial.print(']');
 		switch (LL){
 			case LogLevel::Error:
 				Serial.print("[Err ]: ");
@@ -73,19 +242,23 @@ void Logger::SER_print_LL_type(LogLevel LL){
 // print the loglevel type to SD
 void Logger::SD_print_LL_type(LogLevel LL){
 	if(SD_line_ended){ // make sure to only add this at the beginning of a line
-		__W_SD::getInstance().appendFile(filepath.c_str(), ("[" + __W_RTC::getInstance().stringTime() + "] ").c_str());
+		SD_checkRotate();
+		const char* time = timeString(line_time);
+		SD_write("[", 1);
+		SD_write(time, strlen(time));
+		SD_write("] ", 2);
 		switch (LL){
 			case LogLevel::Error:
-				__W_SD::getInstance().appendFile(filepath.c_str(), "[Err ]: ");
+				SD_write("[Err ]: ", 8);
 				break;
 			case LogLevel::Warning:
-				__W_SD::getInstance().appendFile(filepath.c_str(), "[Warn]: ");
+				SD_write("[Warn]: ", 8);
 				break;
 			case LogLevel::Info:
-				__W_SD::getInstance().appendFile(filepath.c_str(), "[Info]: ");
+				SD_write("[Info]: ", 8);
 				break;
 			case LogLevel::DataDump:
-				__W_SD::getInstance().appendFile(filepath.c_str(), "[Dump]: Start ----------\n");
+				SD_write("[Dump]: Start ----------\n", 25);
 				break;
 			default:
 				break;
@@ -94,48 +267,213 @@ void Logger::SD_print_LL_type(LogLevel LL){
 	}
 }
 
-void Logger::print(String s, LogLevel LL, LogType LT){
-	PREV_LL = LL;
+// copy characters into the SD ring buffer
+void Logger::SD_write(const char* s, size_t len){
+	SD_file_size += len;
+	while(len){
+		if(SD_buffer.full()){
+			SD_flush(false); // buffer is full, write the completed chunks to make room.
+		}
+		size_t n = SD_buffer.write(s, len);
+		s += n;
+		len -= n;
+	}
+}
 
-	// write to serial
-	if(((uint8_t)(PREV_LL) <= DEBUGLEVEL) && ((uint8_t)(LT) & (uint8_t)(LogType::Serial))){
-		SER_print_LL_type(LL);
-		Serial.print(s);
+// decide if the buffered log lines should be written to the SD
+void Logger::SD_checkFlush(LogLevel LL){
+	LogFlush F = SD_buffer.due(LL == LogLevel::Error, millis());
+	if(F != LogFlush::None){
+		SD_flush(F == LogFlush::All);
 	}
-	// write to sd
-	if(((uint8_t)(PREV_LL) <= LOGLEVEL) && ((uint8_t)(LT) & (uint8_t)(LogType::SD)) && Initialized){
-		SD_print_LL_type(LL);
-		__W_SD::getInstance().appendFile(filepath.c_str(), s.c_str());
+}
+
+// write the buffered log lines to the log file
+ERR_Type Logger::SD_flush(bool all){
+	// (re)open the log file, this is a no-op when it is still open.
+	ERR_Type ret = __W_SD::getInstance().openStream(log_stream, filepath.c_str());
+	// without a log file the data is dropped, otherwise a missing SD card would stall the buffer forever.
+	ERR_Type ET = SD_buffer.flush(all, millis(), ret ? nullptr : SD_append, this);
+	return ret ? ret : ET;
+}
+
+ERR_Type Logger::SD_append(const uint8_t* data, size_t len, void* context){
+	Logger* logger = (Logger*)context;
+	return __W_SD::getInstance().appendStream(logger->log_stream, data, len);
+}
+
+// log text to the SD, either directly or as a text record
+void Logger::SD_text(const char* s, size_t len, LogLevel LL, bool newline){
+#if LOG_FORMAT == LOG_FORMAT_BINARY
+	// collect the fragments so that a complete line ends up in a single record.
+	while(len){
+		size_t n = sizeof(SD_line) - SD_line_len;
+		if(n > len){ n = len; }
+		memcpy(SD_line + SD_line_len, s, n);
+		SD_line_len += n;
+		s += n;
+		len -= n;
+		if(SD_line_len == sizeof(SD_line)){
+			SD_textRecord(LL); // the line is too long, store it in multiple records.
+		}
+	}
+	if(newline){
+		SD_textRecord(LL);
+		SD_checkFlush(LL);
 	}
+#else
+	SD_print_LL_type(LL);
+	SD_write(s, len);
+	if(newline){
+		SD_write("\n", 1);
+		SD_line_ended = true; // signal that for the next print statement a debug indicator should be added at the start.
+		SD_checkFlush(LL);
+	}
+#endif
+}
+
+#if LOG_FORMAT == LOG_FORMAT_BINARY
+// store the collected line as a text record
+void Logger::SD_textRecord(LogLevel LL){
+	static_assert(LOG_LINE_SIZE <= 253, "a log line should fit in a single text record");
+	uint8_t args[LOG_LINE_SIZE + 2];
+	args[0] = LOG_ARG_STR;
+	args[1] = (uint8_t)SD_line_len;
+	memcpy(args + 2, SD_line, SD_line_len);
+	SD_checkRotate();
+	SD_writeRecord(LOG_MSG_TEXT, LL, args, SD_line_len + 2, line_time);
+	SD_line_len = 0;
 }
+#endif
 
-void Logger::println(String s, LogLevel LL, LogType LT){
+// buffer a binary record for the SD
+void Logger::SD_writeRecord(LogMessage id, LogLevel LL, const uint8_t* args, size_t arglen, uint32_t timestamp){
+	uint8_t header[LOG_RECORD_HEADER_SIZE];
+	LogRecord::encodeHeader(header, (uint8_t)LL, id, timestamp, (uint8_t)arglen);
+	SD_write((const char*)header, sizeof(header));
+	SD_write((const char*)args, arglen);
+}
+
+ERR_Type Logger::flush(){
+	if(!Initialized){return SD_NOT_INIT;}
+#if LOG_ASYNC
+	if(writer_task && xTaskGetCurrentTaskHandle() != writer_task){
+		// the SD buffer belongs to the writer task, so let it flush once it has written the queued entries.
+		flush_request = true;
+		uint32_t start = millis();
+		while(flush_request){
+			if((millis() - start) >= LOG_FLUSH_INTERVAL){return ERROR;}
+			vTaskDelay(1);
+		}
+		return flush_result;
+	}
+#endif
+	return flushNow();
+}
+
+ERR_Type Logger::flushNow(){
+	ERR_Type ret = SD_flush(true);
+	if(ret){return ret;}
+	return __W_SD::getInstance().syncStream(log_stream);
+}
+
+// position in the values of a print statement while its entries are filled in.
+struct LogTextCursor {
+	const LogText* parts;
+	size_t count;
+	size_t part;
+	size_t offset;
+	const LogEntry* header;
+	bool newline;
+	size_t entries;
+};
+
+void Logger::printText(const LogText* parts, size_t count, LogLevel LL, bool toSerial, bool toSD, bool newline){
+	LogEntry header;
+	initEntry(header, LogEntryKind::Text, LL, toSerial, toSD);
+	const size_t room = sizeof(header.data) - 1;
+	size_t len = 0;
+	for(size_t i = 0; i < count; i++){
+		len += parts[i].len;
+	}
+	// texts that do not fit in a single entry are split over consecutive entries, only the last part ends the line.
+	LogTextCursor C = {parts, count, 0, 0, &header, newline, len ? (len + room - 1) / room : 1};
+	submit(LL, C.entries, [](LogEntry& E, size_t i, void* context){
+		LogTextCursor& C = *(LogTextCursor*)context;
+		memcpy(&E, C.header, offsetof(LogEntry, data));
+		size_t n = 0;
+		while(n < sizeof(E.data) - 1 && C.part < C.count){
+			const LogText& P = C.parts[C.part];
+			size_t take = P.len - C.offset < sizeof(E.data) - 1 - n ? P.len - C.offset : sizeof(E.data) - 1 - n;
+			memcpy(E.data + n, P.text() + C.offset, take);
+			n += take;
+			C.offset += take;
+			if(C.offset == P.len){
+				C.part++;
+				C.offset = 0;
+			}
+		}
+		E.data[n] = '\0';
+		E.len = n;
+		E.newline = C.newline && i + 1 == C.entries;
+	}, &C);
+}
+
+void Logger::writeChar(char c, LogLevel LL, bool toSerial, bool toSD){
+	LogEntry entry;
+	initEntry(entry, LogEntryKind::Char, LL, toSerial, toSD);
+	entry.data[0] = c;
+	entry.len = 1;
+	submit(entry);
+}
+
+void Logger::logRecord(LogMessage id, LogLevel LL, bool toSerial, bool toSD, LogEntry& entry, size_t arglen){
+	initEntry(entry, LogEntryKind::Record, LL, toSerial, toSD);
+	entry.id  = id;
+	entry.len = arglen;
+	submit(entry);
+}
+
+void Logger::breakLine(LogType LT){
+	// the writer writes a linebreak at the level of the line it is part of, which is only known by the writer.
+	// it is queued at Info, so it doesn't take the reserved slots or the wait of an error.
+	LogEntry entry;
+	initEntry(entry, LogEntryKind::Break, LogLevel::Info, false, false);
+	entry.type = (uint8_t)LT;
+	submit(entry);
+}
+
+// writes text to the serial & SD
+void Logger::outText(const char* s, size_t len, LogLevel LL, bool toSerial, bool toSD, bool newline){
 	PREV_LL = LL;
-	
+
 	// write to serial
-	if(((uint8_t)(PREV_LL) <= DEBUGLEVEL) && ((uint8_t)(LT) & (uint8_t)(LogType::Serial))){
+	if(toSerial){
 		SER_print_LL_type(LL);
-		Serial.println(s);
-		SER_line_ended = true; // signal that for the next print statement a debug indicator should be added at the start.
+		if(newline){
+			Serial.println(s);
+			SER_line_ended = true; // signal that for the next print statement a debug indicator should be added at the start.
+		}
+		else{
+			Serial.print(s);
+		}
 	}
 	// write to sd
-	if(((uint8_t)(PREV_LL) <= LOGLEVEL) && ((uint8_t)(LT) & (uint8_t)(LogType::SD)) && Initialized){
-		SD_print_LL_type(LL);
-		__W_SD::getInstance().appendFile(filepath.c_str(), (s + String("\n")).c_str());
-		SD_line_ended = true; // signal that for the next print statement a debug indicator should be added at the start.
+	if(toSD && Initialized){
+		SD_text(s, len, LL, newline);
 	}
 }
 
-// writes a character to the file & serial
-void Logger::write(char s, LogLevel LL, LogType LT){
+// writes a character to the serial
+void Logger::outChar(char c, LogLevel LL, bool toSerial){
 	PREV_LL = LL;
 	// write to serial
-	if(((uint8_t)(PREV_LL) <= DEBUGLEVEL) && ((uint8_t)(LT) & (uint8_t)(LogType::Serial))){
+	if(toSerial){
 		SER_print_LL_type(LL);
-		Serial.write(s);
+		Serial.write(c);
 	}
 	// write to sd
-	//if(((uint8_t)(PREV_LL) <= LOGLEVEL) && ((uint8_t)(LT) & (uint8_t)(LogType::SD)) && Initialized){
+	//if(toSD && Initialized){
 	//	SD_print_LL_type(LL);
 	//	//! NOTE: breekt dingen waarschijnlijk :)
 	// 	//! NOTE: het breekt inderdaad dingen :)
@@ -143,17 +481,43 @@ void Logger::write(char s, LogLevel LL, LogType LT){
 	//}
 }
 
+// logs a message from the LogMessages table
+void Logger::outRecord(LogMessage id, LogLevel LL, bool toSerial, bool toSD, const uint8_t* args, size_t arglen){
+	PREV_LL = LL;
+	toSD = toSD && Initialized;
+
+	// only format the message when it is printed as text.
+	char text[LOG_LINE_SIZE];
+	size_t len = 0;
+	if(toSerial || (toSD && LOG_FORMAT == LOG_FORMAT_TEXT)){
+		len = LogRecord::format(text, sizeof(text), log_message_formats[id], args, arglen);
+	}
+
+	// write to serial
+	if(toSerial){
+		SER_print_LL_type(LL);
+		Serial.println(text);
+		SER_line_ended = true;
+	}
+	// write to sd
+	if(toSD){
+#if LOG_FORMAT == LOG_FORMAT_BINARY
+		(void)len; // the text is only used for the serial.
+		SD_checkRotate();
+		SD_writeRecord(id, LL, args, arglen, line_time);
+		SD_checkFlush(LL);
+#else
+		SD_text(text, len, LL, true);
+#endif
+	}
+}
+
 // writes a new line & tab to the file
-void Logger::breakLine(LogType LT){
+void Logger::outBreak(LogType LT){
 	if(((uint8_t)(PREV_LL) <= DEBUGLEVEL) && ((uint8_t)(LT) & (uint8_t)(LogType::Serial))){
 		Serial.print("\n\t\t");
 	}
 	if(((uint8_t)(PREV_LL) <= LOGLEVEL) && ((uint8_t)(LT) & (uint8_t)(LogType::SD)) && Initialized){
-		__W_SD::getInstance().appendFile(filepath.c_str(), "\n\t\t");
+		SD_text("\n\t\t", 3, PREV_LL, false);
 	}
-}
-
-// signal that the datadump has ended
-void Logger::dataDumpEnd(LogType LT){
-	Logger::println("\n[Dump]: ---------- End", LogLevel::DataDump, LT);
 }
\ No newline at end of file
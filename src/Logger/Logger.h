@@ -11,9 +11,18 @@
 #pragma once
 
 #include <Arduino.h>
+#include <type_traits>
 #include "../Wrappers/SD/__W_SD.h"
+#include "../Wrappers/RTC/__W_RTC.h"
 #include "../Wrappers/Singleton/Singleton.h"
 #include "../Defines/Defines.h"
+#include "LogBuffer.h"
+#include "LogMessages.h"
+#include "LogRecord.h"
+#include "LogQueue.h"
+#include "LogIndex.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 
 /**
  * @defgroup ENUM Global Enumerations
@@ -58,11 +67,113 @@ enum class LogType {
 };
 /**@}*/
 
+/**
+ *  Checks at compile time if a message with the given loglevel and type should be printed to the serial.
+ * @param LL the log level.
+ * @param LT the output to log to.
+ * @return true when DEBUGLEVEL allows the loglevel and LT contains LogType::Serial.
+ */
+constexpr bool LogToSerial(LogLevel LL, LogType LT){
+	return ((uint8_t)(LL) <= DEBUGLEVEL) && ((uint8_t)(LT) & (uint8_t)(LogType::Serial));
+}
+/**
+ *  Checks at compile time if a message with the given loglevel and type should be logged to the SD card.
+ * @param LL the log level.
+ * @param LT the output to log to.
+ * @return true when LOGLEVEL allows the loglevel and LT contains LogType::SD.
+ */
+constexpr bool LogToSD(LogLevel LL, LogType LT){
+	return ((uint8_t)(LL) <= LOGLEVEL) && ((uint8_t)(LT) & (uint8_t)(LogType::SD));
+}
+/**
+ *  Checks at compile time if a message with the given loglevel and type is logged at all.
+ * Print statements for which this is false are compiled out.
+ * @param LL the log level.
+ * @param LT the output to log to.
+ * @return true when the message is printed to the serial, the SD card or both.
+ */
+constexpr bool LogEnabled(LogLevel LL, LogType LT){
+	return LogToSerial(LL, LT) || LogToSD(LL, LT);
+}
+
+/**
+ * @addtogroup ENUM
+ * @{
+ */
+/**
+ *  Kind of log statement stored in a LogEntry.
+ */
+enum class LogEntryKind : uint8_t {
+	/** (0) Text of a print or println statement. */
+	Text,
+	/** (1) Single character of a write statement. */
+	Char,
+	/** (2) Message from the LogMessages table with its encoded arguments. */
+	Record,
+	/** (3) Linebreak of a breakLine statement. */
+	Break
+};
+/**@}*/
+
+/**
+ * @addtogroup STRUCT
+ * @{
+ */
+/**
+ *  A single log statement as it is passed from the calling task to the Logger writer task.
+ */
+struct LogEntry {
+	/** millis() at the time of the log statement. */
+	uint32_t	 timestamp;
+	/** Message id of a Record entry. */
+	uint16_t	 id;
+	/** LogEntryKind of the entry. */
+	LogEntryKind kind;
+	/** LogLevel of the entry. */
+	uint8_t		 level;
+	/** LogType flags of the outputs to log to. */
+	uint8_t		 type;
+	/** Set when the entry ends the log line. */
+	uint8_t		 newline;
+	/** Length of the data. */
+	uint8_t		 len;
+	/** Null terminated text, the character or the encoded arguments of the entry. */
+	uint8_t		 data[LOG_ENTRY_SIZE - 11];
+};
+static_assert(sizeof(LogEntry) <= LOG_ENTRY_SIZE, "LogEntry is larger than LOG_ENTRY_SIZE");
+
+/**
+ *  A single value of a print statement as text.
+ * C strings and Strings are referenced as they are, other values are converted to a String which is kept in the LogText.
+ */
+struct LogText {
+	/** The referenced text, nullptr when the text is kept in value. */
+	const char* s;
+	/** Length of the text. */
+	size_t		len;
+	/** The converted value, the text is read from here so a copy of the LogText stays valid. */
+	String		value;
+
+	/** @brief References a C string. */
+	LogText(const char* s) : s(s), len(strlen(s)) {}
+	/** @brief References a String, which should outlive the LogText. */
+	LogText(const String& s) : s(s.c_str()), len(s.length()) {}
+	/** @brief Converts any other value to a String. */
+	template<typename T>
+	LogText(T v) : s(nullptr), value(v) { len = value.length(); }
+
+	/** @brief Returns the text. */
+	const char* text() const { return s ? s : value.c_str(); }
+};
+/**@}*/
+
 // Logger is the master of Serial1 aswell as the SD card.
 
 /**
  *  Logger singleton class.
  * Logger is implemented as a Singleton to prevent two simultaneous logger instances from accessing the serial or sd.
+ * With LOG_ASYNC enabled the log statements only copy a LogEntry into a lock-free queue, which is written to the serial and
+ * SD card by a writer task on LOG_TASK_CORE. The line state below is then only used by the writer task.
  */
 class Logger : public __iW_Module, public iSingleton{
 private:
@@ -84,14 +195,118 @@ private:
 	 *  Tracks the current LogLevel.
 	 */
 	LogLevel PREV_LL;
+	/**
+	 *  millis() of the log statement that is being written.
+	 */
+	uint32_t line_time = 0;
 	/**
 	 *  Contains the filepath to the current log file on the SD card.
 	 */
 	String filepath = "";
+	/**
+	 *  Stream that keeps the current log file open between flushes.
+	 */
+	SD_Stream log_stream;
 	/**
 	 *  Tracks the current day, used to check if the day has changed. Indicating a new log file should be made.
 	 */
 	uint8_t curr_day = 32;
+	/**
+	 *  Amount of bytes written to the current log file.
+	 */
+	uint32_t SD_file_size = 0;
+	/**
+	 *  Set while a new log file is started, prevents the log statements of the SD functions from starting another one.
+	 */
+	bool SD_rotating = false;
+	/**
+	 *  Mount count of the storage from which the log index was loaded, a new log file and index are used when another storage is mounted.
+	 */
+	uint32_t SD_mount = 0;
+	/**
+	 *  Index of the log files on the SD card, used to delete the oldest log files.
+	 */
+	LogIndex log_index;
+
+	/**
+	 *  Ring buffer in which the SD log lines are collected before they are written to the SD card.
+	 */
+	LogBuffer SD_buffer;
+
+	/**
+	 *  Copies the given characters into the SD_buffer.
+	 * When the buffer runs full the buffered chunks are written to the SD card first.
+	 * @param s the characters to be buffered.
+	 * @param len the amount of characters.
+	 */
+	void SD_write(const char* s, size_t len);
+	/**
+	 *  Checks if the SD_buffer should be written to the SD card.
+	 * An error is always flushed immediately, otherwise the buffer is flushed once LOG_FLUSH_SIZE bytes are collected
+	 * or the last flush was longer than LOG_FLUSH_INTERVAL ms ago.
+	 * @param LL The loglevel of the ended log line.
+	 */
+	void SD_checkFlush(LogLevel LL);
+	/**
+	 *  Writes the SD_buffer to the log file.
+	 * @param all when false only complete LOG_FLUSH_SIZE chunks are written, the rest stays in the buffer.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 */
+	ERR_Type SD_flush(bool all);
+	/**
+	 *  Appends a part of the SD_buffer to the log stream, the sink of Logger::SD_flush().
+	 * @param context handle to the Logger.
+	 */
+	static ERR_Type SD_append(const uint8_t* data, size_t len, void* context);
+
+#if LOG_FORMAT == LOG_FORMAT_BINARY
+	/**
+	 *  Collects the text fragments of the current SD log line, which is stored as a single text record once it ends.
+	 */
+	char SD_line[LOG_LINE_SIZE];
+	/**
+	 *  Length of the text in SD_line.
+	 */
+	size_t SD_line_len = 0;
+	/**
+	 *  Stores the collected SD_line as a LOG_MSG_TEXT record.
+	 * @param LL The loglevel of the line.
+	 */
+	void SD_textRecord(LogLevel LL);
+#endif
+	/**
+	 *  Logs the given text to the SD card, as text or as text record depending on LOG_FORMAT.
+	 * @param s the text.
+	 * @param len the length of the text.
+	 * @param LL The loglevel of the text.
+	 * @param newline end the log entry after the text.
+	 */
+	void SD_text(const char* s, size_t len, LogLevel LL, bool newline);
+	/**
+	 *  Buffers a binary log record for the SD card.
+	 * @param id the message id.
+	 * @param LL the loglevel.
+	 * @param args the encoded arguments.
+	 * @param arglen the length of the encoded arguments.
+	 * @param timestamp the millis() value at the time of the record.
+	 */
+	void SD_writeRecord(LogMessage id, LogLevel LL, const uint8_t* args, size_t arglen, uint32_t timestamp);
+	/**
+	 *  Creates a new log file for the given date and time and deletes the oldest log files.
+	 * The oldest log file is deleted once LOG_MAX_FILES are stored, or while less than LOG_MIN_FREE_SPACE bytes are free.
+	 * @param RTC_DT The date and time at which the file is created.
+	 */
+	void SD_openLogFile(const RTC_DATE_TIME& RTC_DT);
+	/**
+	 *  Starts a new log file when the day has changed or the current file has reached LOG_MAX_FILE_SIZE.
+	 * Should only be called at the start of a log line, so lines are not split over two files.
+	 */
+	void SD_checkRotate();
+	/**
+	 *  Writes the header at the start of a new log file.
+	 * In binary files the header also contains a time anchor record which the LogDecoder uses to turn the millis() timestamps into a time.
+	 */
+	void SD_startFile();
 
 	/**
 	 *  Used to create the header of a log message on serial. Looks like: "[Time][LogLevel] message".
@@ -113,6 +328,149 @@ private:
 	 */
 	void SD_print_LL_type(LogLevel LL);
 
+	/**
+	 *  Queue between the log statements and the writer task.
+	 */
+	LogQueue<LogEntry, LOG_QUEUE_LENGTH> log_queue;
+	/**
+	 *  Handle of the writer task, NULL while the log statements are written directly.
+	 */
+	TaskHandle_t writer_task = NULL;
+	/**
+	 *  Amount of dropped entries per loglevel because the LogQueue was full.
+	 */
+	std::atomic<uint32_t> dropped[5];
+	/**
+	 *  Total amount of dropped entries that has been reported in the log.
+	 */
+	uint32_t reported_drops = 0;
+	/**
+	 *  Set by Logger::flush() to let the writer task flush the SD buffer, cleared by the writer task when done.
+	 */
+	std::atomic<bool> flush_request;
+	/**
+	 *  Result of the last flush done by the writer task.
+	 */
+	ERR_Type flush_result = SUCCESS;
+
+	/**
+	 *  Main loop of the writer task, writes the queued entries to the serial and SD card.
+	 * @param param handle to the Logger.
+	 */
+	static void writerTask(void* param);
+	/**
+	 *  Passes an entry to the writer task or writes it directly when there is no writer task.
+	 * When the LogQueue is full the entry is dropped, Info and lower entries are already dropped once less than
+	 * LOG_QUEUE_RESERVE entries are free, errors wait up to LOG_QUEUE_ERROR_WAIT ms for a free entry.
+	 * @param entry the entry to be logged.
+	 */
+	void submit(const LogEntry& entry);
+	/**
+	 *  Fills in the i-th entry of a statement that takes several entries.
+	 */
+	typedef void (*LogFill)(LogEntry& entry, size_t i, void* context);
+	/**
+	 *  Passes the entries of a statement to the writer task as one block of consecutive entries.
+	 * The block is dropped as a whole under the same rules as a single entry.
+	 * @param LL the log level of the entries.
+	 * @param count the amount of entries.
+	 * @param fill fills in the entries, is only called once there is room for all of them.
+	 * @param context passed to fill.
+	 */
+	void submit(LogLevel LL, size_t count, LogFill fill, void* context);
+	/**
+	 *  Fills in the common fields of a new entry.
+	 * @param entry the entry.
+	 * @param kind the kind of the entry.
+	 * @param LL the log level.
+	 * @param toSerial log the entry to the serial.
+	 * @param toSD log the entry to the SD card.
+	 */
+	void initEntry(LogEntry& entry, LogEntryKind kind, LogLevel LL, bool toSerial, bool toSD);
+	/**
+	 *  Writes a single entry to the outputs.
+	 * @param entry the entry.
+	 */
+	void outEntry(const LogEntry& entry);
+	/**
+	 *  Logs a warning with the amount of entries that have been dropped since the last report.
+	 */
+	void reportDrops();
+	/**
+	 *  Writes the SD buffer to the log file and syncs the file.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 */
+	ERR_Type flushNow();
+	/**
+	 *  Returns the time string of a log statement.
+	 * @param timestamp millis() at the time of the log statement.
+	 * @return the time in a h:m:s format.
+	 */
+	const char* timeString(uint32_t timestamp);
+
+	/**
+	 *  Writes the values of a print statement to the enabled outputs. Called by the print templates once the loglevel has been checked.
+	 * The values are joined into Text entries which are passed to the writer task as one block, so the statement can't be
+	 * interleaved with the statements of other tasks and is either logged completely or dropped completely.
+	 * @param parts the values as text.
+	 * @param count the amount of values.
+	 * @param LL the log level.
+	 * @param toSerial print the text to the serial.
+	 * @param toSD log the text to the SD card.
+	 * @param newline end the log entry after the text.
+	 */
+	void printText(const LogText* parts, size_t count, LogLevel LL, bool toSerial, bool toSD, bool newline);
+	/**
+	 *  Prints the values of a print statement one after another.
+	 * C strings and Strings are not copied into a new String for this.
+	 * @tparam T the datatypes of the passed values. Should be convertable to a string.
+	 * @see Logger::printText()
+	 */
+	template<typename... T>
+	void printValues(LogLevel LL, bool toSerial, bool toSD, bool newline, const T&... values){
+		const LogText parts[] = {values...};
+		printText(parts, sizeof...(T), LL, toSerial, toSD, newline);
+	}
+	/**
+	 *  Writes a single character to the enabled outputs.
+	 * @param c the character.
+	 * @param LL the log level.
+	 * @param toSerial write the character to the serial.
+	 * @param toSD log the character to the SD card.
+	 */
+	void writeChar(char c, LogLevel LL, bool toSerial, bool toSD);
+	/**
+	 *  Writes a log message to the enabled outputs. Called by Logger::log() once the loglevel has been checked.
+	 * @param id the message id.
+	 * @param LL the log level.
+	 * @param toSerial print the formatted message to the serial.
+	 * @param toSD log the message to the SD card.
+	 * @param entry entry of which the data already contains the encoded arguments.
+	 * @param arglen the length of the encoded arguments.
+	 */
+	void logRecord(LogMessage id, LogLevel LL, bool toSerial, bool toSD, LogEntry& entry, size_t arglen);
+
+	/**
+	 *  Writes text to the serial and SD card, used by the writer task for Text entries.
+	 * @see Logger::printText()
+	 */
+	void outText(const char* s, size_t len, LogLevel LL, bool toSerial, bool toSD, bool newline);
+	/**
+	 *  Writes a character to the serial, used by the writer task for Char entries.
+	 * @see Logger::writeChar()
+	 */
+	void outChar(char c, LogLevel LL, bool toSerial);
+	/**
+	 *  Writes a message to the serial and SD card, used by the writer task for Record entries.
+	 * @see Logger::logRecord()
+	 */
+	void outRecord(LogMessage id, LogLevel LL, bool toSerial, bool toSD, const uint8_t* args, size_t arglen);
+	/**
+	 *  Writes a linebreak to the serial and SD card, used by the writer task for Break entries.
+	 * @see Logger::breakLine()
+	 */
+	void outBreak(LogType LT);
+
 	/**
 	 *  virtual implementation of the iW_Module function.
 	 * Will report an error if not initialized.
@@ -134,7 +492,11 @@ public:
 	
 private:	
 	// remove access to the constructor of logger.
-	Logger(){}
+	Logger() : flush_request(false) {
+		for(int i = 0; i < 5; i++){
+			dropped[i].store(0);
+		}
+	}
 public:
 	// Assure that only one instance can exist by removing copy and assign functions.
 	Logger(Logger const&)			= delete;	// delete copy constructor.
@@ -150,72 +512,94 @@ public:
 
 	// print statements.
 	// ----------
+	// The loglevel and output are template parameters so that statements which are disabled by DEBUGLEVEL and LOGLEVEL
+	// are removed at compile time, including the String conversion of their value.
+	// Usage: Logger::getInstance().println<LogLevel::Info>("message");
 
 	/**
-	 *  Prints the given value to the specified output with the given loglevel.
+	 *  Prints the given values to the specified output with the given loglevel.
+	 * Multiple values are printed after each other, so there is no need to concatenate Strings at the call site:
+	 * print<LogLevel::Info>("Size: ", size, " bytes").
 	 * To end the log entry call Logger::println().
-	 * @tparam T the datatype of the passed value. Should be convertable to a string.
-	 * @param value the value to be printed.
-	 * @param LL the log level.
-	 * @param LT the output to log to.
+	 * @tparam LL the log level.
+	 * @tparam LT the output to log to.
+	 * @tparam T the datatypes of the passed values. Should be convertable to a string.
+	 * @param values the values to be printed.
 	 * @see Logger::println()
 	 * @see Logger::breakLine()
 	 */
-	template<typename T>
-	void print(T value, LogLevel LL, LogType LT = LogType::Serial_SD){
-		print(String(value), LL, LT);
+	template<LogLevel LL, LogType LT = LogType::Serial_SD, typename... T>
+	typename std::enable_if<LogEnabled(LL, LT)>::type print(const T&... values){
+		printValues(LL, LogToSerial(LL, LT), LogToSD(LL, LT), false, values...);
 	}
+	/** @cond */
+	template<LogLevel LL, LogType LT = LogType::Serial_SD, typename... T>
+	typename std::enable_if<!LogEnabled(LL, LT)>::type print(const T&...){}
+	/** @endcond */
 
 	/**
-	 *  Prints the given value to the specified output with the given loglevel and ends the line.
+	 *  Prints the given values to the specified output with the given loglevel and ends the line.
 	 * Call this function when a log entry ends. If you need multiple prints in the same log entry use Logger::print().
-	 * @tparam T the datatype of the passed value. Should be convertable to a string.
-	 * @param value the value to be printed.
-	 * @param LL the log level.
-	 * @param LT the output to log to.
+	 * @tparam LL the log level.
+	 * @tparam LT the output to log to.
+	 * @tparam T the datatypes of the passed values. Should be convertable to a string.
+	 * @param values the values to be printed.
 	 * @see Logger::print()
 	 * @see Logger::breakLine()
 	 */
-	template<typename T>
-	void println(T value, LogLevel LL, LogType LT = LogType::Serial_SD){
-		println(String(value), LL, LT);
+	template<LogLevel LL, LogType LT = LogType::Serial_SD, typename... T>
+	typename std::enable_if<LogEnabled(LL, LT)>::type println(const T&... values){
+		printValues(LL, LogToSerial(LL, LT), LogToSD(LL, LT), true, values...);
 	}
+	/** @cond */
+	template<LogLevel LL, LogType LT = LogType::Serial_SD, typename... T>
+	typename std::enable_if<!LogEnabled(LL, LT)>::type println(const T&...){}
+	/** @endcond */
 
-	/**
-	 *  Prints the given value to the specified output with the given loglevel.
-	 * To end the log entry call Logger::println().
-	 * @tparam T the datatype of the passed value. Should be convertable to a string.
-	 * @param s the string to be printed.
-	 * @param LL the log level.
-	 * @param LT the output to log to.
-	 * @see Logger::println()
-	 * @see Logger::breakLine()
-	 */
-	void print(String s, LogLevel LL, LogType LT = LogType::Serial_SD);
-	/**
-	 *  Prints the given value to the specified output with the given loglevel and ends the line.
-	 * Call this function when a log entry ends. If you need multiple prints in the same log entry use Logger::print().
-	 * @tparam T the datatype of the passed value. Should be convertable to a string.
-	 * @param s the value to be printed.
-	 * @param LL the log level.
-	 * @param LT the output to log to.
-	 * @see Logger::print()
-	 * @see Logger::breakLine()
-	 */
-	void println(String s, LogLevel LL, LogType LT = LogType::Serial_SD);
 	/**
 	 *  writes the given character to the specified output with the given loglevel. Use this with loglevel DataDump and Logger::dataDumpEnd().
 	 * To end the log entry call Logger::println().
-	 * @tparam T the datatype of the passed value. Should be convertable to a string.
-	 * @param s the value to be printed.
-	 * @param LL the log level.
-	 * @param LT the output to log to.
+	 * @tparam LL the log level.
+	 * @tparam LT the output to log to.
+	 * @param c the character to be written.
 	 * @see Logger::print()
 	 * @see Logger::println()
 	 * @see Logger::breakLine()
 	 * @see Logger::dataDumpEnd()
 	 */
-	void write(char s, LogLevel LL, LogType LT = LogType::Serial_SD);
+	template<LogLevel LL, LogType LT = LogType::Serial_SD>
+	typename std::enable_if<LogEnabled(LL, LT)>::type write(char c){
+		writeChar(c, LL, LogToSerial(LL, LT), LogToSD(LL, LT));
+	}
+	/** @cond */
+	template<LogLevel LL, LogType LT = LogType::Serial_SD>
+	typename std::enable_if<!LogEnabled(LL, LT)>::type write(char){}
+	/** @endcond */
+
+	/**
+	 *  Logs a complete log entry from the LogMessages table.
+	 * The arguments are stored in their binary form and only formatted when they are printed as text.
+	 * With LOG_FORMAT set to LOG_FORMAT_BINARY the SD card receives a small record instead of a formatted line.
+	 * Usage: Logger::getInstance().log<LogLevel::Info>(LOG_MSG_SCD30, CO2, Temperature, Humidity).
+	 * @tparam LL the log level.
+	 * @tparam LT the output to log to.
+	 * @tparam T the datatypes of the arguments. Should be integers, floats or strings.
+	 * @param id the message id.
+	 * @param args the arguments of the message, one for every {} in the format string.
+	 * @see LOG_MESSAGE_TABLE
+	 */
+	template<LogLevel LL, LogType LT = LogType::Serial_SD, typename... T>
+	typename std::enable_if<LogEnabled(LL, LT)>::type log(LogMessage id, const T&... args){
+		// the arguments are encoded straight into the entry, arguments that do not fit are printed as ?.
+		LogEntry entry;
+		size_t len = LogRecord::encodeArgs(entry.data, sizeof(entry.data), args...);
+		logRecord(id, LL, LogToSerial(LL, LT), LogToSD(LL, LT), entry, len);
+	}
+	/** @cond */
+	template<LogLevel LL, LogType LT = LogType::Serial_SD, typename... T>
+	typename std::enable_if<!LogEnabled(LL, LT)>::type log(LogMessage, const T&...){}
+	/** @endcond */
+
 	/**
 	 *  adds a linebreak to a log entry without ending it.
 	 * @param LT The Loglevel.
@@ -223,7 +607,31 @@ public:
 	void breakLine(LogType LT = LogType::Serial_SD);
 	/**
 	 *  End the started datadump entry.
-	 * @param LT The Loglevel.
+	 * @tparam LT The output to log to.
+	 */
+	template<LogType LT = LogType::Serial_SD>
+	void dataDumpEnd(){
+		println<LogLevel::DataDump, LT>("\n[Dump]: ---------- End");
+	}
+
+	/**
+	 *  Writes everything that is still in the RAM buffer to the SD card.
+	 * Call this before the SD card is removed or the ESP32 is put to sleep.
+	 * With LOG_ASYNC enabled this waits until the writer task has written all log statements made before this call.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 */
+	ERR_Type flush();
+
+	/**
+	 *  Returns the amount of log entries of the given level that were dropped because the LogQueue was full.
+	 * @param LL the log level.
+	 * @return uint32_t the amount of dropped entries since boot.
+	 */
+	uint32_t droppedEntries(LogLevel LL){ return dropped[(uint8_t)LL].load(); }
+	/**
+	 *  Returns the highest amount of entries that has been in the LogQueue at once.
+	 * When this gets close to LOG_QUEUE_LENGTH the queue should be made longer.
+	 * @return size_t the amount of entries.
 	 */
-	void dataDumpEnd(LogType LT = LogType::Serial_SD);
+	size_t queueHighWater(){ return log_queue.highWater(); }
 };
\ No newline at end of file
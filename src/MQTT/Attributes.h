@@ -0,0 +1,114 @@
+/**
+ * @file Attributes.h
+ * @author Imre Korf
+ * @brief Names of the attributes of the sensebox on the IoT platform, and the members of their json values.
+ * @version 0.1
+ * @date 2022-01-13
+ * 
+ * This file only uses the standard library, so the attribute names can also be used by the host tools.
+ * 
+ * @copyright Copyright (c) 2022
+ * 
+ */
+
+#pragma once 
+
+#include "PayloadWriter.h"
+
+/**
+ * @addtogroup ENUM
+ * @{
+ */
+
+/**
+ * @brief Attribute array indices for the attribute_names array.
+ */
+enum attributes {
+    /** Connection, used to signify if the box is connected to the IoT platform.*/
+    CONN,
+    /** Ambimate temperature, int */
+    ambimate_temp,
+    /** Ambimate humidity, float */
+    ambimate_hum,
+    /** Ambimate Eco2, int */
+    ambimate_Eco2,
+    /** Ambimate VOC, int */
+    ambimate_Voc,
+    /** AS7262_Color, json */
+    AS7262_Color,
+    /** TSL2591_Spectrum, json */
+    TSL2591_Spectrum,
+    /** SCD30 CO2, int */
+    SCD30_CO2,
+    /** SCD30 temperature, int */
+    SCD30_temp,
+    /** SCD30 humidity, float */
+    SCD30_hum,
+    /** A-weighted sound level in dB(A), float */
+    MAX4466_Audio,
+    /** Oxygen int */
+    MIX8410_O2,
+    /** PM10 measurement. */
+    PM10,
+    /** PM25 measurement. */
+    PM25,
+    /** PM100 measurement. */
+    PM100,
+    /** Sound level per octave band, json */
+    MAX4466_Bands,
+    /** Time in seconds since 1970 at which the measurement of a batch from the spool was taken, int */
+    TIMESTAMP,
+    /** All the measurements of a cycle as one json object keyed by the names above, only used with MQTT_BATCH. */
+    BATCH,
+    /** Amount of attributes, not an attribute. */
+    ATTRIBUTE_COUNT
+};
+
+/** @} */
+
+/**
+ * @brief Attributes array containing the MQTT names of the measured properties
+ */
+static const char * const attribute_names[] = {
+  [CONN]              = "Connection",
+  [ambimate_temp]     = "ambimate_Temperatuur",
+  [ambimate_hum]      = "ambimate_Humidity",
+  [ambimate_Eco2]     = "ambimate_Eco2",
+  [ambimate_Voc]      = "ambimate_Voc",
+  [AS7262_Color ]     = "AS7262_Color",
+  [TSL2591_Spectrum]  = "TSL2591_Spectrum",
+  [SCD30_CO2]         = "SCD30_CO2",
+  [SCD30_temp]        = "SCD30_Tempratuur",
+  [SCD30_hum]         = "SCD30_Humidity",
+  [MAX4466_Audio]     = "MAX4466_Audio",
+  [MIX8410_O2]        = "MIX8410_O2",
+  // TODO: change IOT names to PM10 and PM100
+  [PM10]              = "particlesPM1",
+  [PM25]              = "particlesPM2_5",
+  [PM100]             = "particlesPM10",
+  [MAX4466_Bands]     = "MAX4466_Bands",
+  [TIMESTAMP]         = "Timestamp",
+  [BATCH]             = "Batch"
+};
+static_assert(sizeof(attribute_names) / sizeof(attribute_names[0]) == ATTRIBUTE_COUNT, "every attribute needs a name");
+
+/**
+ * @brief Members of the AS7262_Color json object.
+ */
+static constexpr JsonField AS7262_Color_fields[] = {
+  {"Violet", 2}, {"Blue", 2}, {"Green", 2}, {"Yellow", 2}, {"Orange", 2}, {"Red", 2}
+};
+
+/**
+ * @brief Members of the TSL2591_Spectrum json object.
+ */
+static constexpr JsonField TSL2591_Spectrum_fields[] = {
+  {"Visible", 0}, {"IR", 0}, {"Full", 0}, {"Lux", 2}
+};
+
+/**
+ * @brief Members of the MAX4466_Bands json object, the octave bands by their center frequency.
+ */
+static constexpr JsonField MAX4466_Bands_fields[] = {
+  {"63", 1}, {"125", 1}, {"250", 1}, {"500", 1}, {"1k", 1}, {"2k", 1}, {"4k", 1}, {"8k", 1}
+};
\ No newline at end of file
@@ -3,9 +3,35 @@
 #include <Arduino.h>
 
 #define KEY 4181456146874
+/** @brief Value of the first 4 bytes of a message in MQTT_UNACKED_FILE ("UNAK"). */
+#define MQTT_UNACKED_MAGIC 0x4B414E55
 
-MQTTClient::MQTTClient() : client(espClient){
+// header of a message in MQTT_UNACKED_FILE, followed by the payload.
+struct UnackedHeader {
+	uint32_t magic;
+	uint16_t length;
+	uint8_t attribute;
+	uint8_t reserved;
+};
 
+bool SecureTransport::write(const uint8_t* data, size_t length){
+	return client.write(data, length) == length;
+}
+
+int SecureTransport::read(uint8_t* data, size_t length){
+	int available = client.available();
+	if(available > 0){
+		return client.read(data, (size_t)available < length ? available : length);
+	}
+	return client.connected() ? 0 : -1;
+}
+
+MQTTClient::MQTTClient() : session(transport), topic_max(0){
+	for(int i = 0; i < ATTRIBUTE_COUNT; i++){
+		topics[i] = nullptr;
+	}
+	session.setMessageCallback(callback, this);
+	session.setUnackedCallback(onUnacked, this);
 }
 
 MQTTClient::~MQTTClient(){
@@ -17,30 +43,38 @@ ERR_Type MQTTClient::init(char* path){
 	if(ret = getSettings(path), ret){
 		return ret;
 	}
-	if(ret = initWiFi(), ret){
+	if(ret = buildTopics(), ret){
 		return ret;
 	}
-	if(ret = initMqttConnect(), ret){
-		return ret;
+	if(!connect_task && xTaskCreatePinnedToCore(connectTask, "MQTTConnect", MQTT_CONNECT_STACK, this, MQTT_CONNECT_PRIORITY, &connect_task, MQTT_CONNECT_CORE) != pdPASS){
+		Logger::getInstance().println<LogLevel::Error>("Failed to create the MQTT connect task.");
+		return ERROR;
 	}
+	configure();
+	// messages that were not acknowledged before a reset are published again once connected.
+	unacked_pending = __W_SD::getInstance().exists(MQTT_UNACKED_FILE);
+	unacked_offset = 0;
+	unacked_mount = __W_SD::getInstance().getMountCount();
+	connect_start = millis();
+	reconnect();
 	return SUCCESS;
 }
 
 ERR_Type MQTTClient::getSettings(char* path){
 	// read settings
-	unsigned long length;
-	__W_SD::getInstance().getFileSize(path, length);
+	char buffer[MQTT_SETTINGS_SIZE];
+	size_t length = 0;
+	ERR_Type ET = __W_SD::getInstance().readFile(path, (uint8_t*)buffer, sizeof(buffer), length);
+	if(ET){
+		return ET;
+	}
 	if(length == 0){
-		Logger::getInstance().println(String(path) + " is empty.", LogLevel::Error);
+		Logger::getInstance().println<LogLevel::Error>(path, " is empty.");
 		return WIFI_SETTINGS_EMPTY;
 	}
 
-	// create a buffer
-	char* buffer = new char[length]; // spooky mem alloc on a mcu
-	__W_SD::getInstance().readFile(path, buffer);
-
-	// decrypt
-	char* settings = new char[(length-1)/2+1];
+	// decrypt, this is done in place as every character is made from the two bytes at or after its own position.
+	char* settings = buffer;
 	for (unsigned long i = 0; i < length-1; i+=2)
 	{
 		uint8_t crypt = buffer[i];
@@ -67,7 +101,7 @@ ERR_Type MQTTClient::getSettings(char* path){
 		if(i == n){
 			// some safety and logging
 			if(settings[j] == '\0'){
-				Logger::getInstance().println("premature exit from config formatting", LogLevel::Error);
+				Logger::getInstance().println<LogLevel::Error>("premature exit from config formatting");
 				return WIFI_SETTINGS_NOT_COMPLETE;
 			}
 			// special parsing
@@ -75,7 +109,7 @@ ERR_Type MQTTClient::getSettings(char* path){
 			while(settings[j] != '\n'){
 				// more safety and logging
 				if(settings[j] == '\0'){
-					Logger::getInstance().println("premature exit from config formatting", LogLevel::Error);
+					Logger::getInstance().println<LogLevel::Error>("premature exit from config formatting");
 					return WIFI_SETTINGS_NOT_COMPLETE;
 				}
 				// copy from settings array to temporary buffer
@@ -89,13 +123,13 @@ ERR_Type MQTTClient::getSettings(char* path){
 		// parse port
 		if(i == 4){
 			if(settings[j] == '\0'){
-				Logger::getInstance().println("premature exit from config formatting", LogLevel::Error);
+				Logger::getInstance().println<LogLevel::Error>("premature exit from config formatting");
 				return WIFI_SETTINGS_NOT_COMPLETE;
 			}
 			char buff[10]; // character port buffer
 			while(settings[j] != '\n'){
 				if(settings[j] == '\0'){
-					Logger::getInstance().println("premature exit from config formatting", LogLevel::Error);
+					Logger::getInstance().println<LogLevel::Error>("premature exit from config formatting");
 					return WIFI_SETTINGS_NOT_COMPLETE;
 				}
 				buff[k++] = settings[j++];
@@ -107,7 +141,7 @@ ERR_Type MQTTClient::getSettings(char* path){
 		// parse IP
 		else if(i == 5){
 			if(settings[j] == '\0'){
-				Logger::getInstance().println("premature exit from config formatting", LogLevel::Error);
+				Logger::getInstance().println<LogLevel::Error>("premature exit from config formatting");
 				return WIFI_SETTINGS_NOT_COMPLETE;
 			}
 			char buff[4]; // octal buffer
@@ -135,11 +169,11 @@ ERR_Type MQTTClient::getSettings(char* path){
 			while(settings[j] != '\n'){
 				// parse other settings
 				if(settings[j] == '\0'){
-				Logger::getInstance().println("premature exit from config formatting", LogLevel::Error);
+				Logger::getInstance().println<LogLevel::Error>("premature exit from config formatting");
 				return WIFI_SETTINGS_NOT_COMPLETE;
 			}
 				if(k >= 100){
-					Logger::getInstance().println("Provided settings string is over 100 characters.", LogLevel::Error);
+					Logger::getInstance().println<LogLevel::Error>("Provided settings string is over 100 characters.");
 					return WIFI_SETTINGS_STRING_OVERLOAD;
 					break;
 				}
@@ -152,64 +186,34 @@ ERR_Type MQTTClient::getSettings(char* path){
 	return SUCCESS;
 }
 
-ERR_Type MQTTClient::initWiFi() {
-	WiFi.mode(WIFI_STA);
-	WiFi.begin(ssid, password);
-
-	Logger::getInstance().print("Connecting to WiFi ..", LogLevel::Info);
-
-	int i = 0;
-	for(; i < WIFI_TIMEOUT && WiFi.status() != WL_CONNECTED; i++) {
-		Logger::getInstance().print('.', LogLevel::Info);
-		delay(1000);
-	}
-
-	if(i >= WIFI_TIMEOUT){
-		Logger::getInstance().println("\n Failed to connect to WiFi", LogLevel::Error);
-		return WIFI_CONN_FAIL;
-	}
-	else{
-		Logger::getInstance().print("\nConnencted to wiFi with ip: ", LogLevel::Info);
-		Logger::getInstance().print(WiFi.localIP()[0], LogLevel::Info); Logger::getInstance().print(".", LogLevel::Info);
-		Logger::getInstance().print(WiFi.localIP()[1], LogLevel::Info); Logger::getInstance().print(".", LogLevel::Info);
-		Logger::getInstance().print(WiFi.localIP()[2], LogLevel::Info); Logger::getInstance().print(".", LogLevel::Info);
-		Logger::getInstance().print(WiFi.localIP()[3], LogLevel::Info); Logger::getInstance().println("", LogLevel::Info);
-		return SUCCESS;
+ERR_Type MQTTClient::buildTopics(){
+	size_t used = 0;
+	topic_max = 0;
+	for(int i = 0; i < ATTRIBUTE_COUNT; i++){
+		PayloadWriter topic(topic_arena + used, sizeof(topic_arena) - used);
+		topic.raw("alkmaar/").raw(client_id).raw("/writeattributevalue/").raw(attribute_names[i]).raw(asset_id);
+		if(!topic.ok()){
+			Logger::getInstance().println<LogLevel::Error>("The MQTT topics don't fit in MQTT_TOPIC_ARENA.");
+			for(int j = 0; j < ATTRIBUTE_COUNT; j++){topics[j] = nullptr;}
+			return MQTT_TOPIC_OVERFLOW;
+		}
+		topics[i] = topic_arena + used;
+		used += topic.size() + 1;
+		if(topic.size() > topic_max){topic_max = topic.size();}
 	}
+	return SUCCESS;
 }
 
-ERR_Type MQTTClient::initMqttConnect()
-{
-	Logger::getInstance().println("\nStarting connection to server...", LogLevel::Info);
-	if(!WiFi.isConnected()){
-		Logger::getInstance().println("Not initializing the MQTT broker due to no WiFi connection.", LogLevel::Warning);
-		return WIFI_CONN_FAIL;
-	}
+void MQTTClient::configure(){
+	WiFi.mode(WIFI_STA);
 	// !IMPORTANT! If the following line is not set the server won't connect. Without this line it will try to verify a CA cert, that we don't have
-	espClient.setInsecure();
-
-	//  Set buffer size for autoprovision
-	//  if(!client.setBufferSize(4096))
-	//  {
-	//    Serial.println("the buffer could not be resized");
-	//  }
-	client.setServer(server, mqtt_port);
-	client.setCallback(callback);
-
-	int retries = 0;
-	while (!client.connected() && retries < MQTT_CONN_TIMEOUT) {
-		Logger::getInstance().println("The client " + String(client_id) + " connects to the public mqtt broker", LogLevel::Info);
-		if (client.connect(client_id, mqtt_username, mqtt_password)) {
-				Logger::getInstance().println("Mqtt broker connected", LogLevel::Info);
-		} else {
-				retries++;
-				Logger::getInstance().print("failed with state ", LogLevel::Error);
-				Logger::getInstance().println(client.state(), LogLevel::Error);
-				delay(2000);
-		}
-	}
-	if(retries >= MQTT_CONN_TIMEOUT){
-		return MQTT_CONN_FAIL;
+	transport.client.setInsecure();
+	transport.client.setHandshakeTimeout(MQTT_CONN_TIMEOUT);
+
+	// a message is published as one packet, which has to fit in MQTT_PACKET_SIZE together with the topic, the 5 byte header,
+	// the 2 byte topic length and the 2 byte packet id.
+	if((MQTT_BATCH ? MQTT_BATCH_SIZE : MQTT_PAYLOAD_SIZE) + topic_max + 9 > MQTT_PACKET_SIZE){
+		Logger::getInstance().println<LogLevel::Warning>("The MQTT topics are too long for MQTT_PACKET_SIZE, large messages will fail.");
 	}
 	// Allocate JsonDocument
 	//  const int capacity = JSON_OBJECT_SIZE(2);
@@ -220,43 +224,280 @@ ERR_Type MQTTClient::initMqttConnect()
 	//  doc["cert"] = "-----BEGIN CERTIFICATE-----\nMIIF8zCCA9sCFDmx9YwAvYOH/0v9O5E8KwMR2MkLMA0GCSqGSIb3DQEBCwUAMIG1MQswCQYDVQQGEwJOTDEWMBQGA1UECAwNTm9vcmQtSG9sbGFuZDEQMA4GA1UEBwwH\nQWxrbWFhcjEdMBsGA1UECgwUSG9nZXNjaG9vbCBJbkhvbGxhbmQxHzAdBgNVBAsM\nFlRlY2huaXNjaGUgSW5mb3JtYXRpY2ExEDAOBgNVBAMMB1RpbG1hbm4xKjAoBgkq\nhkiG9w0BCQEWG1RpbG1hbm4uS29zdGVyQGluaG9sbGFuZC5ubDAeFw0yMTExMjky\nMTAyNDlaFw0yMjExMjkyMTAyNDlaMIG1MQswCQYDVQQGEwJOTDEWMBQGA1UECAwN\nTm9vcmQtSG9sbGFuZDEQMA4GA1UEBwwHQWxrbWFhcjEdMBsGA1UECgwUSG9nZXNj\naG9vbCBJbkhvbGxhbmQxHzAdBgNVBAsMFlRlY2huaXNjaGUgSW5mb3JtYXRpY2Ex\nEDAOBgNVBAMMB1RpbG1hbm4xKjAoBgkqhkiG9w0BCQEWG1RpbG1hbm4uS29zdGVy\nQGluaG9sbGFuZC5ubDCCAiIwDQYJKoZIhvcNAQEBBQADggIPADCCAgoCggIBALlw\n6OvDFkA0P8Bg4kVwYpU0DW7DiKp0AQ/bYV/8Dg+9GBrr4Ck2q/m8jw8V2+FYUINp\nnVWo5CYiVy15QfDa5HgPFOzMDkTw3cstdOnLtz82hZePg1yLePD7wYJYF+NPZOoR\n5bPCRwjkKn5+c+mldKskNaEQLKQktLg1NFZCLjfsbilxzdbyjenP82/7gz6SK1GH\nvgsm6HDDXq3HqjIUk2dqjBCVDjSIiTwifq18JMmM4bJKhN+1VRxq+njiEuiZ063C\nUbxq0I3feIgwW49fOyvMCxnv8G+NO5crD6O4tWtT2eK8TtuhRJMFnH9vtXtQS5sz\nPZUrHCm7UHyuhxkeivzlAaAm/tv7Lzs7GB56y0+/H/e8KBQAgAUuodg4MyM4wXqQ\nvOCNpz6zt20YzV0aA/3cF2NQg/61h8GmhgbO0r932KaG+RO6SjLZuBi7IF+M7VYi\nF7XdZBEWREFS8rsFz8TBQWl+Ay6ARSFoq93dgKrAook050tCI3TxjBI3x7JndEQk\nPuAY56lnynihvstS6tWVXBcYT0rWGaJUcQ02rnkbYP4IwKLTazIk88/echw2QXs4\nhylbXBKlhfV3CnonGOSvyF8LqlHtGAQg9cKIl1bmYyPtlsY0qkB1GFDLkKPEz2qj\n9DC3ElOolRWNiaQ+UthIY/eliSu1mgUMG0tOzEd1AgMBAAEwDQYJKoZIhvcNAQEL\nBQADggIBAFINP9VXFvPmzK+4C7w/FGDkZKKOl5Jw+hvWtRdtuDRhUs9aO6YmFm1d\nQ25rOwK9hC+YEY5ihyiepVM+QcygMl52nO9shxF9BnqvQGJTimd8Wl94oH1I2X98\nQ+/JCWswsxHzLqn/Q7sFZff3CgFCURxu9HIuz2aJgZv7ar9ET657aFppwWvchXuG\nNlBZLfFww6xgeMX3YqCXUP48tU4Fc1igtAmHlef1z6lA1QbMZExFFcudjYTIlFJw\nhpYc+/mkSPP5NrBLm64lA3UdCQCLBbDbLQ/ObKX7edakt5HQWjmcXv7EzGRO7Y/r\nSxps8sbM98q/A0DJRAy3MH+taGXy7e/ym9PYOOj9hxtewB3TFR5e3lDHus6533Ae\nQ8VLQHwhygrGv9woYS87r6/zKlZZA2ffBusnLgdhcJPou9GxMtTzWq3STaMJGN6m\nRI2CzZ5YXVtQwbjL5PR7umu0orBTs6k5Ponlh930ONLEGmAtKGGwvfM6caDKwlTs\n1ZGHKkCdgUi05d7CfgNl7IysHuebiA39fq/LRhw7PxzJrloLLZT1wJNJ8gCLoWpT\nHVIFZFd597nLjl8vYL/mptl88VWWsC0ELtQ7N6xY5JDhccNiWVGssmI/kzfOJ+J3\nLvKoQMkB0NCaQEEn2o+iT361B9pSPnS1/wwc1UAo3+kcAJ8yh1gn\n-----END CERTIFICATE-----";
 	//
 	//  serializeJsonPretty(doc, buffer);
-	return SUCCESS;
 }
 
-void MQTTClient::sendData(const char *attribute, const char *value) {
-	// Current Topic
-	char result[100] = "alkmaar/";   // array to hold the result.
+const char* MQTTClient::getStateName(MQTTState state){
+	switch(state){
+		case MQTTState::Idle: return "Idle";
+		case MQTTState::WiFi: return "WiFi";
+		case MQTTState::Transport: return "Transport";
+		case MQTTState::Session: return "Session";
+		case MQTTState::Connected: return "Connected";
+		case MQTTState::Backoff: return "Backoff";
+		default: return "Unknown";
+	}
+}
+
+void MQTTClient::setState(MQTTState next){
+	state = next;
+	state_since = millis();
+}
+
+void MQTTClient::reconnect(){
+	if(WiFi.status() == WL_CONNECTED){
+		stats.wifi_ms = 0;
+		startTransport();
+	}
+	else{
+		startWiFi();
+	}
+}
+
+void MQTTClient::startWiFi(){
+	Logger::getInstance().println<LogLevel::Info>("Connecting to WiFi ", ssid);
+	// restarts the join, the previous attempt could be stuck on a network that went away.
+	WiFi.disconnect();
+	WiFi.begin(ssid, password);
+	setState(MQTTState::WiFi);
+}
 
-	strcat(result, client_id);
-	strcat(result, "/writeattributevalue/");
-	strcat(result, attribute);
-	strcat(result, asset_id);
+void MQTTClient::startTransport(){
+	Logger::getInstance().println<LogLevel::Info>("The client ", client_id, " connects to the mqtt broker");
+	connect_done = false;
+	setState(MQTTState::Transport);
+	xTaskNotifyGive(connect_task);
+}
 
-	client.publish(result, value);
+void MQTTClient::fail(const char* reason){
+	failures++;
+	stats.failures++;
+	// exponential backoff with equal jitter, so a fleet that lost the same broker doesn't reconnect in lockstep.
+	uint32_t wait = MQTT_BACKOFF_MIN;
+	for(uint32_t i = 1; i < failures && wait < MQTT_BACKOFF_MAX; i++){wait *= 2;}
+	if(wait > MQTT_BACKOFF_MAX){wait = MQTT_BACKOFF_MAX;}
+	backoff = wait / 2 + esp_random() % (wait / 2 + 1);
+	Logger::getInstance().println<LogLevel::Warning>(reason, ", retrying in ", backoff, " ms (attempt ", failures, ")");
+	setState(MQTTState::Backoff);
+}
+
+void MQTTClient::connectTask(void* param){
+	MQTTClient* self = (MQTTClient*)param;
+	for(;;){
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		uint32_t start = millis();
+		bool ok = self->transport.client.connect(self->server, self->mqtt_port);
+		self->transport_ms = millis() - start;
+		self->session_ms = 0;
+		if(ok){
+			self->state = MQTTState::Session;
+			start = millis();
+			// the session gives up on the CONNACK after MQTT_CONN_TIMEOUT seconds.
+			MQTTSession& session = self->session;
+			session.connect(self->client_id, self->mqtt_username, self->mqtt_password, MQTT_KEEP_ALIVE, millis());
+			while(session.getState() == MQTTSession::State::Connecting){
+				vTaskDelay(pdMS_TO_TICKS(10));
+				session.poll(millis());
+			}
+			ok = session.connected();
+			self->session_ms = millis() - start;
+			if(!ok){self->transport.client.stop();}
+		}
+		self->connect_ok = ok;
+		self->connect_done = true;
+	}
+}
+
+bool MQTTClient::sendData(attributes attribute, const char *value) {
+	return sendData(attribute, value, strlen(value));
+}
+
+bool MQTTClient::sendData(attributes attribute, const char *payload, size_t length) {
+	if(state != MQTTState::Connected || !topics[attribute]){
+		return false;
+	}
+	return session.publish(attribute, topics[attribute], (const uint8_t*)payload, length, MQTT_QOS, millis());
+}
+
+size_t MQTTClient::windowFree() const {
+	return MQTT_QOS ? session.windowFree() : SIZE_MAX;
+}
+
+void MQTTClient::onUnacked(attributes attribute, const uint8_t* payload, size_t length, void* context){
+	MQTTClient* self = (MQTTClient*)context;
+	// written in one append, so a reset can at most leave the last message incomplete.
+	uint8_t entry[sizeof(UnackedHeader) + MQTT_PACKET_SIZE];
+	UnackedHeader H = {MQTT_UNACKED_MAGIC, (uint16_t)length, (uint8_t)attribute, 0};
+	memcpy(entry, &H, sizeof(H));
+	memcpy(entry + sizeof(H), payload, length);
+	if(__W_SD::getInstance().appendFile(MQTT_UNACKED_FILE, entry, sizeof(H) + length)){
+		Logger::getInstance().println<LogLevel::Error>("An unacknowledged message on ", attribute_names[attribute], " is lost.");
+		return;
+	}
+	if(self->unacked_mount != __W_SD::getInstance().getMountCount()){
+		// the file is on another storage, so it is published from its start.
+		self->unacked_mount = __W_SD::getInstance().getMountCount();
+		self->unacked_offset = 0;
+	}
+	self->unacked_pending = true;
+}
+
+void MQTTClient::replayUnacked(){
+	__W_SD& SD = __W_SD::getInstance();
+	uint8_t payload[MQTT_PACKET_SIZE];
+	if(unacked_mount != SD.getMountCount()){
+		// another storage has been mounted, for example the flash fallback, its file is published from the start.
+		unacked_mount = SD.getMountCount();
+		unacked_offset = 0;
+		unacked_pending = SD.exists(MQTT_UNACKED_FILE);
+	}
+	if(!unacked_pending || (unacked_failed && millis() - unacked_failed_at < MQTT_UNACKED_RETRY)){return;}
+	unacked_failed = false;
+	for(;;){
+		if(!windowFree()){return;} // the rest is published once PUBACKs have made room.
+		UnackedHeader H;
+		size_t read = 0;
+		// a failed read leaves the file as it is, the storage can be busy or remounted by the Logger and is tried again later.
+		if(SD.readBytes(MQTT_UNACKED_FILE, unacked_offset, (uint8_t*)&H, sizeof(H), read)){
+			unacked_failed = true;
+			unacked_failed_at = millis();
+			return;
+		}
+		if(read < sizeof(H)){
+			break; // all messages are out, or the last one was cut off by a reset.
+		}
+		if(H.magic != MQTT_UNACKED_MAGIC || H.length > sizeof(payload) || H.attribute >= ATTRIBUTE_COUNT){
+			Logger::getInstance().println<LogLevel::Warning>(MQTT_UNACKED_FILE, " is corrupt at ", unacked_offset, ", the rest is dropped.");
+			break;
+		}
+		if(SD.readBytes(MQTT_UNACKED_FILE, unacked_offset + sizeof(H), payload, H.length, read)){
+			unacked_failed = true;
+			unacked_failed_at = millis();
+			return;
+		}
+		if(read < H.length){
+			break;
+		}
+		attributes attribute = (attributes)H.attribute;
+		if(!topics[attribute] || !session.publish(attribute, topics[attribute], payload, H.length, MQTT_QOS, millis())){
+			return; // the window is full or the connection was lost, the message is tried again later.
+		}
+		unacked_offset += sizeof(H) + H.length;
+	}
+	// the whole file has been read, it is only deleted once that is done.
+	if(SD.deleteFile(MQTT_UNACKED_FILE)){
+		// the offset stays at the end, so the delete is tried again without publishing twice.
+		unacked_failed = true;
+		unacked_failed_at = millis();
+		return;
+	}
+	Logger::getInstance().println<LogLevel::Info>("Published ", unacked_offset, " bytes of unacknowledged messages again.");
+	unacked_pending = false;
+	unacked_offset = 0;
+}
+
+void MQTTClient::beginBatch(){
+	batch.clear();
+}
+
+bool MQTTClient::add(attributes attribute, const char *value){
+	return batch.add(attribute, value);
+}
+
+void MQTTClient::truncateBatch(const MQTTBatchMark &mark){
+	batch.truncate(mark);
+}
+
+bool MQTTClient::commit(){
+	if(batch.empty()){
+		return true;
+	}
+	bool ok = sendData(BATCH, batch.data(), batch.bytes());
+	batch.clear();
+	return ok;
 }
 
 void MQTTClient::receiveData(const char *attribute) {
 	// Current Topic
-	char result[100] = "alkmaar/";   // array to hold the result.
-
-	strcat(result, client_id);
-	strcat(result, "/attribute/");
-	strcat(result, attribute);
-	strcat(result, asset_id);
+	char result[256];
+	PayloadWriter topic(result);
+	topic.raw("alkmaar/").raw(client_id).raw("/attribute/").raw(attribute).raw(asset_id);
+	if(!topic.ok()){
+		Logger::getInstance().println<LogLevel::Error>("The topic of attribute ", attribute, " is too long.");
+		return;
+	}
+	if(state != MQTTState::Connected){
+		return;
+	}
 
-	client.subscribe(result);
+	session.subscribe(result, millis());
 }
 
-void MQTTClient::callback(char *topic, byte *payload, unsigned int length) {
- Logger::getInstance().print("\nMessage arrived in topic: ", LogLevel::Info);
- Logger::getInstance().println(topic, LogLevel::Info);
- Logger::getInstance().print("Message:", LogLevel::DataDump);
- for (int i = 0; i < length; i++) {
-		 Logger::getInstance().write((char) payload[i], LogLevel::DataDump);
+void MQTTClient::callback(const char *topic, const uint8_t *payload, size_t length, void*) {
+ Logger::getInstance().print<LogLevel::Info>("\nMessage arrived in topic: ");
+ Logger::getInstance().println<LogLevel::Info>(topic);
+ Logger::getInstance().print<LogLevel::DataDump>("Message:");
+ for (size_t i = 0; i < length; i++) {
+		 Logger::getInstance().write<LogLevel::DataDump>((char) payload[i]);
  }
  Logger::getInstance().dataDumpEnd();
 }
 
+bool MQTTClient::connected(){
+	return state == MQTTState::Connected;
+}
+
 void MQTTClient::loopClient(){
-	client.loop();
+	uint32_t now = millis();
+	switch(state){
+		case MQTTState::WiFi:
+			if(WiFi.status() == WL_CONNECTED){
+				stats.wifi_ms = now - state_since;
+				IPAddress ip = WiFi.localIP();
+				Logger::getInstance().println<LogLevel::Info>("Connected to WiFi with ip: ", ip[0], ".", ip[1], ".", ip[2], ".", ip[3], " in ", stats.wifi_ms, " ms");
+				startTransport();
+			}
+			else if(now - state_since >= WIFI_TIMEOUT * 1000UL){
+				fail("Failed to connect to WiFi");
+			}
+			break;
+		case MQTTState::Transport:
+		case MQTTState::Session:
+			if(!connect_done){break;}
+			connect_done = false;
+			stats.transport_ms = transport_ms;
+			stats.session_ms = session_ms;
+			if(!connect_ok){
+				if(state == MQTTState::Transport){fail("The TLS connection to the broker failed");}
+				else{
+					Logger::getInstance().println<LogLevel::Error>("The broker refused the session with return code ", session.getReturnCode());
+					fail("The MQTT session failed");
+				}
+				break;
+			}
+			setState(MQTTState::Connected);
+			failures = 0;
+			stats.connects++;
+			stats.last_connect_ms = now - connect_start;
+			if(stats.last_connect_ms > stats.max_connect_ms){stats.max_connect_ms = stats.last_connect_ms;}
+			Logger::getInstance().println<LogLevel::Info>("Mqtt broker connected in ", stats.last_connect_ms, " ms (WiFi ", stats.wifi_ms,
+				" ms, TLS ", stats.transport_ms, " ms, session ", stats.session_ms, " ms)");
+			break;
+		case MQTTState::Connected:
+			session.poll(now);
+			if(session.connected()){
+				replayUnacked();
+				break;
+			}
+			stats.disconnects++;
+			Logger::getInstance().println<LogLevel::Warning>("The MQTT connection was lost, the unacknowledged messages are kept in ", MQTT_UNACKED_FILE);
+			transport.client.stop();
+			connect_start = now;
+			reconnect();
+			break;
+		case MQTTState::Backoff:
+			if(now - state_since >= backoff){reconnect();}
+			break;
+		default:
+			break;
+	}
 }
\ No newline at end of file
@@ -5,80 +5,92 @@
  * @version 0.1
  * @date 2022-01-13
  * 
+ * The connection is a state machine that loopClient() advances without waiting:
+ * State | Description
+ * :-----:|:-----------------------------:
+ *  WiFi | WiFi.begin() has been called, waits up to WIFI_TIMEOUT seconds for the network
+ *  Transport | the connect task opens the TCP connection and does the TLS handshake
+ *  Session | the connect task sends the MQTT CONNECT and waits for the CONNACK
+ *  Connected | messages can be published, a lost connection starts over at WiFi or Transport
+ *  Backoff | waits after a failed attempt, from MQTT_BACKOFF_MIN doubling up to MQTT_BACKOFF_MAX with jitter
+ *
+ * The TLS handshake of WiFiClientSecure can't be done without blocking, so it runs in a connect task of its own
+ * together with the wait for the CONNACK. The MQTTSession is only used by the connect task in the
+ * Transport and Session states and only by the caller of loopClient() in the others.
+ *
+ * The messages are published with MQTT_QOS by an MQTTSession. The QoS 1 messages that are not acknowledged
+ * when the connection is lost are appended to MQTT_UNACKED_FILE and published again after the reconnect.
+ *
  * @copyright Copyright (c) 2022
  * 
  */
 
 #pragma once 
 
-#include <PubSubClient.h>
 #include <WiFiClientSecure.h>
+#include "Attributes.h"
+#include "MQTTBatch.h"
+#include "MQTTSession.h"
 #include "../Defines/Defines.h"
 
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
 /**
- * @addtogroup ENUM
- * @{
+ * @brief States of the connection to the broker.
  */
+enum class MQTTState : uint8_t {
+	/** init() has not succeeded. */
+	Idle,
+	/** Waiting for the WiFi network. */
+	WiFi,
+	/** The connect task opens the TCP/TLS connection. */
+	Transport,
+	/** The connect task opens the MQTT session. */
+	Session,
+	/** The session is up. */
+	Connected,
+	/** Waiting before the next attempt. */
+	Backoff,
+};
 
 /**
- * @brief Attribute array indices for the attribute_names array.
+ * @addtogroup STRUCT
+ * @{
+ */
+/**
+ * @brief Counters and timings of the connection to the broker.
  */
-enum attributes {
-    /** Connection, used to signify if the box is connected to the IoT platform.*/
-    CONN,
-    /** Ambimate temperature, int */
-    ambimate_temp,
-    /** Ambimate humidity, float */
-    ambimate_hum,
-    /** Ambimate Eco2, int */
-    ambimate_Eco2,
-    /** Ambimate VOC, int */
-    ambimate_Voc,
-    /** AS7262_Color, json */
-    AS7262_Color,
-    /** TSL2591_Spectrum, json */
-    TSL2591_Spectrum,
-    /** SCD30 CO2, int */
-    SCD30_CO2,
-    /** SCD30 temperature, int */
-    SCD30_temp,
-    /** SCD30 humidity, float */
-    SCD30_hum,
-    /** Audio int */
-    // TODO: still need to implement some kind of data parsing as currently the data is meaningless.
-    MAX4466_Audio,
-    /** Oxygen int */
-    MIX8410_O2,
-    /** PM10 measurement. */
-    PM10,
-    /** PM25 measurement. */
-    PM25,
-    /** PM100 measurement. */
-    PM100
+struct MQTTConnStats {
+	/** Amount of sessions that were opened. */
+	uint32_t connects;
+	/** Amount of sessions that were lost. */
+	uint32_t disconnects;
+	/** Amount of attempts that failed, WiFi, TLS or MQTT. */
+	uint32_t failures;
+	/** Time in ms from the start or the loss of the connection to the last session, including the backoff. */
+	uint32_t last_connect_ms;
+	/** Highest last_connect_ms. */
+	uint32_t max_connect_ms;
+	/** Time in ms the WiFi took to join the network for the last session, 0 when it was still connected. */
+	uint32_t wifi_ms;
+	/** Time in ms of the TCP connect and TLS handshake of the last attempt. */
+	uint32_t transport_ms;
+	/** Time in ms from the MQTT CONNECT to the CONNACK of the last attempt. */
+	uint32_t session_ms;
 };
-
-/** @} */
+/**@}*/
 
 /**
- * @brief Attributes array containing the MQTT names of the measured properties
+ * @brief iMQTTTransport over the TLS client of the ESP32.
  */
-static const char * const attribute_names[] = {
-  [CONN]              = "Connection",
-  [ambimate_temp]     = "ambimate_Temperatuur",
-  [ambimate_hum]      = "ambimate_Humidity",
-  [ambimate_Eco2]     = "ambimate_Eco2",
-  [ambimate_Voc]      = "ambimate_Voc",
-  [AS7262_Color ]     = "AS7262_Color",
-  [TSL2591_Spectrum]  = "TSL2591_Spectrum",
-  [SCD30_CO2]         = "SCD30_CO2",
-  [SCD30_temp]        = "SCD30_Tempratuur",
-  [SCD30_hum]         = "SCD30_Humidity",
-  [MAX4466_Audio]     = "MAX4466_Audio",
-  [MIX8410_O2]        = "MIX8410_O2",
-  // TODO: change IOT names to PM10 and PM100
-  [PM10]              = "particlesPM1",
-  [PM25]              = "particlesPM2_5",
-  [PM100]             = "particlesPM10"
+class SecureTransport : public iMQTTTransport {
+public:
+  /** @brief ESP WiFi client handle. */
+  WiFiClientSecure client;
+
+  bool write(const uint8_t* data, size_t length) override;
+  int read(uint8_t* data, size_t length) override;
 };
 
 /**
@@ -108,22 +120,79 @@ private:
   // json serialization buffer - Big buffer for CA cert - not used for now
   //char buffer[4096];
 
-  /** @brief ESP WiFi client handle. */
-  WiFiClientSecure espClient;
-  /** @brief MQTT Client handle. */
-  PubSubClient client;
-
-  /** @brief Initializes the WiFi on the ESP32. */
-  ERR_Type initWiFi();
-  /** @brief Initializes the MQTT connection to the IoT platform. */
-  ERR_Type initMqttConnect();
+  /** @brief The TLS connection to the broker. */
+  SecureTransport transport;
+  /** @brief The MQTT session on the transport. */
+  MQTTSession session;
+  /** @brief Measurements that are sent together by commit(). */
+  MQTTBatch batch;
+  /** @brief Publish topics of all the attributes, point into topic_arena. nullptr until init() has read the settings. */
+  const char* topics[ATTRIBUTE_COUNT];
+  /** @brief Holds the null terminated topics, built once so a publish doesn't have to format its topic. */
+  char topic_arena[MQTT_TOPIC_ARENA];
+  /** @brief Length of the longest topic. */
+  size_t topic_max;
+
+  /** @brief State of the connection, also written by the connect task when the transport is up. */
+  volatile MQTTState state = MQTTState::Idle;
+  /** @brief Time at which the current state was entered. */
+  uint32_t state_since = 0;
+  /** @brief Time at which the client started or lost the connection, for the time to connect. */
+  uint32_t connect_start = 0;
+  /** @brief Time in ms to wait in the Backoff state. */
+  uint32_t backoff = 0;
+  /** @brief Amount of attempts that failed since the last session. */
+  uint32_t failures = 0;
+  /** @brief Handle of the connect task. */
+  TaskHandle_t connect_task = nullptr;
+  /** @brief Set by the connect task when its attempt has finished. */
+  volatile bool connect_done = false;
+  /** @brief Result of the last attempt of the connect task. */
+  volatile bool connect_ok = false;
+  /** @brief Time in ms of the TCP/TLS connect of the connect task. */
+  volatile uint32_t transport_ms = 0;
+  /** @brief Time in ms of the MQTT CONNECT of the connect task. */
+  volatile uint32_t session_ms = 0;
+  /** @brief The counters of the connection. */
+  MQTTConnStats stats = {0, 0, 0, 0, 0, 0, 0, 0};
+  /** @brief True while MQTT_UNACKED_FILE holds messages that were not published again. */
+  bool unacked_pending = false;
+  /** @brief Position in MQTT_UNACKED_FILE of the next message to publish again. */
+  uint32_t unacked_offset = 0;
+  /** @brief Mount count of the storage on which unacked_offset is valid. */
+  uint32_t unacked_mount = 0;
+  /** @brief True after a failed read or delete of MQTT_UNACKED_FILE, the file is then left alone for MQTT_UNACKED_RETRY ms. */
+  bool unacked_failed = false;
+  /** @brief Time of the last failed read or delete of MQTT_UNACKED_FILE. */
+  uint32_t unacked_failed_at = 0;
+
+  /** @brief Sets up the WiFi and the TLS client once the settings are read. */
+  void configure();
+  /** @brief Enters a state. */
+  void setState(MQTTState next);
+  /** @brief Starts an attempt, from the WiFi when it is down and else from the transport. */
+  void reconnect();
+  /** @brief Starts joining the WiFi network. */
+  void startWiFi();
+  /** @brief Hands the TCP/TLS and MQTT connect to the connect task. */
+  void startTransport();
+  /** @brief Counts a failed attempt and waits the jittered exponential backoff. */
+  void fail(const char* reason);
+  /** @brief Connect task, runs the blocking parts of an attempt. */
+  static void connectTask(void* param);
+  /** @brief Appends a message that was not acknowledged to MQTT_UNACKED_FILE. */
+  static void onUnacked(attributes attribute, const uint8_t* payload, size_t length, void* context);
+  /** @brief Publishes the messages of MQTT_UNACKED_FILE again while the window has room, and deletes the file once they are all out. */
+  void replayUnacked();
   /** @brief Reads settings from MQTTSettings.dat on the SD card
    *  @param path the path to the settings file.
    */ 
   ERR_Type getSettings(char* path);
+  /** @brief Builds the publish topics of all the attributes in the topic arena. */
+  ERR_Type buildTopics();
   
   /** @brief MQTT callback function. */
-  static void callback(char *topic, byte *payload, unsigned int length);
+  static void callback(const char *topic, const uint8_t *payload, size_t length, void* context);
 
 public:
   /**
@@ -136,7 +205,7 @@ public:
   ~MQTTClient();
 
   /**
-   * @brief Initialize the MQTT and WiFi on the ESP32.
+   * @brief Reads the settings and starts connecting to the WiFi and the broker, without waiting for the connection.
    * @param path the path to the settings file.
    */
   ERR_Type init(char* path);
@@ -144,10 +213,52 @@ public:
   /**
    * @brief Sends data to the IoT platform.
    * 
-   * @param attribute The name of the attribute on the IoT platform.
+   * @param attribute The attribute on the IoT platform.
    * @param value The value to send to the IoT platform. Should be converted to a C style string.
+   * @return true the message has been handed to the broker connection.
+   * @return false the client is not connected or the message did not fit.
+   */
+  bool sendData(attributes attribute, const char *value);
+  /**
+   * @brief Sends data to the IoT platform.
+   * 
+   * @param attribute The attribute on the IoT platform.
+   * @param payload The value to send to the IoT platform.
+   * @param length The length of the value in bytes.
+   * @return true the message has been handed to the broker connection.
+   * @return false the client is not connected or the message did not fit.
+   */
+  bool sendData(attributes attribute, const char *payload, size_t length);
+  /**
+   * @brief Starts a new batch, the values of a previous batch that was not committed are dropped.
    */
-  void sendData(const char *attribute, const char *value);
+  void beginBatch();
+  /**
+   * @brief Adds a value to the batch, it is sent by the next commit().
+   * 
+   * @param attribute The attribute of the value.
+   * @param value The value as it would be sent by sendData().
+   * @return true the value has been added.
+   * @return false the attribute is already in the batch or the batch is full.
+   */
+  bool add(attributes attribute, const char *value);
+  /**
+   * @brief Returns the state of the batch, truncateBatch() takes the values added after it out again.
+   */
+  MQTTBatchMark markBatch() const { return batch.mark(); }
+  /**
+   * @brief Takes the values that were added after a mark out of the batch, so the values before it can still be committed.
+   * 
+   * @param mark A mark of the batch, taken after the last beginBatch().
+   */
+  void truncateBatch(const MQTTBatchMark &mark);
+  /**
+   * @brief Sends all the values of the batch as one json message on the Batch attribute, and empties the batch.
+   * 
+   * @return true the batch has been handed to the broker connection, or was empty.
+   * @return false the client is not connected or the batch did not fit.
+   */
+  bool commit();
   /**
    * @brief Receive data about an IoT platform. Currently not implemented.
    * 
@@ -156,8 +267,28 @@ public:
   void receiveData(const char *attribute);
   
   /**
-   * @brief Keeps the MQTT client alive.
-   * Should be called in the end of the loop function.
+   * @brief Returns true when the client has a session with the broker.
+   */
+  bool connected();
+
+  /** @brief Returns the state of the connection. */
+  MQTTState getState() const { return state; }
+
+  /** @brief Returns the counters of the connection. */
+  MQTTConnStats getConnectionStats() const { return stats; }
+
+  /** @brief Returns the counters of the MQTT session. */
+  MQTTSessionStats getSessionStats() const { return session.getStats(); }
+
+  /** @brief Returns the amount of messages that can be published before the QoS 1 window is full, unlimited with QoS 0. */
+  size_t windowFree() const;
+
+  /** @brief Returns the name of a state, for the logs. */
+  static const char* getStateName(MQTTState state);
+
+  /**
+   * @brief Keeps the MQTT client alive and advances the connection, reconnects when the connection is lost.
+   * Never waits for the network, should be called every loop or network step.
    */
   void loopClient();
 };
\ No newline at end of file
@@ -0,0 +1,63 @@
+#include "MQTTBatch.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+MQTTBatch::MQTTBatch() : writer(payload, sizeof(payload) - 1) {
+	clear();
+}
+
+void MQTTBatch::clear(){
+	writer.clear();
+	writer.raw("{", 1);
+	close();
+	present = 0;
+	count = 0;
+}
+
+void MQTTBatch::close(){
+	// the writer leaves the last byte free for the closing brace, so the payload is always a complete object.
+	payload[writer.size()] = '}';
+	payload[writer.size() + 1] = '\0';
+}
+
+bool MQTTBatch::add(attributes attribute, const char* value){
+	if(contains(attribute)){return false;}
+	const size_t old_length = writer.size();
+
+	if(count){writer.raw(",", 1);}
+	writer.string(attribute_names[attribute]).raw(":", 1);
+	if(*value == '{' || *value == '[' || *value == '"'){
+		writer.raw(value);
+	}
+	else{
+		char* end;
+		double number = strtod(value, &end);
+		if(end != value && !*end){
+			// nan and inf are not valid json numbers.
+			if(isfinite(number)){writer.raw(value, end - value);}
+			else{writer.raw("null", 4);}
+		}
+		else{
+			writer.string(value);
+		}
+	}
+
+	if(!writer.ok()){
+		// leave the batch as it was, so it can still be sent.
+		writer.truncate(old_length);
+		close();
+		return false;
+	}
+	close();
+	present |= (uint32_t)1 << attribute;
+	count++;
+	return true;
+}
+
+void MQTTBatch::truncate(const MQTTBatchMark& M){
+	writer.truncate(M.length);
+	close();
+	present = M.present;
+	count = M.count;
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+/**
+ * @file MQTTBatch.h
+ * @author Imre Korf
+ * @brief Collects the measurements of a network cycle into a single json payload.
+ * @version 0.1
+ * @date 2022-03-28
+ *
+ * Every attribute is added as a member of one json object, keyed by its name in attribute_names:
+ *
+ *     {"ambimate_Temperatuur":21.50,"SCD30_CO2":612,"AS7262_Color":{"Violet":1.00, ...}}
+ *
+ * Values that are already json (objects, arrays, strings and finite numbers) are copied as they are,
+ * nan and inf become null and anything else is written as a json string.
+ * This file only uses the standard library, so the payloads can also be built on a host by the MQTTBench tool.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Attributes.h"
+#include "PayloadWriter.h"
+#include "../Defines/Defines.h"
+
+/**
+ * @brief The state of an MQTTBatch at some point, to take the values that were added after it out again.
+ */
+struct MQTTBatchMark {
+	/** Length of the members in the payload. */
+	size_t length;
+	/** Bit mask of the attributes in the payload. */
+	uint32_t present;
+	/** Amount of attributes in the payload. */
+	uint16_t count;
+};
+
+/**
+ * @brief Json object with at most one value per attribute, in a fixed buffer of MQTT_BATCH_SIZE bytes.
+ */
+class MQTTBatch {
+	static_assert(BATCH < 32, "the attributes of a batch are kept in a 32 bit mask");
+private:
+	/** The payload, always a complete json object that ends with a null character. */
+	char payload[MQTT_BATCH_SIZE];
+	/** Writes the members into the payload, without the closing brace. */
+	PayloadWriter writer;
+	/** Bit mask of the attributes in the payload. */
+	uint32_t present;
+	/** Amount of attributes in the payload. */
+	uint16_t count;
+
+	/** @brief Writes the closing brace behind the members. */
+	void close();
+
+public:
+	MQTTBatch();
+	MQTTBatch(MQTTBatch const&)			= delete;	// the writer points into the own payload.
+	void operator=(MQTTBatch const&)	= delete;
+
+	/** @brief Removes all the attributes, the payload becomes an empty json object. */
+	void clear();
+
+	/**
+	 * @brief Adds a value to the batch, the batch is left as it was when the value can't be added.
+	 *
+	 * @param attribute the attribute of the value.
+	 * @param value the value as it would be sent on the topic of the attribute.
+	 * @return true the value has been added.
+	 * @return false the attribute is already in the batch or the value doesn't fit.
+	 */
+	bool add(attributes attribute, const char* value);
+
+	/** @brief Returns the state of the batch, truncate() takes the values added after it out again. */
+	MQTTBatchMark mark() const { return MQTTBatchMark{writer.size(), present, count}; }
+	/**
+	 * @brief Takes the values that were added after a mark out of the batch.
+	 * @param M a mark of this batch, taken after the last clear().
+	 */
+	void truncate(const MQTTBatchMark& M);
+
+	/** @brief Returns true when the attribute has a value in the batch. */
+	bool contains(attributes attribute) const { return present & ((uint32_t)1 << attribute); }
+	/** @brief Returns the amount of attributes in the batch. */
+	uint16_t size() const { return count; }
+	/** @brief Returns true when there are no attributes in the batch. */
+	bool empty() const { return !count; }
+	/** @brief Returns the json payload, valid until the batch is changed. */
+	const char* data() const { return payload; }
+	/** @brief Returns the length of the json payload in bytes. */
+	size_t bytes() const { return writer.size() + 1; }
+};
\ No newline at end of file
@@ -0,0 +1,303 @@
+#include "MQTTSession.h"
+
+#include <string.h>
+
+// control packet types, the high nibble of the fixed header.
+#define MQTT_CONNECT 0x10
+#define MQTT_CONNACK 0x20
+#define MQTT_PUBLISH 0x30
+#define MQTT_PUBACK 0x40
+#define MQTT_SUBSCRIBE 0x82
+#define MQTT_SUBACK 0x90
+#define MQTT_PINGREQ 0xC0
+#define MQTT_PINGRESP 0xD0
+// DUP flag of a PUBLISH that is sent again.
+#define MQTT_DUP 0x08
+
+size_t MQTTSession::putLength(uint8_t* p, size_t length){
+	size_t n = 0;
+	do {
+		uint8_t b = length % 128;
+		length /= 128;
+		if(length){b |= 0x80;}
+		p[n++] = b;
+	} while(length);
+	return n;
+}
+
+size_t MQTTSession::putString(uint8_t* p, const char* s, size_t length){
+	p[0] = length >> 8;
+	p[1] = length & 0xFF;
+	memcpy(p + 2, s, length);
+	return 2 + length;
+}
+
+size_t MQTTSession::encodePublish(uint8_t* buffer, size_t capacity, const char* topic, const uint8_t* payload, size_t length,
+	uint8_t qos, uint16_t id, uint16_t& offset){
+	size_t topic_length = strlen(topic);
+	size_t remaining = 2 + topic_length + (qos ? 2 : 0) + length;
+	uint8_t header[5];
+	size_t header_length = 1 + putLength(header + 1, remaining);
+	if(topic_length > 0xFFFF || header_length + remaining > capacity){return 0;}
+
+	buffer[0] = MQTT_PUBLISH | (qos << 1);
+	memcpy(buffer + 1, header + 1, header_length - 1);
+	size_t n = header_length + putString(buffer + header_length, topic, topic_length);
+	if(qos){
+		buffer[n++] = id >> 8;
+		buffer[n++] = id & 0xFF;
+	}
+	offset = n;
+	memcpy(buffer + n, payload, length);
+	return n + length;
+}
+
+bool MQTTSession::send(const uint8_t* data, size_t length, uint32_t now){
+	if(!transport.write(data, length)){
+		close();
+		return false;
+	}
+	last_out = now;
+	return true;
+}
+
+uint16_t MQTTSession::nextId(){
+	for(;;){
+		if(!++last_id){last_id = 1;} // 0 is not a valid packet id.
+		bool used = false;
+		for(size_t i = 0; i < MQTT_INFLIGHT_WINDOW; i++){
+			if(slots[i].id == last_id){used = true;}
+		}
+		if(!used){return last_id;}
+	}
+}
+
+bool MQTTSession::connect(const char* client_id, const char* username, const char* password, uint16_t keep_alive, uint32_t now){
+	close();
+	rx_state = RxState::Header;
+	return_code = 0;
+	this->keep_alive = keep_alive * 1000UL;
+
+	size_t id_length = strlen(client_id);
+	size_t user_length = username ? strlen(username) : 0;
+	size_t password_length = user_length && password ? strlen(password) : 0; // a password without a username is not allowed.
+	size_t remaining = 10 + 2 + id_length + (user_length ? 2 + user_length : 0) + (password_length ? 2 + password_length : 0);
+	if(remaining + 5 > sizeof(tx)){return false;}
+
+	size_t n = 0;
+	tx[n++] = MQTT_CONNECT;
+	n += putLength(tx + n, remaining);
+	n += putString(tx + n, "MQTT", 4);
+	tx[n++] = 4; // protocol level 3.1.1
+	tx[n++] = 0x02 | (user_length ? 0x80 : 0) | (password_length ? 0x40 : 0); // clean session
+	tx[n++] = keep_alive >> 8;
+	tx[n++] = keep_alive & 0xFF;
+	n += putString(tx + n, client_id, id_length);
+	if(user_length){n += putString(tx + n, username, user_length);}
+	if(password_length){n += putString(tx + n, password, password_length);}
+
+	state = State::Connecting;
+	connect_sent = now;
+	last_in = now;
+	ping_pending = false;
+	return send(tx, n, now);
+}
+
+void MQTTSession::poll(uint32_t now){
+	if(state == State::Closed){return;}
+	uint8_t buffer[64];
+	for(;;){
+		int n = transport.read(buffer, sizeof(buffer));
+		if(n < 0){
+			close();
+			return;
+		}
+		if(!n){break;}
+		last_in = now;
+		for(int i = 0; i < n && state != State::Closed; i++){
+			parse(buffer[i], now);
+		}
+		if(state == State::Closed){return;}
+	}
+
+	if(state == State::Connecting){
+		if(now - connect_sent >= MQTT_CONN_TIMEOUT * 1000UL){close();}
+		return;
+	}
+	if(keep_alive){
+		if(ping_pending && now - ping_sent >= keep_alive){
+			close(); // the broker didn't answer within a keep alive interval.
+			return;
+		}
+		if(!ping_pending && (now - last_out >= keep_alive || now - last_in >= keep_alive)){
+			const uint8_t ping[] = {MQTT_PINGREQ, 0};
+			ping_pending = true;
+			ping_sent = now;
+			if(!send(ping, sizeof(ping), now)){return;}
+		}
+	}
+	for(size_t i = 0; i < MQTT_INFLIGHT_WINDOW; i++){
+		Slot& S = slots[i];
+		if(S.id && now - S.sent >= ack_timeout){
+			S.packet[0] |= MQTT_DUP;
+			S.sent = now;
+			stats.retransmits++;
+			if(!send(S.packet, S.length, now)){return;}
+		}
+	}
+}
+
+void MQTTSession::parse(uint8_t byte, uint32_t now){
+	switch(rx_state){
+		case RxState::Header:
+			rx_header = byte;
+			rx_length = 0;
+			rx_shift = 0;
+			rx_state = RxState::Length;
+			break;
+		case RxState::Length:
+			rx_length |= (uint32_t)(byte & 0x7F) << rx_shift;
+			rx_shift += 7;
+			if(byte & 0x80){
+				if(rx_shift > 21){close();} // the remaining length has at most 4 bytes.
+				break;
+			}
+			rx_received = 0;
+			rx_state = RxState::Body;
+			if(!rx_length){
+				rx_state = RxState::Header;
+				onPacket(now);
+			}
+			break;
+		case RxState::Body:
+			if(rx_received < sizeof(rx)){rx[rx_received] = byte;}
+			if(++rx_received == rx_length){
+				rx_state = RxState::Header;
+				onPacket(now);
+			}
+			break;
+	}
+}
+
+void MQTTSession::onPacket(uint32_t now){
+	size_t length = rx_length < sizeof(rx) ? rx_length : sizeof(rx);
+	switch(rx_header & 0xF0){
+		case MQTT_CONNACK:
+			if(state != State::Connecting || length < 2){break;}
+			return_code = rx[1];
+			if(return_code){
+				close();
+				break;
+			}
+			state = State::Connected;
+			last_out = now;
+			break;
+		case MQTT_PUBACK: {
+			if(length < 2){break;}
+			uint16_t id = (rx[0] << 8) | rx[1];
+			for(size_t i = 0; i < MQTT_INFLIGHT_WINDOW; i++){
+				Slot& S = slots[i];
+				if(S.id != id){continue;}
+				if(now - S.first_sent > stats.max_ack_ms){stats.max_ack_ms = now - S.first_sent;}
+				S.id = 0;
+				inflight--;
+				stats.acked++;
+				break;
+			}
+			break;
+		}
+		case MQTT_PUBLISH: {
+			uint8_t qos = (rx_header >> 1) & 0x03;
+			if(length < 2){break;}
+			size_t topic_length = (rx[0] << 8) | rx[1];
+			size_t start = 2 + topic_length + (qos ? 2 : 0);
+			if(start > length){break;} // a topic that doesn't fit can't be acknowledged or passed on.
+			if(qos == 1){
+				const uint8_t ack[] = {MQTT_PUBACK, 2, rx[start - 2], rx[start - 1]};
+				if(!send(ack, sizeof(ack), now)){return;}
+			}
+			stats.received++;
+			if(message_callback && rx_length <= sizeof(rx)){
+				// move the topic to the front to make room for its null character, the payload stays where it is.
+				memmove(rx, rx + 2, topic_length);
+				rx[topic_length] = '\0';
+				message_callback((const char*)rx, rx + start, rx_length - start, message_context);
+			}
+			break;
+		}
+		case MQTT_PINGRESP:
+			ping_pending = false;
+			break;
+		default:
+			break; // SUBACK and the packets a broker doesn't send to a client.
+	}
+}
+
+bool MQTTSession::publish(attributes attribute, const char* topic, const uint8_t* payload, size_t length, uint8_t qos, uint32_t now){
+	if(state != State::Connected){return false;}
+	uint16_t offset;
+	if(!qos){
+		size_t n = encodePublish(tx, sizeof(tx), topic, payload, length, 0, 0, offset);
+		if(!n || !send(tx, n, now)){return false;}
+		stats.published++;
+		return true;
+	}
+
+	if(inflight >= window){
+		stats.window_full++;
+		return false;
+	}
+	Slot* S = nullptr;
+	for(size_t i = 0; i < MQTT_INFLIGHT_WINDOW && !S; i++){
+		if(!slots[i].id){S = &slots[i];}
+	}
+	uint16_t id = nextId();
+	size_t n = encodePublish(S->packet, sizeof(S->packet), topic, payload, length, 1, id, offset);
+	if(!n){return false;}
+	S->id = id;
+	S->attribute = attribute;
+	S->sequence = next_sequence++;
+	S->first_sent = now;
+	S->sent = now;
+	S->offset = offset;
+	S->length = n;
+	inflight++;
+	stats.published++;
+	// a failed write closes the session, which hands this message off with the others.
+	send(S->packet, n, now);
+	return true;
+}
+
+bool MQTTSession::subscribe(const char* topic, uint32_t now){
+	if(state != State::Connected){return false;}
+	size_t topic_length = strlen(topic);
+	size_t remaining = 2 + 2 + topic_length + 1;
+	if(remaining + 5 > sizeof(tx)){return false;}
+	size_t n = 0;
+	tx[n++] = MQTT_SUBSCRIBE;
+	n += putLength(tx + n, remaining);
+	uint16_t id = nextId();
+	tx[n++] = id >> 8;
+	tx[n++] = id & 0xFF;
+	n += putString(tx + n, topic, topic_length);
+	tx[n++] = 0; // QoS 0
+	return send(tx, n, now);
+}
+
+void MQTTSession::close(){
+	state = State::Closed;
+	rx_state = RxState::Header;
+	// with clean session set the broker forgets the messages, so they are handed off in the order they were published.
+	while(inflight){
+		Slot* oldest = nullptr;
+		for(size_t i = 0; i < MQTT_INFLIGHT_WINDOW; i++){
+			if(slots[i].id && (!oldest || (int32_t)(slots[i].sequence - oldest->sequence) < 0)){oldest = &slots[i];}
+		}
+		oldest->id = 0;
+		inflight--;
+		stats.handed_off++;
+		if(unacked_callback){
+			unacked_callback(oldest->attribute, oldest->packet + oldest->offset, oldest->length - oldest->offset, unacked_context);
+		}
+	}
+}
\ No newline at end of file
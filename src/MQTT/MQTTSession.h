@@ -0,0 +1,285 @@
+/**
+ * @file MQTTSession.h
+ * @author Imre Korf
+ * @brief MQTT 3.1.1 client session with QoS 1 publishing over an abstract transport.
+ * @version 0.1
+ * @date 2022-04-01
+ *
+ * PubSubClient only publishes with QoS 0 and drops the PUBACKs it reads, so a message that is lost
+ * between the ESP32 and the broker is never noticed. The MQTTSession publishes with QoS 1 instead:
+ * Part | Description
+ * :-----:|:-----------------------------:
+ *  window | up to MQTT_INFLIGHT_WINDOW messages wait for their PUBACK at once, so publishing doesn't stop for every round trip
+ *  packet id | every message in the window has its own id, a PUBACK frees the message with the same id
+ *  retransmit | a message without a PUBACK after MQTT_ACK_TIMEOUT ms is sent again with the DUP flag
+ *  hand off | when the session closes the messages in the window are handed to the unacked callback, in the order they were published
+ *
+ * A message is kept as the whole encoded packet, so a retransmit is a single write like the first send.
+ * The session never waits: poll() handles the bytes that have arrived, the keep alive and the retransmits.
+ * This file only uses the standard library, so the session can be run on a host against a broker by the MQTTBench tool.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include "Attributes.h"
+#include "../Defines/Defines.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Byte stream to the broker of an MQTTSession.
+ */
+class iMQTTTransport {
+public:
+	virtual ~iMQTTTransport() {}
+	/**
+	 * @brief Writes a whole packet.
+	 * @return true the packet has been written.
+	 * @return false the connection failed.
+	 */
+	virtual bool write(const uint8_t* data, size_t length) = 0;
+	/**
+	 * @brief Reads the bytes that have arrived, without waiting.
+	 * @return int the amount of bytes read, 0 when none have arrived and -1 when the connection is closed.
+	 */
+	virtual int read(uint8_t* data, size_t length) = 0;
+};
+
+/**
+ * @addtogroup STRUCT
+ * @{
+ */
+/**
+ * @brief Counters of the MQTTSession.
+ */
+struct MQTTSessionStats {
+	/** Amount of messages that were published, QoS 0 and QoS 1. */
+	uint32_t published;
+	/** Amount of QoS 1 messages of which the PUBACK arrived. */
+	uint32_t acked;
+	/** Amount of QoS 1 messages that were sent again. */
+	uint32_t retransmits;
+	/** Amount of QoS 1 messages that were refused because the window was full. */
+	uint32_t window_full;
+	/** Amount of QoS 1 messages that were handed to the unacked callback when the session closed. */
+	uint32_t handed_off;
+	/** Highest time in ms from the first send of a message to its PUBACK. */
+	uint32_t max_ack_ms;
+	/** Amount of messages that were received on the subscriptions. */
+	uint32_t received;
+};
+/**@}*/
+
+/** @brief Called for a message that was received on a subscription, the topic is null terminated. */
+typedef void (*MQTTMessageCallback)(const char* topic, const uint8_t* payload, size_t length, void* context);
+/** @brief Called for a QoS 1 message that was not acknowledged when the session closed. */
+typedef void (*MQTTUnackedCallback)(attributes attribute, const uint8_t* payload, size_t length, void* context);
+
+/**
+ * @brief A session with an MQTT 3.1.1 broker, with clean session set.
+ * Should only be used by one task at a time.
+ */
+class MQTTSession {
+public:
+	/** @brief State of the session. */
+	enum class State : uint8_t {
+		/** No session, connect() starts one. */
+		Closed,
+		/** The CONNECT has been sent, waiting for the CONNACK. */
+		Connecting,
+		/** The broker accepted the session. */
+		Connected,
+	};
+
+private:
+	/**
+	 * @brief A QoS 1 message in the window.
+	 */
+	struct Slot {
+		/** Packet id of the message, 0 when the slot is free. */
+		uint16_t id;
+		/** Attribute of the message, for the unacked callback. */
+		attributes attribute;
+		/** Order in which the message was published. */
+		uint32_t sequence;
+		/** Time of the first send. */
+		uint32_t first_sent;
+		/** Time of the last send. */
+		uint32_t sent;
+		/** Position of the payload in the packet. */
+		uint16_t offset;
+		/** Length of the packet. */
+		uint16_t length;
+		/** The encoded PUBLISH packet. */
+		uint8_t packet[MQTT_PACKET_SIZE];
+	};
+
+	/** @brief Position of the parser in a received packet. */
+	enum class RxState : uint8_t {
+		/** Waiting for the fixed header. */
+		Header,
+		/** Reading the remaining length. */
+		Length,
+		/** Reading the variable header and the payload. */
+		Body,
+	};
+
+	/** The connection to the broker. */
+	iMQTTTransport& transport;
+	/** State of the session. */
+	State state = State::Closed;
+	/** Return code of the last CONNACK. */
+	uint8_t return_code = 0;
+	/** Keep alive interval in ms. */
+	uint32_t keep_alive = 0;
+	/** Time the CONNECT was sent. */
+	uint32_t connect_sent = 0;
+	/** Time the last byte was received. */
+	uint32_t last_in = 0;
+	/** Time the last packet was sent. */
+	uint32_t last_out = 0;
+	/** Time the PINGREQ was sent. */
+	uint32_t ping_sent = 0;
+	/** True while a PINGREQ waits for its PINGRESP. */
+	bool ping_pending = false;
+
+	/** The QoS 1 messages that wait for their PUBACK. */
+	Slot slots[MQTT_INFLIGHT_WINDOW];
+	/** Amount of used slots. */
+	uint8_t inflight = 0;
+	/** Amount of slots that may be used, at most MQTT_INFLIGHT_WINDOW. */
+	uint8_t window = MQTT_INFLIGHT_WINDOW;
+	/** Time in ms after which a message without PUBACK is sent again. */
+	uint32_t ack_timeout = MQTT_ACK_TIMEOUT;
+	/** Last used packet id. */
+	uint16_t last_id = 0;
+	/** Sequence number of the next QoS 1 message. */
+	uint32_t next_sequence = 0;
+	/** Buffer of the QoS 0 and control packets. */
+	uint8_t tx[MQTT_PACKET_SIZE];
+
+	/** State of the parser. */
+	RxState rx_state = RxState::Header;
+	/** Fixed header of the packet that is parsed. */
+	uint8_t rx_header = 0;
+	/** Bit position of the next byte of the remaining length. */
+	uint8_t rx_shift = 0;
+	/** Remaining length of the packet that is parsed. */
+	uint32_t rx_length = 0;
+	/** Amount of bytes of the body that were received. */
+	uint32_t rx_received = 0;
+	/** Body of the packet that is parsed, the bytes that don't fit are skipped. */
+	uint8_t rx[MQTT_RX_SIZE];
+
+	/** Called for the received messages. */
+	MQTTMessageCallback message_callback = nullptr;
+	/** Context of the message callback. */
+	void* message_context = nullptr;
+	/** Called for the unacknowledged messages when the session closes. */
+	MQTTUnackedCallback unacked_callback = nullptr;
+	/** Context of the unacked callback. */
+	void* unacked_context = nullptr;
+	/** The counters. */
+	MQTTSessionStats stats = {0, 0, 0, 0, 0, 0, 0};
+
+	/** @brief Writes the remaining length encoding, returns its size. */
+	static size_t putLength(uint8_t* p, size_t length);
+	/** @brief Writes a string with its 2 byte length, returns the size. */
+	static size_t putString(uint8_t* p, const char* s, size_t length);
+	/**
+	 * @brief Encodes a PUBLISH packet.
+	 * @return size_t the length of the packet, 0 when it doesn't fit in the buffer.
+	 */
+	static size_t encodePublish(uint8_t* buffer, size_t capacity, const char* topic, const uint8_t* payload, size_t length,
+		uint8_t qos, uint16_t id, uint16_t& offset);
+
+	/** @brief Writes a packet, closes the session when the write fails. */
+	bool send(const uint8_t* data, size_t length, uint32_t now);
+	/** @brief Feeds a received byte to the parser. */
+	void parse(uint8_t byte, uint32_t now);
+	/** @brief Handles a received packet. */
+	void onPacket(uint32_t now);
+	/** @brief Returns the next packet id that is not in the window. */
+	uint16_t nextId();
+
+public:
+	/**
+	 * @brief Creates a closed session.
+	 * @param transport the connection to the broker, should be open when connect() is called.
+	 */
+	explicit MQTTSession(iMQTTTransport& transport) : transport(transport) {
+		for(size_t i = 0; i < MQTT_INFLIGHT_WINDOW; i++){slots[i].id = 0;}
+	}
+	MQTTSession(MQTTSession const&)			= delete;	// the transport is shared with the owner.
+	void operator=(MQTTSession const&)		= delete;
+
+	/** @brief Sets the function that is called for the messages received on the subscriptions. */
+	void setMessageCallback(MQTTMessageCallback callback, void* context){ message_callback = callback; message_context = context; }
+	/** @brief Sets the function that takes over the unacknowledged messages when the session closes. */
+	void setUnackedCallback(MQTTUnackedCallback callback, void* context){ unacked_callback = callback; unacked_context = context; }
+	/** @brief Limits the amount of QoS 1 messages in flight, 1 makes the session stop and wait for every PUBACK. */
+	void setWindow(uint8_t size){ window = size < 1 ? 1 : size > MQTT_INFLIGHT_WINDOW ? MQTT_INFLIGHT_WINDOW : size; }
+	/** @brief Sets the time in ms after which a message without PUBACK is sent again. */
+	void setAckTimeout(uint32_t ms){ ack_timeout = ms; }
+
+	/**
+	 * @brief Sends the CONNECT, the session is open once poll() has received the CONNACK.
+	 *
+	 * @param client_id the client id.
+	 * @param username the username, nullptr or empty for none.
+	 * @param password the password, nullptr or empty for none.
+	 * @param keep_alive the keep alive interval in seconds.
+	 * @param now the time in ms.
+	 * @return true the CONNECT has been sent.
+	 * @return false the CONNECT didn't fit or could not be written.
+	 */
+	bool connect(const char* client_id, const char* username, const char* password, uint16_t keep_alive, uint32_t now);
+
+	/**
+	 * @brief Handles the received packets, sends a PINGREQ when the keep alive is due and retransmits the messages without PUBACK.
+	 * Closes the session when the transport is closed, the CONNACK doesn't arrive within MQTT_CONN_TIMEOUT seconds
+	 * or the broker doesn't answer a PINGREQ within the keep alive interval.
+	 *
+	 * @param now the time in ms.
+	 */
+	void poll(uint32_t now);
+
+	/**
+	 * @brief Publishes a message.
+	 *
+	 * @param attribute the attribute of the message, passed to the unacked callback.
+	 * @param topic the topic.
+	 * @param payload the payload.
+	 * @param length the length of the payload in bytes.
+	 * @param qos 0 or 1.
+	 * @param now the time in ms.
+	 * @return true the message has been sent, with QoS 1 it is either acknowledged later or handed to the unacked callback.
+	 * @return false the session is not open, the window is full or the message doesn't fit in MQTT_PACKET_SIZE.
+	 */
+	bool publish(attributes attribute, const char* topic, const uint8_t* payload, size_t length, uint8_t qos, uint32_t now);
+
+	/**
+	 * @brief Subscribes to a topic with QoS 0.
+	 * @return true the SUBSCRIBE has been sent.
+	 */
+	bool subscribe(const char* topic, uint32_t now);
+
+	/** @brief Closes the session and hands the unacknowledged messages to the unacked callback, doesn't close the transport. */
+	void close();
+
+	/** @brief Returns the state of the session. */
+	State getState() const { return state; }
+	/** @brief Returns true when the broker has accepted the session. */
+	bool connected() const { return state == State::Connected; }
+	/** @brief Returns the return code of the last CONNACK, 0 is accepted. */
+	uint8_t getReturnCode() const { return return_code; }
+	/** @brief Returns the amount of QoS 1 messages that wait for their PUBACK. */
+	size_t inFlight() const { return inflight; }
+	/** @brief Returns the amount of QoS 1 messages that can be published before the window is full. */
+	size_t windowFree() const { return inflight < window ? window - inflight : 0; }
+	/** @brief Returns the counters. */
+	MQTTSessionStats getStats() const { return stats; }
+};
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include "PayloadWriter.h"
+
+#include <math.h>
+#include <string.h>
+
+constexpr uint8_t PayloadWriter::MAX_DECIMALS;
+constexpr float PayloadWriter::MAX_NUMBER;
+
+PayloadWriter& PayloadWriter::raw(const char* text, size_t n){
+	if(overflow){return *this;}
+	if(length + n >= capacity){
+		overflow = true;
+		return *this;
+	}
+	memcpy(buffer + length, text, n);
+	length += n;
+	buffer[length] = '\0';
+	return *this;
+}
+
+PayloadWriter& PayloadWriter::raw(const char* text){
+	return raw(text, strlen(text));
+}
+
+PayloadWriter& PayloadWriter::string(const char* text){
+	raw("\"", 1);
+	for(; *text; text++){
+		if(*text == '"' || *text == '\\'){raw("\\", 1);}
+		if((unsigned char)*text < 0x20){continue;} // control characters are not valid in a json string.
+		raw(text, 1);
+	}
+	return raw("\"", 1);
+}
+
+PayloadWriter& PayloadWriter::number(float value, uint8_t decimals){
+	if(isnan(value) || fabsf(value) > MAX_NUMBER){
+		return raw("null", 4);
+	}
+	if(decimals > MAX_DECIMALS){decimals = MAX_DECIMALS;}
+
+	// round to the decimals in fixed point, a double holds every float below MAX_NUMBER times 10^6 exactly enough.
+	uint64_t scale = 1;
+	for(uint8_t i = 0; i < decimals; i++){scale *= 10;}
+	double magnitude = fabs((double)value);
+	uint64_t fixed = (uint64_t)(magnitude * scale + 0.5);
+	uint64_t integer = fixed / scale;
+	uint64_t fraction = fixed % scale;
+
+	// the digits are written from the back, the largest number is a sign, 10 digits, the point and the decimals.
+	char digits[24];
+	char* p = digits + sizeof(digits);
+	for(uint8_t i = 0; i < decimals; i++){
+		*--p = '0' + fraction % 10;
+		fraction /= 10;
+	}
+	if(decimals){*--p = '.';}
+	do {
+		*--p = '0' + integer % 10;
+		integer /= 10;
+	} while(integer);
+	if(value < 0 && fixed){*--p = '-';} // no -0.
+	return raw(p, digits + sizeof(digits) - p);
+}
+
+PayloadWriter& PayloadWriter::integer(uint32_t value){
+	char digits[10];
+	char* p = digits + sizeof(digits);
+	do {
+		*--p = '0' + value % 10;
+		value /= 10;
+	} while(value);
+	return raw(p, digits + sizeof(digits) - p);
+}
\ No newline at end of file
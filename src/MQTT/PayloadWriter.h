@@ -0,0 +1,144 @@
+/**
+ * @file PayloadWriter.h
+ * @author Imre Korf
+ * @brief Formats numbers, strings and json objects into a fixed buffer without using the heap.
+ * @version 0.1
+ * @date 2022-03-29
+ *
+ * The String concatenations that built the payloads allocated and freed a string for every number,
+ * which fragments the heap on long runs. The PayloadWriter writes into a buffer of the caller instead
+ * and formats the numbers itself, as printf with floats can also allocate.
+ *
+ * The members of a json object are described by a constexpr JsonField table. objectSize() gives the
+ * largest payload a table can produce, so the buffer it is written into can be checked with a static_assert.
+ * This file only uses the standard library, so the payloads can also be built on a host by the MQTTBench tool.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @addtogroup STRUCT
+ * @{
+ */
+/**
+ * @brief A member of a json object with a number value.
+ */
+struct JsonField {
+	/** Name of the member. */
+	const char* key;
+	/** Amount of decimals of the value, 0 writes it as an integer. */
+	uint8_t decimals;
+};
+/**@}*/
+
+/**
+ * @brief Appends json to a null terminated string in a fixed buffer.
+ * Once something doesn't fit the writer stops writing and ok() returns false, the buffer then holds the text up to that point.
+ */
+class PayloadWriter {
+public:
+	/** Highest amount of decimals of a number. */
+	static constexpr uint8_t MAX_DECIMALS = 6;
+	/** Highest absolute value of a number, larger values are written as null. */
+	static constexpr float MAX_NUMBER = 4294967040.0f;
+
+private:
+	/** The buffer of the caller. */
+	char* buffer;
+	/** Size of the buffer in bytes, including the null character. */
+	size_t capacity;
+	/** Length of the text in the buffer. */
+	size_t length;
+	/** True once something did not fit. */
+	bool overflow;
+
+	/** @brief Length of the members of a JsonField table from index i on. */
+	static constexpr size_t fieldsSize(const JsonField* fields, size_t i, size_t n){
+		return i < n ? (i ? 1 : 0) + stringLength(fields[i].key) + 3 + numberSize(fields[i].decimals) + fieldsSize(fields, i + 1, n) : 0;
+	}
+
+public:
+	/**
+	 * @brief Creates a writer that writes at the start of a buffer.
+	 * @param buffer the buffer, at least 1 byte.
+	 * @param capacity the size of the buffer in bytes.
+	 */
+	PayloadWriter(char* buffer, size_t capacity) : buffer(buffer), capacity(capacity) { clear(); }
+
+	/** @brief Creates a writer that writes at the start of an array. */
+	template<size_t N>
+	explicit PayloadWriter(char (&buffer)[N]) : PayloadWriter(buffer, N) {}
+
+	/** @brief Empties the buffer. */
+	void clear(){
+		length = 0;
+		overflow = false;
+		buffer[0] = '\0';
+	}
+
+	/** @brief Shortens the text to a length it had before, and clears the overflow. */
+	void truncate(size_t n){
+		if(n < length){length = n;}
+		overflow = false;
+		buffer[length] = '\0';
+	}
+
+	/** @brief Appends text as it is. */
+	PayloadWriter& raw(const char* text, size_t n);
+	/** @brief Appends a null terminated text as it is. */
+	PayloadWriter& raw(const char* text);
+	/** @brief Appends a json string with quotes, the quotes and backslashes in the text are escaped. */
+	PayloadWriter& string(const char* text);
+	/**
+	 * @brief Appends a number with a fixed amount of decimals, without exponent.
+	 * nan, inf and values above MAX_NUMBER are written as null, as they are not valid json numbers.
+	 *
+	 * @param value the value.
+	 * @param decimals the amount of decimals, at most MAX_DECIMALS.
+	 */
+	PayloadWriter& number(float value, uint8_t decimals = 0);
+
+	/** @brief Appends an unsigned integer, for values that a float can't hold exactly such as a time. */
+	PayloadWriter& integer(uint32_t value);
+
+	/**
+	 * @brief Appends a json object of numbers.
+	 * @param fields the names and the decimals of the members.
+	 * @param values the values of the members, in the order of the fields.
+	 */
+	template<size_t N>
+	PayloadWriter& object(const JsonField (&fields)[N], const float (&values)[N]){
+		raw("{", 1);
+		for(size_t i = 0; i < N; i++){
+			if(i){raw(",", 1);}
+			string(fields[i].key).raw(":", 1).number(values[i], fields[i].decimals);
+		}
+		return raw("}", 1);
+	}
+
+	/** @brief Returns false when something did not fit in the buffer. */
+	bool ok() const { return !overflow; }
+	/** @brief Returns the null terminated text. */
+	const char* c_str() const { return buffer; }
+	/** @brief Returns the length of the text in bytes. */
+	size_t size() const { return length; }
+
+	/** @brief Length of a null terminated string that is known at compile time. */
+	static constexpr size_t stringLength(const char* s){
+		return *s ? 1 + stringLength(s + 1) : 0;
+	}
+	/** @brief Largest length of a number with the given decimals: a sign, 10 digits, the point and the decimals. */
+	static constexpr size_t numberSize(uint8_t decimals){
+		return 11 + (decimals ? 1 + decimals : 0);
+	}
+	/** @brief Largest length of the json object of a JsonField table, without the null character. */
+	template<size_t N>
+	static constexpr size_t objectSize(const JsonField (&fields)[N]){
+		return 2 + fieldsSize(fields, 0, N);
+	}
+};
\ No newline at end of file
@@ -0,0 +1,370 @@
+#include "Pipeline.h"
+#include "../Logger/Logger.h"
+#include "../Wrappers/I2C/I2CBus.h"
+#include "../Wrappers/RTC/__W_RTC.h"
+
+#include <Arduino.h>
+
+// the json values are formatted in the payload buffer of the network task, so they have to fit in it whatever the measurement.
+static_assert(PayloadWriter::objectSize(AS7262_Color_fields) < MQTT_PAYLOAD_SIZE, "the AS7262_Color json doesn't fit in MQTT_PAYLOAD_SIZE");
+static_assert(PayloadWriter::objectSize(TSL2591_Spectrum_fields) < MQTT_PAYLOAD_SIZE, "the TSL2591_Spectrum json doesn't fit in MQTT_PAYLOAD_SIZE");
+static_assert(PayloadWriter::objectSize(MAX4466_Bands_fields) < MQTT_PAYLOAD_SIZE, "the MAX4466_Bands json doesn't fit in MQTT_PAYLOAD_SIZE");
+
+// room a record needs in the QoS 1 window: the open batch, or the messages of the Ambimate which sends the most.
+static const size_t RECORD_MESSAGES = MQTT_BATCH ? 1 : 4;
+
+ERR_Type Pipeline::start(){
+	sbox.setCallback(onSample, this);
+#if PIPELINE_DUAL_CORE
+	if(sample_task){return ALREADY_INITIALIZED;}
+	// the network task is created first, so the sampling task can notify it from its first measurement on.
+	if(xTaskCreatePinnedToCore(networkTask, "Network", PIPELINE_NETWORK_STACK, this, PIPELINE_NETWORK_PRIORITY, &network_task, PIPELINE_NETWORK_CORE) != pdPASS){
+		Logger::getInstance().println<LogLevel::Error>("Failed to create the network task.");
+		return ERROR;
+	}
+	if(xTaskCreatePinnedToCore(sampleTask, "Sampling", PIPELINE_SAMPLE_STACK, this, PIPELINE_SAMPLE_PRIORITY, &sample_task, PIPELINE_SAMPLE_CORE) != pdPASS){
+		Logger::getInstance().println<LogLevel::Error>("Failed to create the sampling task.");
+		return ERROR;
+	}
+#endif
+	return SUCCESS;
+}
+
+uint32_t Pipeline::loop(){
+	uint32_t wait = sampleStep();
+	networkStep();
+	return wait;
+}
+
+// sampling task, never waits on anything but its own period.
+void Pipeline::sampleTask(void* param){
+	Pipeline* pipeline = (Pipeline*)param;
+	for(;;){
+		uint32_t wait = pipeline->sampleStep();
+		vTaskDelay(wait ? pdMS_TO_TICKS(wait) : 1); // always sleep a tick, so the lower priority tasks on this core get to run.
+	}
+}
+
+// network task, wakes up for every queued record and at least every PIPELINE_NETWORK_PERIOD.
+void Pipeline::networkTask(void* param){
+	Pipeline* pipeline = (Pipeline*)param;
+	for(;;){
+		pipeline->networkStep();
+		ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(PIPELINE_NETWORK_PERIOD));
+	}
+}
+
+uint32_t Pipeline::sampleStep(){
+	uint32_t now = millis();
+	if(planned_wake){
+		int32_t late = (int32_t)(now - planned_wake);
+		if(late > (int32_t)max_late){max_late = late;}
+	}
+	uint32_t wait = sbox.poll();
+	planned_wake = millis() + (wait ? wait : 1);
+	return wait;
+}
+
+void Pipeline::onSample(SBoxSensor sensor, ERR_Type ET, void* context){
+	Pipeline* pipeline = (Pipeline*)context;
+	if(ET){
+		Logger::getInstance().println<LogLevel::Warning>("Measurement of sensor [", (int)sensor, "] failed: ", ET);
+		return;
+	}
+	SampleRecord record;
+	record.time = millis();
+	record.epoch = __W_RTC::getInstance().epochSeconds();
+	record.sensor = sensor;
+	// the log statements are only queued for the Logger writer task, so they are cheap enough for the sampling task.
+	switch(sensor){
+		case SBoxSensor::Ambimate: {
+			AmbimateData& A_DAT = record.ambimate;
+			A_DAT = pipeline->sbox.getAmbimateData();
+			Logger::getInstance().log<LogLevel::Info>(LOG_MSG_AMBIMATE, A_DAT.temperatureC, A_DAT.Humidity, A_DAT.batVolts, A_DAT.audio,
+				A_DAT.eco2_ppm, A_DAT.voc_ppm, A_DAT.MOT_EVENT, A_DAT.AUD_EVENT, A_DAT.PIR_EVENT);
+			break;
+		}
+		case SBoxSensor::AS7262: {
+			ColorSpectrum& CS = record.spectrum;
+			pipeline->sbox.getColorSpectrum(CS);
+			Logger::getInstance().log<LogLevel::Info>(LOG_MSG_AS7262, CS.Violet, CS.Blue, CS.Green, CS.Yellow, CS.Orange, CS.Red);
+			break;
+		}
+		case SBoxSensor::LDS:
+			pipeline->sbox.getLDSData(record.dust);
+			break;
+		case SBoxSensor::MAX4466: {
+			AudioSummary& AUD = record.audio;
+			AUD = pipeline->sbox.getMax4466();
+			Logger::getInstance().log<LogLevel::Info>(LOG_MSG_MAX4466_LEVEL, AUD.dba, AUD.rms_dbfs, AUD.peak_dbfs, AUD.clipped,
+				AUD.bands[0], AUD.bands[1], AUD.bands[2], AUD.bands[3], AUD.bands[4], AUD.bands[5], AUD.bands[6], AUD.bands[7]);
+			break;
+		}
+		case SBoxSensor::MIX8410:
+			record.o2 = pipeline->sbox.getO2();
+			Logger::getInstance().log<LogLevel::Info>(LOG_MSG_MIX8410, record.o2);
+			break;
+		case SBoxSensor::SCD30: {
+			SCD30_DATA& SCD30_D = record.scd30;
+			SCD30_D = pipeline->sbox.getSCD30Data();
+			Logger::getInstance().log<LogLevel::Info>(LOG_MSG_SCD30, SCD30_D.CO2, SCD30_D.Temperature, SCD30_D.Humidity);
+			break;
+		}
+		case SBoxSensor::TSL2591: {
+			TSL2591_DATA& TSL_DAT = record.tsl2591;
+			TSL_DAT = pipeline->sbox.getTSL2591Data();
+			Logger::getInstance().log<LogLevel::Info>(LOG_MSG_TSL2591, TSL_DAT.visible, TSL_DAT.ir, TSL_DAT.full);
+			Logger::getInstance().log<LogLevel::Info>(LOG_MSG_TSL2591_LUX, TSL_DAT.lux, TSL_DAT.gain, TSL_DAT.integration);
+			break;
+		}
+		default:
+			return;
+	}
+	if(pipeline->queue.push(record)){
+		pipeline->sampled = pipeline->sampled + 1;
+		if(pipeline->network_task){
+			xTaskNotifyGive(pipeline->network_task);
+		}
+	}
+}
+
+void Pipeline::networkStep(){
+	if(!client_initialized){
+		client_initialized = true;
+		if(client.init((char*)settings_path)){
+			Logger::getInstance().println<LogLevel::Error>("MQTT client failed to initialize, the samples are not published.");
+		}
+	}
+	client.loopClient();
+
+	// checked once per step, a record that fails while connected is spooled by the publish path itself.
+	bool online = client.connected();
+	if(online && !announced){
+		client.sendData(CONN, "Connected");
+	}
+	announced = online;
+	SampleRecord record;
+	// while the QoS 1 window is full the records wait in the queue, the PUBACKs free it within a round trip.
+	while((!online || client.windowFree() >= RECORD_MESSAGES) && queue.pop(record)){
+		if(!online){
+			failed = failed + 1;
+			spoolRecord(record);
+			continue;
+		}
+#if MQTT_BATCH
+		// a batch holds at most one record of every sensor, a second record of a sensor starts the next batch.
+		if(batch_sensors & ((uint32_t)1 << (uint8_t)record.sensor)){commitBatch();}
+		if(batchRecord(record)){continue;}
+		// the record did not fit behind the others, the batch is sent without it and the record starts the next one.
+		if(batch_sensors){
+			commitBatch();
+			if(batchRecord(record)){continue;}
+		}
+		failed = failed + 1;
+		spoolRecord(record);
+#else
+		if(publish(record)){published = published + 1;}
+		else{
+			failed = failed + 1;
+			spoolRecord(record);
+		}
+#endif
+	}
+#if MQTT_BATCH
+	commitBatch();
+#endif
+	drainSpool();
+
+#if PIPELINE_STATS_INTERVAL
+	if(millis() - last_stats >= PIPELINE_STATS_INTERVAL){
+		last_stats = millis();
+		PipelineStats S = getStats();
+		Logger::getInstance().println<LogLevel::Info>("Pipeline queue ", (uint32_t)S.depth, "/", PIPELINE_QUEUE_LENGTH, " high water ", (uint32_t)S.high_water,
+			" sampled ", S.sampled, " dropped ", S.dropped, " published ", S.published, " failed ", S.failed, " messages ", S.messages, " max late ", S.max_late, " ms");
+		MQTTConnStats C = client.getConnectionStats();
+		Logger::getInstance().println<LogLevel::Info>("MQTT ", MQTTClient::getStateName(client.getState()), " connects ", C.connects, " disconnects ", C.disconnects,
+			" failures ", C.failures, " last connect ", C.last_connect_ms, " ms max ", C.max_connect_ms, " ms");
+		MQTTSessionStats Q = client.getSessionStats();
+		Logger::getInstance().println<LogLevel::Info>("MQTT QoS ", MQTT_QOS, " published ", Q.published, " acked ", Q.acked, " retransmits ", Q.retransmits,
+			" window full ", Q.window_full, " handed off ", Q.handed_off, " max ack ", Q.max_ack_ms, " ms");
+#if SPOOL_ENABLED
+		SpoolStats P = getSpoolStats();
+		uint32_t now = __W_RTC::getInstance().epochSeconds();
+		Logger::getInstance().println<LogLevel::Info>("Spool depth ", P.depth, " oldest ", P.oldest_epoch && now > P.oldest_epoch ? now - P.oldest_epoch : 0, " s spooled ", P.spooled,
+			" drained ", P.drained, " (", (P.drained - last_drained) * 60000 / PIPELINE_STATS_INTERVAL, "/min) dropped ", P.dropped, " corrupt ", P.corrupt);
+		last_drained = P.drained;
+#endif
+		I2CBus& bus = I2CBus::getInstance();
+		for(uint8_t i = 0; i < (uint8_t)I2CDevice::Count; i++){
+			I2CStats I = bus.getStats((I2CDevice)i);
+			Logger::getInstance().println<LogLevel::Info>("I2C ", I2CBus::getName((I2CDevice)i), " transactions ", I.transactions, " errors ", I.errors,
+				" avg ", I.transactions ? (uint32_t)(I.total_us / I.transactions) : 0, " us max ", I.max_us, " us");
+		}
+		if(bus.getRecoveries()){
+			Logger::getInstance().println<LogLevel::Warning>("I2C bus cleared ", bus.getRecoveries(), " times");
+		}
+	}
+#endif
+}
+
+bool Pipeline::send(attributes attribute, const PayloadWriter& value){
+	if(!value.ok()){return false;}
+#if MQTT_BATCH
+	return client.add(attribute, value.c_str());
+#else
+	if(!client.sendData(attribute, value.c_str(), value.size())){return false;}
+	messages = messages + 1;
+	return true;
+#endif
+}
+
+bool Pipeline::send(attributes attribute, float value, uint8_t decimals){
+	PayloadWriter W(payload);
+	W.number(value, decimals);
+	return send(attribute, W);
+}
+
+bool Pipeline::batchRecord(const SampleRecord& record){
+	if(!batch_sensors){client.beginBatch();}
+	MQTTBatchMark mark = client.markBatch();
+	if(!publish(record)){
+		// take out the values of the record that did fit, so the batch only holds complete records.
+		client.truncateBatch(mark);
+		return false;
+	}
+	batch_sensors |= (uint32_t)1 << (uint8_t)record.sensor;
+	batch_list[batch_records++] = record;
+	return true;
+}
+
+void Pipeline::commitBatch(){
+	if(!batch_sensors){return;}
+	if(client.commit()){
+		published = published + batch_records;
+		messages = messages + 1;
+	}
+	else{
+		failed = failed + batch_records;
+		for(uint32_t i = 0; i < batch_records; i++){
+			spoolRecord(batch_list[i]);
+		}
+	}
+	batch_sensors = 0;
+	batch_records = 0;
+}
+
+void Pipeline::spoolRecord(const SampleRecord& record){
+#if SPOOL_ENABLED
+	spool.push(record);
+#endif
+}
+
+void Pipeline::drainSpool(){
+#if SPOOL_ENABLED
+	// token bucket, the budget grows with SPOOL_DRAIN_RATE records per second up to a burst of SPOOL_DRAIN_BURST.
+	uint32_t now = millis();
+	uint32_t elapsed = now - last_drain;
+	uint32_t limit = SPOOL_DRAIN_BURST * 1000;
+	last_drain = now;
+	drain_budget += (elapsed < limit ? elapsed : limit) * SPOOL_DRAIN_RATE;
+	if(drain_budget > limit){drain_budget = limit;}
+	// the live records go first, the spool is only drained when they are all out.
+	if(!spool.depth() || queue.size() || drain_budget < 1000 || !client.connected()){return;}
+	size_t room = client.windowFree() / RECORD_MESSAGES;
+	if(!room){return;}
+
+	SampleRecord records[SPOOL_DRAIN_BURST];
+	size_t count = spool.read(records, drain_budget / 1000 < room ? drain_budget / 1000 : room);
+	size_t sent = 0;
+	while(sent < count && publishSpooled(records[sent])){sent++;}
+	// only the published records leave the spool, the others are read again so none is lost or published twice.
+	spool.commit(sent);
+	drain_budget -= sent * 1000;
+#endif
+}
+
+bool Pipeline::publishSpooled(const SampleRecord& record){
+#if MQTT_BATCH
+	// the receiver can't tell a spooled record from a live one by its arrival, so it gets the time of the measurement.
+	client.beginBatch();
+	PayloadWriter W(payload);
+	W.integer(record.epoch);
+	if(!send(TIMESTAMP, W) || !publish(record) || !client.commit()){
+		client.beginBatch();
+		return false;
+	}
+	messages = messages + 1;
+	return true;
+#else
+	return publish(record);
+#endif
+}
+
+bool Pipeline::publish(const SampleRecord& record){
+	bool ok = true;
+	switch(record.sensor){
+		case SBoxSensor::Ambimate: {
+			const AmbimateData& A_DAT = record.ambimate;
+			ok &= send(ambimate_Voc, A_DAT.voc_ppm, 0);
+			ok &= send(ambimate_hum, A_DAT.Humidity, 2);
+			ok &= send(ambimate_temp, A_DAT.temperatureC, 2);
+			ok &= send(ambimate_Eco2, A_DAT.eco2_ppm, 0);
+			break;
+		}
+		case SBoxSensor::AS7262: {
+			const ColorSpectrum& CS = record.spectrum;
+			const float color[] = {CS.Violet, CS.Blue, CS.Green, CS.Yellow, CS.Orange, CS.Red};
+			ok &= sendObject(AS7262_Color, AS7262_Color_fields, color);
+			break;
+		}
+		case SBoxSensor::LDS: {
+			const PM25_AQI_Data& DUST = record.dust;
+			ok &= send(PM10, DUST.particles_10um, 0);
+			ok &= send(PM25, DUST.particles_25um, 0);
+			ok &= send(PM100, DUST.particles_100um, 0);
+			break;
+		}
+		case SBoxSensor::MAX4466: {
+			const AudioSummary& AUD = record.audio;
+			ok &= send(MAX4466_Audio, AUD.dba, 1);
+			ok &= sendObject(MAX4466_Bands, MAX4466_Bands_fields, AUD.bands);
+			break;
+		}
+		case SBoxSensor::MIX8410:
+			ok &= send(MIX8410_O2, record.o2, 2);
+			break;
+		case SBoxSensor::SCD30: {
+			const SCD30_DATA& SCD30_D = record.scd30;
+			ok &= send(SCD30_CO2, SCD30_D.CO2, 0);
+			ok &= send(SCD30_hum, SCD30_D.Humidity, 2);
+			ok &= send(SCD30_temp, SCD30_D.Temperature, 2);
+			break;
+		}
+		case SBoxSensor::TSL2591: {
+			const TSL2591_DATA& TSL_DAT = record.tsl2591;
+			const float spectrum[] = {(float)TSL_DAT.visible, (float)TSL_DAT.ir, (float)TSL_DAT.full, TSL_DAT.lux};
+			ok &= sendObject(TSL2591_Spectrum, TSL2591_Spectrum_fields, spectrum);
+			break;
+		}
+		default:
+			break;
+	}
+	return ok;
+}
+
+PipelineStats Pipeline::getStats() const {
+	PipelineStats S;
+	S.sampled = sampled;
+	S.dropped = queue.getDropped();
+	S.published = published;
+	S.failed = failed;
+	S.messages = messages;
+	S.depth = queue.size();
+	S.high_water = queue.highWater();
+	S.max_late = max_late;
+	return S;
+}
+
+SpoolStats Pipeline::getSpoolStats() const {
+	return spool.getStats();
+}
\ No newline at end of file
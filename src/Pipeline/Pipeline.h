@@ -0,0 +1,198 @@
+/**
+ * @file Pipeline.h
+ * @author Imre Korf
+ * @brief Moves the measurements of the SBox to the MQTT client through a SampleQueue.
+ * @version 0.1
+ * @date 2022-03-16
+ *
+ * Task | Core | Description
+ * :-----:|:-----:|:-----------------------------:
+ *  sampling | PIPELINE_SAMPLE_CORE | polls the SBox, logs every measurement and queues it as a SampleRecord
+ *  network | PIPELINE_NETWORK_CORE | advances the connection to the broker, publishes the queued records and keeps the connection alive
+ *
+ * The sampling task never touches the network, so a WiFi stall or TLS handshake can't delay a measurement.
+ * When the network task falls behind the SampleQueue fills up and the newest records are dropped and counted.
+ * With MQTT_BATCH set all the records that the network task finds in the queue are published as one batch message,
+ * so a measurement cycle costs one TLS record instead of one per value.
+ * With SPOOL_ENABLED set the records that can't be published are kept in a SampleSpool on the SD card. Once the broker
+ * is back and the queue is empty they are published again at SPOOL_DRAIN_RATE, so the live measurements always go first.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include "SampleQueue.h"
+#include "SampleRecord.h"
+#include "SampleSpool.h"
+#include "../Sbox/Sbox.h"
+#include "../MQTT/MQTT.h"
+#include "../Defines/Defines.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/**
+ * @addtogroup STRUCT
+ * @{
+ */
+/**
+ * @brief Counters of the Pipeline.
+ */
+struct PipelineStats {
+	/** Amount of records that were queued by the sampling task. */
+	uint32_t sampled;
+	/** Amount of records that were dropped because the queue was full. */
+	uint32_t dropped;
+	/** Amount of records that were published. */
+	uint32_t published;
+	/** Amount of records of which a message could not be published. */
+	uint32_t failed;
+	/** Amount of MQTT messages that were published, one per batch with MQTT_BATCH set. */
+	uint32_t messages;
+	/** Amount of records in the queue. */
+	size_t depth;
+	/** Highest amount of records that has been in the queue at once. */
+	size_t high_water;
+	/** Highest delay in ms between the planned and the actual wake up of the sampling task. */
+	uint32_t max_late;
+};
+/**@}*/
+
+/**
+ * @brief Runs the sampling and the publishing of the SBox measurements, each in its own task.
+ */
+class Pipeline {
+private:
+	/** The sensors. */
+	SBox& sbox;
+	/** The MQTT connection. */
+	MQTTClient& client;
+	/** Path of the MQTT settings file, the client is initialized by the network task. */
+	const char* settings_path;
+	/** The records between the sampling and the network task. */
+	SampleQueue<SampleRecord, PIPELINE_QUEUE_LENGTH> queue;
+
+	/** Handle of the sampling task, nullptr when the tasks are not started. */
+	TaskHandle_t sample_task = nullptr;
+	/** Handle of the network task, nullptr when the tasks are not started. */
+	TaskHandle_t network_task = nullptr;
+	/** True once the network task has initialized the MQTT client. */
+	bool client_initialized = false;
+	/** True when the CONN message has been sent for the current session. */
+	bool announced = false;
+
+	/** Amount of records that were queued, only written by the sampling task. */
+	volatile uint32_t sampled = 0;
+	/** Amount of records that were published, only written by the network task. */
+	volatile uint32_t published = 0;
+	/** Amount of records that could not be published, only written by the network task. */
+	volatile uint32_t failed = 0;
+	/** Amount of MQTT messages that were published, only written by the network task. */
+	volatile uint32_t messages = 0;
+	/** Buffer in which the network task formats the values, so publishing doesn't use the heap. */
+	char payload[MQTT_PAYLOAD_SIZE];
+	/** Bit mask of the sensors of which a record is in the open batch. */
+	uint32_t batch_sensors = 0;
+	/** Amount of records in the open batch. */
+	uint32_t batch_records = 0;
+	/** The records in the open batch, they are spooled when the batch can't be published. */
+	SampleRecord batch_list[(size_t)SBoxSensor::Count];
+	/** The records that could not be published. */
+	SampleSpool spool;
+	/** Amount of spooled records that may be published, in thousandths of a record. */
+	uint32_t drain_budget = 0;
+	/** Time of the last update of the drain budget. */
+	uint32_t last_drain = 0;
+	/** Amount of drained records at the last log of the counters. */
+	uint32_t last_drained = 0;
+	/** Highest wake up delay of the sampling task, only written by the sampling task. */
+	volatile uint32_t max_late = 0;
+	/** Time at which the sampling task should wake up. */
+	uint32_t planned_wake = 0;
+	/** Time of the last log of the counters. */
+	uint32_t last_stats = 0;
+
+	/** @brief Logs a measurement and queues it for the network task, called by the scheduler of the SBox. */
+	static void onSample(SBoxSensor sensor, ERR_Type ET, void* context);
+	/** @brief Publishes all the messages of a record, returns false when a message could not be published. */
+	bool publish(const SampleRecord& record);
+	/** @brief Sends a formatted value on the topic of its attribute, or adds it to the open batch with MQTT_BATCH set. */
+	bool send(attributes attribute, const PayloadWriter& value);
+	/** @brief Sends a number with the given amount of decimals. */
+	bool send(attributes attribute, float value, uint8_t decimals);
+	/** @brief Sends a json object of numbers, the fields are checked against MQTT_PAYLOAD_SIZE in Pipeline.cpp. */
+	template<size_t N>
+	bool sendObject(attributes attribute, const JsonField (&fields)[N], const float (&values)[N]){
+		PayloadWriter W(payload);
+		W.object(fields, values);
+		return send(attribute, W);
+	}
+	/** @brief Adds a record to the open batch, returns false and leaves the batch as it was when the record doesn't fit. */
+	bool batchRecord(const SampleRecord& record);
+	/** @brief Publishes the open batch and counts its records as published or failed. */
+	void commitBatch();
+	/** @brief Keeps a record that could not be published in the spool. */
+	void spoolRecord(const SampleRecord& record);
+	/** @brief Publishes spooled records while the queue is empty, at most SPOOL_DRAIN_RATE per second. */
+	void drainSpool();
+	/** @brief Publishes a record from the spool, with MQTT_BATCH set in a batch of its own with its TIMESTAMP. */
+	bool publishSpooled(const SampleRecord& record);
+
+	/** @brief Sampling task, polls the SBox. */
+	static void sampleTask(void* param);
+	/** @brief Network task, publishes the queued records. */
+	static void networkTask(void* param);
+
+public:
+	/**
+	 * @brief Creates a pipeline between the SBox and the MQTT client.
+	 * @param sbox the initialized SBox.
+	 * @param client the MQTT client, is initialized by the pipeline.
+	 * @param settings_path the path to the MQTT settings file.
+	 */
+	Pipeline(SBox& sbox, MQTTClient& client, const char* settings_path) : sbox(sbox), client(client), settings_path(settings_path) {}
+
+	/**
+	 * @brief Starts the sampling and the network task.
+	 * With PIPELINE_DUAL_CORE set to 0 no tasks are started and loop() should be called from the Arduino loop.
+	 *
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 * @see ERR_Type
+	 */
+	ERR_Type start();
+
+	/**
+	 * @brief Runs one sampling and one network step, only used when PIPELINE_DUAL_CORE is 0.
+	 *
+	 * @return uint32_t the time in ms until the next measurement step is due.
+	 */
+	uint32_t loop();
+
+	/**
+	 * @brief Runs the due measurement steps and queues the collected measurements.
+	 *
+	 * @return uint32_t the time in ms until the next measurement step is due.
+	 */
+	uint32_t sampleStep();
+
+	/**
+	 * @brief Advances the MQTT connection and publishes the queued records.
+	 * The first call initializes the MQTT client, the connection is made in the next steps without blocking them.
+	 */
+	void networkStep();
+
+	/**
+	 * @brief Returns the counters of the pipeline.
+	 *
+	 * @return PipelineStats a copy of the counters.
+	 */
+	PipelineStats getStats() const;
+
+	/**
+	 * @brief Returns the counters of the spool.
+	 *
+	 * @return SpoolStats a copy of the counters.
+	 */
+	SpoolStats getSpoolStats() const;
+};
\ No newline at end of file
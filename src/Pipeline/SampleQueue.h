@@ -0,0 +1,99 @@
+/**
+ * @file SampleQueue.h
+ * @author Imre Korf
+ * @brief Bounded lock-free single producer single consumer ring buffer used between the sampling and the network task.
+ * @version 0.1
+ * @date 2022-03-16
+ *
+ * The producer only writes the head and the consumer only writes the tail, so neither side ever waits on the other.
+ * When the ring is full the new item is dropped and counted, the producer never blocks on a slow consumer.
+ * This file only uses the standard library, so the HostTests can check it with threads on a host.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Bounded lock-free ring buffer with a single producer and a single consumer.
+ * @tparam T the type of the queued items, is copied in and out of the ring.
+ * @tparam N the amount of slots, should be a power of 2.
+ */
+template<typename T, size_t N>
+class SampleQueue {
+	static_assert(N >= 2 && (N & (N - 1)) == 0, "the SampleQueue length should be a power of 2");
+private:
+	/** The slots of the ring. */
+	T items[N];
+	/** Next position to be written, only changed by the producer. */
+	std::atomic<size_t> head;
+	/** Next position to be read, only changed by the consumer. */
+	std::atomic<size_t> tail;
+	/** Highest amount of items that has been in the ring at once. */
+	std::atomic<size_t> high_water;
+	/** Amount of items that were dropped because the ring was full. */
+	std::atomic<uint32_t> dropped;
+
+public:
+	SampleQueue() : head(0), tail(0), high_water(0), dropped(0) {}
+
+	/**
+	 * @brief Adds an item to the ring, should only be called by the producer task.
+	 * @param item the item to be copied into the ring.
+	 * @return true the item has been added.
+	 * @return false the ring is full, the item is dropped.
+	 */
+	bool push(const T& item){
+		size_t h = head.load(std::memory_order_relaxed);
+		size_t t = tail.load(std::memory_order_acquire);
+		if(h - t >= N){
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		items[h & (N - 1)] = item;
+		head.store(h + 1, std::memory_order_release); // publish the item to the consumer.
+		if(h + 1 - t > high_water.load(std::memory_order_relaxed)){
+			high_water.store(h + 1 - t, std::memory_order_relaxed); // only the producer writes the high water mark.
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Takes the oldest item from the ring, should only be called by the consumer task.
+	 * @param item buffer for the item.
+	 * @return true an item has been read.
+	 * @return false the ring is empty.
+	 */
+	bool pop(T& item){
+		size_t t = tail.load(std::memory_order_relaxed);
+		if(head.load(std::memory_order_acquire) == t){
+			return false;
+		}
+		item = items[t & (N - 1)];
+		tail.store(t + 1, std::memory_order_release); // hand the slot back to the producer.
+		return true;
+	}
+
+	/**
+	 * @brief Returns the amount of items in the ring.
+	 * The value is only an indication when the other task is pushing or popping at the same time.
+	 */
+	size_t size() const {
+		size_t t = tail.load(std::memory_order_acquire);
+		size_t h = head.load(std::memory_order_acquire);
+		return h - t > N ? N : h - t;
+	}
+
+	/** @brief Returns the amount of slots of the ring. */
+	static constexpr size_t capacity(){ return N; }
+
+	/** @brief Returns the highest amount of items that has been in the ring at once. */
+	size_t highWater() const { return high_water.load(std::memory_order_relaxed); }
+
+	/** @brief Returns the amount of items that were dropped because the ring was full. */
+	uint32_t getDropped() const { return dropped.load(std::memory_order_relaxed); }
+};
\ No newline at end of file
@@ -0,0 +1,46 @@
+/**
+ * @file SampleRecord.h
+ * @author Imre Korf
+ * @brief A single measurement as it is passed from the sampling task to the network task and the spool.
+ * @version 0.1
+ * @date 2022-03-16
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include "../Sbox/Sbox.h"
+
+/**
+ * @addtogroup STRUCT
+ * @{
+ */
+/**
+ * @brief A single measurement of a sensor of the SBox.
+ */
+struct SampleRecord {
+	/** Time in ms at which the measurement was collected. */
+	uint32_t time;
+	/** Time in seconds since 1970 at which the measurement was collected, from the RTC. */
+	uint32_t epoch;
+	/** The measured sensor, tells which member of the union is valid. */
+	SBoxSensor sensor;
+	union {
+		/** Data of SBoxSensor::Ambimate. */
+		AmbimateData ambimate;
+		/** Data of SBoxSensor::AS7262. */
+		ColorSpectrum spectrum;
+		/** Data of SBoxSensor::LDS. */
+		PM25_AQI_Data dust;
+		/** Data of SBoxSensor::MAX4466. */
+		AudioSummary audio;
+		/** Data of SBoxSensor::MIX8410. */
+		float o2;
+		/** Data of SBoxSensor::SCD30. */
+		SCD30_DATA scd30;
+		/** Data of SBoxSensor::TSL2591. */
+		TSL2591_DATA tsl2591;
+	};
+};
+/**@}*/
\ No newline at end of file
@@ -0,0 +1,288 @@
+#include "SampleSpool.h"
+#include "../Logger/Logger.h"
+#include "../Wrappers/SD/__W_SD.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief Path of the cursor file. */
+#define SPOOL_CURSOR_FILE SPOOL_DIR "/cursor.dat"
+
+// the segments that load() finds on the storage.
+struct SpoolScan {
+	uint32_t first;
+	uint32_t last;
+	uint32_t found;
+	uint32_t entries;
+	size_t last_size;
+	size_t entry_size;
+};
+
+// listDir callback that collects the segment files.
+static bool scanSegment(const char* path, bool is_dir, size_t size, void* context){
+	SpoolScan* scan = (SpoolScan*)context;
+	const char* name = strrchr(path, '/');
+	name = name ? name + 1 : path;
+	char* end;
+	uint32_t segment = strtoul(name, &end, 16);
+	if(is_dir || end != name + 8 || strcmp(end, ".bin")){return true;} // not a segment, e.g. the cursor file.
+	if(segment < scan->first){scan->first = segment;}
+	if(!scan->found || segment > scan->last){
+		scan->last = segment;
+		scan->last_size = size;
+	}
+	scan->found++;
+	scan->entries += size / scan->entry_size;
+	return true;
+}
+
+uint32_t SampleSpool::checksum(const void* data, size_t len){
+	const uint8_t* p = (const uint8_t*)data;
+	uint32_t hash = 2166136261u;
+	for(size_t i = 0; i < len; i++){
+		hash = (hash ^ p[i]) * 16777619u;
+	}
+	return hash;
+}
+
+void SampleSpool::segmentPath(uint32_t segment, char* path){
+	snprintf(path, 32, SPOOL_DIR "/%08lx.bin", (unsigned long)segment);
+}
+
+bool SampleSpool::ready(){
+	__W_SD& SD = __W_SD::getInstance();
+	if(!SD.getStorage()){
+		loaded = false;
+		return false;
+	}
+	if(!loaded || mount != SD.getMountCount()){
+		loaded = load() == SUCCESS;
+	}
+	return loaded;
+}
+
+ERR_Type SampleSpool::load(){
+	__W_SD& SD = __W_SD::getInstance();
+	iStorage* storage = SD.getStorage();
+	if(!storage){return NOT_INITIALIZED;}
+	mount = SD.getMountCount();
+	pending = 0;
+	pending_records = 0;
+	if(!storage->exists(SPOOL_DIR) && !storage->mkdir(SPOOL_DIR)){
+		Logger::getInstance().println<LogLevel::Error>("[Spool] Failed to create ", SPOOL_DIR);
+		return SD_MKDIR_FAIL;
+	}
+
+	Cursor C;
+	size_t read = 0;
+	bool valid = storage->exists(SPOOL_CURSOR_FILE) && !SD.readBytes(SPOOL_CURSOR_FILE, 0, (uint8_t*)&C, sizeof(C), read) &&
+		read == sizeof(C) && C.magic == SPOOL_CURSOR_MAGIC && C.checksum == checksum(&C, offsetof(Cursor, checksum));
+
+	SpoolScan scan = {UINT32_MAX, 0, 0, 0, 0, sizeof(Entry)};
+	storage->listDir(SPOOL_DIR, scanSegment, &scan);
+	if(!scan.found){
+		// nothing spooled, continue the numbering of the cursor so old segments are never mixed up with new ones.
+		read_segment = write_segment = valid ? C.segment : 0;
+		read_index = write_count = 0;
+		stats.depth = 0;
+	}
+	else{
+		write_segment = scan.last;
+		write_count = scan.last_size / sizeof(Entry);
+		if(scan.last_size % sizeof(Entry) || write_count >= SPOOL_SEGMENT_RECORDS){
+			// a torn entry is left where it is, the new entries start in a new segment so they stay aligned.
+			write_segment++;
+			write_count = 0;
+		}
+		// the segments before the cursor are deleted before the cursor is moved, so a cursor outside the segments is stale.
+		if(valid && C.segment >= scan.first && C.segment <= scan.last){
+			read_segment = C.segment;
+			read_index = C.index;
+		}
+		else{
+			read_segment = scan.first;
+			read_index = 0;
+		}
+		stats.depth = scan.entries > read_index ? scan.entries - read_index : 0;
+	}
+	readOldest();
+	if(stats.depth){
+		Logger::getInstance().println<LogLevel::Info>("[Spool] ", stats.depth, " records spooled in ", scan.found, " segments");
+	}
+	return SUCCESS;
+}
+
+ERR_Type SampleSpool::writeCursor(){
+	Cursor C = {SPOOL_CURSOR_MAGIC, read_segment, read_index, 0};
+	C.checksum = checksum(&C, offsetof(Cursor, checksum));
+	return __W_SD::getInstance().writeBytes(SPOOL_CURSOR_FILE, 0, (const uint8_t*)&C, sizeof(C));
+}
+
+void SampleSpool::nextSegment(){
+	char path[32];
+	segmentPath(read_segment, path);
+	// deleted before the cursor is written, so a reset in between never leaves a published segment behind the cursor.
+	iStorage* storage = __W_SD::getInstance().getStorage();
+	if(storage && storage->exists(path)){
+		__W_SD::getInstance().deleteFile(path);
+	}
+	read_segment++;
+	read_index = 0;
+	if(read_segment == write_segment){
+		stats.depth = write_count; // resync the depth, it can be off after a segment that ended early.
+	}
+}
+
+void SampleSpool::readOldest(){
+	stats.oldest_epoch = 0;
+	if(!stats.depth){return;}
+	char path[32];
+	segmentPath(read_segment, path);
+	Entry E;
+	size_t read = 0;
+	iStorage* storage = __W_SD::getInstance().getStorage();
+	if(storage && storage->exists(path) && !__W_SD::getInstance().readBytes(path, read_index * sizeof(Entry), (uint8_t*)&E, sizeof(E), read) &&
+		read == sizeof(E) && E.magic == SPOOL_ENTRY_MAGIC){
+		stats.oldest_epoch = E.record.epoch;
+	}
+}
+
+ERR_Type SampleSpool::push(const SampleRecord& record){
+	SD_Lock L;
+	if(!L || !ready()){
+		stats.dropped++;
+		return NOT_INITIALIZED;
+	}
+	if(__W_SD::getInstance().getFreeSpace() < SPOOL_MIN_FREE){
+		stats.dropped++;
+		return SPOOL_FULL;
+	}
+	if(write_count >= SPOOL_SEGMENT_RECORDS){
+		write_segment++;
+		write_count = 0;
+	}
+	if(!write_count && write_segment - read_segment >= SPOOL_MAX_SEGMENTS){
+		// the spool is full, the oldest measurements are dropped to make room for the new ones.
+		uint32_t lost = SPOOL_SEGMENT_RECORDS - read_index;
+		if(lost > stats.depth){lost = stats.depth;}
+		Logger::getInstance().println<LogLevel::Warning>("[Spool] Full, dropping ", lost, " records");
+		stats.dropped += lost;
+		stats.depth -= lost;
+		pending = 0;
+		pending_records = 0;
+		nextSegment();
+		writeCursor();
+		readOldest();
+	}
+
+	Entry E;
+	memset(&E, 0, sizeof(E));
+	E.magic = SPOOL_ENTRY_MAGIC;
+	E.record = record;
+	E.checksum = checksum(&E, offsetof(Entry, checksum));
+	char path[32];
+	segmentPath(write_segment, path);
+	ERR_Type ET = __W_SD::getInstance().appendFile(path, (const uint8_t*)&E, sizeof(E));
+	if(ET){
+		// a partly written entry would shift every entry after it, so the next entry starts a new segment.
+		write_count = SPOOL_SEGMENT_RECORDS;
+		stats.dropped++;
+		return ET;
+	}
+	write_count++;
+	if(!stats.depth){stats.oldest_epoch = record.epoch;}
+	stats.depth++;
+	stats.spooled++;
+	return SUCCESS;
+}
+
+size_t SampleSpool::read(SampleRecord* records, size_t max){
+	pending = 0;
+	pending_records = 0;
+	SD_Lock L;
+	if(!L || !ready()){return 0;}
+	if(max > SPOOL_DRAIN_BURST){max = SPOOL_DRAIN_BURST;}
+
+	Entry entries[SPOOL_DRAIN_BURST];
+	size_t got = 0;
+	while(stats.depth){
+		uint32_t end = read_segment == write_segment ? write_count : SPOOL_SEGMENT_RECORDS;
+		if(read_index >= end){
+			if(read_segment == write_segment){
+				stats.depth = 0; // the count was off, there is nothing after the write position.
+				break;
+			}
+			nextSegment();
+			writeCursor();
+			continue;
+		}
+		char path[32];
+		segmentPath(read_segment, path);
+		iStorage* storage = __W_SD::getInstance().getStorage();
+		if(!storage || !storage->exists(path)){
+			if(read_segment == write_segment){return 0;}
+			nextSegment(); // the segment is gone, for example removed by hand.
+			writeCursor();
+			continue;
+		}
+		size_t n = end - read_index < max ? end - read_index : max;
+		size_t read = 0;
+		if(__W_SD::getInstance().readBytes(path, read_index * sizeof(Entry), (uint8_t*)entries, n * sizeof(Entry), read)){
+			return 0; // try again on the next call, the storage could be busy.
+		}
+		got = read / sizeof(Entry);
+		if(!got){
+			if(read_segment == write_segment){return 0;}
+			nextSegment(); // the segment ended early, after a reset during a write or a failed append.
+			writeCursor();
+			continue;
+		}
+		break;
+	}
+
+	size_t count = 0;
+	for(size_t i = 0; i < got; i++){
+		if(entries[i].magic == SPOOL_ENTRY_MAGIC && entries[i].checksum == checksum(&entries[i], offsetof(Entry, checksum))){
+			records[count] = entries[i].record;
+			pending_ends[count++] = i + 1;
+		}
+		else{
+			stats.corrupt++;
+		}
+	}
+	pending = got;
+	pending_records = count;
+	return count;
+}
+
+ERR_Type SampleSpool::commit(size_t records){
+	if(!pending || !loaded){return SUCCESS;}
+	// the cursor passes the published records and the corrupt entries before them, all entries once every record is out.
+	uint32_t passed = pending;
+	if(records < pending_records){
+		passed = records ? pending_ends[records - 1] : pending_ends[0] - 1;
+	}
+	else{
+		records = pending_records;
+	}
+	if(!passed){
+		pending = 0;
+		pending_records = 0;
+		return SUCCESS;
+	}
+	SD_Lock L;
+	if(!L){return SD_BUSY;} // the records stay pending, they are published again.
+	read_index += passed;
+	stats.depth = stats.depth > passed ? stats.depth - passed : 0;
+	stats.drained += records;
+	pending = 0;
+	pending_records = 0;
+	if(read_segment != write_segment && read_index >= SPOOL_SEGMENT_RECORDS){
+		nextSegment();
+	}
+	ERR_Type ET = writeCursor();
+	readOldest();
+	return ET;
+}
\ No newline at end of file
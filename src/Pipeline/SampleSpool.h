@@ -0,0 +1,173 @@
+/**
+ * @file SampleSpool.h
+ * @author Imre Korf
+ * @brief Persistent queue on the SD card for the records that could not be published.
+ * @version 0.1
+ * @date 2022-03-30
+ *
+ * The records are appended to segment files of SPOOL_SEGMENT_RECORDS fixed size entries:
+ * File | Description
+ * :-----:|:-----------------------------:
+ *  SPOOL_DIR/xxxxxxxx.bin | segment number xxxxxxxx in hex, entries of SPOOL_ENTRY_MAGIC, the SampleRecord and a checksum
+ *  SPOOL_DIR/cursor.dat | SPOOL_CURSOR_MAGIC, the segment and the entry of the oldest record that is not published, and a checksum
+ *
+ * The segments are only appended to, and the cursor is only written after the records before it have been published,
+ * so a reset can at most publish a few records twice. A segment is deleted once the cursor has passed it.
+ * A torn entry at the end of a segment after a reset fails its checksum and is skipped.
+ * push(), read() and commit() hold an SD_Lock for their whole run, so the Logger writer task can't unmount or switch
+ * the storage between the steps of a spool operation.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include "SampleRecord.h"
+#include "../Defines/Defines.h"
+
+/**
+ * @addtogroup DEFINES
+ * @{
+ */
+/** @brief Value of the first 4 bytes of a spool entry ("SPEN"). */
+#define SPOOL_ENTRY_MAGIC 0x4E455053
+/** @brief Value of the first 4 bytes of the cursor file ("SPCR"). */
+#define SPOOL_CURSOR_MAGIC 0x52435053
+/** @} */
+
+/**
+ * @addtogroup STRUCT
+ * @{
+ */
+/**
+ * @brief Counters of the SampleSpool.
+ */
+struct SpoolStats {
+	/** Amount of records in the spool. */
+	uint32_t depth;
+	/** Time in seconds since 1970 of the oldest record in the spool, 0 when the spool is empty. */
+	uint32_t oldest_epoch;
+	/** Amount of records that were added. */
+	uint32_t spooled;
+	/** Amount of records that were published from the spool. */
+	uint32_t drained;
+	/** Amount of records that were dropped, because the spool was full or the storage failed. */
+	uint32_t dropped;
+	/** Amount of entries that were skipped because their checksum did not match. */
+	uint32_t corrupt;
+};
+/**@}*/
+
+/**
+ * @brief Append-only queue of SampleRecords on the storage of __W_SD, with a cursor that survives a reset.
+ * Should only be used by a single task.
+ */
+class SampleSpool {
+private:
+	/**
+	 * @brief A record as it is stored in a segment.
+	 */
+	struct Entry {
+		/** Should be SPOOL_ENTRY_MAGIC. */
+		uint32_t magic;
+		/** The record. */
+		SampleRecord record;
+		/** Checksum of the magic and the record. */
+		uint32_t checksum;
+	};
+	/**
+	 * @brief Content of the cursor file.
+	 */
+	struct Cursor {
+		/** Should be SPOOL_CURSOR_MAGIC. */
+		uint32_t magic;
+		/** Segment of the oldest record. */
+		uint32_t segment;
+		/** Entry in the segment of the oldest record. */
+		uint32_t index;
+		/** Checksum of the other members. */
+		uint32_t checksum;
+	};
+
+	/** Segment of the oldest record. */
+	uint32_t read_segment = 0;
+	/** Entry in the read segment of the oldest record. */
+	uint32_t read_index = 0;
+	/** Segment to which the records are appended. */
+	uint32_t write_segment = 0;
+	/** Amount of entries in the write segment. */
+	uint32_t write_count = 0;
+	/** Amount of entries that were passed by the last read(), the cursor moves past them on commit(). */
+	uint32_t pending = 0;
+	/** Amount of valid records that were returned by the last read(). */
+	uint32_t pending_records = 0;
+	/** Per record returned by the last read(), the amount of entries up to and including its own. */
+	uint16_t pending_ends[SPOOL_DRAIN_BURST];
+	/** Mount count of __W_SD when the spool was loaded, the spool is loaded again when the storage changes. */
+	uint32_t mount = 0;
+	/** True when the spool has been loaded from the current storage. */
+	bool loaded = false;
+	/** The counters. */
+	SpoolStats stats = {0, 0, 0, 0, 0, 0};
+
+	/** @brief Checksum of a block of bytes (FNV-1a). */
+	static uint32_t checksum(const void* data, size_t len);
+	/** @brief Writes the path of a segment file into a buffer of at least 32 bytes. */
+	static void segmentPath(uint32_t segment, char* path);
+
+	/** @brief Loads the spool when the storage has changed, returns false when there is no storage. */
+	bool ready();
+	/** @brief Finds the segments and reads the cursor. */
+	ERR_Type load();
+	/** @brief Writes the cursor file. */
+	ERR_Type writeCursor();
+	/** @brief Deletes the read segment and moves the cursor to the start of the next segment. */
+	void nextSegment();
+	/** @brief Reads the epoch of the oldest record into the stats. */
+	void readOldest();
+
+public:
+	/**
+	 * @brief Appends a record to the spool.
+	 * When the spool already has SPOOL_MAX_SEGMENTS segments the oldest segment is dropped.
+	 *
+	 * @param record the record.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 * @see ERR_Type
+	 */
+	ERR_Type push(const SampleRecord& record);
+
+	/**
+	 * @brief Reads the oldest records without removing them, call commit() once they have been published.
+	 * Only reads from a single segment, so it can return less than max records while more are spooled.
+	 *
+	 * @param records buffer for the records.
+	 * @param max the amount of records that fit in the buffer.
+	 * @return size_t the amount of records that were read. Can be 0 when only corrupt entries were found,
+	 * commit() should then still be called to skip them.
+	 */
+	size_t read(SampleRecord* records, size_t max);
+
+	/**
+	 * @brief Removes the records returned by the last read() and stores the new cursor.
+	 *
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 * @see ERR_Type
+	 */
+	ERR_Type commit(){ return commit(pending_records); }
+	/**
+	 * @brief Removes the first records returned by the last read() and stores the new cursor.
+	 * The other records stay in the spool and are returned again by the next read().
+	 *
+	 * @param records the amount of records that have been published.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 * @see ERR_Type
+	 */
+	ERR_Type commit(size_t records);
+
+	/** @brief Returns the amount of records in the spool. */
+	uint32_t depth() const { return stats.depth; }
+
+	/** @brief Returns the counters of the spool. */
+	SpoolStats getStats() const { return stats; }
+};
\ No newline at end of file
@@ -1,11 +1,11 @@
 #include "Sbox.h"
 #include "../Logger/Logger.h"
 
-#include <Wire.h>
+#include "../Wrappers/I2C/I2CBus.h"
 
 ERR_Type SBox::init(){
-	// start Wire
-	Wire.begin();
+	// start the I2C bus, when the RTC has not done so already.
+	I2CBus::getInstance().begin();
 
 	// get a handle to the singletons
 	Ambimate = &__W_Ambimate::getInstance();
@@ -17,52 +17,76 @@ ERR_Type SBox::init(){
 	TSL2591  = &__W_TSL2591::getInstance();
 	RTC		 = &__W_RTC::getInstance();
 
-	// store all the handles as a base module for easy initialisation
+	// store all the handles as a base module for easy initialisation, in the order of SBoxSensor.
 	__iW_Module* Modules[] = {Ambimate, AS7262, LDS, MAX4466, MIX8410, SCD30, TSL2591};
+	static const uint32_t Periods[] = {SBOX_PERIOD_AMBIMATE, SBOX_PERIOD_AS7262, SBOX_PERIOD_LDS, SBOX_PERIOD_MAX4466, SBOX_PERIOD_MIX8410, SBOX_PERIOD_SCD30, SBOX_PERIOD_TSL2591};
 
-	for(int i = 0; i < 7; i++){
+	for(int i = 0; i < (int)SBoxSensor::Count; i++){
 		// initialize all the hardware modules.
 		if(Modules[i]->init()){
-			Logger::getInstance().println("Module [" + String(i) + "] was not properly intialized. Exiting...", LogLevel::Error);
+			Logger::getInstance().println<LogLevel::Error>("Module [", i, "] was not properly intialized. Exiting...");
 			//return MOD_INIT_ERR;
+			continue; // only the working modules are measured.
 		}
+		scheduler.add(*Modules[i], i, Periods[i], SBOX_TIMEOUT);
 	}
 
 	return SUCCESS;
 }
 
+/**
+ * @brief Callback of the SBox, is passed to the scheduler as context.
+ */
+struct SBoxCallback {
+	SBox_Callback cb;
+	void* context;
+};
+
+// forward a measurement of the scheduler to the callback of the SBox.
+static void schedulerCallback(uint8_t id, ERR_Type ET, void* context){
+	SBoxCallback* CB = (SBoxCallback*)context;
+	CB->cb((SBoxSensor)id, ET, CB->context);
+}
+
+void SBox::setCallback(SBox_Callback cb, void* context){
+	static SBoxCallback CB;
+	CB.cb = cb;
+	CB.context = context;
+	scheduler.setCallback(cb ? schedulerCallback : nullptr, &CB);
+}
+
 RTC_DATE_TIME SBox::getTime(){
 	return RTC->read();
 }
 
 AmbimateData SBox::getAmbimateData(){
-	return Ambimate->read();
+	return Ambimate->getData();
 }
 
 ERR_Type SBox::getColorSpectrum(ColorSpectrum& CS){
-	if(AS7262->checkDataReady()){
-		AS7262->getMeasurements(&CS);
-		return SUCCESS;
-	}
-	return AS726X_DATA_NOT_READY;
+	AS726X_Sample sample = AS7262->getSample();
+	if(!sample.time){return AS726X_DATA_NOT_READY;}
+	CS = sample.spectrum;
+	return SUCCESS;
 }
 
 ERR_Type SBox::getLDSData(PM25_AQI_Data& Buffer){
-	return LDS->read(Buffer);
+	Buffer = LDS->getData();
+	return SUCCESS;
 }
 
-int SBox::getMax4466(){
-	return MAX4466->read();
+AudioSummary SBox::getMax4466(){
+	return MAX4466->getData();
 }
 
 float SBox::getO2(){
-	return MIX8410->readConcentration();
+	return MIX8410->getData();
 }
 
 SCD30_DATA SBox::getSCD30Data(){
-	return SCD30->read();
+	return SCD30->getData();
 }
 
 TSL2591_DATA SBox::getTSL2591Data(){
-	return TSL2591->getFullLuminosity();
+	return TSL2591->getData();
 }
\ No newline at end of file
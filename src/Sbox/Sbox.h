@@ -46,12 +46,49 @@ Dust
 #include "../Wrappers/Sensors/SCD30/__W_SCD30.h"
 #include "../Wrappers/Sensors/TSL2591/__W_TSL2591.h"
 #include "../Wrappers/RTC/__W_RTC.h"
+#include "../Scheduler/Scheduler.h"
+
+/**
+ * @brief Ids of the sensors in the scheduler of the SBox.
+ */
+enum class SBoxSensor : uint8_t {
+	Ambimate,
+	AS7262,
+	LDS,
+	MAX4466,
+	MIX8410,
+	SCD30,
+	TSL2591,
+	Count
+};
+
+/**
+ * @brief Clock of the ESP32, used by the scheduler of the SBox.
+ */
+class MillisClock : public iClock {
+public:
+	virtual uint32_t now(){ return millis(); }
+};
+
+/**
+ * @brief Callback that is called after every measurement of the SBox.
+ * @param sensor the measured sensor.
+ * @param ET SUCCESS when the new data can be read with the getters of the SBox, else the error of the measurement.
+ * @param context the context pointer given to SBox::setCallback().
+ */
+typedef void (*SBox_Callback)(SBoxSensor sensor, ERR_Type ET, void* context);
 
 /**
  * @brief SBox class containing handles to every sensor on the PCB. 
+ * The sensors are measured by a cooperative scheduler, every sensor with its own period.
+ * Call poll() from the loop, the getters return the last collected data without accessing the hardware.
  */
 class SBox {
 private:
+	/** Clock of the scheduler. */
+	MillisClock clock;
+	/** Scheduler that runs the measurements. */
+	Scheduler scheduler;
 
 	/** Ambimate Handle. */
 	__W_Ambimate 	*Ambimate;
@@ -71,6 +108,8 @@ private:
 	__W_RTC			*RTC;
 
 public:
+	SBox() : scheduler(clock) {}
+
 	/**
 	 * @brief Initializes the SBox object. Should only be called once.
 	 * This function initializes the SBox object. It has a check build in to see if this function has already been called before. If so it will just return 0.
@@ -79,6 +118,27 @@ public:
 	 */
 	ERR_Type init();
 
+	/**
+	 * @brief Runs the measurement steps that are due, never waits on a sensor.
+	 * 
+	 * @return uint32_t the time in ms until the next step is due.
+	 */
+	uint32_t poll(){ return scheduler.poll(); }
+	/**
+	 * @brief Sets the function that is called after every measurement.
+	 * 
+	 * @param cb the callback, is called from poll().
+	 * @param context pointer that is passed to the callback.
+	 */
+	void setCallback(SBox_Callback cb, void* context);
+	/**
+	 * @brief Returns the scheduler counters of a sensor.
+	 * 
+	 * @param sensor the sensor.
+	 * @return const SchedulerStats* the counters, nullptr when the sensor is not scheduled.
+	 */
+	const SchedulerStats* getStats(SBoxSensor sensor){ return scheduler.getStats((uint8_t)sensor); }
+
 	/**
 	 * @brief Get the a date_time struct.
 	 * 
@@ -87,21 +147,21 @@ public:
 	RTC_DATE_TIME getTime();
 
 	/**
-	 * @brief Get the Ambimate Data.
+	 * @brief Get the Ambimate Data of the last measurement.
 	 * 
 	 * @return AmbimateData struct containing the read ambimate data.
 	 */
 	AmbimateData getAmbimateData();
 	/**
-	 * @brief Get the Color Spectrum data.
+	 * @brief Get the Color Spectrum data of the last measurement.
 	 * 
 	 * @param CS ColorSpectrum struct buffer.
-	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. AS726X_DATA_NOT_READY when no spectrum has been collected yet.
 	 * @see ERR_Type
 	 */
 	ERR_Type	 getColorSpectrum(ColorSpectrum& CS);
 	/**
-	 * @brief Get the Laser Dust Sensor data.
+	 * @brief Get the Laser Dust Sensor data of the last measurement.
 	 * 
 	 * @param Buffer PM25_AQI_Data struct buffer.
 	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
@@ -109,25 +169,25 @@ public:
 	 */
 	ERR_Type 	getLDSData(PM25_AQI_Data& Buffer);
 	/**
-	 * @brief Get the Max4466 data.
+	 * @brief Get the Max4466 sound levels of the last measurement.
 	 * 
-	 * @return int ADC value of the Max4466 data.
+	 * @return AudioSummary the levels of the audio since the measurement before it.
 	 */
-	int 		 getMax4466();
+	AudioSummary getMax4466();
 	/**
-	 * @brief Get the O2 value.
+	 * @brief Get the O2 value of the last measurement.
 	 * 
 	 * @return float the read O2 value.
 	 */
 	float 		 getO2();
 	/**
-	 * @brief Get the SCD30 data.
+	 * @brief Get the SCD30 data of the last measurement.
 	 * 
 	 * @return SCD30_DATA struct containing the read SCD30 data.
 	 */
 	SCD30_DATA	 getSCD30Data();
 	/**
-	 * @brief Get the TSL2591 data.
+	 * @brief Get the TSL2591 data of the last measurement.
 	 * 
 	 * @return TSL2591_DATA struct containing the TSL2591 data.
 	 */
@@ -0,0 +1,77 @@
+#include "Scheduler.h"
+
+ERR_Type Scheduler::add(iTask& task, uint8_t id, uint32_t period, uint32_t timeout){
+	if(count >= SCHEDULER_MAX_TASKS){return ERROR;}
+	Entry& E = entries[count++];
+	E.task = &task;
+	E.id = id;
+	E.period = period ? period : 1;
+	E.timeout = timeout;
+	E.next_start = clock.now();
+	E.started = 0;
+	E.running = false;
+	E.stats = SchedulerStats();
+	return SUCCESS;
+}
+
+void Scheduler::finish(Entry& E, uint32_t now, ERR_Type ET){
+	E.running = false;
+	E.next_start += E.period;
+	// keep the phase of the task, but skip the starts that have already passed, a late start is not followed by a second one.
+	if((int32_t)(now - E.next_start) > 0){
+		uint32_t missed = (now - E.next_start - 1) / E.period + 1;
+		E.stats.skipped += missed;
+		E.next_start += missed * E.period;
+	}
+	if(callback){
+		callback(E.id, ET, callback_context);
+	}
+}
+
+uint32_t Scheduler::poll(){
+	uint32_t wait = SCHEDULER_POLL_INTERVAL;
+	for(size_t i = 0; i < count; i++){
+		Entry& E = entries[i];
+		// every step reads the clock again, so the time spent in the earlier tasks is taken into account.
+		uint32_t now = clock.now();
+		if(!E.running && (int32_t)(E.next_start - now) <= 0){
+			uint32_t late = now - E.next_start;
+			if(late > E.stats.max_late){E.stats.max_late = late;}
+			ERR_Type ET = E.task->start(now);
+			if(ET){
+				E.stats.errors++;
+				finish(E, now, ET);
+			}
+			else{
+				E.running = true;
+				E.started = now;
+			}
+		}
+		if(E.running){
+			if(E.task->ready(now)){
+				ERR_Type ET = E.task->collect(now);
+				if(ET){E.stats.errors++;}
+				else{E.stats.runs++;}
+				finish(E, now, ET);
+			}
+			else if(now - E.started >= E.timeout){
+				E.stats.timeouts++;
+				finish(E, now, READ_FAIL);
+			}
+			else{
+				continue; // check again after at most SCHEDULER_POLL_INTERVAL.
+			}
+		}
+		int32_t until = (int32_t)(E.next_start - now);
+		if(until <= 0){wait = 0;}
+		else if((uint32_t)until < wait){wait = until;}
+	}
+	return wait;
+}
+
+const SchedulerStats* Scheduler::getStats(uint8_t id) const {
+	for(size_t i = 0; i < count; i++){
+		if(entries[i].id == id){return &entries[i].stats;}
+	}
+	return nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,189 @@
+/**
+ * @file Scheduler.h
+ * @author Imre Korf
+ * @brief Cooperative scheduler that runs every sensor as a resumable measurement task.
+ * @version 0.1
+ * @date 2022-03-14
+ *
+ * A measurement is split into three steps that each return without waiting on the hardware:
+ * Step | Description
+ * :-----:|:-----------------------------:
+ *  start | starts a measurement, for example sends a trigger command
+ *  ready | checks if the result can be read, for example a data ready flag or the conversion time
+ *  collect | reads the result and stores it in the module
+ *
+ * The scheduler only calls collect when ready returns true, so a slow sensor never delays the other sensors.
+ * The time is read from an iClock, so the scheduler can run on a host with a VirtualClock.
+ * This file only uses the standard library.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../Defines/Defines.h"
+
+/**
+ * @brief Time source of the scheduler.
+ */
+class iClock {
+public:
+	virtual ~iClock(){}
+	/** @brief Returns the time in ms, may wrap around. */
+	virtual uint32_t now() = 0;
+};
+
+/**
+ * @brief Clock that only moves when it is told to, used to run the scheduler on a host.
+ */
+class VirtualClock : public iClock {
+private:
+	/** The current time in ms. */
+	uint32_t time = 0;
+
+public:
+	virtual uint32_t now(){ return time; }
+	/** @brief Moves the clock forward by the given amount of ms. */
+	void advance(uint32_t ms){ time += ms; }
+	/** @brief Sets the clock to the given time in ms. */
+	void set(uint32_t ms){ time = ms; }
+};
+
+/**
+ * @brief A measurement that can be run by the Scheduler.
+ * None of the functions should wait on the hardware.
+ */
+class iTask {
+public:
+	virtual ~iTask(){}
+	/**
+	 * @brief Starts a new measurement.
+	 * @param now the time in ms of the scheduler clock.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code and the measurement is skipped.
+	 */
+	virtual ERR_Type start(uint32_t now){ (void)now; return SUCCESS; }
+	/**
+	 * @brief Checks if the started measurement can be collected.
+	 * @param now the time in ms of the scheduler clock.
+	 * @return true the result is available.
+	 * @return false the measurement is still running.
+	 */
+	virtual bool ready(uint32_t now){ (void)now; return true; }
+	/**
+	 * @brief Reads the result of the measurement.
+	 * @param now the time in ms of the scheduler clock.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 */
+	virtual ERR_Type collect(uint32_t now){ (void)now; return SUCCESS; }
+};
+
+/**
+ * @addtogroup STRUCT
+ * @{
+ */
+/**
+ * @brief Counters of a scheduled task.
+ */
+struct SchedulerStats {
+	/** Amount of collected measurements. */
+	uint32_t runs;
+	/** Amount of measurements that failed to start or collect. */
+	uint32_t errors;
+	/** Amount of measurements that were not ready within the timeout. */
+	uint32_t timeouts;
+	/** Amount of starts that were skipped because their time had passed when the previous measurement finished. */
+	uint32_t skipped;
+	/** Highest delay in ms between the planned and the actual start of a measurement. */
+	uint32_t max_late;
+};
+/**@}*/
+
+/**
+ * @brief Callback that is called after every measurement.
+ * @param id the id that was given to Scheduler::add().
+ * @param ET the result of the measurement, SUCCESS when it has been collected.
+ * @param context the context pointer given to Scheduler::setCallback().
+ */
+typedef void (*Scheduler_Callback)(uint8_t id, ERR_Type ET, void* context);
+
+/**
+ * @brief Runs the measurements of multiple tasks, each with its own period.
+ */
+class Scheduler {
+private:
+	/**
+	 * @brief A scheduled task.
+	 */
+	struct Entry {
+		/** The task. */
+		iTask* task;
+		/** Id passed to the callback. */
+		uint8_t id;
+		/** Time in ms between the starts of two measurements. */
+		uint32_t period;
+		/** Time in ms after which a measurement that is not ready is given up. */
+		uint32_t timeout;
+		/** Planned time of the next start. */
+		uint32_t next_start;
+		/** Time of the start of the running measurement. */
+		uint32_t started;
+		/** True while a measurement is running. */
+		bool running;
+		/** Counters of the task. */
+		SchedulerStats stats;
+	};
+
+	/** The clock of the scheduler. */
+	iClock& clock;
+	/** The scheduled tasks. */
+	Entry entries[SCHEDULER_MAX_TASKS];
+	/** Amount of scheduled tasks. */
+	size_t count = 0;
+	/** Called after every measurement. */
+	Scheduler_Callback callback = nullptr;
+	/** Context pointer of the callback. */
+	void* callback_context = nullptr;
+
+	/** @brief Finishes the running measurement of an entry and plans the next one. */
+	void finish(Entry& E, uint32_t now, ERR_Type ET);
+
+public:
+	/**
+	 * @brief Creates a scheduler without tasks.
+	 * @param clock the time source of the scheduler.
+	 */
+	Scheduler(iClock& clock) : clock(clock) {}
+
+	/**
+	 * @brief Adds a task, the first measurement is started by the next poll().
+	 * @param task the task.
+	 * @param id id that is passed to the callback.
+	 * @param period time in ms between the starts of two measurements.
+	 * @param timeout time in ms after which a measurement that is not ready is given up.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 * @see ERR_Type
+	 */
+	ERR_Type add(iTask& task, uint8_t id, uint32_t period, uint32_t timeout);
+
+	/**
+	 * @brief Sets the function that is called after every measurement.
+	 * @param cb the callback.
+	 * @param context pointer that is passed to the callback.
+	 */
+	void setCallback(Scheduler_Callback cb, void* context){ callback = cb; callback_context = context; }
+
+	/**
+	 * @brief Runs every step that is due, each task at most one step per call.
+	 * @return uint32_t the time in ms until the next step is due, at most SCHEDULER_POLL_INTERVAL.
+	 */
+	uint32_t poll();
+
+	/**
+	 * @brief Returns the counters of a task.
+	 * @param id the id that was given to add().
+	 * @return const SchedulerStats* the counters, nullptr when there is no task with this id.
+	 */
+	const SchedulerStats* getStats(uint8_t id) const;
+};
\ No newline at end of file
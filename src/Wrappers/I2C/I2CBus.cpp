@@ -0,0 +1,179 @@
+#include "I2CBus.h"
+#include "../../Logger/Logger.h"
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <esp_timer.h>
+
+const I2CBus::DeviceConfig I2CBus::Devices[(size_t)I2CDevice::Count] = {
+	{0x2A,				I2C_CLOCK_AMBIMATE,	I2C_TIMEOUT,		"Ambimate"},
+	{0x49,				I2C_CLOCK_AS7262,	I2C_TIMEOUT,		"AS7262"},
+	{0x61,				I2C_CLOCK_SCD30,	I2C_TIMEOUT_SCD30,	"SCD30"},
+	{0x29,				I2C_CLOCK_TSL2591,	I2C_TIMEOUT,		"TSL2591"},
+	{RTC_I2C_ADDRESS,	I2C_CLOCK_RTC,		I2C_TIMEOUT,		"RTC"},
+};
+
+I2CBus::I2CBus(){
+	for(size_t i = 0; i < (size_t)I2CDevice::Count; i++){
+		stats[i] = I2CStats();
+	}
+}
+
+ERR_Type I2CBus::begin(){
+	if(lock){return SUCCESS;} // already started, the RTC starts the bus before the SBox does.
+	lock = xSemaphoreCreateRecursiveMutex();
+	pinMode(I2C_SDA_PIN, INPUT_PULLUP);
+	if(!digitalRead(I2C_SDA_PIN)){
+		// a device was reset in the middle of a transfer and still holds SDA low.
+		Logger::getInstance().println<LogLevel::Warning>("I2C SDA is held low, clearing the bus.");
+		return recover();
+	}
+	Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
+	clock = 0;
+	timeout = 0;
+	return SUCCESS;
+}
+
+void I2CBus::configure(I2CDevice device){
+	const DeviceConfig& D = Devices[(size_t)device];
+	if(D.clock != clock){
+		Wire.setClock(D.clock);
+		clock = D.clock;
+	}
+	if(D.timeout != timeout){
+		Wire.setTimeOut(D.timeout);
+		timeout = D.timeout;
+	}
+}
+
+bool I2CBus::lastTransferOk(){
+	uint8_t error = Wire.lastError();
+	return error == I2C_ERROR_OK || error == I2C_ERROR_CONTINUE;
+}
+
+void I2CBus::reconfigure(){
+	clock = 0;
+	timeout = 0;
+	if(depth){configure(frames[depth - 1].device);}
+}
+
+bool I2CBus::acquire(I2CDevice device){
+	if(!lock){begin();}
+	if(!xSemaphoreTakeRecursive(lock, pdMS_TO_TICKS(I2C_LOCK_TIMEOUT))){
+		return false;
+	}
+	if(depth >= sizeof(frames) / sizeof(frames[0])){
+		xSemaphoreGiveRecursive(lock);
+		return false;
+	}
+	frames[depth].device = device;
+	frames[depth].start = esp_timer_get_time();
+	frames[depth].ok = true;
+	depth++;
+	configure(device);
+	return true;
+}
+
+void I2CBus::release(I2CDevice device, bool ok){
+	(void)device;
+	depth--;
+	const Frame& F = frames[depth];
+	ok = ok && F.ok;
+	if(depth && frames[depth - 1].device == F.device){
+		// part of the outer transaction, which is counted on its release.
+		if(!ok){frames[depth - 1].ok = false;}
+	}
+	else{
+		uint32_t us = (uint32_t)(esp_timer_get_time() - F.start);
+		I2CStats& S = stats[(size_t)F.device];
+		S.transactions++;
+		S.total_us += us;
+		if(us > S.max_us){S.max_us = us;}
+		if(ok){
+			failures = 0;
+		}
+		else{
+			S.errors++;
+			failures++;
+		}
+	}
+	if(depth){
+		configure(frames[depth - 1].device); // back to the device of the outer transaction.
+	}
+	else if(failures >= I2C_RECOVER_ERRORS){
+		failures = 0;
+		recover();
+	}
+	xSemaphoreGiveRecursive(lock);
+}
+
+ERR_Type I2CBus::write(I2CDevice device, const uint8_t* data, size_t length, bool stop){
+	if(!acquire(device)){return I2C_BUS_BUSY;}
+	Wire.beginTransmission(Devices[(size_t)device].address);
+	Wire.write(data, length);
+	bool ok = !Wire.endTransmission(stop);
+	release(device, ok);
+	return ok ? SUCCESS : READ_FAIL;
+}
+
+ERR_Type I2CBus::read(I2CDevice device, uint8_t* buffer, size_t length){
+	if(!acquire(device)){return I2C_BUS_BUSY;}
+	size_t received = Wire.requestFrom(Devices[(size_t)device].address, (uint8_t)length);
+	// never read more than was asked for, whatever the device sent.
+	size_t i = 0;
+	for(; i < length && Wire.available(); i++){
+		buffer[i] = Wire.read();
+	}
+	bool ok = received == length && i == length;
+	release(device, ok);
+	return ok ? SUCCESS : READ_FAIL;
+}
+
+ERR_Type I2CBus::writeRead(I2CDevice device, const uint8_t* data, size_t length, uint8_t* buffer, size_t answer, bool repeated_start){
+	if(!acquire(device)){return I2C_BUS_BUSY;}
+	ERR_Type ET = write(device, data, length, !repeated_start);
+	if(!ET){ET = read(device, buffer, answer);}
+	release(device, !ET);
+	return ET;
+}
+
+ERR_Type I2CBus::recover(){
+	Wire.end();
+	// clock out the byte a device is still sending, it releases SDA at the end of it.
+	pinMode(I2C_SDA_PIN, INPUT_PULLUP);
+	pinMode(I2C_SCL_PIN, OUTPUT_OPEN_DRAIN);
+	digitalWrite(I2C_SCL_PIN, HIGH);
+	for(int i = 0; i < 9 && !digitalRead(I2C_SDA_PIN); i++){
+		digitalWrite(I2C_SCL_PIN, LOW);
+		delayMicroseconds(5);
+		digitalWrite(I2C_SCL_PIN, HIGH);
+		delayMicroseconds(5);
+	}
+	// a stop, SDA rising while SCL is high, ends the transfer for every device.
+	pinMode(I2C_SDA_PIN, OUTPUT_OPEN_DRAIN);
+	digitalWrite(I2C_SDA_PIN, LOW);
+	delayMicroseconds(5);
+	digitalWrite(I2C_SDA_PIN, HIGH);
+	delayMicroseconds(5);
+	pinMode(I2C_SDA_PIN, INPUT_PULLUP);
+	bool released = digitalRead(I2C_SDA_PIN);
+
+	Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
+	reconfigure();
+	recoveries++;
+	if(!released){
+		Logger::getInstance().println<LogLevel::Error>("I2C SDA is still held low after clearing the bus.");
+		return I2C_BUS_STUCK;
+	}
+	Logger::getInstance().println<LogLevel::Warning>("I2C bus cleared.");
+	return SUCCESS;
+}
+
+I2CStats I2CBus::getStats(I2CDevice device){
+	I2CStats S = I2CStats();
+	if(lock && xSemaphoreTakeRecursive(lock, pdMS_TO_TICKS(I2C_LOCK_TIMEOUT))){
+		S = stats[(size_t)device];
+		xSemaphoreGiveRecursive(lock);
+	}
+	return S;
+}
\ No newline at end of file
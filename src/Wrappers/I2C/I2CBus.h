@@ -0,0 +1,262 @@
+/**
+ * @file I2CBus.h
+ * @author Imre Korf
+ * @brief Manager of the I2C bus shared by the Ambimate, AS7262, SCD30, TSL2591 and the RTC.
+ * @version 0.1
+ * @date 2022-03-24
+ *
+ * Every access to a device, also through a library, is done between acquire() and release(), mostly with an I2CTransaction:
+ * Step | Description
+ * :-----:|:-----------------------------:
+ *  lock | a recursive mutex keeps the tasks from interleaving their transfers, a task waits at most I2C_LOCK_TIMEOUT
+ *  clock | the clock and transaction timeout of the device are set, only when they differ from the previous device
+ *  count | the time between acquire and release and the result are added to the counters of the device,
+ *   | a transaction nested in one of the same device, like the write of a writeRead(), is counted with the outer one
+ *  recover | after I2C_RECOVER_ERRORS failures in a row SCL is toggled until the device that holds SDA low lets go
+ *
+ * The libraries don't return the result of most of their transfers, so after a library call the wrapper passes the
+ * error of the last Wire transfer to I2CTransaction::checkLast(). Only the last transfer of a call is seen that way,
+ * a failed transfer that a library follows with a successful one is not counted.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include "../Singleton/Singleton.h"
+#include "../../Defines/Defines.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+/**
+ * @addtogroup ENUM
+ * @{
+ */
+/**
+ * @brief The devices on the I2C bus.
+ */
+enum class I2CDevice : uint8_t {
+	Ambimate,
+	AS7262,
+	SCD30,
+	TSL2591,
+	RTC,
+	/** Amount of devices. */
+	Count
+};
+/**@}*/
+
+/**
+ * @addtogroup STRUCT
+ * @{
+ */
+/**
+ * @brief Counters of a device on the I2C bus.
+ */
+struct I2CStats {
+	/** Amount of transactions. */
+	uint32_t transactions;
+	/** Amount of failed transactions. */
+	uint32_t errors;
+	/** Sum of the transaction times in us. */
+	uint64_t total_us;
+	/** Longest transaction time in us. */
+	uint32_t max_us;
+};
+/**@}*/
+
+/**
+ * @brief Singleton I2C bus manager.
+ */
+class I2CBus : public iSingleton {
+private:
+	/** @brief Settings of a device. */
+	struct DeviceConfig {
+		/** 7 bit address. */
+		uint8_t address;
+		/** Clock in Hz. */
+		uint32_t clock;
+		/** Transaction timeout in ms. */
+		uint16_t timeout;
+		/** Name for the log. */
+		const char* name;
+	};
+	/** @brief The settings of every device, in the order of I2CDevice. */
+	static const DeviceConfig Devices[(size_t)I2CDevice::Count];
+
+	/** @brief A transaction that has been acquired, the transactions of a task can be nested. */
+	struct Frame {
+		/** The device. */
+		I2CDevice device;
+		/** Time in us of the acquire. */
+		int64_t start;
+		/** False once a nested transaction of the same device failed. */
+		bool ok;
+	};
+	/** @brief The acquired transactions, from the outermost on. */
+	Frame frames[4];
+	/** @brief Amount of acquired transactions. */
+	uint8_t depth = 0;
+
+	/** @brief Recursive mutex of the bus. */
+	SemaphoreHandle_t lock = nullptr;
+	/** @brief The clock that is set, 0 when unknown. */
+	uint32_t clock = 0;
+	/** @brief The transaction timeout that is set, 0 when unknown. */
+	uint16_t timeout = 0;
+	/** @brief Amount of failed transactions in a row. */
+	uint8_t failures = 0;
+	/** @brief Amount of bus clears. */
+	uint32_t recoveries = 0;
+	/** @brief Counters of every device. */
+	I2CStats stats[(size_t)I2CDevice::Count];
+
+	/** @brief Sets the clock and timeout of a device. */
+	void configure(I2CDevice device);
+
+	// remove access to the constructor of I2CBus.
+	I2CBus();
+public:
+	/**
+	 * @brief Get the singleton instance of the class
+	 * This function makes sure that only one instance is created and accessible during runtime.
+	 * @return I2CBus& the handle to the singleton instance
+	 */
+	static I2CBus& getInstance(){
+		static I2CBus Instance;	// will only be destroyed on program exit.
+		return Instance;
+	}
+	// Assure that only one instance can exist by removing copy and assign functions.
+	I2CBus(I2CBus const&)			= delete;	// delete copy constructor.
+	void operator=(I2CBus const&)	= delete;	// remove assignment operator.
+
+	/**
+	 * @brief Starts the bus, clears it first when SDA is held low. Can be called more than once.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 */
+	ERR_Type begin();
+
+	/**
+	 * @brief Locks the bus for a device and sets its clock, should be followed by release().
+	 * @param device the device.
+	 * @return true the bus is locked.
+	 * @return false the bus was not released by another task within I2C_LOCK_TIMEOUT.
+	 */
+	bool acquire(I2CDevice device);
+	/**
+	 * @brief Counts the transaction and releases the bus.
+	 * @param device the device of the matching acquire().
+	 * @param ok false when the transaction failed.
+	 */
+	void release(I2CDevice device, bool ok);
+
+	/**
+	 * @brief Writes bytes to a device.
+	 * @param device the device.
+	 * @param data the bytes.
+	 * @param length amount of bytes.
+	 * @param stop false to keep the bus for a repeated start.
+	 * @return ERR_Type returns SUCCESS on succesfull exit, READ_FAIL when the device did not acknowledge. Else it will return an error code.
+	 */
+	ERR_Type write(I2CDevice device, const uint8_t* data, size_t length, bool stop = true);
+	/**
+	 * @brief Reads exactly length bytes from a device.
+	 * @param device the device.
+	 * @param buffer buffer of at least length bytes.
+	 * @param length amount of bytes.
+	 * @return ERR_Type returns SUCCESS on succesfull exit, READ_FAIL when less bytes were received. Else it will return an error code.
+	 */
+	ERR_Type read(I2CDevice device, uint8_t* buffer, size_t length);
+	/**
+	 * @brief Writes a command or register address and reads the answer, in one locked transaction.
+	 * @param device the device.
+	 * @param data the bytes to write.
+	 * @param length amount of bytes to write.
+	 * @param buffer buffer for the answer.
+	 * @param answer amount of bytes to read.
+	 * @param repeated_start true to read after a repeated start, false to stop after the write.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 */
+	ERR_Type writeRead(I2CDevice device, const uint8_t* data, size_t length, uint8_t* buffer, size_t answer, bool repeated_start = false);
+
+	/**
+	 * @brief Returns true when the last transfer on Wire succeeded, also when it was done by a library.
+	 * A write that keeps the bus for a repeated start counts as succeeded.
+	 */
+	bool lastTransferOk();
+
+	/**
+	 * @brief Sets the clock and timeout of the current device again, after a library has restarted Wire in its begin().
+	 * Should be called while the bus is acquired.
+	 */
+	void reconfigure();
+
+	/**
+	 * @brief Clears the bus by toggling SCL until SDA is released and sending a stop, then restarts the bus.
+	 * @return ERR_Type returns SUCCESS on succesfull exit, I2C_BUS_STUCK when SDA is still low.
+	 */
+	ERR_Type recover();
+
+	/**
+	 * @brief Returns the counters of a device.
+	 * @param device the device.
+	 * @return I2CStats a copy of the counters.
+	 */
+	I2CStats getStats(I2CDevice device);
+	/** @brief Returns the amount of bus clears. */
+	uint32_t getRecoveries(){ return recoveries; }
+	/** @brief Returns the name of a device. */
+	static const char* getName(I2CDevice device){ return Devices[(size_t)device].name; }
+};
+
+/**
+ * @brief Holds the I2C bus for a device during its scope, for the transfers that are done by a library.
+ */
+class I2CTransaction {
+private:
+	/** The device. */
+	I2CDevice device;
+	/** True when the bus has been acquired. */
+	bool locked;
+	/** False once a transfer failed. */
+	bool ok = true;
+public:
+	/** @brief Acquires the bus for the device. */
+	explicit I2CTransaction(I2CDevice device) : device(device), locked(I2CBus::getInstance().acquire(device)) {}
+	/** @brief Releases the bus. */
+	~I2CTransaction(){ if(locked){I2CBus::getInstance().release(device, ok);} }
+	I2CTransaction(I2CTransaction const&)	= delete;
+	void operator=(I2CTransaction const&)	= delete;
+
+	/** @brief True when the bus has been acquired. */
+	explicit operator bool() const { return locked; }
+	/**
+	 * @brief Marks the transaction as failed when a result is false.
+	 * @param result the result of a transfer.
+	 * @return bool the result.
+	 */
+	bool check(bool result){
+		if(!result){ok = false;}
+		return result;
+	}
+	/**
+	 * @brief Marks the transaction as failed when the last transfer of a library call failed.
+	 * @return bool true when the transfer succeeded.
+	 */
+	bool checkLast(){
+		return check(I2CBus::getInstance().lastTransferOk());
+	}
+	/**
+	 * @brief Marks the transaction as failed when the last transfer of a library call failed.
+	 * @param value the value that the library returned.
+	 * @return V the value.
+	 */
+	template<typename V>
+	V checkLast(V value){
+		checkLast();
+		return value;
+	}
+};
\ No newline at end of file
@@ -1,15 +1,45 @@
 #include "__W_RTC.h"
 
-#include <Wire.h>
+#include "../I2C/I2CBus.h"
 #include <Arduino.h>
+#include <esp_timer.h>
 #include "../../Logger/Logger.h"
+#include "../../Defines/Defines.h"
+
+// convert a BCD register value to a number.
+static uint8_t fromBCD(uint8_t val){
+	return (val >> 4) * 10 + (val & 0x0F);
+}
+
+// days since 1970-01-01 of a date, see http://howardhinnant.github.io/date_algorithms.html
+static uint32_t daysFromCivil(uint16_t y, uint8_t m, uint8_t d){
+	y -= m <= 2;
+	uint32_t era = y / 400;
+	uint32_t yoe = y - era * 400;
+	uint32_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+	uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + doe - 719468;
+}
+
+// date of a day since 1970-01-01, inverse of daysFromCivil.
+static void civilFromDays(uint32_t days, RTC_DATE_TIME& RTC_DT){
+	days += 719468;
+	uint32_t era = days / 146097;
+	uint32_t doe = days - era * 146097;
+	uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	uint32_t mp = (5 * doy + 2) / 153;
+	RTC_DT.Day	 = doy - (153 * mp + 2) / 5 + 1;
+	RTC_DT.Month = mp < 10 ? mp + 3 : mp - 9;
+	RTC_DT.Year	 = yoe + era * 400 + (RTC_DT.Month <= 2);
+}
 
 bool __W_RTC::checkInitialized(){
     if(Initialized){
         return 0;
     }
     else{
-        Logger::getInstance().println("RTC is not initialized!", LogLevel::Error);
+        Logger::getInstance().println<LogLevel::Error>("RTC is not initialized!");
         return 1;
     }
 }
@@ -17,55 +47,137 @@ bool __W_RTC::checkInitialized(){
 
 ERR_Type __W_RTC::init() {
 	if(Initialized){return ALREADY_INITIALIZED;}	// return if already initialized;
+	// the Logger starts the RTC before the SBox is initialized, so the bus is started here.
+	I2CBus& bus = I2CBus::getInstance();
+	bus.begin();
+	if(!bus.acquire(I2CDevice::RTC)){return RTC_BEGIN_ERR;}
 	if(!RTC.begin()){
+		bus.release(I2CDevice::RTC, false);
 		return RTC_BEGIN_ERR;
 	}
+	bus.reconfigure(); // the library can restart Wire in its begin().
 	//if(!RTC.isRunning()){
 		// set the date time based on these constant which are set on compile time
 		RTC.setDateTime(__DATE__, __TIME__);
 		// start the clock
 		RTC.startClock();
+		bus.release(I2CDevice::RTC, bus.lastTransferOk());
 		Initialized = true; // finish initialisation to prevent errors.
 
+		// anchor the timer on a second boundary of the RTC, so the interpolated milliseconds are correct from the start.
+		uint32_t first, seconds;
+		if(readRegisters(first)){
+			Initialized = false;
+			return RTC_READ_FAIL;
+		}
+		uint32_t start = millis();
+		do{
+			delay(1);
+		}while(!readRegisters(seconds) && seconds == first && (millis() - start) < 1100);
+		anchor_epoch = 0;
+		anchor_us	 = esp_timer_get_time();
+		if(sync()){
+			anchor_epoch = (uint64_t)first * 1000;
+		}
+
 		
-		Logger::getInstance().println("Setting up RTC!", LogLevel::Info, LogType::Serial);
-		Logger::getInstance().println("New Time Set", LogLevel::Info, LogType::Serial);
-		Logger::getInstance().print(__DATE__, LogLevel::Info, LogType::Serial);
-		Logger::getInstance().print(" ", LogLevel::Info, LogType::Serial);
-		Logger::getInstance().println(__TIME__, LogLevel::Info, LogType::Serial);
+		Logger::getInstance().println<LogLevel::Info, LogType::Serial>("Setting up RTC!");
+		Logger::getInstance().println<LogLevel::Info, LogType::Serial>("New Time Set");
+		Logger::getInstance().print<LogLevel::Info, LogType::Serial>(__DATE__);
+		Logger::getInstance().print<LogLevel::Info, LogType::Serial>(" ");
+		Logger::getInstance().println<LogLevel::Info, LogType::Serial>(__TIME__);
 		
 	//}
 	/*
-	Logger::getInstance().print("RTC starting time DD-MM-YYYY : hh:mm:ss : ", LogLevel::Info, LogType::Serial);
-	Logger::getInstance().print(RTC.getDay(), LogLevel::Info, LogType::Serial); Logger::getInstance().print("-", LogLevel::Info, LogType::Serial);
-	Logger::getInstance().print(RTC.getMonth(), LogLevel::Info, LogType::Serial); Logger::getInstance().print("-", LogLevel::Info, LogType::Serial);
-	Logger::getInstance().print(RTC.getYear(), LogLevel::Info, LogType::Serial); Logger::getInstance().print(" : ", LogLevel::Info, LogType::Serial);
-	Logger::getInstance().print(RTC.getHours(), LogLevel::Info, LogType::Serial); Logger::getInstance().print(":", LogLevel::Info, LogType::Serial);
-	Logger::getInstance().print(RTC.getMinutes(), LogLevel::Info, LogType::Serial); Logger::getInstance().print(":", LogLevel::Info, LogType::Serial);
-	Logger::getInstance().print(RTC.getSeconds(), LogLevel::Info, LogType::Serial); Logger::getInstance().println("", LogLevel::Info, LogType::Serial);
+	Logger::getInstance().print<LogLevel::Info, LogType::Serial>("RTC starting time DD-MM-YYYY : hh:mm:ss : ");
+	Logger::getInstance().print<LogLevel::Info, LogType::Serial>(RTC.getDay()); Logger::getInstance().print<LogLevel::Info, LogType::Serial>("-");
+	Logger::getInstance().print<LogLevel::Info, LogType::Serial>(RTC.getMonth()); Logger::getInstance().print<LogLevel::Info, LogType::Serial>("-");
+	Logger::getInstance().print<LogLevel::Info, LogType::Serial>(RTC.getYear()); Logger::getInstance().print<LogLevel::Info, LogType::Serial>(" : ");
+	Logger::getInstance().print<LogLevel::Info, LogType::Serial>(RTC.getHours()); Logger::getInstance().print<LogLevel::Info, LogType::Serial>(":");
+	Logger::getInstance().print<LogLevel::Info, LogType::Serial>(RTC.getMinutes()); Logger::getInstance().print<LogLevel::Info, LogType::Serial>(":");
+	Logger::getInstance().print<LogLevel::Info, LogType::Serial>(RTC.getSeconds()); Logger::getInstance().println<LogLevel::Info, LogType::Serial>("");
 	*/
 	return SUCCESS;
 }
 
-RTC_DATE_TIME __W_RTC::read(){
+ERR_Type __W_RTC::readRegisters(uint32_t& epoch_seconds){
+	// burst read of the seconds (0x02) up to and including the years (0x08) register.
+	const uint8_t first = 0x02;
+	uint8_t reg[7];
+	if(I2CBus::getInstance().writeRead(I2CDevice::RTC, &first, 1, reg, sizeof(reg), true)){return RTC_READ_FAIL;}
+	// mask out the unused and status bits (VL, century) before converting.
+	uint8_t second = fromBCD(reg[0] & 0x7F);
+	uint8_t minute = fromBCD(reg[1] & 0x7F);
+	uint8_t hour   = fromBCD(reg[2] & 0x3F);
+	uint8_t day	   = fromBCD(reg[3] & 0x3F);
+	uint8_t month  = fromBCD(reg[5] & 0x1F);
+	uint16_t year  = 2000 + fromBCD(reg[6]);
+	if(!day || !month || month > 12){return RTC_READ_FAIL;}
+	epoch_seconds = daysFromCivil(year, month, day) * 86400UL + hour * 3600UL + minute * 60UL + second;
+	return SUCCESS;
+}
+
+ERR_Type __W_RTC::sync(){
+	if(!Initialized){return NOT_INITIALIZED;}
+	uint32_t seconds;
+	ERR_Type ET = readRegisters(seconds);
+	portENTER_CRITICAL(&anchor_lock);
+	int64_t now_us = esp_timer_get_time();
+	uint64_t now = anchor_epoch + (now_us - anchor_us) / 1000;
+	if(!ET){
+		// the RTC only has a resolution of 1s, so keep the interpolated milliseconds as long as they agree with the RTC.
+		uint64_t rtc_ms = (uint64_t)seconds * 1000;
+		if(now < rtc_ms){ now = rtc_ms; }
+		else if(now >= rtc_ms + 1000){ now = rtc_ms + 999; }
+	}
+	// on a failed read the current interpolation is kept until the next resync.
+	anchor_epoch = now;
+	anchor_us	 = now_us;
+	portEXIT_CRITICAL(&anchor_lock);
+	return ET;
+}
+
+uint64_t __W_RTC::epochMillis(){
+	portENTER_CRITICAL(&anchor_lock);
+	int64_t now_us = esp_timer_get_time();
+	bool resync = Initialized && (now_us - anchor_us) >= (int64_t)RTC_RESYNC_INTERVAL * 1000;
+	uint64_t now = anchor_epoch + (now_us - anchor_us) / 1000;
+	portEXIT_CRITICAL(&anchor_lock);
+	if(resync){
+		sync(); // the I2C read can not be done inside the critical section.
+		return epochMillis();
+	}
+	return now;
+}
+
+void __W_RTC::updateCache(uint32_t epoch_seconds){
+	if(epoch_seconds == cache_second){return;}
+	cache_second = epoch_seconds;
+	cache_DT	 = toDateTime(epoch_seconds);
+	snprintf(cache_time, sizeof(cache_time), "%u:%u:%u", cache_DT.Hour, cache_DT.Minute, cache_DT.Second);
+	snprintf(cache_date_time, sizeof(cache_date_time), "%u-%u-%u %s", cache_DT.Year, cache_DT.Month, cache_DT.Day, cache_time);
+}
+
+RTC_DATE_TIME __W_RTC::toDateTime(uint32_t epoch_seconds){
 	RTC_DATE_TIME RTC_DT;
-	if(checkInitialized()){return RTC_DT;} // don't act on to the RTC hardware if not properly intialized;
-	
-	RTC_DT.Day	 	= RTC.getDay();
-	RTC_DT.Month	= RTC.getMonth();
-	RTC_DT.Year 	= RTC.getYear();
-	RTC_DT.Hour 	= RTC.getHours();
-	RTC_DT.Minute 	= RTC.getMinutes();
-	RTC_DT.Second 	= RTC.getSeconds();
+	civilFromDays(epoch_seconds / 86400, RTC_DT);
+	uint32_t sec_of_day = epoch_seconds % 86400;
+	RTC_DT.Hour	  = sec_of_day / 3600;
+	RTC_DT.Minute = (sec_of_day / 60) % 60;
+	RTC_DT.Second = sec_of_day % 60;
 	return RTC_DT;
 }
 
-String __W_RTC::stringDateTime(){
-	if(checkInitialized()){return String("");} // don't act on to the RTC hardware if not properly intialized;
-	return String(RTC.getYear()) + "-" + String(RTC.getMonth()) + "-" + String(RTC.getDay()) + " " + String(RTC.getHours()) + ":" + String(RTC.getMinutes()) + ":" + String(RTC.getSeconds());
+RTC_DATE_TIME __W_RTC::read(){
+	return toDateTime(epochSeconds());
+}
+
+const char* __W_RTC::stringDateTime(){
+	updateCache(epochSeconds());
+	return cache_date_time;
 }
 
-String __W_RTC::stringTime(){
-	if(checkInitialized()){return String("");} // don't act on to the RTC hardware if not properly intialized;
-	return String(RTC.getHours()) + ":" + String(RTC.getMinutes()) + ":" + String(RTC.getSeconds());
+const char* __W_RTC::stringTime(uint32_t epoch_seconds){
+	updateCache(epoch_seconds);
+	return cache_time;
 }
\ No newline at end of file
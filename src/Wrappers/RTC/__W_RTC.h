@@ -14,6 +14,8 @@
 #include "../Singleton/Singleton.h"
 
 #include <RTC.h>
+#include <stdint.h>
+#include <freertos/FreeRTOS.h>
 
 /**
  * @defgroup STRUCT Global structures
@@ -41,6 +43,8 @@ struct RTC_DATE_TIME{
 
 /**
  * @brief Singleton RTC Module.
+ * The RTC is only read at init and every RTC_RESYNC_INTERVAL ms. In between the time is interpolated with the ESP32 timer,
+ * which means all the time functions can be called as often as needed without causing any I2C traffic.
  */
 class __W_RTC : public __iW_Module, public iSingleton{
 private:
@@ -48,6 +52,21 @@ private:
 	 * @brief Handle to the RTC library.
 	 */
 	PCF8563 RTC;
+
+	/** Time since 1970 in ms at the moment of the last sync. */
+	uint64_t anchor_epoch = 0;
+	/** ESP32 timer value in us at the moment of the last sync. */
+	int64_t	 anchor_us = 0;
+	/** Guards the anchor, which is used by the Logger task and the sampling code at the same time. */
+	portMUX_TYPE anchor_lock = portMUX_INITIALIZER_UNLOCKED;
+	/** Epoch second of which the cached values below are valid. */
+	uint32_t cache_second = UINT32_MAX;
+	/** Cached date time. */
+	RTC_DATE_TIME cache_DT = {1, 1, 1970, 0, 0, 0};
+	/** Cached time string. */
+	char	 cache_time[9] = "0:0:0";
+	/** Cached date time string. */
+	char	 cache_date_time[20] = "1970-1-1 0:0:0";
 	
 	/**
 	 * @brief virtual implementation of the iW_Module function.
@@ -57,6 +76,21 @@ private:
 	 */
 	virtual bool checkInitialized();
 
+	/**
+	 * @brief Reads all date time registers of the RTC in a single I2C transaction.
+	 * Reading the registers at once prevents the values from tearing when the RTC ticks in between reads.
+	 * @param epoch_seconds buffer for the read time in seconds since 1970.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 * @see ERR_Type
+	 */
+	ERR_Type readRegisters(uint32_t& epoch_seconds);
+
+	/**
+	 * @brief Updates the cached date time and strings if the second has changed.
+	 * @param epoch_seconds the current time in seconds since 1970.
+	 */
+	void updateCache(uint32_t epoch_seconds);
+
 	// remove access to the constructor of __W_RTC.
 	__W_RTC(){}
 
@@ -82,7 +116,35 @@ public:
 	 * @see ERR_Type
 	 */
 	ERR_Type init();
+
+	/**
+	 * @brief Reads the RTC and anchors the ESP32 timer to it.
+	 * Is called automatically every RTC_RESYNC_INTERVAL ms by the time functions.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 * @see ERR_Type
+	 */
+	ERR_Type sync();
+
+	/**
+	 * @brief Returns the current time in ms since 1970.
+	 * Before the RTC is initialized this is the time since boot.
+	 * @return uint64_t the current time in ms.
+	 */
+	uint64_t epochMillis();
+
+	/**
+	 * @brief Returns the current time in seconds since 1970.
+	 * @return uint32_t the current time in seconds.
+	 */
+	uint32_t epochSeconds(){ return epochMillis() / 1000; }
 	
+	/**
+	 * @brief Converts a time in seconds since 1970 into a date time.
+	 * @param epoch_seconds the time in seconds since 1970.
+	 * @return RTC_DATE_TIME the date time of the given time.
+	 */
+	static RTC_DATE_TIME toDateTime(uint32_t epoch_seconds);
+
 	/**
 	 * @brief Returns the current date time.
 	 * @return the current date time in a RTC_DATE_TIME struct.
@@ -91,13 +153,22 @@ public:
 
 	/**
 	 * @brief Returns a datetime in a string format.
-	 * @return a datetime in a YYYY-MM-DD_hh.mm.ss format.
+	 * The string stays valid until the next call of one of the string functions, which are meant to be used by the Logger only.
+	 * @return a datetime in a YYYY-M-D h:m:s format.
 	 */
-	String stringDateTime();
+	const char* stringDateTime();
 
 	/**
 	 * @brief Returns the time in a string format.
-	 * @return a time string in a hh.mm.ss format.
+	 * The string stays valid until the next call of one of the string functions, which are meant to be used by the Logger only.
+	 * @return a time string in a h:m:s format.
+	 */
+	const char* stringTime(){ return stringTime(epochSeconds()); }
+
+	/**
+	 * @brief Returns the given time in a string format.
+	 * @param epoch_seconds the time in seconds since 1970.
+	 * @return a time string in a h:m:s format.
 	 */
-	String stringTime();
+	const char* stringTime(uint32_t epoch_seconds);
 };
\ No newline at end of file
@@ -0,0 +1,255 @@
+#include "SD_Benchmark.h"
+
+#include <stdio.h>
+#include <algorithm>
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <chrono>
+// the time in us, like the Arduino function.
+static uint32_t micros(){
+	return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+#define SD_BENCH_FILE SD_BENCH_DIR "/test.bin"
+
+ERR_Type SD_Benchmark::run(const char* csv_path){
+	result_count = 0;
+	for(size_t i = 0; i < sizeof(block); i++){
+		block[i] = (uint8_t)i;
+	}
+	storage.mkdir(SD_BENCH_DIR);
+
+	ERR_Type ET = SUCCESS;
+	for(size_t size = SD_BENCH_MIN_BLOCK; size <= SD_BENCH_MAX_BLOCK && !ET; size *= 2){
+		size_t ops = SD_BENCH_FILE_SIZE / size;
+		if(ops > SD_BENCH_MAX_SAMPLES){ ops = SD_BENCH_MAX_SAMPLES; }
+		if(!ops){ ops = 1; }
+		if(!ET){ ET = seqWrite(SD_BENCH_FILE, size, ops); }
+		if(!ET){ ET = seqRead(SD_BENCH_FILE, size, ops); }
+		if(!ET){ ET = randRead(SD_BENCH_FILE, size, ops); }
+		if(!ET){ ET = randWrite(SD_BENCH_FILE, size, ops); }
+		storage.remove(SD_BENCH_FILE);
+	}
+	// log lines are around 64 bytes, the Logger flushes in LOG_FLUSH_SIZE chunks.
+	for(size_t size = 64; size <= LOG_FLUSH_SIZE && !ET; size *= 8){
+		if(!ET){ ET = appendReopen(SD_BENCH_FILE, size); }
+		storage.remove(SD_BENCH_FILE);
+		if(!ET){ ET = appendHeld(SD_BENCH_FILE, size); }
+		storage.remove(SD_BENCH_FILE);
+	}
+	if(!ET){ ET = metadata(); }
+	storage.rmdir(SD_BENCH_DIR);
+
+	ERR_Type ret = report(csv_path);
+	return ET ? ET : ret;
+}
+
+void SD_Benchmark::begin(){
+	sample_count = 0;
+	test_start = micros();
+}
+
+void SD_Benchmark::sample(uint32_t start){
+	if(sample_count < SD_BENCH_MAX_SAMPLES){
+		samples[sample_count++] = micros() - start;
+	}
+}
+
+void SD_Benchmark::finish(const char* test, uint32_t block_size, uint32_t bytes){
+	uint32_t total = micros() - test_start;
+	if(result_count >= sizeof(results) / sizeof(results[0])){return;}
+	SD_BenchResult& R = results[result_count++];
+	R = {test, block_size, (uint32_t)sample_count, bytes, total, 0, 0, 0, 0};
+	if(!sample_count){return;}
+	std::sort(samples, samples + sample_count);
+	R.min_us = samples[0];
+	R.p50_us = samples[sample_count / 2];
+	R.p99_us = samples[(sample_count * 99) / 100];
+	R.max_us = samples[sample_count - 1];
+}
+
+uint32_t SD_Benchmark::random(uint32_t max){
+	// xorshift32, the same sequence on every run so the results can be compared.
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	return rng % max;
+}
+
+ERR_Type SD_Benchmark::seqWrite(const char* path, size_t block_size, size_t ops){
+	begin();
+	StorageFile file = storage.open(path, StorageMode::Write);
+	if(!file){return SD_FILE_OPEN_FAIL;}
+	for(size_t i = 0; i < ops; i++){
+		uint32_t start = micros();
+		if(file.write(block, block_size) != block_size){
+			file.close();
+			return SD_WRITE_FAIL;
+		}
+		sample(start);
+	}
+	file.close();
+	finish("seq_write", block_size, block_size * ops);
+	return SUCCESS;
+}
+
+ERR_Type SD_Benchmark::seqRead(const char* path, size_t block_size, size_t ops){
+	begin();
+	StorageFile file = storage.open(path, StorageMode::Read);
+	if(!file){return SD_FILE_OPEN_FAIL;}
+	for(size_t i = 0; i < ops; i++){
+		uint32_t start = micros();
+		if(file.read(block, block_size) != block_size){
+			file.close();
+			return READ_FAIL;
+		}
+		sample(start);
+	}
+	file.close();
+	finish("seq_read", block_size, block_size * ops);
+	return SUCCESS;
+}
+
+ERR_Type SD_Benchmark::randRead(const char* path, size_t block_size, size_t ops){
+	begin();
+	StorageFile file = storage.open(path, StorageMode::Read);
+	if(!file){return SD_FILE_OPEN_FAIL;}
+	for(size_t i = 0; i < ops; i++){
+		uint32_t start = micros();
+		if(!file.seek(random(ops) * block_size) || file.read(block, block_size) != block_size){
+			file.close();
+			return READ_FAIL;
+		}
+		sample(start);
+	}
+	file.close();
+	finish("rand_read", block_size, block_size * ops);
+	return SUCCESS;
+}
+
+ERR_Type SD_Benchmark::randWrite(const char* path, size_t block_size, size_t ops){
+	begin();
+	StorageFile file = storage.open(path, StorageMode::Update);
+	if(!file){return SD_FILE_OPEN_FAIL;}
+	for(size_t i = 0; i < ops; i++){
+		uint32_t start = micros();
+		if(!file.seek(random(ops) * block_size) || file.write(block, block_size) != block_size){
+			file.close();
+			return SD_WRITE_FAIL;
+		}
+		sample(start);
+	}
+	file.close();
+	finish("rand_write", block_size, block_size * ops);
+	return SUCCESS;
+}
+
+ERR_Type SD_Benchmark::appendReopen(const char* path, size_t block_size){
+	begin();
+	for(size_t i = 0; i < SD_BENCH_APPEND_OPS; i++){
+		uint32_t start = micros();
+		StorageFile file = storage.open(path, StorageMode::Append);
+		if(!file){return SD_FILE_OPEN_FAIL;}
+		size_t written = file.write(block, block_size);
+		file.close();
+		if(written != block_size){return SD_APP_FAIL;}
+		sample(start);
+	}
+	finish("append_reopen", block_size, block_size * SD_BENCH_APPEND_OPS);
+	return SUCCESS;
+}
+
+ERR_Type SD_Benchmark::appendHeld(const char* path, size_t block_size){
+	begin();
+	StorageFile file = storage.open(path, StorageMode::Append);
+	if(!file){return SD_FILE_OPEN_FAIL;}
+	for(size_t i = 0; i < SD_BENCH_APPEND_OPS; i++){
+		uint32_t start = micros();
+		if(file.write(block, block_size) != block_size){
+			file.close();
+			return SD_APP_FAIL;
+		}
+		sample(start);
+	}
+	file.close();
+	finish("append_held", block_size, block_size * SD_BENCH_APPEND_OPS);
+	return SUCCESS;
+}
+
+ERR_Type SD_Benchmark::metadata(){
+	char path[48];
+	char path2[48];
+
+	begin();
+	for(int i = 0; i < SD_BENCH_META_OPS; i++){
+		snprintf(path, sizeof(path), SD_BENCH_DIR "/d%d", i);
+		uint32_t start = micros();
+		if(!storage.mkdir(path)){return SD_MKDIR_FAIL;}
+		sample(start);
+	}
+	finish("mkdir", 0, 0);
+
+	// create the files that are renamed and removed, this is not timed.
+	for(int i = 0; i < SD_BENCH_META_OPS; i++){
+		snprintf(path, sizeof(path), SD_BENCH_DIR "/d%d/f", i);
+		StorageFile file = storage.open(path, StorageMode::Write);
+		if(!file){return SD_FILE_OPEN_FAIL;}
+		size_t written = file.write(block, 64);
+		file.close();
+		if(written != 64){return SD_WRITE_FAIL;}
+	}
+
+	begin();
+	for(int i = 0; i < SD_BENCH_META_OPS; i++){
+		snprintf(path, sizeof(path), SD_BENCH_DIR "/d%d/f", i);
+		snprintf(path2, sizeof(path2), SD_BENCH_DIR "/d%d/g", i);
+		uint32_t start = micros();
+		if(!storage.rename(path, path2)){return SD_RENAME_FAIL;}
+		sample(start);
+	}
+	finish("rename", 0, 0);
+
+	begin();
+	for(int i = 0; i < SD_BENCH_META_OPS; i++){
+		snprintf(path, sizeof(path), SD_BENCH_DIR "/d%d/g", i);
+		uint32_t start = micros();
+		if(!storage.remove(path)){return SD_RM_FAIL;}
+		sample(start);
+	}
+	finish("remove", 0, 0);
+
+	begin();
+	for(int i = 0; i < SD_BENCH_META_OPS; i++){
+		snprintf(path, sizeof(path), SD_BENCH_DIR "/d%d", i);
+		uint32_t start = micros();
+		if(!storage.rmdir(path)){return SD_RMDIR_FAIL;}
+		sample(start);
+	}
+	finish("rmdir", 0, 0);
+	return SUCCESS;
+}
+
+size_t SD_Benchmark::formatResult(const SD_BenchResult& R, char* out, size_t size){
+	uint32_t kBps = R.total_us ? (uint32_t)(((uint64_t)R.bytes * 1000) / R.total_us) : 0;
+	int n = snprintf(out, size, "%s,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu",
+		R.test, (unsigned long)R.block, (unsigned long)R.ops, (unsigned long)R.bytes, (unsigned long)R.total_us,
+		(unsigned long)kBps, (unsigned long)R.min_us, (unsigned long)R.p50_us, (unsigned long)R.p99_us, (unsigned long)R.max_us);
+	if(n < 0){return 0;}
+	return (size_t)n < size ? n : size - 1;
+}
+
+ERR_Type SD_Benchmark::report(const char* csv_path){
+	StorageFile file = storage.open(csv_path, StorageMode::Write);
+	if(!file){return SD_FILE_OPEN_FAIL;}
+	file.print("test,block,ops,bytes,total_us,kBps,min_us,p50_us,p99_us,max_us\n");
+	char line[128];
+	for(size_t i = 0; i < result_count; i++){
+		size_t len = formatResult(results[i], line, sizeof(line) - 1);
+		line[len++] = '\n';
+		if(file.write((const uint8_t*)line, len) != len){return SD_WRITE_FAIL;}
+	}
+	file.close();
+	return SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,137 @@
+/**
+ * @file SD_Benchmark.h
+ * @author Imre Korf
+ * @brief Benchmark of the file system operations used by the Logger and the MQTT client.
+ * @version 0.1
+ * @date 2022-03-07
+ *
+ * Every operation is timed separately in microseconds, for every test the CSV file contains:
+ * Column | Description
+ * :-----:|:-----------------------------:
+ *  test | name of the test
+ *  block | block size in bytes
+ *  ops | amount of timed operations
+ *  bytes | amount of bytes read or written
+ *  total_us | time of the whole test, including opening and closing the file
+ *  kBps | bytes / total_us * 1000
+ *  min_us, p50_us, p99_us, max_us | latency of a single operation
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include "../Storage/iStorage.h"
+#include "../../Defines/Defines.h"
+
+/**
+ * @addtogroup STRUCT
+ * @{
+ */
+/**
+ * @brief Result of a single benchmark test.
+ */
+struct SD_BenchResult {
+	/** Name of the test. */
+	const char* test;
+	/** Block size in bytes. */
+	uint32_t block;
+	/** Amount of timed operations. */
+	uint32_t ops;
+	/** Amount of bytes read or written. */
+	uint32_t bytes;
+	/** Time of the whole test in us. */
+	uint32_t total_us;
+	/** Fastest operation in us. */
+	uint32_t min_us;
+	/** Median operation in us. */
+	uint32_t p50_us;
+	/** 99th percentile operation in us. */
+	uint32_t p99_us;
+	/** Slowest operation in us. */
+	uint32_t max_us;
+};
+/**@}*/
+
+/**
+ * @brief Runs the file system benchmark on a mounted storage.
+ * The benchmark needs a lot of RAM for its block buffer, so it should be a global or heap object.
+ * It only depends on the iStorage interface, so it also runs on a host with a POSIX_Storage.
+ */
+class SD_Benchmark {
+private:
+	/** The storage under test. */
+	iStorage& storage;
+	/** Block buffer used for reading and writing. */
+	uint8_t block[SD_BENCH_MAX_BLOCK];
+	/** Latencies of the operations of the running test. */
+	uint32_t samples[SD_BENCH_MAX_SAMPLES];
+	/** Amount of latencies in samples. */
+	size_t sample_count = 0;
+	/** Start time of the running test. */
+	uint32_t test_start = 0;
+	/** Results of the finished tests. */
+	SD_BenchResult results[64];
+	/** Amount of results. */
+	size_t result_count = 0;
+	/** State of the random generator. */
+	uint32_t rng = 0x12345678;
+
+	/** @brief Starts timing a new test. */
+	void begin();
+	/** @brief Stores the latency of an operation that started at the given time. */
+	void sample(uint32_t start);
+	/** @brief Stops timing the running test and stores its result. */
+	void finish(const char* test, uint32_t block_size, uint32_t bytes);
+	/** @brief Returns a random number below max. */
+	uint32_t random(uint32_t max);
+
+	/** @brief Writes the test file sequentially, the file is used by the read tests. */
+	ERR_Type seqWrite(const char* path, size_t block_size, size_t ops);
+	/** @brief Reads the test file sequentially. */
+	ERR_Type seqRead(const char* path, size_t block_size, size_t ops);
+	/** @brief Reads blocks from random positions in the test file. */
+	ERR_Type randRead(const char* path, size_t block_size, size_t ops);
+	/** @brief Overwrites blocks at random positions in the test file. */
+	ERR_Type randWrite(const char* path, size_t block_size, size_t ops);
+	/** @brief Appends blocks and opens and closes the file for every append, like __W_SD::appendFile(). */
+	ERR_Type appendReopen(const char* path, size_t block_size);
+	/** @brief Appends blocks to a file that is kept open, like the Logger stream. */
+	ERR_Type appendHeld(const char* path, size_t block_size);
+	/** @brief Times mkdir, rename, remove and rmdir. */
+	ERR_Type metadata();
+	/** @brief Writes the results to the CSV file. */
+	ERR_Type report(const char* csv_path);
+
+public:
+	/**
+	 * @brief Creates a benchmark for the given storage.
+	 * @param storage the mounted storage.
+	 */
+	SD_Benchmark(iStorage& storage) : storage(storage) {}
+
+	/**
+	 * @brief Runs all tests in SD_BENCH_DIR and writes the results as CSV.
+	 * Takes a few minutes on a slow card.
+	 * @param csv_path the path of the CSV file.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 * @see ERR_Type
+	 */
+	ERR_Type run(const char* csv_path = SD_BENCH_CSV);
+
+	/**
+	 * @brief Returns the results of the last run.
+	 * @param count the amount of results.
+	 * @return const SD_BenchResult* the results.
+	 */
+	const SD_BenchResult* getResults(size_t& count) const { count = result_count; return results; }
+
+	/**
+	 * @brief Formats a result as a line of the CSV file, without the line end.
+	 * @param result the result.
+	 * @param out the buffer for the line.
+	 * @param size the size of the buffer.
+	 * @return size_t the length of the line.
+	 */
+	static size_t formatResult(const SD_BenchResult& result, char* out, size_t size);
+};
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "__W_SD.h"
 #include <SPI.h>
 #include "../../Logger/Logger.h"
+#include "SD_Benchmark.h"
+#include <new>
 
 
 bool __W_SD::checkInitialized(){
@@ -8,121 +10,168 @@ bool __W_SD::checkInitialized(){
         return 0;
     }
     else{
-        Logger::getInstance().println("SD card is not initialized!", LogLevel::Error, LogType::Serial);
+        Logger::getInstance().println<LogLevel::Error, LogType::Serial>("SD card is not initialized!");
         return 1;
     }
 }
 
 ERR_Type __W_SD::init(){
+    SD_Lock L;
+    if(!L){return SD_BUSY;}
     if(Initialized){return ALREADY_INITIALIZED;}	// return if already initialized;
-	ESP_SD = &SD; // rename the SD handle and save it in this class.
+    if(fixed_storage){return mount(*storage);}
+
+    ERR_Type ET = initSD();
+#if STORAGE_FLASH_FALLBACK
+    if(ET){
+        // keep the files on the internal flash until the card is back.
+        last_mount_try = millis();
+        if(mount(flash_storage) == SUCCESS){
+            Logger::getInstance().println<LogLevel::Warning, LogType::Serial>("[SD] SD card unavailable, using the internal flash");
+            return SUCCESS;
+        }
+    }
+#endif
+    return ET;
+}
+
+ERR_Type __W_SD::init(iStorage& backend){
+    SD_Lock L;
+    if(!L){return SD_BUSY;}
+    if(Initialized){return ALREADY_INITIALIZED;}	// return if already initialized;
+    fixed_storage = true;
+    storage = &backend;
+    return mount(backend);
+}
+
+ERR_Type __W_SD::initSD(){
     // check if the SD card is inserted.
-    if(digitalRead(25)){
-        Logger::getInstance().println("SD-card not inserted!", LogLevel::Error, LogType::Serial);
+    if(!cardPresent()){
+        Logger::getInstance().println<LogLevel::Error, LogType::Serial>("SD-card not inserted!");
         return NO_SD_CARD;
     }
     // start the SD module
-	if(!ESP_SD->begin()){
-        Logger::getInstance().println("SD Card Mount Failed", LogLevel::Error, LogType::Serial);
-        return SD_BEGIN_ERR;
-    }
+    ERR_Type ET = mount(sd_storage);
+    if(ET){return ET;}
     // check the cardtype
-	uint8_t cardType = ESP_SD->cardType();
-
-	if(cardType == CARD_NONE){
-        Logger::getInstance().println("No SD card attached", LogLevel::Error, LogType::Serial);
-        return SD_CARDTYPE_NONE;
-    }
-	Initialized = true; // SD card is not properly initialized, so it's cool to start printing to it. ( prevents recursive calls to checkInitialized etc. )
+	uint8_t cardType = sd_storage.cardType();
 
     // debug info
-	Logger::getInstance().print("SD Card Type: ", LogLevel::Info, LogType::Serial);
+	Logger::getInstance().print<LogLevel::Info, LogType::Serial>("SD Card Type: ");
     if(cardType == CARD_MMC){
-        Logger::getInstance().println("MMC", LogLevel::Info, LogType::Serial);
+        Logger::getInstance().println<LogLevel::Info, LogType::Serial>("MMC");
     } else if(cardType == CARD_SD){
-        Logger::getInstance().println("SDSC", LogLevel::Info, LogType::Serial);
+        Logger::getInstance().println<LogLevel::Info, LogType::Serial>("SDSC");
     } else if(cardType == CARD_SDHC){
-        Logger::getInstance().println("SDHC", LogLevel::Info, LogType::Serial);
+        Logger::getInstance().println<LogLevel::Info, LogType::Serial>("SDHC");
     } else {
-        Logger::getInstance().println("UNKNOWN", LogLevel::Info, LogType::Serial);
+        Logger::getInstance().println<LogLevel::Info, LogType::Serial>("UNKNOWN");
     }
 	
     // more debug info
-	uint32_t cardSize = ESP_SD->cardSize() / (1024 * 1024);
-    Logger::getInstance().println((String)("SD Card Size: " + String(cardSize) + "MB"), LogLevel::Info, LogType::Serial);
+	uint32_t cardSize = sd_storage.cardSize() / (1024 * 1024);
+    Logger::getInstance().println<LogLevel::Info, LogType::Serial>("SD Card Size: ", cardSize, "MB");
+    return SUCCESS;
+}
 
+ERR_Type __W_SD::mount(iStorage& backend){
+    if(!backend.begin()){
+        Logger::getInstance().println<LogLevel::Error, LogType::Serial>("[SD] Failed to mount ", backend.name());
+        return SD_BEGIN_ERR;
+    }
+    storage = &backend;
+    mount_count++;
+	Initialized = true; // the storage is now properly initialized, so it's cool to start printing to it. ( prevents recursive calls to checkInitialized etc. )
+
+    updateFreeSpace();
+    Logger::getInstance().println<LogLevel::Info, LogType::Serial>("[SD] Storage: ", backend.name(), ", Free Space: ", (uint32_t)(free_space / (1024 * 1024)), "MB");
 	return SUCCESS;
 }
 
+/**
+ * @brief Context of the directory listing of __W_SD::listDir().
+ */
+struct ListDirContext {
+    __W_SD* sd;
+    uint8_t levels;
+};
+
+// print an entry of the directory listed by listDir().
+static bool listDirEntry(const char* path, bool is_dir, size_t size, void* context){
+    ListDirContext* ctx = (ListDirContext*)context;
+    if(is_dir){
+        Logger::getInstance().print<LogLevel::Info>("  DIR : ");
+        Logger::getInstance().println<LogLevel::Info>(path);
+        // re-execute the function with 1 less level. (recursive)
+        if(ctx->levels){
+            ctx->sd->listDir(path, ctx->levels - 1);
+        }
+    } else {
+        Logger::getInstance().print<LogLevel::Info>("  FILE: ");
+        Logger::getInstance().print<LogLevel::Info>(path);
+        Logger::getInstance().print<LogLevel::Info>("  SIZE: ");
+        Logger::getInstance().println<LogLevel::Info>((uint32_t)size);
+    }
+    return true;
+}
+
 ERR_Type __W_SD::listDir(const char * dirname, uint8_t levels){
+    SD_Lock L;
+    if(!L){return SD_BUSY;}
     if(checkInitialized()){return NOT_INITIALIZED;} // don't act on to the SD hardware if not properly intialized;
 
-    Logger::getInstance().println((String)("[SD] Listing directory: " + String(dirname)), LogLevel::Info);
+    Logger::getInstance().println<LogLevel::Info>("[SD] Listing directory: ", dirname);
 
-    // open the file
-    File root = ESP_SD->open(dirname);
-    if(!root){
-        Logger::getInstance().println("[SD] Failed to open directory", LogLevel::Error);
+    if(!storage->exists(dirname)){
+        Logger::getInstance().println<LogLevel::Error>("[SD] Failed to open directory");
         return SD_DIR_OPEN_FAIL;
     }
-
-    if(!root.isDirectory()){
-        Logger::getInstance().println("[SD] Not a directory", LogLevel::Error);
+    ListDirContext ctx = {this, levels};
+    if(!storage->listDir(dirname, listDirEntry, &ctx)){
+        Logger::getInstance().println<LogLevel::Error>("[SD] Not a directory");
         return SD_NOT_A_DIR;
     }
-
-    File file = root.openNextFile();
-    while(file){
-        if(file.isDirectory()){
-            Logger::getInstance().print("  DIR : ", LogLevel::Info);
-            Logger::getInstance().println(file.name(), LogLevel::Info);
-            // re-execute the function with 1 less level. (recursive)
-            if(levels){
-                listDir(file.name(), levels -1);
-            }
-        } else {
-            Logger::getInstance().print("  FILE: ", LogLevel::Info);
-            Logger::getInstance().print(file.name(), LogLevel::Info);
-            Logger::getInstance().print("  SIZE: ", LogLevel::Info);
-            Logger::getInstance().println(file.size(), LogLevel::Info);
-        }
-        file = root.openNextFile();
-    }
     return SUCCESS;
 }
 
 ERR_Type __W_SD::createDir(const char * path){
+    SD_Lock L;
+    if(!L){return SD_BUSY;}
     if(checkInitialized()){return NOT_INITIALIZED;} // don't act on to the SD hardware if not properly intialized;
 
-    Logger::getInstance().println((String)("[SD] Creating Dir: " + String(path)), LogLevel::Info);
-    if(ESP_SD->mkdir(path)){
-        Logger::getInstance().println("[SD] Dir created", LogLevel::Info);
+    Logger::getInstance().println<LogLevel::Info>("[SD] Creating Dir: ", path);
+    if(storage->mkdir(path)){
+        Logger::getInstance().println<LogLevel::Info>("[SD] Dir created");
         return SUCCESS;
     } else {
-        Logger::getInstance().println("[SD] mkdir failed", LogLevel::Error);
+        Logger::getInstance().println<LogLevel::Error>("[SD] mkdir failed");
         return SD_MKDIR_FAIL;
     }
 }
 
 ERR_Type __W_SD::removeDir(const char * path){
+    SD_Lock L;
+    if(!L){return SD_BUSY;}
     if(checkInitialized()){return NOT_INITIALIZED;} // don't act on to the SD hardware if not properly intialized;
 
-    Logger::getInstance().println(String("[SD] Removing Dir: " + String(path)), LogLevel::Info);
-    if(ESP_SD->rmdir(path)){
-        Logger::getInstance().println("[SD] Dir removed", LogLevel::Info);
+    Logger::getInstance().println<LogLevel::Info>("[SD] Removing Dir: ", path);
+    if(storage->rmdir(path)){
+        Logger::getInstance().println<LogLevel::Info>("[SD] Dir removed");
         return SUCCESS;
     } else {
-        Logger::getInstance().println("[SD] rmdir failed", LogLevel::Warning);
+        Logger::getInstance().println<LogLevel::Warning>("[SD] rmdir failed");
         return SD_RMDIR_FAIL;
     }
 }
 
 ERR_Type __W_SD::getFileSize(const char* path, unsigned long& val){
+    SD_Lock L;
+    if(!L){return SD_BUSY;}
     if(checkInitialized()){return NOT_INITIALIZED;} // don't act on to the SD hardware if not properly intialized;
-    Logger::getInstance().println(String("[SD] Getting filesize of: " + String(path)), LogLevel::Info);
-    File file = ESP_SD->open(path);
+    Logger::getInstance().println<LogLevel::Info>("[SD] Getting filesize of: ", path);
+    StorageFile file = storage->open(path, StorageMode::Read);
     if(!file){
-        Logger::getInstance().println("[SD] Failed to open file for reading", LogLevel::Error);
+        Logger::getInstance().println<LogLevel::Error>("[SD] Failed to open file for reading");
         file.close();
         return SD_FILE_OPEN_FAIL;
     }
@@ -134,44 +183,94 @@ ERR_Type __W_SD::getFileSize(const char* path, unsigned long& val){
 
 }
 
-ERR_Type __W_SD::readFile(const char * path, char* buffer){
+// dump read data to the log, only used when SD_DUMP_READS is set.
+static void dumpData(const uint8_t* data, size_t len){
+    for(size_t i = 0; i < len; i++){
+        Logger::getInstance().write<LogLevel::DataDump>((char)data[i]);
+    }
+}
+
+ERR_Type __W_SD::readFile(const char * path, uint8_t * buffer, size_t size, size_t& read){
+    read = 0;
+    SD_Lock L;
+    if(!L){return SD_BUSY;}
     if(checkInitialized()){return NOT_INITIALIZED;} // don't act on to the SD hardware if not properly intialized;
     
-    Logger::getInstance().println(String("[SD] Reading file: " + String(path)), LogLevel::Info);
+    Logger::getInstance().println<LogLevel::Info>("[SD] Reading file: ", path);
 
-    File file = ESP_SD->open(path);
+    StorageFile file = storage->open(path, StorageMode::Read);
     if(!file){
-        Logger::getInstance().println("[SD] Failed to open file for reading", LogLevel::Error);
-        file.close();
+        Logger::getInstance().println<LogLevel::Error>("[SD] Failed to open file for reading");
+        return SD_FILE_OPEN_FAIL;
+    }
+
+    size_t len = file.size();
+    // read the whole file in one go, the file system splits it up into sector reads.
+    read = file.read(buffer, len < size ? len : size);
+    file.close();
+
+    if(SD_DUMP_READS){
+        Logger::getInstance().println<LogLevel::DataDump>("[SD] Read from file: ");
+        dumpData(buffer, read);
+        Logger::getInstance().dataDumpEnd<LogType::Serial_SD>();
+    }
+    if(len > size){
+        Logger::getInstance().println<LogLevel::Error>("[SD] File of ", (uint32_t)len, " bytes does not fit in a buffer of ", (uint32_t)size, " bytes");
+        return SD_BUFFER_TOO_SMALL;
+    }
+    return SUCCESS;
+}
+
+ERR_Type __W_SD::readFileChunks(const char * path, SD_ChunkCallback callback, void * context, uint8_t * block, size_t block_size){
+    SD_Lock L;
+    if(!L){return SD_BUSY;}
+    if(checkInitialized()){return NOT_INITIALIZED;} // don't act on to the SD hardware if not properly intialized;
+
+    Logger::getInstance().println<LogLevel::Info>("[SD] Reading file in blocks of ", (uint32_t)block_size, " bytes: ", path);
+
+    StorageFile file = storage->open(path, StorageMode::Read);
+    if(!file){
+        Logger::getInstance().println<LogLevel::Error>("[SD] Failed to open file for reading");
         return SD_FILE_OPEN_FAIL;
     }
 
-    Logger::getInstance().println("[SD] Read from file: ", LogLevel::Info);
-    // read the file into the buffer and print to the logger
-    uint64_t i = 0;
-    while(file.available()){
-        buffer[i++] = file.read();
-        Logger::getInstance().write(buffer[i-1], LogLevel::DataDump);
+    if(SD_DUMP_READS){
+        Logger::getInstance().println<LogLevel::DataDump>("[SD] Read from file: ");
+    }
+    size_t len;
+    while((len = file.read(block, block_size)) > 0){
+        if(SD_DUMP_READS){
+            dumpData(block, len);
+        }
+        if(!callback(block, len, context)){
+            break; // the callback has read enough.
+        }
     }
     file.close();
-	Logger::getInstance().dataDumpEnd(LogType::Serial_SD);
+    if(SD_DUMP_READS){
+        Logger::getInstance().dataDumpEnd<LogType::Serial_SD>();
+    }
     return SUCCESS;
 }
 
 ERR_Type __W_SD::writeFile(const char * path, const char * message){
+    SD_Lock L;
+    if(!L){return SD_BUSY;}
     if(checkInitialized()){return NOT_INITIALIZED;} // don't act on to the SD hardware if not properly intialized;
 
-    Logger::getInstance().println(String("[SD] Writing file: " + String(path)), LogLevel::SD_printInfo, LogType::Serial);
+    Logger::getInstance().println<LogLevel::SD_printInfo, LogType::Serial>("[SD] Writing file: ", path);
 
-    File file = ESP_SD->open(path, FILE_WRITE);
+    StorageFile file = storage->open(path, StorageMode::Write);
     if(!file){
-        Logger::getInstance().println("[SD] Failed to open file for writing", LogLevel::Error, LogType::Serial);
+        Logger::getInstance().println<LogLevel::Error, LogType::Serial>("[SD] Failed to open file for writing");
         return SD_FILE_OPEN_FAIL;
     }
-    if(file.print(message)){
-        Logger::getInstance().println("[SD] File written", LogLevel::SD_printInfo, LogType::Serial);
+    size_t written = file.print(message);
+    useSpace(written);
+    if(written){
+        Logger::getInstance().println<LogLevel::SD_printInfo, LogType::Serial>("[SD] File written");
     } else {
-        Logger::getInstance().println("[SD] Write failed", LogLevel::Warning, LogType::Serial);
+        Logger::getInstance().println<LogLevel::Warning, LogType::Serial>("[SD] Write failed");
         file.close();
         return SD_WRITE_FAIL;
     }
@@ -180,20 +279,23 @@ ERR_Type __W_SD::writeFile(const char * path, const char * message){
 }
 
 ERR_Type __W_SD::appendFile(const char * path, const char * message){
+    SD_Lock L;
+    if(!L){return SD_BUSY;}
     if(checkInitialized()){return NOT_INITIALIZED;} // don't act on to the SD hardware if not properly intialized;
 
-    Logger::getInstance().println(String("[SD] Appending to file: " + String(path)), LogLevel::SD_printInfo, LogType::Serial);
+    Logger::getInstance().println<LogLevel::SD_printInfo, LogType::Serial>("[SD] Appending to file: ", path);
 
-    File file = ESP_SD->open(path, FILE_APPEND);
+    StorageFile file = storage->open(path, StorageMode::Append);
     if(!file){
-        Logger::getInstance().println("[SD] Failed to open file for appending", LogLevel::Error, LogType::Serial);
+        Logger::getInstance().println<LogLevel::Error, LogType::Serial>("[SD] Failed to open file for appending");
         return SD_FILE_OPEN_FAIL;
     }
-    if(file.print(message)){
-        Logger::getInstance().println("[SD] Message appended", LogLevel::SD_printInfo, LogType::Serial);
-        return SUCCESS;
+    size_t written = file.print(message);
+    useSpace(written);
+    if(written){
+        Logger::getInstance().println<LogLevel::SD_printInfo, LogType::Serial>("[SD] Message appended");
     } else {
-        Logger::getInstance().println("[SD] Append failed", LogLevel::Warning, LogType::Serial);
+        Logger::getInstance().println<LogLevel::Warning, LogType::Serial>("[SD] Append failed");
         file.close();
         return SD_APP_FAIL;
     }
@@ -201,39 +303,76 @@ ERR_Type __W_SD::appendFile(const char * path, const char * message){
     return SUCCESS;
 }
 
+ERR_Type __W_SD::appendFile(const char * path, const uint8_t * data, size_t len){
+    SD_Lock L;
+    if(!L){return SD_BUSY;}
+    if(checkInitialized()){return NOT_INITIALIZED;} // don't act on to the SD hardware if not properly intialized;
+
+    Logger::getInstance().println<LogLevel::SD_printInfo, LogType::Serial>("[SD] Appending ", (uint32_t)len, " bytes to file: ", path);
+
+    StorageFile file = storage->open(path, StorageMode::Append);
+    if(!file){
+        Logger::getInstance().println<LogLevel::Error, LogType::Serial>("[SD] Failed to open file for appending");
+        return SD_FILE_OPEN_FAIL;
+    }
+    size_t written = file.write(data, len);
+    useSpace(written);
+    if(written != len){
+        Logger::getInstance().println<LogLevel::Warning, LogType::Serial>("[SD] Append failed");
+        file.close();
+        return SD_APP_FAIL;
+    }
+    file.close();
+    Logger::getInstance().println<LogLevel::SD_printInfo, LogType::Serial>("[SD] Bytes appended");
+    return SUCCESS;
+}
+
 ERR_Type __W_SD::renameFile(const char * path1, const char * path2){
+    SD_Lock L;
+    if(!L){return SD_BUSY;}
     if(checkInitialized()){return NOT_INITIALIZED;} // don't act on to the SD hardware if not properly intialized;
 
-    Logger::getInstance().println(String("[SD] Renaming file " + String(path1) + " to " + String(path2)), LogLevel::Info);
-    if (ESP_SD->rename(path1, path2)) {
-        Logger::getInstance().println("[SD] File renamed", LogLevel::Info);
+    Logger::getInstance().println<LogLevel::Info>("[SD] Renaming file ", path1, " to ", path2);
+    if (storage->rename(path1, path2)) {
+        Logger::getInstance().println<LogLevel::Info>("[SD] File renamed");
         return SUCCESS;
     } else {
-        Logger::getInstance().println("[SD] Rename failed", LogLevel::Error);
+        Logger::getInstance().println<LogLevel::Error>("[SD] Rename failed");
         return SD_RENAME_FAIL;
     }
 }
 
 ERR_Type __W_SD::deleteFile(const char * path){
+    SD_Lock L;
+    if(!L){return SD_BUSY;}
     if(checkInitialized()){return NOT_INITIALIZED;} // don't act on to the SD hardware if not properly intialized;
 
-    Logger::getInstance().println(String("[SD] Deleting file: " + String(path)), LogLevel::Info);
-    if(ESP_SD->remove(path)){
-        Logger::getInstance().println("[SD] File deleted", LogLevel::Info);
+    Logger::getInstance().println<LogLevel::Info>("[SD] Deleting file: ", path);
+    size_t size = 0;
+    StorageFile file = storage->open(path, StorageMode::Read);
+    if(file){
+        size = file.size();
+        file.close();
+    }
+    if(storage->remove(path)){
+        free_space += size;
+        Logger::getInstance().println<LogLevel::Info>("[SD] File deleted");
         return SUCCESS;
     } else {
-        Logger::getInstance().println("[SD] Delete failed", LogLevel::Warning);
+        Logger::getInstance().println<LogLevel::Warning>("[SD] Delete failed");
         return SD_RM_FAIL;
     }
 }
 
 ERR_Type __W_SD::testFileIO(const char * path){
+    SD_Lock L;
+    if(!L){return SD_BUSY;}
     if(checkInitialized()){return NOT_INITIALIZED;} // don't act on to the SD hardware if not properly intialized;
     
-    Logger::getInstance().println("[SD] Testing FileIO", LogLevel::Info);
+    Logger::getInstance().println<LogLevel::Info>("[SD] Testing FileIO");
 
     // open a file and read 512 bytes. check how long it took and print that time.
-    File file = ESP_SD->open(path);
+    StorageFile file = storage->open(path, StorageMode::Read);
     static uint8_t buf[512];
     size_t len = 0;
     uint32_t start = millis();
@@ -251,17 +390,17 @@ ERR_Type __W_SD::testFileIO(const char * path){
             len -= toRead;
         }
         end = millis() - start;
-        Logger::getInstance().println(String(String((uint32_t)flen) + " bytes read for " + String(end) + " ms"), LogLevel::Info);
+        Logger::getInstance().println<LogLevel::Info>((uint32_t)flen, " bytes read for ", end, " ms");
         file.close();
     } else {
-        Logger::getInstance().println("[SD] Failed to open file for reading", LogLevel::Error);
+        Logger::getInstance().println<LogLevel::Error>("[SD] Failed to open file for reading");
         return SD_FILE_OPEN_FAIL;
     }
 
     // open a file and write 2048 * 512 bytes. check how long it took and print that time.
-    file = ESP_SD->open(path, FILE_WRITE);
+    file = storage->open(path, StorageMode::Write);
     if(!file){
-        Logger::getInstance().println("[SD] Failed to open file for writing", LogLevel::Error);
+        Logger::getInstance().println<LogLevel::Error>("[SD] Failed to open file for writing");
         file.close();
         return SD_FILE_OPEN_FAIL;
     }
@@ -272,7 +411,188 @@ ERR_Type __W_SD::testFileIO(const char * path){
         file.write(buf, 512);
     }
     end = millis() - start;
-	Logger::getInstance().println(String(String((uint32_t)2048 * 512) + " bytes written for " + String(end) + " ms"), LogLevel::Info);
+	Logger::getInstance().println<LogLevel::Info>((uint32_t)2048 * 512, " bytes written for ", end, " ms");
     file.close();
     return SUCCESS;
+}
+
+ERR_Type __W_SD::benchmark(const char * csv_path){
+    SD_Lock L;
+    if(!L){return SD_BUSY;}
+    if(checkInitialized()){return NOT_INITIALIZED;} // don't act on to the SD hardware if not properly intialized;
+
+    SD_Benchmark* bench = new (std::nothrow) SD_Benchmark(*storage);
+    if(!bench){
+        Logger::getInstance().println<LogLevel::Error>("[SD] Not enough memory for the benchmark");
+        return ERROR;
+    }
+    Logger::getInstance().println<LogLevel::Info>("[SD] Starting benchmark on ", storage->name(), " in ", SD_BENCH_DIR);
+    ERR_Type ET = bench->run(csv_path);
+    if(ET){
+        Logger::getInstance().println<LogLevel::Error>("[SD] Benchmark failed with error ", (int)ET);
+    }
+    size_t count;
+    const SD_BenchResult* results = bench->getResults(count);
+    char line[128];
+    for(size_t i = 0; i < count; i++){
+        SD_Benchmark::formatResult(results[i], line, sizeof(line));
+        Logger::getInstance().println<LogLevel::Info>("[SD] ", line);
+    }
+    delete bench;
+    updateFreeSpace();
+    return ET;
+}
+
+ERR_Type __W_SD::readBytes(const char * path, size_t offset, uint8_t * buffer, size_t len, size_t& read){
+    read = 0;
+    SD_Lock L;
+    if(!L){return SD_BUSY;}
+    if(checkInitialized()){return NOT_INITIALIZED;} // don't act on to the SD hardware if not properly intialized;
+
+    StorageFile file = storage->open(path, StorageMode::Read);
+    if(!file){
+        Logger::getInstance().println<LogLevel::Error, LogType::Serial>("[SD] Failed to open file for reading");
+        return SD_FILE_OPEN_FAIL;
+    }
+    if(offset && !file.seek(offset)){
+        file.close();
+        return READ_FAIL;
+    }
+    read = file.read(buffer, len);
+    file.close();
+    return SUCCESS;
+}
+
+ERR_Type __W_SD::writeBytes(const char * path, size_t offset, const uint8_t * data, size_t len){
+    SD_Lock L;
+    if(!L){return SD_BUSY;}
+    if(checkInitialized()){return NOT_INITIALIZED;} // don't act on to the SD hardware if not properly intialized;
+
+    Logger::getInstance().println<LogLevel::SD_printInfo, LogType::Serial>("[SD] Writing ", (uint32_t)len, " bytes at ", (uint32_t)offset, " in file: ", path);
+
+    // "r+" keeps the content of the file, but can not create it.
+    StorageFile file = storage->open(path, storage->exists(path) ? StorageMode::Update : StorageMode::Write);
+    if(!file){
+        Logger::getInstance().println<LogLevel::Error, LogType::Serial>("[SD] Failed to open file for writing");
+        return SD_FILE_OPEN_FAIL;
+    }
+    size_t size = file.size();
+    if(offset && !file.seek(offset)){
+        file.close();
+        return SD_WRITE_FAIL;
+    }
+    size_t written = file.write(data, len);
+    if(offset + written > size){
+        useSpace(offset + written - size);
+    }
+    file.close();
+    if(written != len){
+        Logger::getInstance().println<LogLevel::Warning, LogType::Serial>("[SD] Write failed");
+        return SD_WRITE_FAIL;
+    }
+    return SUCCESS;
+}
+
+ERR_Type __W_SD::updateFreeSpace(){
+    SD_Lock L;
+    if(!L){return SD_BUSY;}
+    if(checkInitialized()){return NOT_INITIALIZED;} // don't act on to the SD hardware if not properly intialized;
+    free_space = storage->totalBytes() - storage->usedBytes();
+    return SUCCESS;
+}
+
+bool __W_SD::exists(const char* path){
+    SD_Lock L;
+    return L && Initialized && storage->exists(path);
+}
+
+uint64_t __W_SD::getFreeSpace(){
+    SD_Lock L; // a 64 bit value is not read in one go.
+    return free_space;
+}
+
+bool __W_SD::cardPresent(){
+    return sd_storage.present();
+}
+
+ERR_Type __W_SD::openStream(SD_Stream& stream, const char * path){
+    SD_Lock L;
+    if(!L){return SD_BUSY;}
+#if STORAGE_FLASH_FALLBACK
+    // go back to the SD card once it is inserted again, the stream is then reopened on the card.
+    if(Initialized && !fixed_storage && storage == &flash_storage && cardPresent() && (millis() - last_mount_try) >= STORAGE_RETRY_INTERVAL){
+        last_mount_try = millis();
+        if(initSD() == SUCCESS){
+            Logger::getInstance().println<LogLevel::Info, LogType::Serial>("[SD] SD card is back, leaving the internal flash");
+        }
+    }
+#endif
+    if(stream.file && stream.storage == storage && stream.path == path){return SUCCESS;} // already open.
+    closeStream(stream);
+
+    // mount the card if it was removed and reinserted since the last init. Returns SUCCESS if it is already mounted.
+    ERR_Type ET = init();
+    if(ET){return ET;}
+
+    Logger::getInstance().println<LogLevel::SD_printInfo, LogType::Serial>("[SD] Opening stream: ", path);
+    stream.file = storage->open(path, StorageMode::Append);
+    if(!stream.file){
+        Logger::getInstance().println<LogLevel::Error, LogType::Serial>("[SD] Failed to open file for streaming");
+        return SD_FILE_OPEN_FAIL;
+    }
+    stream.storage = storage;
+    stream.path = path;
+    stream.last_sync = millis();
+    stream.dirty = false;
+    return SUCCESS;
+}
+
+ERR_Type __W_SD::appendStream(SD_Stream& stream, const uint8_t * data, size_t len){
+    SD_Lock L;
+    if(!L){return SD_BUSY;}
+    if(!stream.file){return SD_FILE_OPEN_FAIL;}
+    if(!stream.storage->present()){
+        // the card is gone, release the handle and unmount so a storage is mounted again by the next openStream().
+        Logger::getInstance().println<LogLevel::Error, LogType::Serial>("[SD] ", stream.storage->name(), " removed, closing stream");
+        stream.file.close();
+        stream.dirty = false;
+        if(stream.storage == storage){
+            storage->end();
+            Initialized = false;
+        }
+        return NO_SD_CARD;
+    }
+    size_t written = stream.file.write(data, len);
+    useSpace(written);
+    if(written != len){
+        Logger::getInstance().println<LogLevel::Warning, LogType::Serial>("[SD] Stream append failed");
+        return SD_APP_FAIL;
+    }
+    stream.dirty = true;
+    if((millis() - stream.last_sync) >= SD_SYNC_INTERVAL){
+        return syncStream(stream);
+    }
+    return SUCCESS;
+}
+
+ERR_Type __W_SD::syncStream(SD_Stream& stream){
+    SD_Lock L;
+    if(!L){return SD_BUSY;}
+    if(!stream.file){return SD_FILE_OPEN_FAIL;}
+    if(stream.dirty){
+        stream.file.flush(); // flushes the file system buffers and updates the directory entry.
+        stream.dirty = false;
+    }
+    stream.last_sync = millis();
+    return SUCCESS;
+}
+
+void __W_SD::closeStream(SD_Stream& stream){
+    SD_Lock L;
+    if(!L){return;} // the stream stays open, the next openStream() closes it.
+    if(!stream.file){return;}
+    syncStream(stream);
+    stream.file.close();
+    stream.storage = nullptr;
+    stream.path = "";
 }
\ No newline at end of file
@@ -5,6 +5,11 @@
  * @version 0.1
  * @date 2021-11-30
  * 
+ * The Logger writer task, the network task (spool and unacknowledged messages) and the setup code all use the storage.
+ * Every function of __W_SD holds a recursive mutex while it uses the storage, also while a storage is mounted, unmounted
+ * or switched, so a task never sees the storage change under a file it has open. A task that needs several calls in a row
+ * without another task in between holds an SD_Lock around them.
+ * 
  * @copyright Copyright (c) 2021
  * 
  */
@@ -14,8 +19,43 @@
 #include "../__W_Module/__iW_Module.h"
 #include "../Singleton/Singleton.h"
 
-#include <FS.h>
-#include <SD.h>
+#include "../Storage/iStorage.h"
+#include "../Storage/FS_Storage.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+/**
+ * @addtogroup STRUCT
+ * @{
+ */
+/**
+ * @brief Handle to a file that is kept open for appending.
+ * Should only be used through the __W_SD stream functions.
+ * @see __W_SD::openStream()
+ */
+struct SD_Stream {
+	/** The opened file. */
+	StorageFile file;
+	/** The storage on which the file is opened. */
+	iStorage* storage = nullptr;
+	/** Path of the opened file. */
+	String path;
+	/** Time in ms of the last sync to the card. */
+	uint32_t last_sync = 0;
+	/** True when data has been written since the last sync. */
+	bool dirty = false;
+};
+/**@}*/
+
+/**
+ * @brief Callback that receives the blocks of a file read by __W_SD::readFileChunks().
+ * @param data the read block.
+ * @param len the length of the block.
+ * @param context the context pointer passed to readFileChunks().
+ * @return true to continue reading, false to stop.
+ */
+typedef bool (*SD_ChunkCallback)(const uint8_t* data, size_t len, void* context);
 
 /**
  * @brief Singleton SD module.
@@ -23,8 +63,28 @@
  */
 class __W_SD : public __iW_Module, public iSingleton {
 private:
-	/** SD library handle */
-	SDFS* ESP_SD; 
+	/** The storage that is used, nullptr when nothing is mounted. */
+	iStorage* storage = nullptr;
+	/** The SD card. */
+	SD_Storage sd_storage;
+	/** LittleFS on the internal flash, used when the SD card is absent. */
+	LittleFS_Storage flash_storage;
+	/** True when the storage has been given to init(), it is then never replaced. */
+	bool fixed_storage = false;
+	/** Amount of times a storage has been mounted. */
+	uint32_t mount_count = 0;
+	/** Time in ms of the last attempt to mount the SD card while the fallback is used. */
+	uint32_t last_mount_try = 0;
+	/** Free space on the card in bytes, counted down on writes so the slow FAT free cluster scan is only done at init. */
+	uint64_t free_space = 0;
+	/** Recursive mutex of the storage, held by every function that uses the storage. */
+	SemaphoreHandle_t lock = nullptr;
+
+	/**
+	 * @brief Subtracts the written bytes from the free space.
+	 * @param len the amount of written bytes.
+	 */
+	void useSpace(size_t len){ free_space = free_space > len ? free_space - len : 0; }
 
 	/**
 	 * @brief virtual implementation of the iW_Module function.
@@ -34,8 +94,21 @@ private:
 	 */
 	virtual bool checkInitialized();
 
+	/**
+	 * @brief Mounts the SD card and prints its info.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 */
+	ERR_Type initSD();
+	/**
+	 * @brief Mounts the given storage and starts using it.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 */
+	ERR_Type mount(iStorage& backend);
+
 	// remove access to the constructor of __W_SD.
-	__W_SD(){}
+	__W_SD() : sd_storage(SD), flash_storage(LittleFS) {
+		lock = xSemaphoreCreateRecursiveMutex(); // created with the instance, so no task can see the instance without it.
+	}
 
 public:
 	/**
@@ -59,6 +132,45 @@ public:
 	 * @see ERR_Type
 	 */
 	ERR_Type init();
+	/**
+	 * @brief Initializes the SD object on the given storage instead of the SD card, for example a POSIX_Storage.
+	 * The storage is used until the program exits, there is no fallback to another storage.
+	 * @param backend the storage to use.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 * @see ERR_Type
+	 */
+	ERR_Type init(iStorage& backend);
+
+	/**
+	 * @brief Locks the storage for the calling task, should be followed by release(). Mostly used through an SD_Lock.
+	 * @return true the storage is locked.
+	 * @return false another task did not release the storage within SD_LOCK_TIMEOUT.
+	 */
+	bool acquire(){ return xSemaphoreTakeRecursive(lock, pdMS_TO_TICKS(SD_LOCK_TIMEOUT)) == pdTRUE; }
+	/**
+	 * @brief Releases the lock taken by acquire().
+	 */
+	void release(){ xSemaphoreGiveRecursive(lock); }
+
+	/**
+	 * @brief Returns the storage that is used.
+	 * The storage can be unmounted or switched by another task, so the returned storage should only be used while an SD_Lock is held.
+	 * @return iStorage* the storage, nullptr when nothing is mounted.
+	 */
+	iStorage* getStorage(){ return Initialized ? storage : nullptr; }
+	/**
+	 * @brief Checks if a file or directory exists.
+	 * @param path the path.
+	 * @return true the path exists on the mounted storage.
+	 * @return false the path does not exist, nothing is mounted or the storage is busy.
+	 */
+	bool exists(const char* path);
+	/**
+	 * @brief Returns the amount of times a storage has been mounted.
+	 * The files on the storage can have changed when this value changes, for example when the SD card has been swapped
+	 * or the flash fallback has been taken into use.
+	 */
+	uint32_t getMountCount(){ return mount_count; }
 
 	/**
 	 * @brief lists the directories in given path.
@@ -97,13 +209,37 @@ public:
 	ERR_Type getFileSize(const char* path, unsigned long& val);
 	/**
 	 * @brief Reads the file at the given path into the passed buffer.
+	 * When the file is larger than the buffer only the start of the file is read and SD_BUFFER_TOO_SMALL is returned.
 	 * 
 	 * @param path the path to the file.
 	 * @param buffer the buffer that is read into.
+	 * @param size the size of the buffer.
+	 * @param read the amount of bytes that have been read.
 	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
 	 * @see ERR_Type
 	 */
-	ERR_Type readFile(const char * path, char* buffer);
+	ERR_Type readFile(const char * path, uint8_t * buffer, size_t size, size_t& read);
+	/**
+	 * @brief Reads the file at the given path block by block and passes every block to the callback.
+	 * Only the block buffer is used, so files of any size can be read.
+	 * 
+	 * @param path the path to the file.
+	 * @param callback the function that receives the blocks, can stop the read by returning false.
+	 * @param context pointer that is passed on to the callback.
+	 * @param block buffer for a single block.
+	 * @param block_size the size of the block buffer, blocks of 512 bytes match the SD sector size.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 * @see ERR_Type
+	 */
+	ERR_Type readFileChunks(const char * path, SD_ChunkCallback callback, void * context, uint8_t * block, size_t block_size);
+	/**
+	 * @brief Reads the file at the given path in blocks of SD_READ_BLOCK_SIZE bytes, the block buffer is taken from the stack.
+	 * @see readFileChunks()
+	 */
+	ERR_Type readFileChunks(const char * path, SD_ChunkCallback callback, void * context){
+		uint8_t block[SD_READ_BLOCK_SIZE];
+		return readFileChunks(path, callback, context, block, sizeof(block));
+	}
 	/**
 	 * @brief rewrites the message to the given file.
 	 * 
@@ -122,6 +258,16 @@ public:
 	 * @see ERR_Type
 	 */
 	ERR_Type appendFile(const char * path, const char * message);
+	/**
+	 * @brief Adds the given bytes at the end of the file.
+	 * 
+	 * @param path the path to the file.
+	 * @param data the bytes to be added to the file.
+	 * @param len the amount of bytes.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 * @see ERR_Type
+	 */
+	ERR_Type appendFile(const char * path, const uint8_t * data, size_t len);
 	/**
 	 * @brief renames the file to the given name.
 	 * e.g. "/path/to/file" "/path/to/file2" rewrites "file" to "file2".
@@ -148,4 +294,122 @@ public:
 	 * @see ERR_Type
 	 */
 	ERR_Type testFileIO(const char * path);
+	/**
+	 * @brief Runs the SD_Benchmark on the card and writes the results as CSV.
+	 * The benchmark buffers are allocated for the duration of the run.
+	 * 
+	 * @param csv_path the path of the CSV file.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 * @see ERR_Type
+	 * @see SD_Benchmark
+	 */
+	ERR_Type benchmark(const char * csv_path = SD_BENCH_CSV);
+
+	/**
+	 * @brief Reads bytes from the given position in a file.
+	 * 
+	 * @param path the path to the file.
+	 * @param offset the position in the file to start reading from.
+	 * @param buffer the buffer that is read into.
+	 * @param len the size of the buffer.
+	 * @param read the amount of bytes that have been read.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 * @see ERR_Type
+	 */
+	ERR_Type readBytes(const char * path, size_t offset, uint8_t * buffer, size_t len, size_t& read);
+	/**
+	 * @brief Overwrites bytes at the given position in a file, the rest of the file is kept.
+	 * The file is created when it does not exist.
+	 * 
+	 * @param path the path to the file.
+	 * @param offset the position in the file to start writing.
+	 * @param data the bytes to be written.
+	 * @param len the amount of bytes.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 * @see ERR_Type
+	 */
+	ERR_Type writeBytes(const char * path, size_t offset, const uint8_t * data, size_t len);
+
+	/**
+	 * @brief Returns the free space on the card.
+	 * The free space is read from the card at init and afterwards counted down by the writes through this class,
+	 * and counted up by deleteFile(). It is not rounded to clusters, so call updateFreeSpace() for the exact value.
+	 * 
+	 * @return uint64_t the free space in bytes.
+	 */
+	uint64_t getFreeSpace();
+	/**
+	 * @brief Reads the free space from the storage. On the SD card this scans the FAT, which can take a while on large cards.
+	 * 
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 * @see ERR_Type
+	 */
+	ERR_Type updateFreeSpace();
+
+	/**
+	 * @brief Checks the card detect switch.
+	 * 
+	 * @return true an SD card is inserted.
+	 * @return false no SD card is inserted.
+	 */
+	bool cardPresent();
+
+	// stream functions.
+	// ----------
+
+	/**
+	 * @brief Opens the file at the given path for appending and keeps it open in the stream.
+	 * If the stream already has this file open nothing happens, if it has another file open that file is closed first.
+	 * When the SD card has been removed and reinserted this will mount it again.
+	 * @param stream the stream handle.
+	 * @param path the path to the file.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 * @see ERR_Type
+	 */
+	ERR_Type openStream(SD_Stream& stream, const char * path);
+	/**
+	 * @brief Adds the given bytes at the end of the opened file.
+	 * The stream is synced every SD_SYNC_INTERVAL ms. If the card has been removed the stream is closed.
+	 * @param stream the stream handle.
+	 * @param data the bytes to be added to the file.
+	 * @param len the amount of bytes.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 * @see ERR_Type
+	 */
+	ERR_Type appendStream(SD_Stream& stream, const uint8_t * data, size_t len);
+	/**
+	 * @brief Writes the data that is buffered by the file system to the card.
+	 * 
+	 * @param stream the stream handle.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 * @see ERR_Type
+	 */
+	ERR_Type syncStream(SD_Stream& stream);
+	/**
+	 * @brief Syncs and closes the file of the stream.
+	 * 
+	 * @param stream the stream handle.
+	 */
+	void closeStream(SD_Stream& stream);
+};
+
+/**
+ * @brief Holds the lock of the storage for its scope.
+ * Used by the __W_SD functions themselves, and by a task that has to do several __W_SD calls without another task in between.
+ * @code
+ * SD_Lock L;
+ * if(!L){return SD_BUSY;}
+ * @endcode
+ */
+class SD_Lock {
+private:
+	/** True when the lock has been taken. */
+	bool locked;
+public:
+	SD_Lock() : locked(__W_SD::getInstance().acquire()) {}
+	~SD_Lock(){ if(locked){__W_SD::getInstance().release();} }
+	SD_Lock(SD_Lock const&)			= delete;	// the lock is released once.
+	void operator=(SD_Lock const&)	= delete;
+	/** @brief Returns true when the lock has been taken. */
+	explicit operator bool() const { return locked; }
 };
\ No newline at end of file
@@ -2,84 +2,166 @@
 #include "__W_AS726X.h"
 #include "../../../Logger/Logger.h"
 
+volatile bool __W_AS726X::data_ready = false;
+
+void IRAM_ATTR __W_AS726X::onDataReady(){
+	data_ready = true;
+}
+
 bool __W_AS726X::checkInitialized(){
     if(Initialized){
         return 0;
     }
     else{
-        Logger::getInstance().println("AS7226X is not initialized!", LogLevel::Error);
+        Logger::getInstance().println<LogLevel::Error>("AS7226X is not initialized!");
         return 1;
     }
 }
 
 ERR_Type __W_AS726X::init(){
 	if(Initialized){return ALREADY_INITIALIZED;}	// return if already initialized;
-	if(!AS7262.begin()){
-		Logger::getInstance().println("Could not connect to AS726X! Please check your wiring.", LogLevel::Error);
+	I2CTransaction T(I2CDevice::AS7262);
+	if(!T || !T.check(AS7262.begin())){
+		Logger::getInstance().println<LogLevel::Error>("Could not connect to AS726X! Please check your wiring.");
 		return AS726X_BEGIN_ERR;	
 	}
-	Logger::getInstance().println("AS7262 initialized", LogLevel::Info);
+	I2CBus::getInstance().reconfigure(); // the library restarts Wire in its begin().
+	// convert all six channels continuously, a new spectrum is ready every two integration times.
+	AS7262.setConversionType(MODE_2);
+	T.checkLast();
+#if AS7262_INT_PIN >= 0
+	pinMode(AS7262_INT_PIN, INPUT_PULLUP);
+	attachInterrupt(digitalPinToInterrupt(AS7262_INT_PIN), onDataReady, FALLING);
+	AS7262.enableInterrupt();
+	T.checkLast();
+#endif
+	Logger::getInstance().println<LogLevel::Info>("AS7262 initialized");
 	Initialized = true;
 	return SUCCESS;
 }
 
 void __W_AS726X::setDrvLed(bool on){
 	if(checkInitialized()){return;} // don't act on to the hardware if not properly intialized;
+	I2CTransaction T(I2CDevice::AS7262);
+	if(!T){return;}
 	if(on){	AS7262.drvOn();	}
 	else{	AS7262.drvOff();}
+	T.checkLast();
 }
 
 void __W_AS726X::setDrvCurrent(uint8_t current){
 	if(checkInitialized()){return;} // don't act on to the hardware if not properly intialized;
+	I2CTransaction T(I2CDevice::AS7262);
+	if(!T){return;}
 	AS7262.setDrvCurrent(current);
+	T.checkLast();
 }
 
 void __W_AS726X::indicateLED(bool on){
 	if(checkInitialized()){return;} // don't act on to the hardware if not properly intialized;
+	I2CTransaction T(I2CDevice::AS7262);
+	if(!T){return;}
 	AS7262.indicateLED(on);
+	T.checkLast();
 }
 
 void __W_AS726X::setIndicateCurrent(uint8_t current){
 	if(checkInitialized()){return;} // don't act on to the hardware if not properly intialized;
+	I2CTransaction T(I2CDevice::AS7262);
+	if(!T){return;}
 	AS7262.setIndicateCurrent(current);
+	T.checkLast();
 }
 
 void __W_AS726X::setGain(uint8_t gain){
 	if(checkInitialized()){return;} // don't act on to the hardware if not properly intialized;
+	I2CTransaction T(I2CDevice::AS7262);
+	if(!T){return;}
 	AS7262.setGain(gain);
+	T.checkLast();
 }
 
 void __W_AS726X::setIntegrationTime(uint8_t time){
 	if(checkInitialized()){return;} // don't act on to the hardware if not properly intialized;
+	I2CTransaction T(I2CDevice::AS7262);
+	if(!T){return;}
 	AS7262.setIntegrationTime(time);
+	T.checkLast();
 }
 
 void __W_AS726X::setConversionType(uint8_t type){
 	if(checkInitialized()){return;} // don't act on to the hardware if not properly intialized;
+	I2CTransaction T(I2CDevice::AS7262);
+	if(!T){return;}
 	AS7262.setConversionType(type);
+	T.checkLast();
 }
 
 void __W_AS726X::startMeasurement(){
 	if(checkInitialized()){return;} // don't act on to the hardware if not properly intialized;
+	I2CTransaction T(I2CDevice::AS7262);
+	if(!T){return;}
 	AS7262.startMeasurement();
+	T.checkLast();
 }
 
 bool __W_AS726X::checkDataReady(){
 	if(checkInitialized()){return false;} // don't act on to the hardware if not properly intialized;
-	return AS7262.dataReady();
+	I2CTransaction T(I2CDevice::AS7262);
+	if(!T){return false;}
+	bool ready = AS7262.dataReady();
+	return T.checkLast() && ready;
 }
 
 void __W_AS726X::getMeasurements(ColorSpectrum* CS){
 	if(checkInitialized()){return;} // don't act on to the hardware if not properly intialized;
-	CS->Violet = AS7262.readCalibratedViolet();
-	CS->Blue = AS7262.readCalibratedBlue();
-	CS->Green = AS7262.readCalibratedGreen();
-	CS->Yellow = AS7262.readCalibratedYellow();
-	CS->Orange = AS7262.readCalibratedOrange();
-	CS->Red = AS7262.readCalibratedRed();
+	float values[AS726x_NUM_CHANNELS];
+	I2CTransaction T(I2CDevice::AS7262);
+	if(!T){return;}
+	AS7262.readCalibratedValues(values, AS726x_NUM_CHANNELS); // reads the channels in order, from violet to red.
+	if(!T.checkLast()){return;}
+	CS->Violet = values[0];
+	CS->Blue = values[1];
+	CS->Green = values[2];
+	CS->Yellow = values[3];
+	CS->Orange = values[4];
+	CS->Red = values[5];
 }
 
 uint8_t __W_AS726X::getTemperature(){
 	if(checkInitialized()){return 0;} // don't act on to the hardware if not properly intialized;
-	return AS7262.readTemperature();
+	I2CTransaction T(I2CDevice::AS7262);
+	if(!T){return 0;}
+	return T.checkLast(AS7262.readTemperature());
+}
+
+bool __W_AS726X::ready(uint32_t now){
+	(void)now;
+#if AS7262_INT_PIN >= 0
+	return data_ready;
+#else
+	return checkDataReady();
+#endif
+}
+
+ERR_Type __W_AS726X::collect(uint32_t now){
+	if(checkInitialized()){return NOT_INITIALIZED;} // don't act on to the hardware if not properly intialized;
+	I2CTransaction T(I2CDevice::AS7262);
+	if(!T){return I2C_BUS_BUSY;}
+	data_ready = false;
+	// fill the slot that is not read by getSample(), and only then make it the front.
+	uint8_t back = front ^ 1;
+	float values[AS726x_NUM_CHANNELS];
+	AS7262.readCalibratedValues(values, AS726x_NUM_CHANNELS);
+	if(!T.checkLast()){return READ_FAIL;} // keep the previous spectrum.
+	ColorSpectrum& CS = cache[back].spectrum;
+	CS.Violet = values[0];
+	CS.Blue = values[1];
+	CS.Green = values[2];
+	CS.Yellow = values[3];
+	CS.Orange = values[4];
+	CS.Red = values[5];
+	cache[back].time = now ? now : 1; // 0 means that there is no spectrum yet.
+	front = back;
+	return SUCCESS;
 }
\ No newline at end of file
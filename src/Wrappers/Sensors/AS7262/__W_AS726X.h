@@ -13,6 +13,7 @@
 #include <Adafruit_AS726x.h>
 #include "../../__W_Module/__iW_Module.h"
 #include "../../Singleton/Singleton.h"
+#include "../../I2C/I2CBus.h"
 
 /**
  * @addtogroup STRUCT
@@ -34,6 +35,14 @@ struct ColorSpectrum {
 	/** @brief Measured red color spectrum value */
 	float Red;
 };
+
+/** @brief A collected spectrum with the time at which it was read. */
+struct AS726X_Sample {
+	/** @brief The calibrated spectrum. */
+	ColorSpectrum spectrum;
+	/** @brief Time in ms at which the spectrum was read, 0 when no spectrum has been read yet. */
+	uint32_t time;
+};
 /**@}*/
 
 /**
@@ -43,6 +52,15 @@ class __W_AS726X : public __iW_Module, public iSingleton {
 private:
 	/** @brief Handle to the adafruit AS726x library. */
 	Adafruit_AS726x AS7262;
+	/** @brief Double buffered cache of the collected spectra, collect() writes the slot that is not the front. */
+	AS726X_Sample cache[2] = {AS726X_Sample(), AS726X_Sample()};
+	/** @brief Index of the slot in the cache that holds the freshest complete spectrum. */
+	volatile uint8_t front = 0;
+	/** @brief Set by the INT pin interrupt when a conversion has finished. */
+	static volatile bool data_ready;
+
+	/** @brief Interrupt handler of the INT pin. */
+	static void IRAM_ATTR onDataReady();
 
 	/**
 	 * @brief virtual implementation of the iW_Module function.
@@ -111,7 +129,8 @@ public:
 	void setConversionType(uint8_t type);
 
 	/**
-	 * @brief Start a measurement.
+	 * @brief Start a one shot measurement.
+	 * This switches the sensor out of the continuous mode that is set by init().
 	 */
 	void startMeasurement();
 	/**
@@ -131,4 +150,33 @@ public:
 	 * @return uint8_t The read temperature.
 	 */
 	uint8_t getTemperature();
+
+	/**
+	 * @brief Checks if the sensor has a new conversion.
+	 * The sensor converts continuously, so no measurement has to be started.
+	 * Uses the INT pin when AS7262_INT_PIN is set, else the data ready flag of the sensor.
+	 * @param now the time in ms.
+	 * @return true a new conversion can be collected.
+	 * @return false the conversion is still running.
+	 */
+	virtual bool ready(uint32_t now);
+	/**
+	 * @brief Reads the six calibrated channels into the cache, they can be read with getSample() or getData().
+	 * This is not a burst read: the library reads every byte through the virtual registers of the sensor, each after
+	 * polling the status register, so the 24 bytes take many small transfers. The bus is held for all of them, so the
+	 * six channels are from the same conversion.
+	 * @param now the time in ms.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 */
+	virtual ERR_Type collect(uint32_t now);
+	/**
+	 * @brief Returns the freshest complete spectrum from the cache, does not access the sensor.
+	 * @return AS726X_Sample copy of the spectrum and the time at which it was read.
+	 */
+	AS726X_Sample getSample() const { return cache[front]; }
+	/**
+	 * @brief Returns the freshest complete spectrum from the cache, does not access the sensor.
+	 * @return ColorSpectrum copy of the spectrum.
+	 */
+	ColorSpectrum getData() const { return cache[front].spectrum; }
 };
\ No newline at end of file
@@ -7,7 +7,7 @@ bool __W_Ambimate::checkInitialized(){
         return 0;
     }
     else{
-        Logger::getInstance().println("Ambimate is not initialized!", LogLevel::Error);
+        Logger::getInstance().println<LogLevel::Error>("Ambimate is not initialized!");
         return 1;
     }
 }
@@ -16,76 +16,99 @@ ERR_Type __W_Ambimate::init() {
 	if(Initialized){return ALREADY_INITIALIZED;}	// return if already initialized;
 
 	// Data and basic information are acquired from the module
-	Wire.beginTransmission(0x2A); // transmit to device
-	Wire.write(byte(0x80));       // sends instruction to read firmware version
-	if(Wire.endTransmission()){   // stop transmitting
-		Logger::getInstance().print("Ambimate I2C Error: ", LogLevel::Error); 
-		Logger::getInstance().println(String(Wire.getErrorText(Wire.lastError())), LogLevel::Error);
+	I2CBus& bus = I2CBus::getInstance();
+	const uint8_t FW_VER = 0x80, FW_SUB_VER = 0x81, OPT_SENSORS = 0x82;
+	uint8_t fw_ver = 0, fw_sub_ver = 0;
+	if(bus.writeRead(I2CDevice::Ambimate, &FW_VER, 1, &fw_ver, 1) ||			// firmware version
+		bus.writeRead(I2CDevice::Ambimate, &FW_SUB_VER, 1, &fw_sub_ver, 1) ||	// firmware subversion
+		bus.writeRead(I2CDevice::Ambimate, &OPT_SENSORS, 1, &opt_sensors, 1)){	// optional sensors byte
+		Logger::getInstance().println<LogLevel::Error>("Ambimate I2C Error: the Ambimate did not answer.");
 		return AMBI_I2C_INIT_ERR;
-	}      
-	Wire.requestFrom(0x2A, 1);    // request byte from slave device
-	uint8_t fw_ver = Wire.read(); // receive a byte
-
-	Wire.beginTransmission(0x2A); // transmit to device
-	Wire.write(byte(0x81));       // sends instruction to read firmware subversion
-	Wire.endTransmission();       // stop transmitting
-	Wire.requestFrom(0x2A, 1);    // request byte from slave device
-	uint8_t fw_sub_ver = Wire.read(); // receive a byte
-
-	Wire.beginTransmission(0x2A); // transmit to device
-	Wire.write(byte(0x82));       // sends instruction to read optional sensors byte
-	Wire.endTransmission();       // stop transmitting
-	Wire.requestFrom(0x2A, 1);    // request byte from slave device
-	opt_sensors = Wire.read();    // receive a byte
+	}
 
-	//TODO: check if this delay is neccessary
-	delay(1000);
+	// the first scan is only sent once the Ambimate has had time to start up.
+	ready_at = millis() + AMBIMATE_STARTUP_TIME;
+	scan_pending = false;
 
 	// debug info
 
 	//If device contains additional CO2 and audio sensor, it is indicated here
-	Logger::getInstance().print("AmbiMate sensors: 4 core", LogLevel::Info);
+	Logger::getInstance().print<LogLevel::Info>("AmbiMate sensors: 4 core");
 	if (opt_sensors & 0x01)
-		Logger::getInstance().print(" + CO2", LogLevel::Info);
+		Logger::getInstance().print<LogLevel::Info>(" + CO2");
 	if (opt_sensors & 0x04)
-		Logger::getInstance().print(" + Audio", LogLevel::Info);
-	Logger::getInstance().println(" ", LogLevel::Info);
+		Logger::getInstance().print<LogLevel::Info>(" + Audio");
+	Logger::getInstance().println<LogLevel::Info>(" ");
 
-	Logger::getInstance().print("AmbiMate Firmware version ", LogLevel::Info);
-	Logger::getInstance().print(fw_ver, LogLevel::Info);
-	Logger::getInstance().print(".", LogLevel::Info);
-	Logger::getInstance().println(fw_sub_ver, LogLevel::Info);
+	Logger::getInstance().print<LogLevel::Info>("AmbiMate Firmware version ");
+	Logger::getInstance().print<LogLevel::Info>(fw_ver);
+	Logger::getInstance().print<LogLevel::Info>(".");
+	Logger::getInstance().println<LogLevel::Info>(fw_sub_ver);
 
 	Initialized = true;
 	return SUCCESS;
 }
 
 AmbimateData __W_Ambimate::read(){
-	AmbimateData AD;
-	if(checkInitialized()){return AD;} // don't act on to the hardware if not properly intialized;
+	if(startScan(millis())){return data;}
+	// wait until all sensors are scanned by the AmbiMate
+	while(!isScanComplete(millis())){
+		delay(1);
+	}
+	collect(data);
+	return data;
+}
+
+ERR_Type __W_Ambimate::startScan(uint32_t now){
+	if(checkInitialized()){return NOT_INITIALIZED;} // don't act on to the hardware if not properly intialized;
+
+	scan_failed = false;
+	if((int32_t)(now - ready_at) < 0){
+		scan_pending = true;
+		return SUCCESS;
+	}
+	scan_pending = false;
+	return sendScan(now);
+}
 
+ERR_Type __W_Ambimate::sendScan(uint32_t now){
 	// All sensors except the CO2 sensor are scanned in response to this command
-	Wire.beginTransmission(0x2A); // transmit to device
-	// Device address is specified in datasheet
-	Wire.write(byte(0xC0));       // sends instruction to read sensors in next byte
-	Wire.write(0xFF);             // 0xFF indicates to read all connected sensors
-	Wire.endTransmission();       // stop transmitting
-	// Delay to make sure all sensors are scanned by the AmbiMate
-	delay(100);
-
-	Wire.beginTransmission(0x2A); // transmit to device
-	Wire.write(byte(0x00));       // sends instruction to read sensors in next byte
-	Wire.endTransmission();       // stop transmitting
-	Wire.requestFrom(0x2A, 15);    // request 6 bytes from slave device
-
-	// Acquire the Raw Data
-	uint16_t i = 0;
-	uint8_t buf[20];
-	while (Wire.available()) { // slave may send less than requested
-		buf[i] = Wire.read(); // receive a byte as character and store in buffer
-		i++;
+	// 0xC0 is the instruction to read the sensors in the next byte, 0xFF indicates to read all connected sensors
+	const uint8_t SCAN[] = {0xC0, 0xFF};
+	if(I2CBus::getInstance().write(I2CDevice::Ambimate, SCAN, sizeof(SCAN))){
+		return READ_FAIL;
 	}
+	scan_start = now;
+	return SUCCESS;
+}
 
+bool __W_Ambimate::isScanComplete(uint32_t now){
+	if(scan_pending){
+		if((int32_t)(now - ready_at) < 0){return false;}
+		scan_pending = false;
+		if(sendScan(now)){
+			// let collect() report the failed scan, instead of waiting for a scan that never started.
+			scan_failed = true;
+			return true;
+		}
+		return false;
+	}
+	return (now - scan_start) >= AMBIMATE_SCAN_TIME;
+}
+
+ERR_Type __W_Ambimate::collect(AmbimateData& AD){
+	if(checkInitialized()){return NOT_INITIALIZED;} // don't act on to the hardware if not properly intialized;
+	if(scan_failed){
+		scan_failed = false;
+		return READ_FAIL;
+	}
+
+	// Acquire the Raw Data, 15 bytes from register 0x00 on. The bus never reads more than the buffer holds.
+	const uint8_t DATA = 0x00;
+	uint8_t buf[15];
+	if(I2CBus::getInstance().writeRead(I2CDevice::Ambimate, &DATA, 1, buf, sizeof(buf))){
+		return READ_FAIL;
+	}
 
 	// convert the raw data to engineering units, see application spec for more information 
 	AD.status = buf[0];
@@ -97,7 +120,7 @@ AmbimateData __W_Ambimate::read(){
 	AD.eco2_ppm = (buf[11] * 256.0 + buf[12]);
 	AD.voc_ppm = (buf[13] * 256.0 + buf[14]);
 
-	return AD;
+	return SUCCESS;
 }
 
 uint8_t __W_Ambimate::get_opt_sensors(){
@@ -12,7 +12,7 @@
  */
 #pragma once
 
-#include <Wire.h>
+#include "../../I2C/I2CBus.h"
 #include "../../__W_Module/__iW_Module.h"
 #include "../../Singleton/Singleton.h"
 
@@ -62,6 +62,33 @@ private:
 	 * @brief contains flags indicating which option senors are present.
 	 */
 	uint8_t opt_sensors;
+	/**
+	 * @brief The last collected data.
+	 */
+	AmbimateData data = AmbimateData();
+	/**
+	 * @brief Time in ms at which the running scan was started.
+	 */
+	uint32_t scan_start = 0;
+	/**
+	 * @brief Time in ms from which the Ambimate accepts a scan command, AMBIMATE_STARTUP_TIME after init.
+	 */
+	uint32_t ready_at = 0;
+	/**
+	 * @brief True when a scan was started before ready_at, the command is then sent by isScanComplete().
+	 */
+	bool scan_pending = false;
+	/**
+	 * @brief True when the scan command sent by isScanComplete() failed, collect() then reports the failure.
+	 */
+	bool scan_failed = false;
+
+	/**
+	 * @brief Sends the scan command to the Ambimate.
+	 * @param now the time in ms.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 */
+	ERR_Type sendScan(uint32_t now);
 
 	/**
 	 * @brief virtual implementation of the iW_Module function.
@@ -98,11 +125,45 @@ public:
 
 	/**
 	 * @brief Reads the Ambimate sensor's data into the AmbimateData struct.
+	 * Waits until the scan is complete, use startScan(), isScanComplete() and collect() to not wait.
 	 * eCO2/VOC sensor is only updated in AmbiMate every 60 seconds.
 	 * @return AmbimateData the struct containing the read data.
 	 */
 	AmbimateData read();
 
+	/**
+	 * @brief Starts a scan of all the sensors except the CO2 sensor.
+	 * Right after init the Ambimate is not ready yet, the scan command is then sent by isScanComplete() once it is.
+	 * @param now the time in ms.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 */
+	ERR_Type startScan(uint32_t now);
+	/**
+	 * @brief Checks if the started scan has had AMBIMATE_SCAN_TIME ms to finish.
+	 * @param now the time in ms.
+	 * @return true the scan is done and can be collected.
+	 * @return false the scan is still running.
+	 */
+	bool isScanComplete(uint32_t now);
+	/**
+	 * @brief Reads the result of a completed scan.
+	 * @param AD buffer for the data, is only written when the read succeeds.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 */
+	ERR_Type collect(AmbimateData& AD);
+
+	/** @brief Scheduler step, calls startScan(). */
+	virtual ERR_Type start(uint32_t now){ return startScan(now); }
+	/** @brief Scheduler step, calls isScanComplete(). */
+	virtual bool ready(uint32_t now){ return isScanComplete(now); }
+	/** @brief Scheduler step, collects the scan into the data returned by getData(). */
+	virtual ERR_Type collect(uint32_t now){ (void)now; return collect(data); }
+	/**
+	 * @brief Returns the data of the last collected scan.
+	 * @return const AmbimateData& the data.
+	 */
+	const AmbimateData& getData(){ return data; }
+
 	/**
 	 * @brief Get the opt sensors flags.
 	 * 
@@ -0,0 +1,76 @@
+#include "PMFrameParser.h"
+
+#include <string.h>
+
+// the frame length field of the SM-UART-04L, the data words and the checksum.
+static const uint16_t FRAME_LENGTH = 2 * PM_FRAME_WORDS + 2;
+
+bool PMFrameParser::step(uint8_t byte){
+	switch(state){
+		case State::Start1:
+			if(byte == 0x42){
+				buf[0] = byte;
+				fill = 1;
+				state = State::Start2;
+			}
+			else{
+				stats.skipped++;
+			}
+			return false;
+		case State::Start2:
+			if(byte == 0x4D){
+				buf[1] = byte;
+				fill = 2;
+				state = State::Body;
+			}
+			else{
+				// the first start character was a data byte, this byte can still be the start of a frame.
+				stats.skipped++;
+				state = State::Start1;
+				return step(byte);
+			}
+			return false;
+		case State::Body:
+			break;
+	}
+
+	buf[fill++] = byte;
+	if(fill == 4 && ((buf[2] << 8) | buf[3]) != FRAME_LENGTH){
+		stats.length_errors++;
+		resync();
+		return false;
+	}
+	if(fill < PM_FRAME_SIZE){return false;}
+
+	uint16_t sum = 0;
+	for(size_t i = 0; i < PM_FRAME_SIZE - 2; i++){
+		sum += buf[i];
+	}
+	if(sum != ((buf[PM_FRAME_SIZE - 2] << 8) | buf[PM_FRAME_SIZE - 1])){
+		stats.checksum_errors++;
+		resync();
+		return false;
+	}
+
+	frame.length = FRAME_LENGTH;
+	for(size_t i = 0; i < PM_FRAME_WORDS; i++){
+		frame.data[i] = (buf[4 + 2 * i] << 8) | buf[5 + 2 * i];
+	}
+	frame.checksum = sum;
+	stats.frames++;
+	reset();
+	return true;
+}
+
+void PMFrameParser::resync(){
+	// a start character inside the dropped bytes can be the start of the next frame. The replay is shorter than a frame,
+	// so it can't complete one, and every nested resync replays fewer bytes.
+	uint8_t replay[PM_FRAME_SIZE];
+	size_t count = fill - 1;
+	memcpy(replay, buf + 1, count);
+	reset();
+	stats.skipped++; // the first start character of the dropped frame.
+	for(size_t i = 0; i < count; i++){
+		step(replay[i]);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,131 @@
+/**
+ * @file PMFrameParser.h
+ * @author Imre Korf
+ * @brief Incremental parser of the frames of the SM-UART-04L dust sensor.
+ * @version 0.1
+ * @date 2022-03-23
+ *
+ * Byte | Content
+ * :-----:|:-----------------------------:
+ *  0 - 1 | start characters 0x42 0x4D
+ *  2 - 3 | frame length, 2 * 13 data words + 2 checksum bytes = 28
+ *  4 - 29 | 13 data words, big endian
+ *  30 - 31 | checksum, the sum of bytes 0 - 29
+ *
+ * The parser takes one byte at a time, so it can be fed straight from the UART without waiting for a whole frame.
+ * When the length or the checksum of a frame is wrong, the bytes after its first start character are parsed again,
+ * so a frame that starts inside a corrupted one is not lost.
+ * This file only uses the standard library, so recorded byte streams can be replayed on a host with the LDSReplay tool.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Amount of bytes in a frame of the SM-UART-04L.
+ */
+#define PM_FRAME_SIZE 32
+/**
+ * @brief Amount of data words in a frame of the SM-UART-04L.
+ */
+#define PM_FRAME_WORDS 13
+
+/**
+ * @addtogroup STRUCT
+ * @{
+ */
+/**
+ * @brief A frame of the SM-UART-04L with a valid checksum.
+ */
+struct PMFrame {
+	/** The frame length field. */
+	uint16_t length;
+	/**
+	 * The data words: PM1.0, PM2.5 and PM10 in ug/m3 at standard particles, the same at atmospheric environment,
+	 * the amount of particles per 0.1 L above 0.3, 0.5, 1.0, 2.5, 5.0 and 10 um, and a reserved word.
+	 */
+	uint16_t data[PM_FRAME_WORDS];
+	/** The checksum field. */
+	uint16_t checksum;
+};
+
+/**
+ * @brief Counters of the PMFrameParser.
+ */
+struct PMParserStats {
+	/** Amount of parsed bytes. */
+	uint32_t bytes;
+	/** Amount of valid frames. */
+	uint32_t frames;
+	/** Amount of frames that were dropped because of a wrong checksum. */
+	uint32_t checksum_errors;
+	/** Amount of frames that were dropped because of a wrong length field. */
+	uint32_t length_errors;
+	/** Amount of bytes that were skipped while searching for a start character. */
+	uint32_t skipped;
+};
+/**@}*/
+
+/**
+ * @brief Parses the byte stream of the SM-UART-04L into frames.
+ */
+class PMFrameParser {
+private:
+	/** @brief Position in the frame. */
+	enum class State : uint8_t {
+		/** Waiting for the first start character. */
+		Start1,
+		/** Waiting for the second start character. */
+		Start2,
+		/** Receiving the rest of the frame. */
+		Body
+	};
+	/** The current state. */
+	State state = State::Start1;
+	/** The bytes of the current frame. */
+	uint8_t buf[PM_FRAME_SIZE];
+	/** Amount of bytes in buf. */
+	size_t fill = 0;
+	/** The last valid frame. */
+	PMFrame frame = PMFrame();
+	/** The counters. */
+	PMParserStats stats = PMParserStats();
+
+	/**
+	 * @brief Runs the state machine for one byte.
+	 * @return true the byte completed a valid frame.
+	 */
+	bool step(uint8_t byte);
+	/**
+	 * @brief Drops the current frame and parses its bytes from position 1 on again.
+	 */
+	void resync();
+
+public:
+	/**
+	 * @brief Adds a received byte.
+	 * @param byte the byte.
+	 * @return true the byte completed a valid frame, it can be read with getFrame().
+	 */
+	bool push(uint8_t byte){
+		stats.bytes++;
+		return step(byte);
+	}
+
+	/**
+	 * @brief Drops the partly received frame, after bytes were lost in between.
+	 */
+	void reset(){
+		state = State::Start1;
+		fill = 0;
+	}
+
+	/** @brief Returns the last valid frame. */
+	const PMFrame& getFrame() const { return frame; }
+	/** @brief Returns the counters. */
+	const PMParserStats& getStats() const { return stats; }
+};
\ No newline at end of file
@@ -2,36 +2,136 @@
 #include "__W_SMUART_4L.h"
 #include "../../../Logger/Logger.h"
 
-#define RXD2 16
-#define TXD2 17
+#include <driver/uart.h>
 
 bool __W_SM_UART_4L::checkInitialized(){
     if(Initialized){
         return 0;
     }
     else{
-        Logger::getInstance().println("SM_UART_4L is not initialized!", LogLevel::Error);
+        Logger::getInstance().println<LogLevel::Error>("SM_UART_4L is not initialized!");
         return 1;
     }
 }
 
 ERR_Type __W_SM_UART_4L::init() {
 	if(Initialized){return SUCCESS;}	// return if already initialized;
-	Serial2.begin(9600, SERIAL_8N1, RXD2, TXD2);
-	if(!aqi.begin_UART(&Serial2)){
-		Logger::getInstance().println("Could not find SM_UART_4L sensor.", LogLevel::Error);
+	uart_config_t config = uart_config_t();
+	config.baud_rate = LDS_BAUD;
+	config.data_bits = UART_DATA_8_BITS;
+	config.parity = UART_PARITY_DISABLE;
+	config.stop_bits = UART_STOP_BITS_1;
+	config.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+	if(uart_param_config(LDS_UART, &config) ||
+		uart_set_pin(LDS_UART, LDS_TX_PIN, LDS_RX_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE) ||
+		uart_driver_install(LDS_UART, LDS_RX_BUFFER, 0, LDS_EVENT_QUEUE, &uart_queue, 0)){
+		Logger::getInstance().println<LogLevel::Error>("Could not start the SM_UART_4L UART.");
 		return NO_LDS_SENSOR;
 	}
-	Logger::getInstance().println("SM_UART_4L found and initialized.", LogLevel::Info);
+	if(xTaskCreatePinnedToCore(uartTask, "LDS", LDS_TASK_STACK, this, LDS_TASK_PRIORITY, &uart_task, LDS_TASK_CORE) != pdPASS){
+		Logger::getInstance().println<LogLevel::Error>("Failed to create the SM_UART_4L task.");
+		return ERROR;
+	}
+	Logger::getInstance().println<LogLevel::Info>("SM_UART_4L initialized.");
 	Initialized = true;
 	return SUCCESS;
 }
 
+void __W_SM_UART_4L::uartTask(void* param){
+	__W_SM_UART_4L* L = (__W_SM_UART_4L*)param;
+	uint8_t bytes[64];
+	uart_event_t event;
+	for(;;){
+		if(!xQueueReceive(L->uart_queue, &event, portMAX_DELAY)){continue;}
+		switch(event.type){
+			case UART_DATA: {
+				// read everything that is buffered, the event size can lag behind the ring buffer.
+				int count;
+				while((count = uart_read_bytes(LDS_UART, bytes, sizeof(bytes), 0)) > 0){
+					for(int i = 0; i < count; i++){
+						if(L->parser.push(bytes[i])){L->storeFrame(millis());}
+					}
+				}
+				break;
+			}
+			case UART_FIFO_OVF:
+			case UART_BUFFER_FULL:
+				// bytes were lost, the frame that was being received can't be completed.
+				uart_flush_input(LDS_UART);
+				xQueueReset(L->uart_queue);
+				L->parser.reset();
+				portENTER_CRITICAL(&L->frame_lock);
+				L->stats.overflows++;
+				portEXIT_CRITICAL(&L->frame_lock);
+				break;
+			default:
+				break;
+		}
+		portENTER_CRITICAL(&L->frame_lock);
+		L->stats.parser = L->parser.getStats();
+		portEXIT_CRITICAL(&L->frame_lock);
+	}
+}
+
+void __W_SM_UART_4L::storeFrame(uint32_t now){
+	const PMFrame& F = parser.getFrame();
+	PM25_AQI_Data D = PM25_AQI_Data();
+	D.framelen = F.length;
+	D.pm10_standard = F.data[0];
+	D.pm25_standard = F.data[1];
+	D.pm100_standard = F.data[2];
+	D.pm10_env = F.data[3];
+	D.pm25_env = F.data[4];
+	D.pm100_env = F.data[5];
+	D.particles_03um = F.data[6];
+	D.particles_05um = F.data[7];
+	D.particles_10um = F.data[8];
+	D.particles_25um = F.data[9];
+	D.particles_50um = F.data[10];
+	D.particles_100um = F.data[11];
+	D.unused = F.data[12];
+	D.checksum = F.checksum;
+	portENTER_CRITICAL(&frame_lock);
+	latest = D;
+	frames++;
+	stats.last_frame = now;
+	portEXIT_CRITICAL(&frame_lock);
+}
+
 ERR_Type __W_SM_UART_4L::read(PM25_AQI_Data& data){
 	if(checkInitialized()){return NOT_INITIALIZED;} // don't act on to the hardware if not properly intialized;
-	if(!aqi.read(&data)){
-		Logger::getInstance().println("Could not read from SM_UART_4L", LogLevel::Warning);
-		return READ_FAIL;
+	portENTER_CRITICAL(&frame_lock);
+	uint32_t count = frames;
+	data = latest;
+	portEXIT_CRITICAL(&frame_lock);
+	return count ? SUCCESS : READ_FAIL;
+}
+
+bool __W_SM_UART_4L::ready(uint32_t now){
+	(void)now;
+	return frames != collected;
+}
+
+ERR_Type __W_SM_UART_4L::collect(uint32_t now){
+	(void)now;
+	portENTER_CRITICAL(&frame_lock);
+	collected = frames;
+	portEXIT_CRITICAL(&frame_lock);
+	ERR_Type ET = read(data);
+
+	LDSStats S = getStats();
+	uint32_t drops = S.parser.checksum_errors + S.parser.length_errors + S.overflows;
+	if(drops != reported_drops){
+		Logger::getInstance().println<LogLevel::Warning>("SM_UART_4L dropped ", drops - reported_drops, " frames, total: ", S.parser.checksum_errors,
+			" checksum, ", S.parser.length_errors, " length, ", S.overflows, " overflows, ", S.parser.skipped, " bytes skipped");
+		reported_drops = drops;
 	}
-	return SUCCESS;
+	return ET;
+}
+
+LDSStats __W_SM_UART_4L::getStats(){
+	portENTER_CRITICAL(&frame_lock);
+	LDSStats S = stats;
+	portEXIT_CRITICAL(&frame_lock);
+	return S;
 }
\ No newline at end of file
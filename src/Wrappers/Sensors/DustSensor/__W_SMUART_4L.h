@@ -1,9 +1,12 @@
 /**
  * @file __W_SMUART_4L.h
  * @author Imre Korf
- * @brief SM_UART_4L wrapper for the PM25AQI adafruit library
+ * @brief SM_UART_4L wrapper for the SM-UART-04L dust sensor
  * @version 0.1
  * @date 2021-11-29
+ *
+ * The UART driver receives the bytes into a ring buffer from its interrupt and signals a UART task through its event queue.
+ * The UART task runs every byte through the PMFrameParser and keeps the last valid frame, so a measurement only copies it.
  * 
  * @copyright Copyright (c) 2021
  * 
@@ -13,14 +16,54 @@
 #include <Adafruit_PM25AQI.h>
 #include "../../__W_Module/__iW_Module.h"
 #include "../../Singleton/Singleton.h"
+#include "PMFrameParser.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+
+/**
+ * @addtogroup STRUCT
+ * @{
+ */
+/**
+ * @brief Counters of the dust sensor.
+ */
+struct LDSStats {
+	/** Counters of the frame parser. */
+	PMParserStats parser;
+	/** Amount of times the UART ring buffer overflowed and its bytes were dropped. */
+	uint32_t overflows;
+	/** Time in ms at which the last valid frame was received, 0 before the first frame. */
+	uint32_t last_frame;
+};
+/**@}*/
 
 /**
  * @brief Singleton LDS module.
  */
 class __W_SM_UART_4L : public __iW_Module, public iSingleton {
 private:
-	/** @brief Handle to the adafruit PM25AQI library. */
-	Adafruit_PM25AQI aqi;
+	/** @brief The frame parser, only used by the UART task. */
+	PMFrameParser parser;
+	/** @brief Event queue of the UART driver. */
+	QueueHandle_t uart_queue = nullptr;
+	/** @brief Handle of the UART task. */
+	TaskHandle_t uart_task = nullptr;
+	/** @brief Lock of latest, frames and stats between the UART task and the scheduler. */
+	portMUX_TYPE frame_lock = portMUX_INITIALIZER_UNLOCKED;
+	/** @brief The last valid frame. */
+	PM25_AQI_Data latest = PM25_AQI_Data();
+	/** @brief Amount of valid frames, tells the scheduler a new frame arrived. */
+	uint32_t frames = 0;
+	/** @brief Copy of the counters, updated by the UART task. */
+	LDSStats stats = LDSStats();
+	/** @brief Value of frames at the last collect. */
+	uint32_t collected = 0;
+	/** @brief Amount of dropped frames at the last collect, to report new drops. */
+	uint32_t reported_drops = 0;
+	/** @brief The last collected frame. */
+	PM25_AQI_Data data = PM25_AQI_Data();
 	
 	/**
 	 * @brief virtual implementation of the iW_Module function.
@@ -29,6 +72,15 @@ private:
 	 * @return false LDS has not been initialized.
 	 */
 	virtual bool checkInitialized();
+
+	/**
+	 * @brief UART task, parses the received bytes on every event of the UART driver.
+	 */
+	static void uartTask(void* param);
+	/**
+	 * @brief Stores a valid frame of the parser as the latest frame.
+	 */
+	void storeFrame(uint32_t now);
 	
 	// remove access to the constructor of __W_SM_UART_4L.
 	__W_SM_UART_4L(){}
@@ -49,17 +101,42 @@ public:
 	/**
 	 * @brief Initializes the LDS object. Should only be called once.
 	 * This function initializes the LDS object. It has a check build in to see if this function has already been called before. If so it will just return 0.
+	 * Installs the UART driver and starts the UART task. The sensor sends its frames by itself, a missing sensor shows up as measurement timeouts.
 	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
 	 * @see ERR_Type
 	 */
 	ERR_Type init();
 
 	/**
-	 * @brief Reads the LDS sensor data into the data object.
+	 * @brief Copies the last valid frame, never waits for the sensor.
 	 * 
 	 * @param data The PM25_AQI_Data object into which the data should be read.
-	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 * @return ERR_Type returns SUCCESS on succesfull exit, READ_FAIL when no frame has been received yet. Else it will return an error code.
 	 * @see ERR_Type
 	 */
 	ERR_Type read(PM25_AQI_Data& data);
+
+	/**
+	 * @brief Checks if a frame has been received since the last collect.
+	 * @param now the time in ms.
+	 * @return true a new frame can be read.
+	 * @return false no new frame yet.
+	 */
+	virtual bool ready(uint32_t now);
+	/**
+	 * @brief Reads the last received frame, it can be read with getData().
+	 * @param now the time in ms.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 */
+	virtual ERR_Type collect(uint32_t now);
+	/**
+	 * @brief Returns the last collected frame.
+	 * @return const PM25_AQI_Data& the frame.
+	 */
+	const PM25_AQI_Data& getData(){ return data; }
+	/**
+	 * @brief Returns the counters of the UART and the frame parser.
+	 * @return LDSStats a copy of the counters.
+	 */
+	LDSStats getStats();
 };
\ No newline at end of file
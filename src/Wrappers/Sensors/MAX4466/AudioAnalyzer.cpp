@@ -0,0 +1,211 @@
+#include "AudioAnalyzer.h"
+
+#include <math.h>
+
+// mean square of a full scale sine in Q15 squared, the 0 dBFS reference.
+static const double FULL_SCALE_MS = 32767.0 * 32767.0 / 2;
+// largest magnitude at the input of a butterfly stage that can't overflow, a butterfly output is at most (1 + sqrt(2)) times larger.
+static const int32_t FFT_STAGE_LIMIT = 13572;
+// the windowed block is shifted up until its largest magnitude is at least this, a bit of headroom keeps the first stage unscaled.
+static const int32_t FFT_INPUT_LIMIT = 8192;
+
+// converts a mean square in Q15 squared to dB relative to a full scale sine.
+static float toDb(double ms){
+	if(ms <= 0){return AUDIO_DB_FLOOR;}
+	float db = 10 * log10(ms / FULL_SCALE_MS);
+	return db < AUDIO_DB_FLOOR ? AUDIO_DB_FLOOR : db;
+}
+
+// squared gain of the A-weighting curve (IEC 61672) at frequency f, 1 at 1 kHz.
+static double aWeight(double f){
+	const double f2 = f * f;
+	const double ra = (12194.0 * 12194.0 * f2 * f2) /
+		((f2 + 20.6 * 20.6) * sqrt((f2 + 107.7 * 107.7) * (f2 + 737.9 * 737.9)) * (f2 + 12194.0 * 12194.0));
+	const double gain = ra * 1.2589; // +2.00 dB, so the gain at 1 kHz is 0 dB.
+	return gain * gain;
+}
+
+AudioAnalyzer::AudioAnalyzer(uint32_t sample_rate){
+	const double pi = 3.14159265358979323846;
+	for(size_t i = 0; i < N; i++){
+		window[i] = (int16_t)lround(32767 * 0.5 * (1 - cos(2 * pi * i / N)));
+	}
+	for(size_t k = 0; k < N / 2; k++){
+		twiddle_cos[k] = (int16_t)lround(32767 * cos(2 * pi * k / N));
+		twiddle_sin[k] = (int16_t)lround(32767 * sin(2 * pi * k / N));
+	}
+	for(size_t k = 0; k <= N / 2; k++){
+		double f = (double)k * sample_rate / N;
+		a_weight[k] = k ? (float)aWeight(f) : 0;
+		// the bands are an octave wide around 62.5 Hz * 2^b, so band b starts at 62.5 Hz * 2^(b - 0.5).
+		band_of[k] = 0xFF;
+		if(k){
+			double b = floor(log2(f / 62.5) + 0.5);
+			if(b >= 0 && b < AUDIO_OCTAVE_BANDS){band_of[k] = (uint8_t)b;}
+		}
+	}
+	for(int b = 0; b < AUDIO_OCTAVE_BANDS; b++){
+		sum_bands[b] = 0;
+	}
+}
+
+void AudioAnalyzer::pushAdc(const uint16_t* raw, size_t count){
+	int16_t samples[64];
+	size_t n = 0;
+	for(size_t i = 0; i < count; i++){
+		int32_t x = raw[i] & 0x0FFF;
+		if(x == 0 || x == 0x0FFF){clipped++;}
+		if(dc < 0){dc = x << 8;} // start the average at the first sample.
+		dc += ((x << 8) - dc) >> 8; // running average over about 256 samples.
+		int32_t s = ((x << 8) - dc) >> 4; // 12 bit to Q15, the 8 fraction bits of the average minus the 4 bits that are added.
+		if(s > 32767){s = 32767;}
+		else if(s < -32768){s = -32768;}
+		samples[n++] = (int16_t)s;
+		if(n == sizeof(samples) / sizeof(samples[0])){
+			process(samples, n);
+			n = 0;
+		}
+	}
+	process(samples, n);
+}
+
+void AudioAnalyzer::process(const int16_t* samples, size_t count){
+	for(size_t i = 0; i < count; i++){
+		block[fill++] = samples[i];
+		if(fill == N){
+			processBlock();
+			fill = 0;
+		}
+	}
+}
+
+void AudioAnalyzer::processBlock(){
+	// time domain, the RMS and peak of the unweighted signal, and the largest windowed sample in Q30.
+	int64_t sum_sq = 0;
+	int32_t largest = 0;
+	for(size_t i = 0; i < N; i++){
+		int32_t x = block[i];
+		sum_sq += x * x;
+		int32_t a = x < 0 ? -x : x;
+		if(a > peak){peak = a;}
+		int32_t w = a * window[i];
+		if(w > largest){largest = w;}
+	}
+	sum_ms += (double)sum_sq / N;
+
+	// the windowed block is shifted so it uses the full 16 bits, a quiet block then keeps all its bits in the FFT.
+	// This is done on the Q30 products, so the window doesn't round a quiet block away before fft() could shift it up.
+	int shift = 15;
+	while(shift > 0 && (largest >> shift) < FFT_INPUT_LIMIT){shift--;}
+	for(size_t i = 0; i < N; i++){
+		re[i] = (int16_t)(((int32_t)block[i] * window[i]) >> shift);
+		im[i] = 0;
+	}
+
+	int exponent = fft(re, im) + shift - 15;
+
+	// the FFT is scaled by 1/N, so the sum of the bin powers is the mean square of the windowed block.
+	// The Hann window has a mean square of 3/8, and every bin below N / 2 also stands for its mirror bin.
+	const double scale = ldexp(8.0 / 3.0, 2 * exponent);
+	double weighted = 0;
+	double bands[AUDIO_OCTAVE_BANDS] = {0};
+	for(size_t k = 1; k <= N / 2; k++){
+		double power = ((int32_t)re[k] * re[k] + (int32_t)im[k] * im[k]) * (k < N / 2 ? 2 : 1) * scale;
+		weighted += power * a_weight[k];
+		if(band_of[k] != 0xFF){bands[band_of[k]] += power;}
+	}
+	sum_weighted += weighted;
+	for(int b = 0; b < AUDIO_OCTAVE_BANDS; b++){
+		sum_bands[b] += bands[b];
+	}
+	blocks++;
+}
+
+int AudioAnalyzer::fft(int16_t* re, int16_t* im) const {
+	int32_t largest = 0;
+	for(size_t i = 0; i < N; i++){
+		int32_t r = re[i] < 0 ? -re[i] : re[i];
+		int32_t m = im[i] < 0 ? -im[i] : im[i];
+		if(r > largest){largest = r;}
+		if(m > largest){largest = m;}
+	}
+	// a small input is shifted up first, so its rounding in the stages is as small as that of a large input.
+	int exponent = 0;
+	if(largest){
+		while(largest < FFT_INPUT_LIMIT){
+			largest <<= 1;
+			exponent--;
+		}
+		for(size_t i = 0; exponent && i < N; i++){
+			re[i] = (int16_t)(re[i] * (1 << -exponent));
+			im[i] = (int16_t)(im[i] * (1 << -exponent));
+		}
+	}
+	// reorder the samples in bit reversed order.
+	for(size_t i = 1, j = 0; i < N; i++){
+		size_t bit = N >> 1;
+		for(; j & bit; bit >>= 1){j ^= bit;}
+		j |= bit;
+		if(i < j){
+			int16_t t = re[i]; re[i] = re[j]; re[j] = t;
+			t = im[i]; im[i] = im[j]; im[j] = t;
+		}
+	}
+	// butterflies, a stage is only halved when its largest input could make an output overflow.
+	// The largest output of a stage is tracked on the way, so it doesn't take another pass over the block.
+	int size_log2 = 0;
+	for(size_t size = 2; size <= N; size <<= 1){
+		size_t half = size >> 1;
+		size_t step = N / size;
+		int scale = largest > FFT_STAGE_LIMIT ? 1 : 0;
+		exponent += scale;
+		size_log2++;
+		largest = 0;
+		for(size_t k = 0; k < half; k++){
+			int32_t wr = twiddle_cos[k * step];
+			int32_t wi = -twiddle_sin[k * step];
+			for(size_t i = k; i < N; i += size){
+				size_t j = i + half;
+				// rounded, a truncated product would add a bias to every stage.
+				int32_t tr = (re[j] * wr - im[j] * wi + 0x4000) >> 15;
+				int32_t ti = (re[j] * wi + im[j] * wr + 0x4000) >> 15;
+				int32_t out[4] = {
+					(re[i] - tr) >> scale,
+					(im[i] - ti) >> scale,
+					(re[i] + tr) >> scale,
+					(im[i] + ti) >> scale,
+				};
+				re[j] = (int16_t)out[0];
+				im[j] = (int16_t)out[1];
+				re[i] = (int16_t)out[2];
+				im[i] = (int16_t)out[3];
+				for(int o = 0; o < 4; o++){
+					int32_t a = out[o] < 0 ? -out[o] : out[o];
+					if(a > largest){largest = a;}
+				}
+			}
+		}
+	}
+	// the butterflies compute the plain FFT, the 1/N of the result is log2(N) halvings.
+	return exponent - size_log2;
+}
+
+AudioSummary AudioAnalyzer::takeSummary(){
+	AudioSummary S;
+	S.blocks = blocks;
+	S.clipped = clipped;
+	double n = blocks ? blocks : 1;
+	S.rms_dbfs = toDb(sum_ms / n);
+	S.peak_dbfs = peak ? 20 * log10(peak / 32767.0) : AUDIO_DB_FLOOR;
+	S.dba = toDb(sum_weighted / n) + MAX4466_DB_OFFSET;
+	for(int b = 0; b < AUDIO_OCTAVE_BANDS; b++){
+		S.bands[b] = toDb(sum_bands[b] / n) + MAX4466_DB_OFFSET;
+		sum_bands[b] = 0;
+	}
+	sum_ms = 0;
+	sum_weighted = 0;
+	peak = 0;
+	clipped = 0;
+	blocks = 0;
+	return S;
+}
\ No newline at end of file
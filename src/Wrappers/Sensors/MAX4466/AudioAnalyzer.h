@@ -0,0 +1,148 @@
+/**
+ * @file AudioAnalyzer.h
+ * @author Imre Korf
+ * @brief Sound level and octave band analysis of the MAX4466 microphone signal.
+ * @version 0.1
+ * @date 2022-03-21
+ *
+ * The samples are processed in blocks of MAX4466_FFT_SIZE samples:
+ * Step | Description
+ * :-----:|:-----------------------------:
+ *  DC | the ADC offset is removed with a running average, and the 12 bit samples are scaled to Q15
+ *  time | the sum of squares and the peak of the block are kept for the RMS and peak level
+ *  FFT | a Hann windowed radix-2 FFT in block floating point: the windowed block is shifted up to use the full 16 bits,
+ *   | and a stage is only scaled by 1/2 when it could overflow, the shifts are kept in an exponent
+ *  spectrum | the bin powers are summed with the A-weighting curve and per octave band
+ *
+ * The results of all blocks since the last takeSummary() are averaged into an AudioSummary.
+ * A fixed 1/2 in every stage would drop log2(N) bits, which puts a quantization floor on quiet signals, the block
+ * floating point keeps the resolution of a quiet block as good as that of a loud one.
+ * This file only uses the standard library, so the analysis can be tested on a host with the AudioBench tool and HostTests.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../../../Defines/Defines.h"
+
+/**
+ * @brief Amount of octave bands in an AudioSummary, with the center frequencies 62.5 Hz to 8 kHz.
+ */
+#define AUDIO_OCTAVE_BANDS 8
+/**
+ * @brief Level in dB that is reported when there is no signal at all.
+ */
+#define AUDIO_DB_FLOOR -120.0f
+
+/**
+ * @addtogroup STRUCT
+ * @{
+ */
+/**
+ * @brief Sound levels of an interval of audio blocks.
+ * The dBFS levels are relative to a full scale sine, the dB levels are calibrated with MAX4466_DB_OFFSET.
+ */
+struct AudioSummary {
+	/** Amount of blocks in the interval, the levels are meaningless when this is 0. */
+	uint32_t blocks;
+	/** Amount of samples at the limits of the ADC, the levels are too low when this is not 0. */
+	uint32_t clipped;
+	/** RMS level of the unweighted signal in dBFS. */
+	float rms_dbfs;
+	/** Highest absolute sample in dBFS. */
+	float peak_dbfs;
+	/** A-weighted sound level in dB(A). */
+	float dba;
+	/** Unweighted sound level per octave band in dB, from 62.5 Hz to 8 kHz. */
+	float bands[AUDIO_OCTAVE_BANDS];
+};
+/**@}*/
+
+/**
+ * @brief Computes the sound levels of a stream of audio samples.
+ * Not thread safe, the caller should make sure process() and takeSummary() are not called at the same time.
+ */
+class AudioAnalyzer {
+public:
+	/** Amount of samples in a block, a power of 2. */
+	static constexpr size_t N = MAX4466_FFT_SIZE;
+	static_assert(N >= 16 && (N & (N - 1)) == 0, "MAX4466_FFT_SIZE should be a power of 2");
+
+private:
+	/** Hann window in Q15. */
+	int16_t window[N];
+	/** cos(2 pi k / N) in Q15, for k < N / 2. */
+	int16_t twiddle_cos[N / 2];
+	/** sin(2 pi k / N) in Q15, for k < N / 2. */
+	int16_t twiddle_sin[N / 2];
+	/** Squared A-weighting gain of every bin up to N / 2. */
+	float a_weight[N / 2 + 1];
+	/** Octave band of every bin up to N / 2, 0xFF when the bin is outside the bands. */
+	uint8_t band_of[N / 2 + 1];
+
+	/** Samples of the block that is being filled, in Q15. */
+	int16_t block[N];
+	/** Real parts of the FFT of the block. */
+	int16_t re[N];
+	/** Imaginary parts of the FFT of the block. */
+	int16_t im[N];
+	/** Amount of samples in the block. */
+	size_t fill = 0;
+	/** Running average of the ADC samples, the DC offset, in 1/256 ADC counts. */
+	int32_t dc = -1;
+
+	/** Sum of the mean squares of the blocks in the interval, in Q15 squared. */
+	double sum_ms = 0;
+	/** Sum of the A-weighted mean squares of the blocks in the interval, in Q15 squared. */
+	double sum_weighted = 0;
+	/** Sum of the mean squares per octave band of the blocks in the interval, in Q15 squared. */
+	double sum_bands[AUDIO_OCTAVE_BANDS];
+	/** Highest absolute sample of the interval, in Q15. */
+	int32_t peak = 0;
+	/** Amount of clipped samples in the interval. */
+	uint32_t clipped = 0;
+	/** Amount of blocks in the interval. */
+	uint32_t blocks = 0;
+
+	/** @brief Analyzes the full block and adds it to the interval. */
+	void processBlock();
+
+public:
+	/**
+	 * @brief Creates an analyzer and calculates its tables.
+	 * @param sample_rate the sample rate in Hz.
+	 */
+	AudioAnalyzer(uint32_t sample_rate);
+
+	/**
+	 * @brief Adds raw 12 bit ADC samples, the upper 4 bits are ignored.
+	 * @param raw the samples as read from the I2S ADC.
+	 * @param count amount of samples.
+	 */
+	void pushAdc(const uint16_t* raw, size_t count);
+
+	/**
+	 * @brief Adds samples without a DC offset.
+	 * @param samples the samples in Q15.
+	 * @param count amount of samples.
+	 */
+	void process(const int16_t* samples, size_t count);
+
+	/**
+	 * @brief Returns the levels of the blocks since the last call, and starts a new interval.
+	 * @return AudioSummary the levels of the interval.
+	 */
+	AudioSummary takeSummary();
+
+	/**
+	 * @brief In place block floating point FFT of N samples.
+	 * A small input is shifted up first, and a butterfly stage is scaled by 1/2 only when its input is large enough to overflow 16 bits.
+	 * @param re the real parts, the input samples.
+	 * @param im the imaginary parts, should be 0 for a real signal.
+	 * @return int the exponent e of the result, the FFT of the input scaled by 1/N is re * 2^e and im * 2^e.
+	 */
+	int fft(int16_t* re, int16_t* im) const;
+};
\ No newline at end of file
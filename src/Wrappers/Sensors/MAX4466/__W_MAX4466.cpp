@@ -2,8 +2,8 @@
 #include "__W_MAX4466.h"
 #include "../../../Logger/Logger.h"
 
-#include <Arduino.h>
-#include <esp_adc_cal.h>
+#include <driver/adc.h>
+#include <driver/i2s.h>
 
 // AUD_IN pin is GPIO36, ADC1 CH0
 
@@ -12,26 +12,113 @@ bool __W_MAX4466::checkInitialized(){
         return 0;
     }
     else{
-        Logger::getInstance().println("MAX4466 is not initialized!", LogLevel::Error);
+        Logger::getInstance().println<LogLevel::Error>("MAX4466 is not initialized!");
         return 1;
     }
 }
 
 ERR_Type __W_MAX4466::init(){
 	if(Initialized){return ALREADY_INITIALIZED;}	// return if already initialized;
-	
-	// range 0-4096
-	adc1_config_width(ADC_WIDTH_BIT_12);
 
 	// full voltage range
 	adc1_config_channel_atten(ADC1_CHANNEL_0, ADC_ATTEN_DB_11);
 
+	// sample ADC1 CH0 continuously into DMA buffers, the I2S peripheral sets the sample rate.
+	i2s_config_t config = i2s_config_t();
+	config.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_ADC_BUILT_IN);
+	config.sample_rate = MAX4466_SAMPLE_RATE;
+	config.bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT;
+	config.channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;
+	config.communication_format = I2S_COMM_FORMAT_STAND_I2S;
+	config.intr_alloc_flags = 0;
+	config.dma_buf_count = MAX4466_DMA_BUFFERS;
+	config.dma_buf_len = MAX4466_FFT_SIZE;
+	config.use_apll = false;
+	if(i2s_driver_install(I2S_NUM_0, &config, 0, NULL) || i2s_set_adc_mode(ADC_UNIT_1, ADC1_CHANNEL_0)){
+		Logger::getInstance().println<LogLevel::Error>("MAX4466 I2S ADC could not be started.");
+		return MAX4466_I2S_ERR;
+	}
+	lock = xSemaphoreCreateMutex();
+	if(!share_lock){share_lock = xSemaphoreCreateMutex();}
+	// from here on readAdc1() goes through the audio task. A read that is still running directly on ADC1 delays the enable.
+	adc_owned = true;
+	i2s_adc_enable(I2S_NUM_0);
+
+	xTaskCreatePinnedToCore(audioTask, "Audio", MAX4466_TASK_STACK, this, MAX4466_TASK_PRIORITY, &audio_task, MAX4466_TASK_CORE);
+
 	Initialized = true;
 
 	return SUCCESS;
 }
 
+void __W_MAX4466::audioTask(void* param){
+	__W_MAX4466* M = (__W_MAX4466*)param;
+	static uint16_t raw[MAX4466_FFT_SIZE];
+	for(;;){
+		// waits until the DMA has filled a buffer, so the task only runs once per block.
+		size_t bytes = 0;
+		if(i2s_read(I2S_NUM_0, raw, sizeof(raw), &bytes, portMAX_DELAY) || !bytes){continue;}
+		xSemaphoreTake(M->lock, portMAX_DELAY);
+		M->analyzer.pushAdc(raw, bytes / sizeof(raw[0]));
+		xSemaphoreGive(M->lock);
+
+		if(M->share_pending){
+			// the I2S ADC holds the ADC1 lock, release it for the few samples of the other module.
+			AdcShare& S = M->share;
+			i2s_adc_disable(I2S_NUM_0);
+			for(size_t i = 0; i < S.count; i++){
+				S.samples[i] = (uint16_t)adc1_get_raw(S.channel);
+			}
+			i2s_adc_enable(I2S_NUM_0);
+			M->share_pending = false;
+			xTaskNotifyGive(S.caller);
+		}
+	}
+}
+
+ERR_Type __W_MAX4466::readAdc1(adc1_channel_t channel, uint16_t* samples, size_t count){
+	if(count > MAX4466_SHARE_SAMPLES){count = MAX4466_SHARE_SAMPLES;}
+	if(!share_lock){share_lock = xSemaphoreCreateMutex();}
+	xSemaphoreTake(share_lock, portMAX_DELAY);
+	ERR_Type ET = SUCCESS;
+	if(!adc_owned){
+		for(size_t i = 0; i < count; i++){
+			samples[i] = (uint16_t)adc1_get_raw(channel);
+		}
+	}
+	else if(share_pending){
+		ET = READ_FAIL; // an earlier read timed out and the audio task has not done it yet, share is still in use.
+	}
+	else{
+		share.channel = channel;
+		share.count = count;
+		share.caller = xTaskGetCurrentTaskHandle();
+		ulTaskNotifyTake(pdTRUE, 0); // clear a notification of an earlier read that timed out.
+		share_pending = true;
+		if(ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(MAX4466_SHARE_TIMEOUT))){
+			for(size_t i = 0; i < count; i++){
+				samples[i] = share.samples[i];
+			}
+		}
+		else{
+			ET = READ_FAIL;
+		}
+	}
+	xSemaphoreGive(share_lock);
+	return ET;
+}
+
 int __W_MAX4466::read(){
-	// read a sample from the ADC
-	return adc1_get_raw(ADC1_CHANNEL_0);
+	return (int)(data.dba + 0.5f);
+}
+
+ERR_Type __W_MAX4466::collect(uint32_t now){
+	(void)now;
+	if(checkInitialized()){return NOT_INITIALIZED;} // don't act on to the hardware if not properly intialized;
+	xSemaphoreTake(lock, portMAX_DELAY);
+	AudioSummary summary = analyzer.takeSummary();
+	xSemaphoreGive(lock);
+	if(!summary.blocks){return READ_FAIL;}
+	data = summary;
+	return SUCCESS;
 }
\ No newline at end of file
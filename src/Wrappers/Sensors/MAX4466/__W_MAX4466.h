@@ -6,6 +6,11 @@
  * @date 2021-11-23
  * 
  * source: https://blog.yavilevich.com/2016/08/arduino-sound-level-meter-and-spectrum-analyzer/
+ *
+ * The microphone is sampled at MAX4466_SAMPLE_RATE by the I2S ADC with DMA. An audio task analyzes the samples
+ * in blocks with the AudioAnalyzer, the scheduler collects the levels of all blocks since its last measurement.
+ * While the I2S ADC runs it owns ADC1, other modules read ADC1 through readAdc1(), which lets the audio task
+ * pause the I2S ADC between two blocks.
  * 
  * @copyright Copyright (c) 2021
  * 
@@ -14,6 +19,12 @@
 
 #include "../../__W_Module/__iW_Module.h"
 #include "../../Singleton/Singleton.h"
+#include "AudioAnalyzer.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <driver/adc.h>
 
 /**
  * @brief Singleton MAX4466 module.
@@ -27,9 +38,60 @@ private:
 	 * @return false MAX4466 has not been initialized.
 	 */
 	virtual bool checkInitialized();
+	/**
+	 * @brief The levels of the last collected interval.
+	 */
+	AudioSummary data = AudioSummary();
+	/**
+	 * @brief Analyzes the samples, only used by the audio task and collect() while holding the lock.
+	 */
+	AudioAnalyzer analyzer;
+	/**
+	 * @brief Lock between the audio task and collect().
+	 */
+	SemaphoreHandle_t lock = nullptr;
+	/**
+	 * @brief Handle of the audio task.
+	 */
+	TaskHandle_t audio_task = nullptr;
+	/**
+	 * @brief True from the moment the I2S ADC claims ADC1.
+	 */
+	volatile bool adc_owned = false;
+
+	/**
+	 * @brief A read of ADC1 that is done by the audio task for another task.
+	 */
+	struct AdcShare {
+		/** The channel to read. */
+		adc1_channel_t channel;
+		/** Amount of samples to read. */
+		size_t count;
+		/** The task that waits for the samples. */
+		TaskHandle_t caller;
+		/** The read samples. */
+		uint16_t samples[MAX4466_SHARE_SAMPLES];
+	};
+	/**
+	 * @brief The pending read, only one task at a time can use it.
+	 */
+	AdcShare share;
+	/**
+	 * @brief True while the audio task should do the read in share.
+	 */
+	volatile bool share_pending = false;
+	/**
+	 * @brief Lock between the tasks that call readAdc1().
+	 */
+	SemaphoreHandle_t share_lock = nullptr;
+
+	/**
+	 * @brief Audio task, reads the DMA buffers of the I2S ADC and analyzes them.
+	 */
+	static void audioTask(void* param);
 	
 	// remove access to the constructor of __W_MAX4466.
-	__W_MAX4466(){}
+	__W_MAX4466() : analyzer(MAX4466_SAMPLE_RATE) {}
 public:
 	/**
 	 * @brief Get the singleton instance of the class
@@ -47,16 +109,40 @@ public:
 	/**
 	 * @brief Initializes the MAX4466 object. Should only be called once.
 	 * This function initializes the MAX4466 object. It has a check build in to see if this function has already been called before. If so it will just return 0.
+	 * Starts the I2S ADC on ADC1 CH0 and the audio task, after this ADC1 can't be read with adc1_get_raw().
 	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
 	 * @see ERR_Type
 	 */
 	ERR_Type init();
 
 	/**
-	 * @brief Reads the MAX4466 analog value.
+	 * @brief Reads the sound level of the last collected interval.
 	 * 
-	 * @return int The ADC converted value.
+	 * @return int The A-weighted sound level in dB(A).
 	 */
 	int read();
 
+	/**
+	 * @brief Collects the levels of the audio blocks since the last collect, they can be read with getData().
+	 * @param now the time in ms.
+	 * @return ERR_Type returns SUCCESS on succesfull exit, READ_FAIL when no block has been analyzed. Else it will return an error code.
+	 */
+	virtual ERR_Type collect(uint32_t now);
+	/**
+	 * @brief Returns the levels of the last collected interval.
+	 * @return const AudioSummary& the levels.
+	 */
+	const AudioSummary& getData(){ return data; }
+
+	/**
+	 * @brief Reads another channel of ADC1, also while the I2S ADC is running.
+	 * When the I2S ADC runs, the audio task stops it after its current block, reads the channel and starts it again.
+	 * This can take up to one audio block, so it should only be called from a background task.
+	 * @param channel the ADC1 channel, should be configured by the caller.
+	 * @param samples buffer for the raw samples.
+	 * @param count amount of samples to read, at most MAX4466_SHARE_SAMPLES.
+	 * @return ERR_Type returns SUCCESS on succesfull exit, READ_FAIL when the audio task did not respond within MAX4466_SHARE_TIMEOUT.
+	 */
+	ERR_Type readAdc1(adc1_channel_t channel, uint16_t* samples, size_t count);
+
 };
\ No newline at end of file
@@ -1,29 +1,90 @@
 #include "__W_MIX8410.h"
 #include <Arduino.h>
 #include "../../../Logger/Logger.h"
+#include "../MAX4466/__W_MAX4466.h"
 
 #define ADCMax 4095.0
 
-float __W_MIX8410::readO2Vout(){
-    long sum = 0;
-    for(int i=0; i<32; i++)
-    {
-        sum += analogRead(pinAdc);
+static_assert(__W_MIX8410::CalibrationPoints >= 2 && __W_MIX8410::calibrationSorted(), "MIX8410_CALIBRATION should have at least 2 points, sorted on the voltage");
+static_assert(MIX8410_BURST >= 1 && MIX8410_BURST <= MAX4466_SHARE_SAMPLES, "MIX8410_BURST should be between 1 and MAX4466_SHARE_SAMPLES");
+
+constexpr MIX8410_Point __W_MIX8410::Calibration[];
+
+ERR_Type __W_MIX8410::init(){
+    if(Initialized){return ALREADY_INITIALIZED;}	// return if already initialized;
+
+    adc1_config_width(ADC_WIDTH_BIT_12);
+    // full voltage range
+    adc1_config_channel_atten(channel, ADC_ATTEN_DB_11);
+#if MIX8410_ADC_CALIBRATION
+    esp_adc_cal_value_t source = esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, 1100, &adc_chars);
+    Logger::getInstance().println<LogLevel::Info>("MIX8410 ADC calibration: ", source == ESP_ADC_CAL_VAL_EFUSE_TP ? "eFuse two point" :
+        source == ESP_ADC_CAL_VAL_EFUSE_VREF ? "eFuse Vref" : "default Vref");
+#endif
+
+    if(xTaskCreatePinnedToCore(sampleTask, "MIX8410", MIX8410_TASK_STACK, this, MIX8410_TASK_PRIORITY, &sample_task, MIX8410_TASK_CORE) != pdPASS){
+        Logger::getInstance().println<LogLevel::Error>("Failed to create the MIX8410 sampling task.");
+        return ERROR;
+    }
+
+    Initialized = true;
+
+    return SUCCESS;
+}
+
+void __W_MIX8410::sampleTask(void* param){
+    __W_MIX8410* M = (__W_MIX8410*)param;
+    for(;;){
+        if(M->sampleBurst()){M->failed_bursts = M->failed_bursts + 1;}
+        vTaskDelay(pdMS_TO_TICKS(MIX8410_SAMPLE_INTERVAL));
     }
- 
-    sum >>= 5;
- 
-    float MeasuredVout = sum * (VRefer / ADCMax);
-    return MeasuredVout;
+}
+
+ERR_Type __W_MIX8410::sampleBurst(){
+    // ADC1 is shared with the I2S ADC of the MAX4466, which reads the samples for us while it runs.
+    uint16_t samples[MIX8410_BURST];
+    ERR_Type ET = __W_MAX4466::getInstance().readAdc1(channel, samples, MIX8410_BURST);
+    if(ET){return ET;}
+
+    // insertion sort, the burst is only a few samples.
+    for(size_t i = 1; i < MIX8410_BURST; i++){
+        uint16_t x = samples[i];
+        size_t j = i;
+        for(; j > 0 && samples[j - 1] > x; j--){
+            samples[j] = samples[j - 1];
+        }
+        samples[j] = x;
+    }
+    int32_t mv = (int32_t)toMillivolts(samples[MIX8410_BURST / 2]) << 8;
+
+    int32_t f = filtered;
+    if(f < 0){f = mv;} // start the filter at the first burst.
+    f += (mv - f) >> MIX8410_FILTER_SHIFT;
+    filtered = f;
+    return SUCCESS;
+}
+
+uint32_t __W_MIX8410::toMillivolts(uint16_t raw){
+#if MIX8410_ADC_CALIBRATION
+    return esp_adc_cal_raw_to_voltage(raw, &adc_chars);
+#else
+    return (uint32_t)(raw * (VRefer * 1000 / ADCMax));
+#endif
+}
+
+float __W_MIX8410::readO2Vout(){
+    int32_t f = filtered;
+    return f < 0 ? 0.0f : f / 256000.0f;
 }
  
 float __W_MIX8410::readConcentration(){
-    // Vout samples are with reference to 3.3V
-    float MeasuredVout = readO2Vout();
- 
-    //float Concentration = FmultiMap(MeasuredVout, VoutArray,O2ConArray, 6);
-    //when its output voltage is 2.0V,
-    float Concentration = MeasuredVout * 0.21 / 2.0;
-    float Concentration_Percentage=Concentration*100;
-    return Concentration_Percentage;
+    return toConcentration(readO2Vout() * 1000);
+}
+
+ERR_Type __W_MIX8410::collect(uint32_t now){
+    (void)now;
+    if(!Initialized){return NOT_INITIALIZED;}
+    if(filtered < 0){return MIX8410_NO_SAMPLES;}
+    data = readConcentration();
+    return SUCCESS;
 }
\ No newline at end of file
@@ -4,6 +4,10 @@
  * @brief MIX8410 wrapper for the MIX8410 sensor
  * @version 0.1
  * @date 2021-11-23
+ *
+ * The sensor is sampled in the background by a task, every MIX8410_SAMPLE_INTERVAL it reads a burst of MIX8410_BURST samples.
+ * The median of the burst removes spikes and an IIR filter smooths the medians, so a measurement only converts the filtered voltage.
+ * The voltage is converted into a concentration with the MIX8410_CALIBRATION points.
  * 
  * @copyright Copyright (c) 2021
  * 
@@ -13,20 +17,104 @@
 #include "../../__W_Module/__iW_Module.h"
 #include "../../Singleton/Singleton.h"
 
+#include <stddef.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <driver/adc.h>
+#include <esp_adc_cal.h>
+
+/**
+ * @addtogroup STRUCT
+ * @{
+ */
+/**
+ * @brief A calibration point of the MIX8410.
+ */
+struct MIX8410_Point {
+	/** Output voltage of the sensor board in mV. */
+	float mv;
+	/** O2 concentration in % at that voltage. */
+	float o2;
+};
+/**@}*/
+
 /**
  * @brief Singleton MIX8410 module.
  */
 class __W_MIX8410 : public __iW_Module, public iSingleton {
+public:
+	/**
+	 * @brief The calibration points, from MIX8410_CALIBRATION.
+	 */
+	static constexpr MIX8410_Point Calibration[] = {MIX8410_CALIBRATION};
+	/**
+	 * @brief Amount of calibration points.
+	 */
+	static constexpr size_t CalibrationPoints = sizeof(Calibration) / sizeof(Calibration[0]);
+
+	/**
+	 * @brief Checks at compile time that the calibration points are sorted on the voltage.
+	 * @param i the first point to check.
+	 * @return true every point from i on has a higher voltage than the point before it.
+	 */
+	static constexpr bool calibrationSorted(size_t i = 1){
+		return i >= CalibrationPoints || (Calibration[i - 1].mv < Calibration[i].mv && calibrationSorted(i + 1));
+	}
+	/**
+	 * @brief Interpolates the concentration between the two calibration points around the voltage.
+	 * Outside the table the first or the last segment is extended.
+	 * @param mv the output voltage of the sensor board in mV.
+	 * @param i the upper point of the segment to start searching at.
+	 * @return float the O2 concentration in %.
+	 */
+	static constexpr float toConcentration(float mv, size_t i = 1){
+		return (i + 1 < CalibrationPoints && mv > Calibration[i].mv) ? toConcentration(mv, i + 1) :
+			Calibration[i - 1].o2 + (mv - Calibration[i - 1].mv) * (Calibration[i].o2 - Calibration[i - 1].o2) / (Calibration[i].mv - Calibration[i - 1].mv);
+	}
 
 private:	
 	/**
-	 * @brief The Voltage reference of the ADC.
+	 * @brief The Voltage reference of the ADC, only used without MIX8410_ADC_CALIBRATION.
 	 */
 	const float VRefer = 3.3;
 	/**
-	 * @brief The Pin onto which the module is connected.
+	 * @brief The ADC channel onto which the module is connected, GPIO35.
+	 */
+	const adc1_channel_t channel = ADC1_CHANNEL_7;
+	/**
+	 * @brief The eFuse calibration of ADC1.
+	 */
+	esp_adc_cal_characteristics_t adc_chars;
+	/**
+	 * @brief The filtered output voltage in 1/256 mV, -1 until the first burst.
 	 */
-	const int pinAdc   = A0;		
+	volatile int32_t filtered = -1;
+	/**
+	 * @brief Amount of bursts that could not be read.
+	 */
+	volatile uint32_t failed_bursts = 0;
+	/**
+	 * @brief Handle of the sampling task.
+	 */
+	TaskHandle_t sample_task = nullptr;
+	/**
+	 * @brief The last collected O2 percentage.
+	 */
+	float data = 0.0;
+
+	/**
+	 * @brief Sampling task, reads a burst every MIX8410_SAMPLE_INTERVAL.
+	 */
+	static void sampleTask(void* param);
+	/**
+	 * @brief Reads a burst of samples and adds its median to the filter.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 */
+	ERR_Type sampleBurst();
+	/**
+	 * @brief Converts a raw ADC value into mV.
+	 */
+	uint32_t toMillivolts(uint16_t raw);
 
 	// remove access to the constructor of __W_MIX8410.
 	__W_MIX8410(){}
@@ -47,20 +135,37 @@ public:
 	/**
 	 * @brief Initializes the MIX8410 object. Should only be called once.
 	 * This function initializes the MIX8410 object. It has a check build in to see if this function has already been called before. If so it will just return 0.
+	 * Configures the ADC channel and starts the sampling task.
 	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
 	 * @see ERR_Type
 	 */
-	ERR_Type init(){return SUCCESS;}
+	ERR_Type init();
 	/**
-	 * @brief Converted ADC value into O2 percentage.
+	 * @brief Converts the filtered voltage into O2 percentage.
 	 * 
 	 * @return float The Percentage of Oxygen in the air.
 	 */
 	float readConcentration();
 	/**
-	 * @brief Reads the ADC value and converts it into a voltage value.
+	 * @brief Returns the filtered output voltage of the sensor board, does not access the ADC.
 	 * 
-	 * @return float The read ADC value.
+	 * @return float The filtered voltage in V.
 	 */
 	float readO2Vout();
+
+	/**
+	 * @brief Measures the O2 concentration, it can be read with getData().
+	 * @param now the time in ms.
+	 * @return ERR_Type returns SUCCESS on succesfull exit, MIX8410_NO_SAMPLES before the first burst. Else it will return an error code.
+	 */
+	virtual ERR_Type collect(uint32_t now);
+	/**
+	 * @brief Returns the last collected O2 percentage.
+	 * @return float the Percentage of Oxygen in the air.
+	 */
+	float getData(){ return data; }
+	/**
+	 * @brief Returns the amount of bursts that could not be read, because the audio task did not release ADC1 in time.
+	 */
+	uint32_t getFailedBursts(){ return failed_bursts; }
 };
\ No newline at end of file
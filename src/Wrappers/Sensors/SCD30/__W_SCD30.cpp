@@ -1,12 +1,17 @@
 #include "__W_SCD30.h"
 #include "../../../Logger/Logger.h"
 
+/** @brief Command that returns 1 when a measurement can be read. */
+#define SCD30_CMD_DATA_READY 0x0202
+/** @brief Command that returns the CO2, T and RH of the last measurement. */
+#define SCD30_CMD_READ_MEASUREMENT 0x0300
+
 bool __W_SCD30::checkInitialized(){
     if(Initialized){
         return 0;
     }
     else{
-        Logger::getInstance().println("SCD30 is not initialized!", LogLevel::Error);
+        Logger::getInstance().println<LogLevel::Error>("SCD30 is not initialized!");
         return 1;
     }
 }
@@ -19,91 +24,205 @@ ERR_Type __W_SCD30::init(bool autoCalibrate){
 
 ERR_Type __W_SCD30::init(){
 	if(Initialized){return ALREADY_INITIALIZED;}	// return if already initialized;
-	if(!airSensor.begin(autoCalibrate)){ 
-		Logger::getInstance().println("SCD30 not detected. Please check wiring.", LogLevel::Error);
+	I2CTransaction T(I2CDevice::SCD30);
+	if(!T || !T.check(airSensor.begin(autoCalibrate))){ 
+		Logger::getInstance().println<LogLevel::Error>("SCD30 not detected. Please check wiring.");
 		return SCD30_BEGIN_ERR;
 	}
-	Logger::getInstance().println("SCD30 initialized.", LogLevel::Info);
+#if SCD30_RDY_PIN >= 0
+	pinMode(SCD30_RDY_PIN, INPUT);
+#endif
+	Logger::getInstance().println<LogLevel::Info>("SCD30 initialized.");
 	Initialized = true;
 	return SUCCESS;
 }
 
 SCD30_DATA __W_SCD30::read(){
-	SCD30_DATA buffer;
-	if(checkInitialized()){return buffer;} // don't act on to the hardware if not properly intialized;
-	buffer.CO2 = getCO2();
-	buffer.Temperature = getTemperature();
-	buffer.Humidity = getHumidity();
-	return buffer;
+	if(checkInitialized()){return data;} // don't act on to the hardware if not properly intialized;
+	state = ReadState::Idle; // a read of the scheduler that is still running is started again.
+	if(!dataAvailable() || !sendCommand(SCD30_CMD_READ_MEASUREMENT)){return data;}
+	delay(SCD30_RESPONSE_TIME);
+	readMeasurement(data);
+	return data;
 }
 
 bool __W_SCD30::dataAvailable(){
 	if(checkInitialized()){return false;} // don't act on to the hardware if not properly intialized;
-	return airSensor.dataAvailable();
+	I2CTransaction T(I2CDevice::SCD30);
+	if(!T){return false;}
+	bool available = airSensor.dataAvailable();
+	return T.checkLast() && available;
+}
+
+bool __W_SCD30::ready(uint32_t now){
+	if(!Initialized || (int32_t)(now - busy_until) < 0){return false;}
+	switch(state){
+		case ReadState::Idle:
+#if SCD30_RDY_PIN >= 0
+			// the RDY pin is high while a measurement can be read.
+			if(!digitalRead(SCD30_RDY_PIN)){return false;}
+#else
+			if((now - command_time) < SCD30_POLL_INTERVAL){return false;}
+			if(sendCommand(SCD30_CMD_DATA_READY)){
+				state = ReadState::StatusRequested;
+			}
+			command_time = now;
+			return false;
+#endif
+			break;
+		case ReadState::StatusRequested: {
+			if((now - command_time) < SCD30_RESPONSE_TIME){return false;}
+			state = ReadState::Idle;
+			uint8_t buf[3];
+			if(I2CBus::getInstance().read(I2CDevice::SCD30, buf, sizeof(buf))){return false;}
+			if(crc8(buf) != buf[2] || buf[1] != 1){return false;} // the word is 1 when a measurement can be read.
+			break;
+		}
+		case ReadState::MeasurementRequested:
+			return (now - command_time) >= SCD30_RESPONSE_TIME;
+	}
+	// a measurement can be read, request it.
+	if(sendCommand(SCD30_CMD_READ_MEASUREMENT)){
+		state = ReadState::MeasurementRequested;
+	}
+	command_time = now;
+	return false;
+}
+
+ERR_Type __W_SCD30::collect(uint32_t now){
+	(void)now;
+	if(checkInitialized()){return NOT_INITIALIZED;} // don't act on to the hardware if not properly intialized;
+	state = ReadState::Idle;
+	return readMeasurement(data);
+}
+
+bool __W_SCD30::sendCommand(uint16_t command){
+	const uint8_t buf[] = {(uint8_t)(command >> 8), (uint8_t)(command & 0xFF)};
+	return !I2CBus::getInstance().write(I2CDevice::SCD30, buf, sizeof(buf));
+}
+
+ERR_Type __W_SCD30::readMeasurement(SCD30_DATA& buffer){
+	// CO2, T and RH are big endian floats, sent as two words that are each followed by a CRC.
+	uint8_t buf[18];
+	if(I2CBus::getInstance().read(I2CDevice::SCD30, buf, sizeof(buf))){return READ_FAIL;}
+	float values[3];
+	for(int v = 0; v < 3; v++){
+		const uint8_t* word = buf + v * 6;
+		if(crc8(word) != word[2] || crc8(word + 3) != word[5]){
+			return SCD30_CRC_ERR;
+		}
+		uint32_t bits = ((uint32_t)word[0] << 24) | ((uint32_t)word[1] << 16) | ((uint32_t)word[3] << 8) | word[4];
+		memcpy(&values[v], &bits, sizeof(float));
+	}
+	buffer.CO2 = values[0];
+	buffer.Temperature = values[1];
+	buffer.Humidity = values[2];
+	buffer.sequence = data.sequence + 1;
+	return SUCCESS;
+}
+
+uint8_t __W_SCD30::crc8(const uint8_t* data){
+	uint8_t crc = 0xFF;
+	for(int i = 0; i < 2; i++){
+		crc ^= data[i];
+		for(int bit = 0; bit < 8; bit++){
+			crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : crc << 1;
+		}
+	}
+	return crc;
 }
 
 uint16_t __W_SCD30::getCO2(){
 	if(checkInitialized()){return 0;} // don't act on to the hardware if not properly intialized;
-	return airSensor.getCO2();
+	I2CTransaction T(I2CDevice::SCD30);
+	if(!T){return 0;}
+	return T.checkLast(airSensor.getCO2());
 }
 
 float __W_SCD30::getTemperature(){
 	if(checkInitialized()){return 0.0;} // don't act on to the hardware if not properly intialized;
-	return airSensor.getTemperature();
+	I2CTransaction T(I2CDevice::SCD30);
+	if(!T){return 0.0;}
+	return T.checkLast(airSensor.getTemperature());
 }
 
 float __W_SCD30::getHumidity(){
 	if(checkInitialized()){return 0.0;} // don't act on to the hardware if not properly intialized;
-	return airSensor.getHumidity();
+	I2CTransaction T(I2CDevice::SCD30);
+	if(!T){return 0.0;}
+	return T.checkLast(airSensor.getHumidity());
 }
 
 // Options
 
 void __W_SCD30::setMeasurementsInterval(uint16_t seconds){
 	if(checkInitialized()){return;} // don't act on to the hardware if not properly intialized;
-	airSensor.setMeasurementInterval(seconds);
-	delay(200);
+	I2CTransaction T(I2CDevice::SCD30);
+	if(!T){return;}
+	T.check(airSensor.setMeasurementInterval(seconds));
+	// the sensor restarts its measurement, let ready() leave it alone instead of waiting here.
+	busy_until = millis() + SCD30_INTERVAL_SETTLE_TIME;
+	state = ReadState::Idle;
 }
 bool __W_SCD30::getMeasurementsInterval(uint16_t& seconds){
 	if(checkInitialized()){return false;} // don't act on to the hardware if not properly intialized;
-	return airSensor.getMeasurementInterval(&seconds);
+	I2CTransaction T(I2CDevice::SCD30);
+	if(!T){return false;}
+	return T.check(airSensor.getMeasurementInterval(&seconds));
 }
 
 void __W_SCD30::setAltitudeCompensation(uint16_t altitude){
 	if(checkInitialized()){return;} // don't act on to the hardware if not properly intialized;
-	airSensor.setAltitudeCompensation(altitude);
+	I2CTransaction T(I2CDevice::SCD30);
+	if(!T){return;}
+	T.check(airSensor.setAltitudeCompensation(altitude));
 }
 bool __W_SCD30::getAltitudeCompensation(uint16_t& altitude){
 	if(checkInitialized()){return false;} // don't act on to the hardware if not properly intialized;
-	return airSensor.getAltitudeCompensation(&altitude);
+	I2CTransaction T(I2CDevice::SCD30);
+	if(!T){return false;}
+	return T.check(airSensor.getAltitudeCompensation(&altitude));
 }
 
 void __W_SCD30::setAmbientPressure(uint16_t offset){
 	if(checkInitialized()){return;} // don't act on to the hardware if not properly intialized;
-	airSensor.setAmbientPressure(offset);
+	I2CTransaction T(I2CDevice::SCD30);
+	if(!T){return;}
+	T.check(airSensor.setAmbientPressure(offset));
 }
 
 void __W_SCD30::setTemperatureOffset(float tempOffset){
 	if(checkInitialized()){return;} // don't act on to the hardware if not properly intialized;
-	airSensor.setTemperatureOffset(tempOffset);
+	I2CTransaction T(I2CDevice::SCD30);
+	if(!T){return;}
+	T.check(airSensor.setTemperatureOffset(tempOffset));
 }
 
 bool __W_SCD30::getTemperatureOffset(float& tempOffset){
 	if(checkInitialized()){return false;} // don't act on to the hardware if not properly intialized;
-	return airSensor.getTemperatureOffset((uint16_t*)&tempOffset);
+	I2CTransaction T(I2CDevice::SCD30);
+	if(!T){return false;}
+	return T.check(airSensor.getTemperatureOffset((uint16_t*)&tempOffset));
 }
 
 bool  __W_SCD30::getAutoSelfCalibration(){
 	if(checkInitialized()){return false;} // don't act on to the hardware if not properly intialized;
-	return airSensor.getAutoSelfCalibration();
+	I2CTransaction T(I2CDevice::SCD30);
+	if(!T){return false;}
+	bool enabled = airSensor.getAutoSelfCalibration();
+	return T.checkLast() && enabled;
 }
 
 bool __W_SCD30::getForcedRecalibration(uint16_t& settingVal){
 	if(checkInitialized()){return false;} // don't act on to the hardware if not properly intialized;
-	return airSensor.getForcedRecalibration(&settingVal);
+	I2CTransaction T(I2CDevice::SCD30);
+	if(!T){return false;}
+	return T.check(airSensor.getForcedRecalibration(&settingVal));
 }
 
 bool __W_SCD30::getFirmwareVersion(uint16_t& settingVal){
 	if(checkInitialized()){return false;} // don't act on to the hardware if not properly intialized;
-	return airSensor.getFirmwareVersion(&settingVal);
+	I2CTransaction T(I2CDevice::SCD30);
+	if(!T){return false;}
+	return T.check(airSensor.getFirmwareVersion(&settingVal));
 }
\ No newline at end of file
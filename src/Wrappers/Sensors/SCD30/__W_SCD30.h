@@ -10,10 +10,10 @@
  */
 #pragma once
 
-#include <Wire.h>
 #include <SparkFun_SCD30_Arduino_Library.h>
 #include "../../__W_Module/__iW_Module.h"
 #include "../../Singleton/Singleton.h"
+#include "../../I2C/I2CBus.h"
 
 /**
  * @addtogroup STRUCT
@@ -27,6 +27,8 @@ struct SCD30_DATA {
 	float Temperature;
 	/** Humidity value */
 	float Humidity;
+	/** Number of the measurement, counts up for every measurement that is read, 0 when nothing has been read yet. */
+	uint32_t sequence;
 };
 /**@}*/
 
@@ -42,6 +44,48 @@ private:
 	 * @brief boolean value indicating if the sensor should autocalibrate.
 	 */
 	bool autoCalibrate = false;
+	/**
+	 * @brief The last collected data.
+	 */
+	SCD30_DATA data = SCD30_DATA();
+
+	/**
+	 * @brief Steps of reading a measurement without waiting on the sensor.
+	 */
+	enum class ReadState : uint8_t {
+		/** Waiting for the RDY pin or the next data ready poll. */
+		Idle,
+		/** The data ready status has been requested. */
+		StatusRequested,
+		/** The measurement has been requested and can be read after SCD30_RESPONSE_TIME. */
+		MeasurementRequested
+	};
+	/** @brief The step of the running read. */
+	ReadState state = ReadState::Idle;
+	/** @brief Time in ms at which the last command was sent. */
+	uint32_t command_time = 0;
+	/** @brief The sensor takes no commands before this time in ms, set by setMeasurementsInterval(). */
+	uint32_t busy_until = 0;
+
+	/**
+	 * @brief Sends a command without arguments to the SCD30.
+	 * @param command the command.
+	 * @return true the sensor acknowledged the command.
+	 */
+	bool sendCommand(uint16_t command);
+	/**
+	 * @brief Reads the response of the read measurement command: CO2, T and RH in one transaction.
+	 * Every word is checked against its CRC, the buffer is only written when all of them match.
+	 * @param buffer buffer for the measurement.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 */
+	ERR_Type readMeasurement(SCD30_DATA& buffer);
+	/**
+	 * @brief Calculates the CRC of a word of the SCD30.
+	 * @param data the two bytes of the word.
+	 * @return uint8_t the CRC-8 with polynomial 0x31 and initial value 0xFF.
+	 */
+	static uint8_t crc8(const uint8_t* data);
 	/**
 	 * @brief virtual implementation of the iW_Module function.
 	 * Will report an error if not initialized.
@@ -67,9 +111,9 @@ public:
 	void operator=(__W_SCD30 const&)	= delete;	// remove assignment operator.
 
 	/**
-	 * @brief Reads the SCD30 sensor.
-	 * 
-	 * @return SCD30_DATA Struct containing the read SCD30 Data.
+	 * @brief Reads the SCD30 sensor when it has a new measurement.
+	 * Waits SCD30_RESPONSE_TIME for the sensor, use the scheduler to read without waiting.
+	 * @return SCD30_DATA Struct containing the read SCD30 Data, the last read data when there is no new measurement.
 	 */
 	SCD30_DATA read();
 
@@ -104,9 +148,29 @@ public:
 	 */
 	bool dataAvailable();
 
+	/**
+	 * @brief Checks if the sensor has a new measurement, the SCD30 measures continuously.
+	 * Every call does at most one step: check the RDY pin or the data ready status, then request the measurement.
+	 * @param now the time in ms.
+	 * @return true the requested measurement can be read.
+	 * @return false there is no new measurement yet.
+	 */
+	virtual bool ready(uint32_t now);
+	/**
+	 * @brief Reads the requested measurement, it can be read with getData().
+	 * @param now the time in ms.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 */
+	virtual ERR_Type collect(uint32_t now);
+	/**
+	 * @brief Returns the last collected measurement.
+	 * @return const SCD30_DATA& the measurement.
+	 */
+	const SCD30_DATA& getData(){ return data; }
+
 	/**
 	 * @brief Returns the read CO2 ppm value.
-	 * 
+	 * Reads a new measurement from the sensor, use read() or getData() to get all values of the same measurement.
 	 * @return uint16_t the CO2 in ppm.
 	 */
 	uint16_t getCO2();
@@ -127,6 +191,7 @@ public:
 	/**
 	 * @brief Set the Measurements Interval.
 	 * Change number of seconds between measurements: 2 to 1800 (30 minutes), stored in non-volatile memory of SCD30.
+	 * Does not wait for the sensor, the measurement is not read for SCD30_INTERVAL_SETTLE_TIME ms after the change.
 	 * @param seconds 
 	 */
 	void setMeasurementsInterval(uint16_t seconds);
@@ -0,0 +1,62 @@
+#include "TSL2591Ranging.h"
+
+// device factor of the lux calculation, the same value as TSL2591_LUX_DF of the Adafruit library.
+static const float LUX_DF = 408.0F;
+
+const TSL2591Range TSL2591Ranging::Ranges[TSL2591_RANGE_COUNT] = {
+    {1,    100},
+    {25,   100},
+    {428,  100},
+    {428,  300},
+    {9876, 100},
+    {9876, 300},
+    {9876, 600},
+};
+
+// highest count of a channel, the ADC can't reach the full 16 bits with the shortest integration time.
+static uint32_t maxCount(uint16_t time){
+    return time == 100 ? 36863 : 65535;
+}
+
+// relative sensitivity of a range.
+static uint32_t sensitivity(const TSL2591Range& R){
+    return (uint32_t)R.factor * (R.time / 100);
+}
+
+float TSL2591Ranging::lux(uint16_t full, uint16_t ir, const TSL2591Range& R){
+    if(full == 0xFFFF || ir == 0xFFFF){return -1;}
+    if(full == 0){return 0;}
+    float cpl = ((float)R.time * (float)R.factor) / LUX_DF;
+    return ((float)full - (float)ir) * (1.0F - ((float)ir / (float)full)) / cpl;
+}
+
+float TSL2591Ranging::evaluate(uint16_t full, uint16_t ir){
+    const TSL2591Range& R = Ranges[range];
+    uint32_t high = maxCount(R.time) * TSL2591_RANGE_HIGH / 100;
+    uint32_t count = full > ir ? full : ir;
+    if(count >= high){
+        // a fully clipped channel says nothing about how bright it is, so start again from the least sensitive range.
+        uint8_t next = count >= maxCount(R.time) ? 0 : (range ? range - 1 : 0);
+#if TSL2591_AUTORANGE
+        range = next;
+#else
+        (void)next;
+#endif
+        return -1;
+    }
+    // the lux belongs to the range of this conversion, so it is calculated before the range changes.
+    float result = lux(full, ir, R);
+#if TSL2591_AUTORANGE
+    // take the most sensitive range at which the counts are expected to stay below half of the saturation level,
+    // so the next conversion neither saturates nor steps straight back down.
+    uint8_t next = range;
+    while(next + 1 < TSL2591_RANGE_COUNT){
+        const TSL2591Range& N = Ranges[next + 1];
+        uint64_t expected = (uint64_t)count * sensitivity(N) / sensitivity(R);
+        if(expected >= maxCount(N.time) * TSL2591_RANGE_HIGH / 200){break;}
+        next++;
+    }
+    range = next;
+#endif
+    return result;
+}
\ No newline at end of file
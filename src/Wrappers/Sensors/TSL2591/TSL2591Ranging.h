@@ -0,0 +1,88 @@
+/**
+ * @file TSL2591Ranging.h
+ * @author Imre Korf
+ * @brief The gain and integration time ranges of the TSL2591, the lux of a conversion and the choice of the next range.
+ * @version 0.1
+ * @date 2022-04-05
+ *
+ * Index | Gain | Integration time
+ * :-----:|:-----:|:-----:
+ *  0 | 1x | 100 ms
+ *  1 | 25x | 100 ms
+ *  2 | 428x | 100 ms
+ *  3 | 428x | 300 ms
+ *  4 | 9876x | 100 ms
+ *  5 | 9876x | 300 ms
+ *  6 | 9876x | 600 ms
+ *
+ * The lux of a conversion is calculated with the range it was measured with, before the next range is picked.
+ * This file only uses the standard library, so the HostTests can check it on a host.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+#include "../../../Defines/Defines.h"
+
+/**
+ * @brief Amount of ranges of the TSL2591.
+ */
+#define TSL2591_RANGE_COUNT 7
+
+static_assert(TSL2591_RANGE_START < TSL2591_RANGE_COUNT, "TSL2591_RANGE_START is not in the range table");
+
+/**
+ * @addtogroup STRUCT
+ * @{
+ */
+/**
+ * @brief A gain and integration time of the TSL2591.
+ */
+struct TSL2591Range {
+	/** Gain as a factor, the same values the Adafruit library uses in calculateLux(). */
+	uint16_t factor;
+	/** Integration time in ms. */
+	uint16_t time;
+};
+/**@}*/
+
+/**
+ * @brief Keeps the active range of the TSL2591 and picks the next one from the counts of a conversion.
+ */
+class TSL2591Ranging {
+private:
+	/** @brief Index of the active range. */
+	uint8_t range = TSL2591_RANGE_START;
+public:
+	/** @brief The ranges from least to most sensitive, the gain is raised before the integration time to keep the conversions short. */
+	static const TSL2591Range Ranges[TSL2591_RANGE_COUNT];
+
+	/**
+	 * @brief Calculates the lux of a conversion, the same way the Adafruit library does.
+	 * @param full count of channel 0 (IR+Visible).
+	 * @param ir count of channel 1 (IR).
+	 * @param R the range the conversion was measured with.
+	 * @return float the lux, -1 when a channel overflowed.
+	 */
+	static float lux(uint16_t full, uint16_t ir, const TSL2591Range& R);
+
+	/**
+	 * @brief Calculates the lux of a conversion with the active range, then picks the range of the next conversion.
+	 * @param full count of channel 0.
+	 * @param ir count of channel 1.
+	 * @return float the lux, -1 when a channel was saturated.
+	 */
+	float evaluate(uint16_t full, uint16_t ir);
+
+	/**
+	 * @brief Sets the active range.
+	 * @param index index in the range table, is limited to the last range.
+	 */
+	void set(uint8_t index){ range = index < TSL2591_RANGE_COUNT ? index : TSL2591_RANGE_COUNT - 1; }
+	/** @brief Returns the index of the active range. */
+	uint8_t index() const { return range; }
+	/** @brief Returns the active range. */
+	const TSL2591Range& current() const { return Ranges[range]; }
+};
\ No newline at end of file
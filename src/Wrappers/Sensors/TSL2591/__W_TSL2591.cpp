@@ -2,12 +2,31 @@
 #include <Arduino.h>
 #include "../../../Logger/Logger.h"
 
+/**
+ * @brief The register values of a range of the TSL2591.
+ */
+struct TSL2591_Setting {
+    tsl2591Gain_t gain;
+    tsl2591IntegrationTime_t timing;
+};
+
+// the gain and integration time of every range, in the order of TSL2591Ranging::Ranges.
+static constexpr TSL2591_Setting Settings[TSL2591_RANGE_COUNT] = {
+    {TSL2591_GAIN_LOW,  TSL2591_INTEGRATIONTIME_100MS},
+    {TSL2591_GAIN_MED,  TSL2591_INTEGRATIONTIME_100MS},
+    {TSL2591_GAIN_HIGH, TSL2591_INTEGRATIONTIME_100MS},
+    {TSL2591_GAIN_HIGH, TSL2591_INTEGRATIONTIME_300MS},
+    {TSL2591_GAIN_MAX,  TSL2591_INTEGRATIONTIME_100MS},
+    {TSL2591_GAIN_MAX,  TSL2591_INTEGRATIONTIME_300MS},
+    {TSL2591_GAIN_MAX,  TSL2591_INTEGRATIONTIME_600MS},
+};
+
 bool __W_TSL2591::checkInitialized(){
     if(Initialized){
         return 0;
     }
     else{
-        Logger::getInstance().println("TSL2591 is not initialized!", LogLevel::Error);
+        Logger::getInstance().println<LogLevel::Error>("TSL2591 is not initialized!");
         return 1;
     }
 }
@@ -19,54 +38,46 @@ bool __W_TSL2591::checkInitialized(){
 /**************************************************************************/
 ERR_Type __W_TSL2591::init(){
     if(Initialized){return ALREADY_INITIALIZED;}	// return if already initialized.
-    if (tsl.begin()) 
+    I2CTransaction T(I2CDevice::TSL2591);
+    if (T && T.check(tsl.begin())) 
     {
-		Logger::getInstance().println("Found a TSL2591 sensor", LogLevel::Info);
+        I2CBus::getInstance().reconfigure(); // the library restarts Wire in its begin().
+		Logger::getInstance().println<LogLevel::Info>("Found a TSL2591 sensor");
 	} 
 	else 
 	{
-		Logger::getInstance().println("No TSL2591 sensor found ... check your wiring?", LogLevel::Error);
+		Logger::getInstance().println<LogLevel::Error>("No TSL2591 sensor found ... check your wiring?");
 		return TSL_BEGIN_ERR; // error code
     }
 
-    // You can change the gain on the fly, to adapt to brighter/dimmer light situations
-    //tsl.setGain(TSL2591_GAIN_LOW);    // 1x gain (bright light)
-    tsl.setGain(TSL2591_GAIN_MED);      // 25x gain
-    //tsl.setGain(TSL2591_GAIN_HIGH);   // 428x gain
-
-    // Changing the integration time gives you a longer time over which to sense light
-    // longer timelines are slower, but are good in very low light situtations!
-    //tsl.setTiming(TSL2591_INTEGRATIONTIME_100MS);  // shortest integration time (bright light)
-    // tsl.setTiming(TSL2591_INTEGRATIONTIME_200MS);
-    tsl.setTiming(TSL2591_INTEGRATIONTIME_300MS);
-    // tsl.setTiming(TSL2591_INTEGRATIONTIME_400MS);
-    // tsl.setTiming(TSL2591_INTEGRATIONTIME_500MS);
-    // tsl.setTiming(TSL2591_INTEGRATIONTIME_600MS);  // longest integration time (dim light)
+    // The gain and integration time are changed on the fly by autoRange() to adapt to brighter/dimmer light situations,
+    // a higher gain or longer integration time is more sensitive but saturates in bright light.
+    setRange(TSL2591_RANGE_START);
 
     /* Display the gain and integration time for reference sake */  
-    Logger::getInstance().print("TSL2591 bootup\n", LogLevel::Info);
-    Logger::getInstance().print("------------------------------------\n", LogLevel::Info);
-    Logger::getInstance().print("Gain:         ", LogLevel::Info);
-    tsl2591Gain_t gain = tsl.getGain();
+    Logger::getInstance().print<LogLevel::Info>("TSL2591 bootup\n");
+    Logger::getInstance().print<LogLevel::Info>("------------------------------------\n");
+    Logger::getInstance().print<LogLevel::Info>("Gain:         ");
+    tsl2591Gain_t gain = tsl.getGain(); // the library keeps the gain and timing it set, no I2C.
     switch(gain)
     {
     	case TSL2591_GAIN_LOW:
-			Logger::getInstance().print("1x (Low)\n", LogLevel::Info);
+			Logger::getInstance().print<LogLevel::Info>("1x (Low)\n");
 			break;
       	case TSL2591_GAIN_MED:
-			Logger::getInstance().print("25x (Medium)\n", LogLevel::Info);
+			Logger::getInstance().print<LogLevel::Info>("25x (Medium)\n");
 			break;
       	case TSL2591_GAIN_HIGH:
-			Logger::getInstance().print("428x (High)\n", LogLevel::Info);
+			Logger::getInstance().print<LogLevel::Info>("428x (High)\n");
 			break;
       	case TSL2591_GAIN_MAX:
-			Logger::getInstance().print("9876x (Max)\n", LogLevel::Info);
+			Logger::getInstance().print<LogLevel::Info>("9876x (Max)\n");
 			break;
     }
-    Logger::getInstance().print  ("Timing:       ", LogLevel::Info);
-    Logger::getInstance().print((tsl.getTiming() + 1) * 100, LogLevel::Info); 
-    Logger::getInstance().print(" ms\n", LogLevel::Info);
-    Logger::getInstance().println("------------------------------------\n", LogLevel::Info);
+    Logger::getInstance().print<LogLevel::Info>("Timing:       ");
+    Logger::getInstance().print<LogLevel::Info>((tsl.getTiming() + 1) * 100); 
+    Logger::getInstance().print<LogLevel::Info>(" ms\n");
+    Logger::getInstance().println<LogLevel::Info>("------------------------------------\n");
 
     Initialized = true;
     return SUCCESS;
@@ -83,35 +94,96 @@ void __W_TSL2591::displaySensorDetails(void)
 {
     if(checkInitialized()){return;} // don't act on to the hardware if not properly intialized;
     sensor_t sensor;
-    tsl.getSensor(&sensor);
-    Logger::getInstance().print("\nTSL2591 Sensor Info: ", LogLevel::Info);
-    Logger::getInstance().print("\n------------------------------------", LogLevel::Info);
-    Logger::getInstance().print("\nSensor:       ", LogLevel::Info); Logger::getInstance().print(sensor.name, LogLevel::Info);
-    Logger::getInstance().print("\nDriver Ver:   ", LogLevel::Info); Logger::getInstance().print(sensor.version, LogLevel::Info);
-    Logger::getInstance().print("\nUnique ID:    ", LogLevel::Info); Logger::getInstance().print(sensor.sensor_id, LogLevel::Info);
-    Logger::getInstance().print("\nMax Value:    ", LogLevel::Info); Logger::getInstance().print(sensor.max_value, LogLevel::Info); Logger::getInstance().println(" lux", LogLevel::Info);
-    Logger::getInstance().print("\nMin Value:    ", LogLevel::Info); Logger::getInstance().print(sensor.min_value, LogLevel::Info); Logger::getInstance().println(" lux", LogLevel::Info);
-    Logger::getInstance().print("\nResolution:   ", LogLevel::Info); Logger::getInstance().print(sensor.resolution, LogLevel::Info); Logger::getInstance().println(" lux", LogLevel::Info);  
-    Logger::getInstance().println("\n------------------------------------", LogLevel::Info);
+    tsl.getSensor(&sensor); // only fills in constants, no I2C.
+    Logger::getInstance().print<LogLevel::Info>("\nTSL2591 Sensor Info: ");
+    Logger::getInstance().print<LogLevel::Info>("\n------------------------------------");
+    Logger::getInstance().print<LogLevel::Info>("\nSensor:       "); Logger::getInstance().print<LogLevel::Info>(sensor.name);
+    Logger::getInstance().print<LogLevel::Info>("\nDriver Ver:   "); Logger::getInstance().print<LogLevel::Info>(sensor.version);
+    Logger::getInstance().print<LogLevel::Info>("\nUnique ID:    "); Logger::getInstance().print<LogLevel::Info>(sensor.sensor_id);
+    Logger::getInstance().print<LogLevel::Info>("\nMax Value:    "); Logger::getInstance().print<LogLevel::Info>(sensor.max_value); Logger::getInstance().println<LogLevel::Info>(" lux");
+    Logger::getInstance().print<LogLevel::Info>("\nMin Value:    "); Logger::getInstance().print<LogLevel::Info>(sensor.min_value); Logger::getInstance().println<LogLevel::Info>(" lux");
+    Logger::getInstance().print<LogLevel::Info>("\nResolution:   "); Logger::getInstance().print<LogLevel::Info>(sensor.resolution); Logger::getInstance().println<LogLevel::Info>(" lux");  
+    Logger::getInstance().println<LogLevel::Info>("\n------------------------------------");
     delay(500);
 }
 
 uint16_t __W_TSL2591::getLuminosity(uint8_t spectrum){
     if(checkInitialized()){return 0;} // don't act on to the hardware if not properly intialized;
-    return tsl.getLuminosity(spectrum);
+    I2CTransaction T(I2CDevice::TSL2591);
+    if(!T){return 0;}
+    return T.checkLast(tsl.getLuminosity(spectrum));
 }
 
 TSL2591_DATA __W_TSL2591::getFullLuminosity(){
-    TSL2591_DATA LB;
+    TSL2591_DATA LB = TSL2591_DATA();
     if(checkInitialized()){return LB;} // don't act on to the hardware if not properly intialized;
+    I2CTransaction T(I2CDevice::TSL2591);
+    if(!T){return LB;}
     uint32_t lum = tsl.getFullLuminosity();
+    if(!T.checkLast()){return LB;}
     LB.ir = lum >> 16; // get last 16 bits
     LB.full = lum & 0xFFFF; // get first 16 bits
     LB.visible = LB.full-LB.ir;
+    LB.lux = tsl.calculateLux(LB.full, LB.ir);
+    LB.gain = ranging.current().factor;
+    LB.integration = ranging.current().time;
     return LB;
 }
 
 float __W_TSL2591::getLux(uint16_t full, uint16_t ir){
     if(checkInitialized()){return 0.0;} // don't act on to the hardware if not properly intialized;
     return tsl.calculateLux(full, ir);
+}
+
+void __W_TSL2591::setRange(uint8_t index){
+    ranging.set(index);
+    I2CTransaction T(I2CDevice::TSL2591);
+    if(!T){return;}
+    tsl.setGain(Settings[ranging.index()].gain);
+    T.checkLast();
+    tsl.setTiming(Settings[ranging.index()].timing);
+    T.checkLast();
+}
+
+ERR_Type __W_TSL2591::start(uint32_t now){
+    if(checkInitialized()){return NOT_INITIALIZED;} // don't act on to the hardware if not properly intialized;
+    I2CTransaction T(I2CDevice::TSL2591);
+    if(!T){return I2C_BUS_BUSY;}
+    tsl.enable();
+    if(!T.checkLast()){return READ_FAIL;}
+    conversion_start = now;
+    return SUCCESS;
+}
+
+bool __W_TSL2591::ready(uint32_t now){
+    // don't poll the bus before the integration time has passed, the conversion can't be done yet.
+    if((now - conversion_start) < ranging.current().time){return false;}
+    I2CTransaction T(I2CDevice::TSL2591);
+    if(!T){return false;}
+    uint8_t status = tsl.getStatus();
+    return T.checkLast() && (status & 0x01); // ALS valid bit, set once both channels hold a complete conversion.
+}
+
+ERR_Type __W_TSL2591::collect(uint32_t now){
+    (void)now;
+    if(checkInitialized()){return NOT_INITIALIZED;} // don't act on to the hardware if not properly intialized;
+    // read both channels in one transaction, the Adafruit library only does this in the blocking getFullLuminosity().
+    I2CTransaction T(I2CDevice::TSL2591);
+    if(!T){return I2C_BUS_BUSY;}
+    const uint8_t reg = TSL2591_COMMAND_BIT | TSL2591_REGISTER_CHAN0_LOW;
+    uint8_t buf[4];
+    ERR_Type ET = I2CBus::getInstance().writeRead(I2CDevice::TSL2591, &reg, 1, buf, sizeof(buf));
+    tsl.disable();
+    T.checkLast();
+    if(ET){return READ_FAIL;}
+    data.full = buf[0] | (buf[1] << 8);
+    data.ir = buf[2] | (buf[3] << 8);
+    data.visible = data.full - data.ir;
+    data.gain = ranging.current().factor;
+    data.integration = ranging.current().time;
+    // the lux is calculated with the range of this conversion, the library would use the gain and time set for the next one.
+    uint8_t previous = ranging.index();
+    data.lux = ranging.evaluate(data.full, data.ir);
+    if(ranging.index() != previous){setRange(ranging.index());}
+    return data.lux < 0 ? TSL_SATURATED : SUCCESS;
 }
\ No newline at end of file
@@ -10,12 +10,13 @@
  */
 #pragma once
 
-#include <Wire.h>
+#include "../../I2C/I2CBus.h"
 #include <Adafruit_Sensor.h>
 #include <Adafruit_TSL2591.h>
 
 #include "../../__W_Module/__iW_Module.h"
 #include "../../Singleton/Singleton.h"
+#include "TSL2591Ranging.h"
 
 /**
  * @addtogroup STRUCT
@@ -30,6 +31,12 @@ struct TSL2591_DATA {
 	uint16_t ir;
 	/** @brief Lux values of full spectrum range. */
 	uint16_t full;
+	/** @brief Lux calculated with the gain and integration time of the conversion, negative when a channel was saturated. */
+	float lux;
+	/** @brief Gain of the conversion, 1, 25, 428 or 9876. */
+	uint16_t gain;
+	/** @brief Integration time of the conversion in ms. */
+	uint16_t integration;
 };
 /**@}*/
 
@@ -40,6 +47,18 @@ class __W_TSL2591 : public __iW_Module, public iSingleton {
 private:
 	/** @brief Handle to the adafruit TSL2591 library. */
 	Adafruit_TSL2591 tsl; 
+	/** @brief The last collected data. */
+	TSL2591_DATA data = TSL2591_DATA();
+	/** @brief Time in ms at which the running conversion was started. */
+	uint32_t conversion_start = 0;
+	/** @brief The active gain and integration time, picks the next ones after every conversion. */
+	TSL2591Ranging ranging;
+
+	/**
+	 * @brief Sets the gain and integration time of a range.
+	 * @param index index in the range table, is limited to the last range.
+	 */
+	void setRange(uint8_t index);
 
 	/**
 	 * @brief virtual implementation of the iW_Module function.
@@ -99,4 +118,35 @@ public:
     @returns Lux, based on AMS coefficients (or < 0 if overflow)
 	*/
 	float getLux(uint16_t full, uint16_t ir);
+	/**
+	 * @brief Returns the lux of the last collected conversion.
+	 * @returns Lux, calculated with the gain and integration time of that conversion (or < 0 if overflow)
+	 */
+	float getLux(){ return data.lux; }
+
+	/**
+	 * @brief Powers on the ADCs to start a conversion with the active range.
+	 * @param now the time in ms.
+	 * @return ERR_Type returns SUCCESS on succesfull exit. Else it will return an error code.
+	 */
+	virtual ERR_Type start(uint32_t now);
+	/**
+	 * @brief Checks the ALS valid bit once the integration time has passed.
+	 * @param now the time in ms.
+	 * @return true the conversion is done.
+	 * @return false the conversion is still running.
+	 */
+	virtual bool ready(uint32_t now);
+	/**
+	 * @brief Reads both channels, powers the ADCs off and picks the range of the next conversion.
+	 * The data can be read with getData().
+	 * @param now the time in ms.
+	 * @return ERR_Type returns SUCCESS on succesfull exit, TSL_SATURATED when a channel was saturated. Else it will return an error code.
+	 */
+	virtual ERR_Type collect(uint32_t now);
+	/**
+	 * @brief Returns the last collected data.
+	 * @return const TSL2591_DATA& the data.
+	 */
+	const TSL2591_DATA& getData(){ return data; }
 };
\ No newline at end of file
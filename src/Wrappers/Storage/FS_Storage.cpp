@@ -0,0 +1,38 @@
+#include "FS_Storage.h"
+
+StorageFile FS_Storage::open(const char* path, StorageMode mode){
+	const char* fmode = FILE_READ;
+	switch(mode){
+		case StorageMode::Read:   fmode = FILE_READ;   break;
+		case StorageMode::Write:  fmode = FILE_WRITE;  break;
+		case StorageMode::Append: fmode = FILE_APPEND; break;
+		case StorageMode::Update: fmode = "r+";        break;
+	}
+	fs::File file = FS.open(path, fmode);
+	if(!file){return StorageFile();}
+	return StorageFile(new FS_StorageFile(file));
+}
+
+bool FS_Storage::listDir(const char* path, Storage_DirCallback callback, void* context){
+	fs::File root = FS.open(path);
+	if(!root || !root.isDirectory()){return false;}
+	fs::File file = root.openNextFile();
+	while(file){
+		bool is_dir = file.isDirectory();
+		if(!callback(file.path(), is_dir, is_dir ? 0 : file.size(), context)){
+			break;
+		}
+		file = root.openNextFile();
+	}
+	return true;
+}
+
+bool SD_Storage::begin(){
+	if(!present()){return false;}
+	if(!SD_FS.begin()){return false;}
+	if(SD_FS.cardType() == CARD_NONE){
+		SD_FS.end();
+		return false;
+	}
+	return true;
+}
\ No newline at end of file
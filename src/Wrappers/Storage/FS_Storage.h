@@ -0,0 +1,105 @@
+/**
+ * @file FS_Storage.h
+ * @author Imre Korf
+ * @brief Storage implementations on top of the Arduino file systems: the SD card and LittleFS on the internal flash.
+ * @version 0.1
+ * @date 2022-03-09
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include "iStorage.h"
+#include "../../Defines/Defines.h"
+
+#include <Arduino.h>
+#include <FS.h>
+#include <SD.h>
+#include <LittleFS.h>
+
+/**
+ * @brief File of an Arduino file system.
+ */
+class FS_StorageFile : public iStorageFile {
+private:
+	/** The opened Arduino file. */
+	fs::File file;
+
+public:
+	FS_StorageFile(fs::File opened) : file(opened) {}
+	virtual ~FS_StorageFile(){ file.close(); }
+
+	virtual size_t read(uint8_t* buffer, size_t len){ return file.read(buffer, len); }
+	virtual size_t write(const uint8_t* data, size_t len){ return file.write(data, len); }
+	virtual bool seek(size_t pos){ return file.seek(pos); }
+	virtual size_t size(){ return file.size(); }
+	virtual void flush(){ file.flush(); }
+};
+
+/**
+ * @brief Common part of the storages that use an Arduino file system.
+ */
+class FS_Storage : public iStorage {
+protected:
+	/** The Arduino file system. */
+	fs::FS& FS;
+
+public:
+	FS_Storage(fs::FS& fs) : FS(fs) {}
+
+	virtual StorageFile open(const char* path, StorageMode mode);
+	virtual bool exists(const char* path){ return FS.exists(path); }
+	virtual bool remove(const char* path){ return FS.remove(path); }
+	virtual bool rename(const char* from, const char* to){ return FS.rename(from, to); }
+	virtual bool mkdir(const char* path){ return FS.mkdir(path); }
+	virtual bool rmdir(const char* path){ return FS.rmdir(path); }
+	virtual bool listDir(const char* path, Storage_DirCallback callback, void* context);
+};
+
+/**
+ * @brief The SD card over SPI.
+ */
+class SD_Storage : public FS_Storage {
+private:
+	/** The SD library handle. */
+	SDFS& SD_FS;
+
+public:
+	SD_Storage(SDFS& sd) : FS_Storage(sd), SD_FS(sd) {}
+
+	virtual const char* name() const { return "SD"; }
+	virtual bool begin();
+	virtual void end(){ SD_FS.end(); }
+	/** @brief Checks the card detect switch. */
+	virtual bool present(){ return !digitalRead(SD_DETECT_PIN); }
+	virtual uint64_t totalBytes(){ return SD_FS.totalBytes(); }
+	virtual uint64_t usedBytes(){ return SD_FS.usedBytes(); }
+
+	/** @brief Returns the type of the mounted card. */
+	sdcard_type_t cardType(){ return SD_FS.cardType(); }
+	/** @brief Returns the size of the mounted card in bytes. */
+	uint64_t cardSize(){ return SD_FS.cardSize(); }
+};
+
+/**
+ * @brief LittleFS on the internal flash.
+ * The flash is much smaller than an SD card, so it is only meant to keep the latest logs when the card is absent.
+ */
+class LittleFS_Storage : public FS_Storage {
+private:
+	/** The LittleFS library handle. */
+	fs::LittleFSFS& LFS;
+
+public:
+	LittleFS_Storage(fs::LittleFSFS& lfs) : FS_Storage(lfs), LFS(lfs) {}
+
+	virtual const char* name() const { return "LittleFS"; }
+	/** @brief Mounts the partition, it is formatted when STORAGE_FLASH_FORMAT is set and it can not be mounted. */
+	virtual bool begin(){ return LFS.begin(STORAGE_FLASH_FORMAT); }
+	virtual void end(){ LFS.end(); }
+	/** @brief The internal flash is always present. */
+	virtual bool present(){ return true; }
+	virtual uint64_t totalBytes(){ return LFS.totalBytes(); }
+	virtual uint64_t usedBytes(){ return LFS.usedBytes(); }
+};
\ No newline at end of file
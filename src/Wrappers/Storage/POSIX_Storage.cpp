@@ -0,0 +1,127 @@
+#include "POSIX_Storage.h"
+
+#include <string.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#ifndef ARDUINO
+#include <sys/statvfs.h>
+#endif
+
+size_t POSIX_StorageFile::size(){
+	fflush(file); // the size of the file does not include the buffered data.
+	struct stat st;
+	if(fstat(fileno(file), &st)){return 0;}
+	return st.st_size;
+}
+
+POSIX_Storage::POSIX_Storage(const char* dir){
+	size_t len = strlen(dir);
+	if(len >= sizeof(root)){len = sizeof(root) - 1;}
+	while(len && dir[len - 1] == '/'){len--;}
+	memcpy(root, dir, len);
+	root[len] = '\0';
+}
+
+bool POSIX_Storage::fullPath(char* out, const char* path) const {
+	int n = snprintf(out, STORAGE_PATH_SIZE, "%s%s%s", root, path[0] == '/' ? "" : "/", path);
+	return n > 0 && n < STORAGE_PATH_SIZE;
+}
+
+bool POSIX_Storage::begin(){
+	if(root[0] && !present()){
+		::mkdir(root, 0777);
+	}
+	return present();
+}
+
+bool POSIX_Storage::present(){
+	struct stat st;
+	return !stat(root[0] ? root : "/", &st) && S_ISDIR(st.st_mode);
+}
+
+StorageFile POSIX_Storage::open(const char* path, StorageMode mode){
+	char full[STORAGE_PATH_SIZE];
+	if(!fullPath(full, path)){return StorageFile();}
+	const char* fmode = "rb";
+	switch(mode){
+		case StorageMode::Read:   fmode = "rb";  break;
+		case StorageMode::Write:  fmode = "wb";  break;
+		case StorageMode::Append: fmode = "ab";  break;
+		case StorageMode::Update: fmode = "r+b"; break;
+	}
+	FILE* file = fopen(full, fmode);
+	if(!file){return StorageFile();}
+	return StorageFile(new POSIX_StorageFile(file));
+}
+
+bool POSIX_Storage::exists(const char* path){
+	char full[STORAGE_PATH_SIZE];
+	struct stat st;
+	return fullPath(full, path) && !stat(full, &st);
+}
+
+bool POSIX_Storage::remove(const char* path){
+	char full[STORAGE_PATH_SIZE];
+	return fullPath(full, path) && !unlink(full);
+}
+
+bool POSIX_Storage::rename(const char* from, const char* to){
+	char full_from[STORAGE_PATH_SIZE];
+	char full_to[STORAGE_PATH_SIZE];
+	return fullPath(full_from, from) && fullPath(full_to, to) && !::rename(full_from, full_to);
+}
+
+bool POSIX_Storage::mkdir(const char* path){
+	char full[STORAGE_PATH_SIZE];
+	return fullPath(full, path) && !::mkdir(full, 0777);
+}
+
+bool POSIX_Storage::rmdir(const char* path){
+	char full[STORAGE_PATH_SIZE];
+	return fullPath(full, path) && !::rmdir(full);
+}
+
+bool POSIX_Storage::listDir(const char* path, Storage_DirCallback callback, void* context){
+	char full[STORAGE_PATH_SIZE];
+	if(!fullPath(full, path)){return false;}
+	DIR* dir = opendir(full);
+	if(!dir){return false;}
+
+	// the callback gets the path relative to the root, like the other storages.
+	size_t dir_len = strlen(path);
+	while(dir_len && path[dir_len - 1] == '/'){dir_len--;}
+	char entry_path[STORAGE_PATH_SIZE];
+	struct dirent* entry;
+	while((entry = readdir(dir)) != NULL){
+		if(!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")){continue;}
+		int n = snprintf(entry_path, sizeof(entry_path), "%.*s/%s", (int)dir_len, path, entry->d_name);
+		if(n <= 0 || n >= (int)sizeof(entry_path) || !fullPath(full, entry_path)){continue;}
+		struct stat st;
+		if(stat(full, &st)){continue;}
+		bool is_dir = S_ISDIR(st.st_mode);
+		if(!callback(entry_path, is_dir, is_dir ? 0 : (size_t)st.st_size, context)){
+			break;
+		}
+	}
+	closedir(dir);
+	return true;
+}
+
+#ifndef ARDUINO
+uint64_t POSIX_Storage::totalBytes(){
+	struct statvfs st;
+	if(statvfs(root[0] ? root : "/", &st)){return 0;}
+	return (uint64_t)st.f_blocks * st.f_frsize;
+}
+
+uint64_t POSIX_Storage::usedBytes(){
+	struct statvfs st;
+	if(statvfs(root[0] ? root : "/", &st)){return 0;}
+	return (uint64_t)(st.f_blocks - st.f_bavail) * st.f_frsize;
+}
+#else
+// the ESP32 VFS has no statvfs(), use the library of the mounted file system for the free space.
+uint64_t POSIX_Storage::totalBytes(){ return 0; }
+uint64_t POSIX_Storage::usedBytes(){ return 0; }
+#endif
\ No newline at end of file
@@ -0,0 +1,80 @@
+/**
+ * @file POSIX_Storage.h
+ * @author Imre Korf
+ * @brief Storage in a directory that is accessed with the C library.
+ * @version 0.1
+ * @date 2022-03-09
+ *
+ * On a host this runs the storage code of the SenseBox against a normal directory, for tests and benchmarks.
+ * On the ESP32 it can be used on a file system that is mounted in the VFS, for example "/sd" or "/littlefs".
+ * This file only uses the standard library, so it can be compiled for a host.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include "iStorage.h"
+#include "../../Defines/Defines.h"
+
+#include <stdio.h>
+
+/**
+ * @brief File opened with the C library.
+ */
+class POSIX_StorageFile : public iStorageFile {
+private:
+	/** The opened file. */
+	FILE* file;
+
+public:
+	POSIX_StorageFile(FILE* opened) : file(opened) {}
+	virtual ~POSIX_StorageFile(){ fclose(file); }
+
+	virtual size_t read(uint8_t* buffer, size_t len){ return fread(buffer, 1, len, file); }
+	virtual size_t write(const uint8_t* data, size_t len){ return fwrite(data, 1, len, file); }
+	virtual bool seek(size_t pos){ return !fseek(file, (long)pos, SEEK_SET); }
+	virtual size_t size();
+	virtual void flush(){ fflush(file); }
+};
+
+/**
+ * @brief Storage in a directory, the paths of the storage are relative to this directory.
+ */
+class POSIX_Storage : public iStorage {
+private:
+	/** The root directory, without a trailing '/'. */
+	char root[STORAGE_PATH_SIZE];
+
+	/**
+	 * @brief Puts the root directory in front of the given path.
+	 * @return true the full path fits in the buffer.
+	 */
+	bool fullPath(char* out, const char* path) const;
+
+public:
+	/**
+	 * @brief Creates a storage in the given directory.
+	 * @param dir the root directory, is created by begin() when it does not exist.
+	 */
+	POSIX_Storage(const char* dir);
+
+	virtual const char* name() const { return "POSIX"; }
+	virtual bool begin();
+	virtual void end(){}
+	/** @brief Returns true when the root directory exists. */
+	virtual bool present();
+
+	virtual StorageFile open(const char* path, StorageMode mode);
+	virtual bool exists(const char* path);
+	virtual bool remove(const char* path);
+	virtual bool rename(const char* from, const char* to);
+	virtual bool mkdir(const char* path);
+	virtual bool rmdir(const char* path);
+	virtual bool listDir(const char* path, Storage_DirCallback callback, void* context);
+
+	/** @brief Returns the size of the file system that holds the root directory, 0 when it is unknown. */
+	virtual uint64_t totalBytes();
+	/** @brief Returns the used space of the file system that holds the root directory, 0 when it is unknown. */
+	virtual uint64_t usedBytes();
+};
\ No newline at end of file
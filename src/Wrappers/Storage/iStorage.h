@@ -0,0 +1,151 @@
+/**
+ * @file iStorage.h
+ * @author Imre Korf
+ * @brief Interface for the file systems that __W_SD can store its files on.
+ * @version 0.1
+ * @date 2022-03-09
+ *
+ * Implementations:
+ * Class | Storage
+ * :-----:|:-----------------------------:
+ *  SD_Storage | SD card over SPI
+ *  LittleFS_Storage | LittleFS on the internal flash, used when the SD card is absent
+ *  POSIX_Storage | a directory accessed with the C library, used on a host for tests and benchmarks
+ *
+ * This file only uses the standard library, so the interface can also be compiled for a host.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+
+/**
+ * @brief The ways a file can be opened.
+ */
+enum class StorageMode : uint8_t {
+	/** Read only, the file must exist. */
+	Read,
+	/** Write only, the file is created or emptied. */
+	Write,
+	/** Write only at the end of the file, the file is created if it does not exist. */
+	Append,
+	/** Read and write anywhere in the file, the file must exist. */
+	Update
+};
+
+/**
+ * @brief Interface of an opened file, implemented by every storage.
+ * The file is closed when the object is destroyed.
+ */
+class iStorageFile {
+public:
+	virtual ~iStorageFile(){}
+	/** @brief Reads up to len bytes, returns the amount of bytes read. */
+	virtual size_t read(uint8_t* buffer, size_t len) = 0;
+	/** @brief Writes len bytes, returns the amount of bytes written. */
+	virtual size_t write(const uint8_t* data, size_t len) = 0;
+	/** @brief Moves the position to pos bytes from the start of the file. */
+	virtual bool seek(size_t pos) = 0;
+	/** @brief Returns the size of the file in bytes. */
+	virtual size_t size() = 0;
+	/** @brief Writes the buffered data to the storage. */
+	virtual void flush() = 0;
+};
+
+/**
+ * @brief Handle to an opened file, returned by iStorage::open().
+ * Can be moved but not copied, the file is closed when the handle is destroyed or close() is called.
+ */
+class StorageFile {
+private:
+	/** The opened file, empty when no file is open. */
+	std::unique_ptr<iStorageFile> file;
+
+public:
+	StorageFile(){}
+	explicit StorageFile(iStorageFile* opened) : file(opened) {}
+
+	/** @brief Returns true when a file is open. */
+	explicit operator bool() const { return (bool)file; }
+
+	/** @brief Reads up to len bytes, returns the amount of bytes read. */
+	size_t read(uint8_t* buffer, size_t len){ return file ? file->read(buffer, len) : 0; }
+	/** @brief Writes len bytes, returns the amount of bytes written. */
+	size_t write(const uint8_t* data, size_t len){ return file ? file->write(data, len) : 0; }
+	/** @brief Writes a string without its terminator, returns the amount of bytes written. */
+	size_t print(const char* text);
+	/** @brief Moves the position to pos bytes from the start of the file. */
+	bool seek(size_t pos){ return file ? file->seek(pos) : false; }
+	/** @brief Returns the size of the file in bytes. */
+	size_t size(){ return file ? file->size() : 0; }
+	/** @brief Writes the buffered data to the storage. */
+	void flush(){ if(file){ file->flush(); } }
+	/** @brief Closes the file. */
+	void close(){ file.reset(); }
+};
+
+inline size_t StorageFile::print(const char* text){
+	size_t len = 0;
+	while(text[len]){len++;}
+	return write((const uint8_t*)text, len);
+}
+
+/**
+ * @brief Callback that receives the entries of a directory listed by iStorage::listDir().
+ * @param path the path of the entry.
+ * @param is_dir true if the entry is a directory.
+ * @param size the size of the file in bytes, 0 for directories.
+ * @param context the context pointer passed to listDir().
+ * @return true to continue listing, false to stop.
+ */
+typedef bool (*Storage_DirCallback)(const char* path, bool is_dir, size_t size, void* context);
+
+/**
+ * @brief Interface of a file system.
+ * All paths start with a '/' and are relative to the root of the storage.
+ */
+class iStorage {
+public:
+	virtual ~iStorage(){}
+
+	/** @brief Returns the name of the storage, used in log messages. */
+	virtual const char* name() const = 0;
+	/** @brief Mounts the storage, returns true when it can be used. */
+	virtual bool begin() = 0;
+	/** @brief Unmounts the storage. Files that are still open become invalid. */
+	virtual void end() = 0;
+	/** @brief Returns true when the medium is available, for example when the SD card is inserted. */
+	virtual bool present() = 0;
+
+	/**
+	 * @brief Opens a file.
+	 * @param path the path to the file.
+	 * @param mode the way the file is opened.
+	 * @return StorageFile handle to the file, which is false when the file could not be opened.
+	 */
+	virtual StorageFile open(const char* path, StorageMode mode) = 0;
+	/** @brief Returns true when the file or directory exists. */
+	virtual bool exists(const char* path) = 0;
+	/** @brief Removes a file. */
+	virtual bool remove(const char* path) = 0;
+	/** @brief Renames or moves a file. */
+	virtual bool rename(const char* from, const char* to) = 0;
+	/** @brief Creates a directory, the parent directory must exist. */
+	virtual bool mkdir(const char* path) = 0;
+	/** @brief Removes an empty directory. */
+	virtual bool rmdir(const char* path) = 0;
+	/**
+	 * @brief Calls the callback for every entry of a directory, not recursive.
+	 * @return false when the path could not be opened or is not a directory.
+	 */
+	virtual bool listDir(const char* path, Storage_DirCallback callback, void* context) = 0;
+
+	/** @brief Returns the size of the storage in bytes. */
+	virtual uint64_t totalBytes() = 0;
+	/** @brief Returns the used space of the storage in bytes. */
+	virtual uint64_t usedBytes() = 0;
+};
\ No newline at end of file
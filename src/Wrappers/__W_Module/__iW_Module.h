@@ -12,6 +12,7 @@
 
 #include <Arduino.h>
 #include "../../Defines/Defines.h"
+#include "../../Scheduler/Scheduler.h"
 
 /**
  * @brief Interface for a hardware module
@@ -19,8 +20,9 @@
  * hardware module should be implemented as a singleton to ensure 
  * that there won't be two processes accessing the same hardware at the same time
  * Singleton format: https://stackoverflow.com/a/1008289
+ * Sensors implement the iTask functions so they can be measured by the Scheduler without blocking.
  */
-class __iW_Module {
+class __iW_Module : public iTask {
 protected:
 	/**
 	 * @brief The Initialized flag is used to keep track of the state of the Module.